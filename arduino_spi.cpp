@@ -1,9 +1,6 @@
 #include "arduino_spi.h"
 #include <SPI.h>
 
-#define SPI_TYPE	1			//1: select hardware SPI, depond on platform 
-								//0: select software GPIO simulate SPI,
-
 /**********************************************************
 **Name: 	vSpiInit
 **Func: 	Init Spi Config
@@ -3,6 +3,11 @@
 
 #include <arduino.h>
 
+#ifndef SPI_TYPE
+#define SPI_TYPE	1			//1: select hardware SPI, depond on platform 
+								//0: select software GPIO simulate SPI,
+#endif
+
 //Dirver hardware I/O define
 #define MISO			12	
 #define MOSI			11
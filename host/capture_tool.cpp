@@ -0,0 +1,644 @@
+/************************Description************************
+  Capture files (rfm26_capture.cpp) on the host: make, index,
+  filter and replay them.
+
+    gen      a capture the driver writes itself: one node on
+             the radio emulator with RFM26_SetCapture on, fed
+             random frames, sending now and then
+    index    block index next to the capture (file.idx): per
+             4096 records the offset, time span, kinds, CRC
+             status, RSSI range and channels; an index is
+             extended, not rebuilt, as the capture grows
+    filter   records matching kind, channel, RSSI, CRC status
+             and time; blocks that cannot match are skipped
+             whole; matches can be printed or written out as a
+             new capture
+    replay   Rx records fed back into the emulator at their
+             times (or back to back), read by the driver
+             through RFM26_Hal_Xfer with receive_message(); the
+             driver's own capture of the replay must give the
+             same payload and RSSI, else the run fails
+
+  The capture is read through mmap. A torn record fails its
+  check byte and the reader moves on to the next sync byte.
+  Timestamps are micros() of the device and are unwrapped to
+  64 bits while reading; gaps over 35 minutes are lost.
+
+  Built with -DRFM26_INSTRUMENT=1 and ../rfm26_instr.cpp added,
+  replay also shows the driver's own counters: SPI traffic,
+  commands and CTS polls per opcode, errors, the last commands.
+
+  Build:  g++ -O2 -I.. -o capture_tool capture_tool.cpp rfm26_emu.cpp ../rfm26_driver.cpp \
+              ../rfm26_energy.cpp ../rfm26_capture.cpp ../rfm26_config.cpp ../rfm26_profiles.cpp \
+              ../rfm26_cal.cpp ../rfm26_snap.cpp
+  Usage:  capture_tool gen out.cap [frames]
+          capture_tool index file.cap
+          capture_tool filter file.cap [-k rx|tx|armed] [-c chan] [-r min_rssi] [-s none|ok|bad]
+                       [-t from_s to_s] [-p] [-o out.cap]
+          capture_tool replay file.cap [filter options] [-f]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rfm26_emu.h"
+#include "rfm26_driver.h"
+
+#define IDX_MAGIC		"R26I"
+#define IDX_VERSION		1
+#define IDX_BLOCK_RECORDS	4096								// records per index block
+
+typedef struct
+{
+  uint64_t offset;                                        // first record
+  uint64_t end;                                           // byte after the last record
+  int64_t  t_start;                                       // unwrap state before the first record
+  int64_t  t_min, t_max;                                  // us, unwrapped
+  uint32_t records;
+  uint8_t  kinds;                                         // bit per C_CAP_xxx kind
+  uint8_t  status;                                        // bit per C_CAP_CRC_xxx >> 2
+  uint8_t  rssi_min, rssi_max;
+  uint8_t  chan[32];                                      // bit per channel
+} IDX_BLOCK;
+
+typedef struct
+{
+  char     magic[4];
+  uint32_t version;
+  uint32_t block_records;
+  uint32_t reserved;
+  uint64_t indexed;                                       // capture bytes covered
+  uint64_t records;
+  uint64_t skipped;                                       // bytes not part of a valid record
+  uint64_t blocks;
+} IDX_HDR;
+
+typedef struct
+{
+  const uint8_t* p;
+  uint64_t size;
+  int      fd;
+} CAP_MAP;
+
+typedef struct
+{
+  int      kind;                                          // -1 any
+  int      chan;
+  int      rssi_min;
+  int      status;
+  double   from_s, to_s;
+  int      print;
+  const char* out;
+  int      fast;                                          // replay back to back
+} CAP_FILTER;
+
+static double fTool_Now(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int iTool_Map(const char* name, CAP_MAP* m)
+{
+  struct stat st;
+
+  m->fd = open(name, O_RDONLY);
+  if (m->fd < 0 || fstat(m->fd, &st) < 0) {
+    fprintf(stderr, "cannot read %s\n", name);
+    return 0;
+  }
+  m->size = (uint64_t)st.st_size;
+  m->p = m->size ? (const uint8_t*)mmap(0, m->size, PROT_READ, MAP_PRIVATE, m->fd, 0) : 0;
+  if (m->size && m->p == (const uint8_t*)MAP_FAILED) {
+    fprintf(stderr, "cannot map %s\n", name);
+    return 0;
+  }
+  if (m->size)
+    madvise((void*)m->p, m->size, MADV_SEQUENTIAL);
+  if (m->size < RFM26_CAP_FILE_HDR || memcmp(m->p, RFM26_CAP_MAGIC, 4) || m->p[4] != RFM26_CAP_VERSION) {
+    fprintf(stderr, "%s is not a version %d capture\n", name, RFM26_CAP_VERSION);
+    return 0;
+  }
+  return 1;
+}
+
+static void vTool_Unmap(CAP_MAP* m)
+{
+  if (m->size)
+    munmap((void*)m->p, m->size);
+  close(m->fd);
+}
+
+/**********************************************************
+**Name:     lTool_Next
+**Function: Next valid record at or after pos, resyncing on
+            the sync byte over anything torn
+**Output:   its offset, size if none; skipped bytes added up
+**********************************************************/
+static uint64_t lTool_Next(const CAP_MAP* m, uint64_t pos, uint64_t end, RFM26_CAP_REC* r, uint16_t* n,
+                           uint64_t* skipped)
+{
+  while (pos < end) {
+    *n = RFM26_Cap_Parse(m->p + pos, (uint32_t)(end - pos < 0xFFFF ? end - pos : 0xFFFF), r);
+    if (*n)
+      return pos;
+    const uint8_t* s = (const uint8_t*)memchr(m->p + pos + 1, RFM26_CAP_SYNC, end - pos - 1);
+    uint64_t next = s ? (uint64_t)(s - m->p) : end;
+    *skipped += next - pos;
+    pos = next;
+  }
+  return end;
+}
+
+static void vTool_Unwrap(int64_t* t, uint32_t raw)
+{
+  *t += (int32_t)(raw - (uint32_t)*t);                    // small steps back are Tx logged after START_TX
+}
+
+/**********************************************************
+**Name:     iTool_Index
+**Function: Load the index of a capture, extend it over what
+            was appended since, write it back if it changed
+**Output:   1 if ok
+**********************************************************/
+static int iTool_Index(const char* name, const CAP_MAP* m, IDX_HDR* h, std::vector<IDX_BLOCK>* blk, int verbose)
+{
+  std::string iname = std::string(name) + ".idx";
+  FILE* f = fopen(iname.c_str(), "rb");
+  uint64_t pos;
+  int64_t t;
+  double t0 = fTool_Now();
+
+  blk->clear();
+  memset(h, 0, sizeof(*h));
+  if (f) {
+    if (fread(h, sizeof(*h), 1, f) == 1 && !memcmp(h->magic, IDX_MAGIC, 4) && h->version == IDX_VERSION &&
+        h->block_records == IDX_BLOCK_RECORDS && h->indexed <= m->size) {
+      blk->resize(h->blocks);
+      if (h->blocks && fread(&(*blk)[0], sizeof(IDX_BLOCK), h->blocks, f) != h->blocks)
+        blk->clear();
+    }
+    fclose(f);
+    if (blk->size() != h->blocks)
+      memset(h, 0, sizeof(*h));                           // unreadable, start over
+  }
+  if (h->indexed == m->size && h->blocks) {
+    if (verbose)
+      printf("%s up to date\n", iname.c_str());
+    return 1;
+  }
+  memcpy(h->magic, IDX_MAGIC, 4);
+  h->version = IDX_VERSION;
+  h->block_records = IDX_BLOCK_RECORDS;
+
+  // the last block may be partial: index again from its start
+  pos = RFM26_CAP_FILE_HDR;
+  t = 0;
+  if (!blk->empty()) {
+    IDX_BLOCK& b = blk->back();
+    h->records -= b.records;
+    pos = b.offset;
+    t = b.t_start;
+    if (b.records == IDX_BLOCK_RECORDS) {
+      pos = b.end;
+      h->records += b.records;
+      t = b.t_max;                                        // unwrap state is the last record's time
+    } else {
+      blk->pop_back();
+    }
+  }
+  uint64_t from = pos;
+  RFM26_CAP_REC r;
+  uint16_t n;
+  int first = h->records == 0;
+
+  while ((pos = lTool_Next(m, pos, m->size, &r, &n, &h->skipped)) < m->size) {
+    if (blk->empty() || blk->back().records == IDX_BLOCK_RECORDS) {
+      IDX_BLOCK b;
+      memset(&b, 0, sizeof(b));
+      b.offset = pos;
+      b.t_start = t;
+      b.rssi_min = 0xFF;
+      blk->push_back(b);
+    }
+    IDX_BLOCK& b = blk->back();
+    if (first) {
+      t = r.t_us;                                         // time starts at the first record
+      b.t_start = t;
+      first = 0;
+    }
+    vTool_Unwrap(&t, r.t_us);
+    if (b.records == 0 || t < b.t_min)
+      b.t_min = t;
+    if (b.records == 0 || t > b.t_max)
+      b.t_max = t;
+    b.kinds |= 1 << r.kind;
+    b.status |= 1 << (r.status >> 2);
+    if (r.rssi < b.rssi_min)
+      b.rssi_min = r.rssi;
+    if (r.rssi > b.rssi_max)
+      b.rssi_max = r.rssi;
+    b.chan[r.channel / 8] |= 1 << (r.channel % 8);
+    b.records++;
+    h->records++;
+    pos += n;
+    b.end = pos;
+  }
+  h->indexed = m->size;
+  h->blocks = blk->size();
+
+  f = fopen(iname.c_str(), "wb");
+  if (!f || fwrite(h, sizeof(*h), 1, f) != 1 ||
+      (h->blocks && fwrite(&(*blk)[0], sizeof(IDX_BLOCK), h->blocks, f) != h->blocks)) {
+    fprintf(stderr, "cannot write %s\n", iname.c_str());
+    if (f)
+      fclose(f);
+    return 0;
+  }
+  fclose(f);
+  if (verbose) {
+    double s = fTool_Now() - t0;
+    printf("%s: %llu records in %llu blocks, %llu bytes skipped; indexed %.1f MB in %.3f s (%.0f MB/s)\n",
+           iname.c_str(), (unsigned long long)h->records, (unsigned long long)h->blocks,
+           (unsigned long long)h->skipped, (m->size - from) / 1e6, s, (m->size - from) / 1e6 / (s > 0 ? s : 1e-9));
+  }
+  return 1;
+}
+
+static int iTool_BlockMay(const IDX_BLOCK* b, const CAP_FILTER* q, int64_t t0)
+{
+  if (q->kind >= 0 && !(b->kinds & (1 << q->kind)))
+    return 0;
+  if (q->status >= 0 && !(b->status & (1 << (q->status >> 2))))
+    return 0;
+  if (q->chan >= 0 && !(b->chan[q->chan / 8] & (1 << (q->chan % 8))))
+    return 0;
+  if (q->rssi_min >= 0 && b->rssi_max < q->rssi_min)
+    return 0;
+  if (b->t_max - t0 < q->from_s * 1e6 || b->t_min - t0 > q->to_s * 1e6)
+    return 0;
+  return 1;
+}
+
+static int iTool_Match(const RFM26_CAP_REC* r, int64_t t, const CAP_FILTER* q, int64_t t0)
+{
+  return (q->kind < 0 || r->kind == q->kind) && (q->status < 0 || r->status == q->status) &&
+         (q->chan < 0 || r->channel == q->chan) && (q->rssi_min < 0 || r->rssi >= q->rssi_min) &&
+         t - t0 >= q->from_s * 1e6 && t - t0 <= q->to_s * 1e6;
+}
+
+typedef void (*TOOL_EACH)(void* ctx, const RFM26_CAP_REC* r, int64_t t, const uint8_t* raw, uint16_t n);
+
+/**********************************************************
+**Name:     lTool_Scan
+**Function: Call each for every record matching q, blocks that
+            cannot match skipped with the index
+**Output:   matching records; blocks read in *read
+**********************************************************/
+static uint64_t lTool_Scan(const CAP_MAP* m, const std::vector<IDX_BLOCK>& blk, const CAP_FILTER* q, TOOL_EACH each,
+                           void* ctx, uint64_t* read)
+{
+  uint64_t hits = 0, skipped = 0;
+  int64_t t0 = blk.empty() ? 0 : blk[0].t_start;
+
+  *read = 0;
+  for (size_t i = 0; i < blk.size(); i++) {
+    const IDX_BLOCK& b = blk[i];
+    if (!iTool_BlockMay(&b, q, t0))
+      continue;
+    (*read)++;
+    uint64_t pos = b.offset;
+    int64_t t = b.t_start;
+    RFM26_CAP_REC r;
+    uint16_t n;
+    while ((pos = lTool_Next(m, pos, b.end, &r, &n, &skipped)) < b.end) {
+      vTool_Unwrap(&t, r.t_us);
+      if (iTool_Match(&r, t, q, t0)) {
+        hits++;
+        each(ctx, &r, t - t0, m->p + pos, n);
+      }
+      pos += n;
+    }
+  }
+  return hits;
+}
+
+/**********************************************************
+  filter
+**********************************************************/
+
+typedef struct
+{
+  FILE*    out;
+  int      print;
+  uint64_t bytes;
+} TOOL_FILTER_CTX;
+
+static void vTool_FilterEach(void* ctx, const RFM26_CAP_REC* r, int64_t t, const uint8_t* raw, uint16_t n)
+{
+  TOOL_FILTER_CTX* c = (TOOL_FILTER_CTX*)ctx;
+  static const char* const kind[4] = { "rx", "tx", "armed", "?" };
+  static const char* const status[4] = { "", " crc ok", " crc bad", " ?" };
+
+  c->bytes += n;
+  if (c->out)
+    fwrite(raw, 1, n, c->out);
+  if (c->print) {
+    printf("%12.6f %-5s ch %3u rssi %3u%s :", t / 1e6, kind[r->kind], r->channel, r->rssi, status[r->status >> 2]);
+    for (uint8_t i = 0; i < r->len; i++)
+      printf(" %02X", r->data[i]);
+    printf("\n");
+  }
+}
+
+/**********************************************************
+  gen: the driver writes the capture
+**********************************************************/
+
+static uint8_t bTool_FileWrite(void* ctx, const uint8_t* p, uint16_t n)
+{
+  return fwrite(p, 1, n, (FILE*)ctx) == n;
+}
+
+static uint32_t gl_Rand = 0x7A3C91E5;
+
+static uint32_t lTool_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+// one frame on air at the node ending at t (moved later if the chip was busy), read by the driver
+static uint8_t bTool_Feed(RFM26_EMU* e, double t, const uint8_t* data, uint8_t len, double dbm, uint8_t* out)
+{
+  double since = RFM26_Emu_RxSince(e);
+
+  if (since < 0)
+    return 0;
+  if (t < since + RFM26_Emu_Airtime(e, len))
+    t = since + RFM26_Emu_Airtime(e, len);
+  if (t < e->now)
+    t = e->now;
+  RFM26_Emu_Enter(e, t);
+  if (!RFM26_Emu_Receive(e, t, data, len, dbm, 1))
+    return 0;
+  return receive_message(out);
+}
+
+static int iTool_Gen(const char* name, uint64_t frames)
+{
+  FILE* f = fopen(name, "wb");
+  RFM26_EMU e;
+  RFM26_CAPTURE c;
+  uint8_t data[RFM26_PKT_LEN], buf[RFM26_PKT_LEN];
+  double t0 = fTool_Now(), t;
+
+  if (!f) {
+    fprintf(stderr, "cannot write %s\n", name);
+    return 1;
+  }
+  setvbuf(f, 0, _IOFBF, 1 << 20);
+  RFM26_Emu_Init(&e, 0, 0, 0);
+  RFM26_Emu_Enter(&e, 0);
+  RFM26_EntryRx();
+  RFM26_Cap_Init(&c, bTool_FileWrite, f, 0);
+  RFM26_Cap_Start(&c);
+  RFM26_SetCapture(&c);
+  t = e.now;
+  for (uint64_t k = 0; k < frames; k++) {
+    for (uint8_t i = 0; i < RFM26_PKT_LEN; i++)
+      data[i] = (uint8_t)lTool_Rand();
+    t += 200000 + lTool_Rand() % 2000000;                 // 0.2 to 2.2 s apart
+    if (k % 16 == 15) {                                   // answer now and then
+      RFM26_Emu_Enter(&e, t);
+      RFM26_SetINT_CTL(0x01, 0x30, 0x00, 0x00);
+      send_message(data, RFM26_PKT_LEN);
+      RFM26_Emu_Enter(&e, e.tx_end);                      // PACKET_SENT
+      RFM26_GetTxStamp();
+      RFM26_ChangeToRxMode(RFM26_PKT_LEN);
+      t = e.now;
+      continue;
+    }
+    bTool_Feed(&e, t, data, RFM26_PKT_LEN, -120 + (lTool_Rand() % 800) / 10.0, buf);
+  }
+  RFM26_SetCapture(0);
+  fclose(f);
+  double s = fTool_Now() - t0;
+  printf("%s: %u records, %u dropped, %.1f s of radio time, written in %.2f s (%.0f records/s)\n", name,
+         c.records, c.dropped, (t - 0) / 1e6, s, c.records / s);
+  return c.dropped != 0;
+}
+
+/**********************************************************
+  replay: captured Rx frames back through the driver
+**********************************************************/
+
+typedef struct
+{
+  RFM26_EMU e;
+  double   base;                                          // emulator time of capture time 0
+  int      fast;
+  uint64_t fed, read, missed, other_len, mismatch;
+  uint8_t  last[RFM26_CAP_MAX_LEN];                       // what the driver captured last
+  uint8_t  last_len, last_rssi;
+  uint8_t  got;
+} TOOL_REPLAY;
+
+static uint8_t bTool_ReplayWrite(void* ctx, const uint8_t* p, uint16_t n)
+{
+  TOOL_REPLAY* r = (TOOL_REPLAY*)ctx;
+
+  if (n == RFM26_CAP_HDR) {
+    r->last_len = 0;
+    r->last_rssi = p[3];
+    r->got = 1;
+  } else if (r->last_len + n <= RFM26_CAP_MAX_LEN) {
+    memcpy(r->last + r->last_len, p, n);
+    r->last_len += (uint8_t)n;
+  }
+  return 1;
+}
+
+static void vTool_ReplayEach(void* ctx, const RFM26_CAP_REC* r, int64_t t, const uint8_t* raw, uint16_t n)
+{
+  TOOL_REPLAY* p = (TOOL_REPLAY*)ctx;
+  uint8_t buf[RFM26_PKT_LEN];
+
+  (void)raw;
+  (void)n;
+  if (r->kind != C_CAP_RX)
+    return;
+  if (r->len != RFM26_PKT_LEN) {
+    p->other_len++;                                       // the driver reads fixed length frames
+    return;
+  }
+  p->fed++;
+  p->got = 0;
+  if (!bTool_Feed(&p->e, p->fast ? 0 : p->base + t, r->data, r->len, r->rssi / 2.0 - 134, buf)) {
+    p->missed++;
+    return;
+  }
+  p->read++;
+  if (!p->got || p->last_len != r->len || memcmp(p->last, r->data, r->len) || memcmp(buf, r->data, r->len) ||
+      p->last_rssi != r->rssi)
+    p->mismatch++;
+}
+
+#if RFM26_INSTRUMENT
+static void vTool_Instr(const RFM26_INSTR* s, uint64_t frames)
+{
+  RFM26_TRACE t[RFM26_TRACE_DEPTH];
+  double f = frames ? (double)frames : 1;
+  uint8_t i, n;
+
+  printf("\ndriver: %u SPI bytes in %u transfers, %u commands, %u CTS polls (at most %u for one, %u timeouts)\n",
+         s->spi_bytes, s->spi_xfers, s->cmds, s->cts_polls, s->cts_max, s->cts_timeouts);
+  printf("        %u FIFO errors, %u command errors, %u CRC errors, %u Rx edges missed\n", s->fifo_errors,
+         s->cmd_errors, s->crc_errors, s->rx_missed);
+  printf("  opcode  per frame  CTS polls per command\n");
+  for (i = 0; i < RFM26_INSTR_OPS; i++)
+    if (s->op_count[i])
+      printf("    %02X %12.2f %10.2f\n", RFM26_Instr_Op(i), s->op_count[i] / f, (double)s->op_cts[i] / s->op_count[i]);
+  n = RFM26_Instr_Trace(s, t);
+  printf("  last %u commands: t us, opcode, first argument, CTS polls\n", n);
+  for (i = 0; i < n; i++)
+    printf("    %10u  %02X %02X %5u\n", t[i].t_us, t[i].op, t[i].arg, t[i].cts);
+}
+#endif
+
+static int iTool_Replay(const CAP_MAP* m, const std::vector<IDX_BLOCK>& blk, const CAP_FILTER* q)
+{
+  static TOOL_REPLAY p;
+  RFM26_CAPTURE c;
+  uint64_t read;
+  double t0;
+
+  memset(&p, 0, sizeof(p));
+  p.fast = q->fast;
+  RFM26_Emu_Init(&p.e, 0, 0, 0);
+  RFM26_Emu_Enter(&p.e, 0);
+  RFM26_EntryRx();
+  p.base = p.e.now + 1000;
+#if RFM26_INSTRUMENT
+  RFM26_ClearInstr();
+#endif
+  RFM26_Cap_Init(&c, bTool_ReplayWrite, &p, 0);
+  RFM26_SetCapture(&c);
+  t0 = fTool_Now();
+  lTool_Scan(m, blk, q, vTool_ReplayEach, &p, &read);
+  double s = fTool_Now() - t0;
+  RFM26_SetCapture(0);
+  printf("replayed %llu Rx frames (%llu not 21 bytes): %llu read by the driver, %llu not listening, "
+         "%llu differ\n", (unsigned long long)p.fed, (unsigned long long)p.other_len, (unsigned long long)p.read,
+         (unsigned long long)p.missed, (unsigned long long)p.mismatch);
+  printf("%.1f s of radio time in %.2f s: %.0f frames/s, %.0f SPI bytes per frame\n", p.e.now / 1e6, s,
+         p.fed / (s > 0 ? s : 1e-9), p.fed ? (double)p.e.stats.spi_bytes / p.fed : 0.0);
+#if RFM26_INSTRUMENT
+  vTool_Instr(RFM26_GetInstr(), p.fed);
+#endif
+  return p.mismatch != 0;
+}
+
+static void vTool_Usage(const char* me)
+{
+  fprintf(stderr, "usage: %s gen out.cap [frames]\n"
+                  "       %s index file.cap\n"
+                  "       %s filter file.cap [-k rx|tx|armed] [-c chan] [-r min_rssi] [-s none|ok|bad]\n"
+                  "                 [-t from_s to_s] [-p] [-o out.cap]\n"
+                  "       %s replay file.cap [filter options] [-f]\n", me, me, me, me);
+}
+
+int main(int argc, char** argv)
+{
+  CAP_FILTER q = { -1, -1, -1, -1, -1e18, 1e18, 0, 0, 0 };
+  CAP_MAP m;
+  IDX_HDR h;
+  std::vector<IDX_BLOCK> blk;
+
+  if (argc < 3) {
+    vTool_Usage(argv[0]);
+    return 1;
+  }
+  if (!strcmp(argv[1], "gen"))
+    return iTool_Gen(argv[2], argc > 3 ? strtoull(argv[3], 0, 0) : 1000000);
+
+  for (int i = 3; i < argc; i++) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : 0;
+    if (!strcmp(a, "-k") && v) {
+      q.kind = !strcmp(v, "rx") ? C_CAP_RX : !strcmp(v, "tx") ? C_CAP_TX : !strcmp(v, "armed") ? C_CAP_TX_ARMED : -2;
+      i++;
+    } else if (!strcmp(a, "-s") && v) {
+      q.status = !strcmp(v, "none") ? C_CAP_CRC_NONE : !strcmp(v, "ok") ? C_CAP_CRC_OK :
+                 !strcmp(v, "bad") ? C_CAP_CRC_BAD : -2;
+      i++;
+    } else if (!strcmp(a, "-c") && v) {
+      q.chan = atoi(v) & 0xFF;
+      i++;
+    } else if (!strcmp(a, "-r") && v) {
+      q.rssi_min = atoi(v);
+      i++;
+    } else if (!strcmp(a, "-t") && v && i + 2 < argc) {
+      q.from_s = atof(v);
+      q.to_s = atof(argv[i + 2]);
+      i += 2;
+    } else if (!strcmp(a, "-o") && v) {
+      q.out = v;
+      i++;
+    } else if (!strcmp(a, "-p")) {
+      q.print = 1;
+    } else if (!strcmp(a, "-f")) {
+      q.fast = 1;
+    } else {
+      vTool_Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (q.kind == -2 || q.status == -2) {
+    vTool_Usage(argv[0]);
+    return 1;
+  }
+  if (!iTool_Map(argv[2], &m) || !iTool_Index(argv[2], &m, &h, &blk, !strcmp(argv[1], "index")))
+    return 1;
+
+  int rc = 0;
+  if (!strcmp(argv[1], "index")) {
+    if (!blk.empty())
+      printf("%.1f s from first to last record\n", (blk.back().t_max - blk[0].t_start) / 1e6);
+  } else if (!strcmp(argv[1], "filter")) {
+    TOOL_FILTER_CTX c = { 0, q.print, 0 };
+    uint64_t read;
+    if (q.out) {
+      c.out = fopen(q.out, "wb");
+      if (!c.out) {
+        fprintf(stderr, "cannot write %s\n", q.out);
+        return 1;
+      }
+      setvbuf(c.out, 0, _IOFBF, 1 << 20);
+      fwrite("R26C\x01\0\0\0", 1, RFM26_CAP_FILE_HDR, c.out);
+    }
+    double t0 = fTool_Now();
+    uint64_t hits = lTool_Scan(&m, blk, &q, vTool_FilterEach, &c, &read);
+    double s = fTool_Now() - t0;
+    if (c.out)
+      fclose(c.out);
+    printf("%llu of %llu records match, %llu of %llu blocks read; %.3f s, %.0f MB/s of capture\n",
+           (unsigned long long)hits, (unsigned long long)h.records, (unsigned long long)read,
+           (unsigned long long)blk.size(), s, m.size / 1e6 / (s > 0 ? s : 1e-9));
+  } else if (!strcmp(argv[1], "replay")) {
+    rc = iTool_Replay(&m, blk, &q);
+  } else {
+    vTool_Usage(argv[0]);
+    rc = 1;
+  }
+  vTool_Unmap(&m);
+  return rc;
+}
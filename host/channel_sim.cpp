@@ -0,0 +1,543 @@
+/************************Description************************
+  Discrete event RF channel with many RFM26 nodes, each one
+  running the unmodified driver on the Si446x emulator
+  (rfm26_emu.cpp).
+
+  Nodes are placed at random in a square. Every node boots
+  with RFM26_EntryRx, then sends a 21 byte frame at random
+  (exponential) intervals the way rfm26.cpp does:
+  RFM26_SetINT_CTL for PACKET_SENT, send_message(), and back
+  to Rx with RFM26_ChangeToRxMode once RFM26_GetTxStamp() says
+  the frame is out. Received frames are read with
+  receive_message() from the nIRQ edge. The payload carries an
+  application CRC-16 (rfm26_crc.cpp), since the driver config
+  has the packet handler CRC off.
+
+  Channel, per link:
+    path loss   31.2 + 10 n log10(d) dB (868MHz free space at
+                1m), plus log-normal shadowing, same both ways
+    power       Tx dBm from PA_PWR_LVL, on the frequency the
+                chip is tuned to; airtime from the preamble,
+                sync word, CRC and data rate properties
+    lock        a listening receiver locks on a frame at or
+                above sensitivity and capture ratio over noise
+                and everything else on air; a stronger frame
+                taking over during the preamble and sync word
+                steals the lock
+    outcome     the locked frame is good if it stayed capture
+                ratio above the worst interference it met; a
+                bad frame reaches the chip with bits flipped
+
+  Per link (receiver at or above sensitivity when the frame
+  starts) a frame is delivered, collided (lost to interference
+  or the lock stolen), blocked (receiver locked on another
+  frame) or busy (receiver not in Rx, or left it). Delivered
+  and bad frames must show up exactly in the application's
+  own counts, else the run fails.
+
+  Build:  g++ -O2 -c -I.. ../rfm26_driver.cpp
+          objcopy --set-section-flags .bss=alloc,load,contents,data \
+                  --rename-section .data=rfm26_state \
+                  --rename-section .bss=rfm26_state rfm26_driver.o
+          g++ -O2 -I.. -o channel_sim channel_sim.cpp rfm26_emu.cpp rfm26_driver.o \
+              ../rfm26_energy.cpp ../rfm26_crc.cpp ../rfm26_capture.cpp \
+              ../rfm26_config.cpp ../rfm26_profiles.cpp ../rfm26_cal.cpp ../rfm26_snap.cpp
+  Usage:  channel_sim [nodes] [seconds] [period_s] [area_m] [exponent] [capture_db]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <queue>
+#include <chrono>
+
+#include "rfm26_emu.h"
+#include "rfm26_driver.h"
+#include "rfm26_crc.h"
+
+#define NOISE_DBM		-120.0								// noise floor in the Rx bandwidth
+#define SENS_DBM		-110.0								// sensitivity at 2.4kbps
+#define SHADOW_DB		4.0									// shadowing sigma
+#define NEAR_DB			10.0								// links this far under noise are left out
+#define DIST_BIN_M		100									// delivery by distance
+#define DIST_BINS		10
+
+enum { EV_FRAME_END, EV_FRAME_START, EV_SEND, EV_BOOT };
+
+typedef struct
+{
+  int      to;
+  float    loss;                                          // dB
+  float    dist;                                          // m
+} SIM_LINK;
+
+typedef struct
+{
+  RFM26_EMU emu;
+  double   x, y;
+  std::vector<SIM_LINK> nb;
+  uint16_t seq;
+  uint8_t  tx_busy;                                       // send_message() done, PACKET_SENT not yet seen
+  int      lock;                                          // frame locked on, -1 for none
+  double   lock_mw;
+  float    lock_dist;
+  double   air_mw;                                        // all frames on air here, mW
+  unsigned air_n;
+  double   worst_mw;                                      // worst interference to the locked frame
+  unsigned app_ok, app_bad, skipped;
+} SIM_NODE;
+
+typedef struct
+{
+  int      node;
+  double   start, end, sync_end;                          // sync_end: a stronger frame can steal the lock until then
+  double   dbm;
+  uint32_t chan;
+  uint16_t len;
+  uint8_t  data[RFM26_EMU_FIFO];
+} SIM_FRAME;
+
+typedef struct
+{
+  double   t;
+  uint64_t seq;
+  int      type;
+  int      node;
+  int      arg;
+} SIM_EV;
+
+struct SimLater
+{
+  bool operator()(const SIM_EV& a, const SIM_EV& b) const
+  {
+    if (a.t != b.t)
+      return a.t > b.t;
+    if (a.type != b.type)
+      return a.type > b.type;                             // a frame ending frees the air for one starting
+    return a.seq > b.seq;
+  }
+};
+
+typedef struct
+{
+  uint64_t links, delivered, captured, collided, blocked, busy;
+  uint64_t bad_rx;                                        // bad frames handed to a chip
+  uint64_t bin_links[DIST_BINS + 1], bin_ok[DIST_BINS + 1];
+  uint64_t frames, events;
+} SIM_STATS;
+
+static std::vector<SIM_NODE> gt_Node;
+static std::vector<SIM_FRAME> gt_Frame;
+static std::vector<int> gt_FrameFree;
+static std::priority_queue<SIM_EV, std::vector<SIM_EV>, SimLater> gt_Queue;
+static uint64_t gl_EvSeq = 0;
+static SIM_STATS gt_Stats;
+static double gf_Capture;                                 // capture ratio, linear
+static double gf_Period;                                  // mean send interval, us
+static double gf_End;                                     // us
+static RFM26_CRC gt_AppCrc;
+static uint32_t gl_Rand = 0x2545F491;
+
+static uint32_t lSim_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static double fSim_Uniform(void)
+{
+  return (lSim_Rand() + 0.5) / 4294967296.0;
+}
+
+static double fSim_Normal(void)
+{
+  return sqrt(-2 * log(fSim_Uniform())) * cos(2 * M_PI * fSim_Uniform());
+}
+
+static double fSim_MilliWatt(double dbm)
+{
+  return pow(10.0, dbm / 10);
+}
+
+static void vSim_Event(double t, int type, int node, int arg)
+{
+  SIM_EV ev = { t, gl_EvSeq++, type, node, arg };
+
+  gt_Queue.push(ev);
+}
+
+static int iSim_Node(const RFM26_EMU* e)
+{
+  return (int)(((const char*)e - (const char*)&gt_Node[0].emu) / sizeof(SIM_NODE));
+}
+
+// START_TX of any node: the frame goes on air
+static void vSim_Tx(void* ctx, RFM26_EMU* e, double start, double end, const uint8_t* data, uint16_t len)
+{
+  int f;
+
+  (void)ctx;
+  if (!gt_FrameFree.empty()) {
+    f = gt_FrameFree.back();
+    gt_FrameFree.pop_back();
+  } else {
+    f = (int)gt_Frame.size();
+    gt_Frame.push_back(SIM_FRAME());
+  }
+  SIM_FRAME& fr = gt_Frame[f];
+  fr.node = iSim_Node(e);
+  fr.start = start;
+  fr.end = end;
+  fr.sync_end = start + RFM26_Emu_Airtime(e, 0);
+  fr.dbm = RFM26_Emu_TxDbm(e);
+  fr.chan = RFM26_Emu_Channel(e);
+  fr.len = len;
+  memcpy(fr.data, data, len);
+  gt_Stats.frames++;
+  vSim_Event(start, EV_FRAME_START, fr.node, f);
+  vSim_Event(end, EV_FRAME_END, fr.node, f);
+}
+
+static int iSim_Bin(float dist)
+{
+  int b = (int)(dist / DIST_BIN_M);
+
+  return b > DIST_BINS ? DIST_BINS : b;
+}
+
+/**********************************************************
+  Application on every node, driver calls only
+**********************************************************/
+
+static void vApp_Send(SIM_NODE* n, int id)
+{
+  uint8_t buf[RFM26_PKT_LEN];
+  uint8_t i;
+
+  if (n->tx_busy) {
+    n->skipped++;
+    return;
+  }
+  buf[0] = (uint8_t)(id >> 8);
+  buf[1] = (uint8_t)id;
+  buf[2] = (uint8_t)(n->seq >> 8);
+  buf[3] = (uint8_t)n->seq;
+  for (i = 4; i < RFM26_PKT_LEN - 2; i++)
+    buf[i] = (uint8_t)(id * 7 + n->seq + i);
+  RFM26_Crc_Put(&gt_AppCrc, RFM26_Crc_Calc(&gt_AppCrc, buf, RFM26_PKT_LEN - 2), buf + RFM26_PKT_LEN - 2);
+  n->seq++;
+  RFM26_SetINT_CTL(0x01, 0x30, 0x00, 0x00);               // PACKET_SENT and PACKET_RX
+  send_message(buf, RFM26_PKT_LEN);
+  n->tx_busy = 1;
+}
+
+// nIRQ went low
+static void vApp_Irq(SIM_NODE* n)
+{
+  uint8_t buf[RFM26_PKT_LEN];
+
+  if (n->tx_busy) {
+    if (RFM26_GetTxStamp()) {
+      n->tx_busy = 0;
+      RFM26_ChangeToRxMode(RFM26_PKT_LEN);
+    }
+    return;
+  }
+  if (receive_message(buf)) {
+    if (RFM26_Crc_Check(&gt_AppCrc, buf, RFM26_PKT_LEN - 2))
+      n->app_ok++;
+    else
+      n->app_bad++;
+  }
+}
+
+/**********************************************************
+  Channel
+**********************************************************/
+
+static void vSim_FrameStart(int f)
+{
+  const SIM_FRAME& fr = gt_Frame[f];
+  const SIM_NODE& s = gt_Node[fr.node];
+
+  for (size_t k = 0; k < s.nb.size(); k++) {
+    const SIM_LINK& l = s.nb[k];
+    SIM_NODE& r = gt_Node[l.to];
+    double dbm = fr.dbm - l.loss;
+    double mw = fSim_MilliWatt(dbm);
+    uint8_t heard = dbm >= SENS_DBM;
+    uint8_t listen = RFM26_Emu_Listen(&r.emu, fr.start) == fr.chan;
+
+    r.air_mw += mw;
+    r.air_n++;
+    if (!heard) {
+      if (r.lock >= 0 && r.air_mw - r.lock_mw > r.worst_mw)
+        r.worst_mw = r.air_mw - r.lock_mw;
+      continue;
+    }
+    gt_Stats.links++;
+    gt_Stats.bin_links[iSim_Bin(l.dist)]++;
+    if (!listen) {
+      gt_Stats.busy++;
+      continue;
+    }
+    if (mw < gf_Capture * (fSim_MilliWatt(NOISE_DBM) + r.air_mw - mw)) {
+      if (r.lock >= 0) {
+        gt_Stats.blocked++;
+        if (r.air_mw - r.lock_mw > r.worst_mw)
+          r.worst_mw = r.air_mw - r.lock_mw;
+      } else {
+        gt_Stats.collided++;
+      }
+      continue;
+    }
+    if (r.lock >= 0) {
+      if (fr.start >= gt_Frame[r.lock].sync_end) {        // past sync: the receiver stays on its frame
+        gt_Stats.blocked++;
+        if (r.air_mw - r.lock_mw > r.worst_mw)
+          r.worst_mw = r.air_mw - r.lock_mw;
+        continue;
+      }
+      gt_Stats.collided++;                                // lock stolen
+    }
+    r.lock = f;
+    r.lock_mw = mw;
+    r.lock_dist = l.dist;
+    r.worst_mw = r.air_mw - mw;
+  }
+}
+
+static void vSim_FrameEnd(int f)
+{
+  const SIM_FRAME& fr = gt_Frame[f];
+  SIM_NODE& s = gt_Node[fr.node];
+
+  for (size_t k = 0; k < s.nb.size(); k++) {
+    SIM_NODE& r = gt_Node[s.nb[k].to];
+
+    if (--r.air_n == 0)
+      r.air_mw = 0;                                       // no rounding left behind
+    else
+      r.air_mw -= fSim_MilliWatt(fr.dbm - s.nb[k].loss);
+    if (r.lock != f)
+      continue;
+    r.lock = -1;
+
+    double since = RFM26_Emu_RxSince(&r.emu);
+    uint8_t ok = r.lock_mw >= gf_Capture * (fSim_MilliWatt(NOISE_DBM) + r.worst_mw);
+    uint8_t data[RFM26_EMU_FIFO];
+
+    if (since < 0 || since > fr.start) {
+      gt_Stats.busy++;                                    // left Rx during the frame
+      continue;
+    }
+    memcpy(data, fr.data, fr.len);
+    if (!ok) {
+      unsigned bit[3], flips = 1 + lSim_Rand() % 3;
+      for (unsigned b = 0; b < flips; b++) {
+        bit[b] = lSim_Rand() % (fr.len * 8u);
+        if ((b > 0 && bit[b] == bit[0]) || (b > 1 && bit[b] == bit[1]))
+          b--;                                            // distinct bits, a double flip is no error
+        else
+          data[bit[b] / 8] ^= (uint8_t)(1 << (bit[b] % 8));
+      }
+    }
+    RFM26_Emu_Enter(&r.emu, fr.end);
+    if (!RFM26_Emu_Receive(&r.emu, fr.end, data, fr.len, 10 * log10(r.lock_mw), ok)) {
+      gt_Stats.busy++;
+      continue;
+    }
+    if (ok) {
+      gt_Stats.delivered++;
+      gt_Stats.captured += r.worst_mw > 0;
+      gt_Stats.bin_ok[iSim_Bin(r.lock_dist)]++;
+    } else {
+      gt_Stats.collided++;
+      gt_Stats.bad_rx++;
+    }
+    vApp_Irq(&r);
+  }
+  RFM26_Emu_Enter(&s.emu, fr.end);                        // PACKET_SENT
+  vApp_Irq(&s);
+  gt_FrameFree.push_back(f);
+}
+
+static void vSim_Place(double area, double exponent, double tx_dbm)
+{
+  size_t n = gt_Node.size();
+  double reach = tx_dbm - (NOISE_DBM - NEAR_DB);
+
+  for (size_t i = 0; i < n; i++) {
+    gt_Node[i].x = fSim_Uniform() * area;
+    gt_Node[i].y = fSim_Uniform() * area;
+  }
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = i + 1; j < n; j++) {
+      double dx = gt_Node[i].x - gt_Node[j].x, dy = gt_Node[i].y - gt_Node[j].y;
+      double d = sqrt(dx * dx + dy * dy);
+      double loss = 31.2 + 10 * exponent * log10(d < 1 ? 1 : d) + SHADOW_DB * fSim_Normal();
+      if (loss > reach)
+        continue;
+      SIM_LINK a = { (int)j, (float)loss, (float)d }, b = { (int)i, (float)loss, (float)d };
+      gt_Node[i].nb.push_back(a);
+      gt_Node[j].nb.push_back(b);
+    }
+}
+
+static double fSim_Now(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv)
+{
+  int nodes = argc > 1 ? atoi(argv[1]) : 1000;
+  double seconds = argc > 2 ? atof(argv[2]) : 3600;
+  double period = argc > 3 ? atof(argv[3]) : 60;
+  double area = argc > 4 ? atof(argv[4]) : 5000;
+  double exponent = argc > 5 ? atof(argv[5]) : 3.5;
+  double capture = argc > 6 ? atof(argv[6]) : 6;
+
+  if (nodes < 2 || nodes > 65535 || seconds <= 0 || seconds > 4000 || period <= 0 || area <= 0 || exponent < 2 ||
+      capture < 0) {
+    fprintf(stderr, "usage: %s [nodes] [seconds<=4000] [period_s] [area_m] [exponent>=2] [capture_db]\n", argv[0]);
+    return 1;
+  }
+  gf_Capture = fSim_MilliWatt(capture);
+  gf_Period = period * 1e6;
+  gf_End = seconds * 1e6;
+  RFM26_Crc_Init(&gt_AppCrc, C_CRC_SEED_ONES | C_CRC_CCITT_16, C_PKT_CRC_ENDIAN);
+
+  if (!RFM26_Emu_Swaps()) {
+    fprintf(stderr, "driver globals are not kept per node, build rfm26_driver.o as shown in %s\n", __FILE__);
+    return 1;
+  }
+  double t0 = fSim_Now();
+  gt_Node.resize(nodes);
+  for (int i = 0; i < nodes; i++) {
+    SIM_NODE& n = gt_Node[i];
+    RFM26_Emu_Init(&n.emu, 0, vSim_Tx, 0);
+    n.seq = 0;
+    n.tx_busy = 0;
+    n.lock = -1;
+    n.air_mw = 0;
+    n.air_n = 0;
+    n.app_ok = n.app_bad = n.skipped = 0;
+    vSim_Event(fSim_Uniform() * 1e6, EV_BOOT, i, 0);
+  }
+
+  // boot the first node now to learn the configured power and airtime
+  SIM_EV first = gt_Queue.top();
+  gt_Queue.pop();
+  RFM26_Emu_Enter(&gt_Node[first.node].emu, first.t);
+  RFM26_EntryRx();
+  vSim_Event(gt_Node[first.node].emu.now - log(fSim_Uniform()) * gf_Period, EV_SEND, first.node, 0);
+  double air = RFM26_Emu_Airtime(&gt_Node[first.node].emu, RFM26_PKT_LEN);
+  double tx_dbm = RFM26_Emu_TxDbm(&gt_Node[first.node].emu);
+  vSim_Place(area, exponent, tx_dbm);
+
+  double t1 = fSim_Now();
+  while (!gt_Queue.empty() && gt_Queue.top().t < gf_End) {
+    SIM_EV ev = gt_Queue.top();
+    gt_Queue.pop();
+    gt_Stats.events++;
+    switch (ev.type) {
+      case EV_BOOT:
+        RFM26_Emu_Enter(&gt_Node[ev.node].emu, ev.t);
+        RFM26_EntryRx();
+        vSim_Event(gt_Node[ev.node].emu.now - log(fSim_Uniform()) * gf_Period, EV_SEND, ev.node, 0);
+        break;
+      case EV_SEND:
+        RFM26_Emu_Enter(&gt_Node[ev.node].emu, ev.t);
+        vApp_Send(&gt_Node[ev.node], ev.node);
+        vSim_Event(ev.t - log(fSim_Uniform()) * gf_Period, EV_SEND, ev.node, 0);
+        break;
+      case EV_FRAME_START:
+        vSim_FrameStart(ev.arg);
+        break;
+      case EV_FRAME_END:
+        vSim_FrameEnd(ev.arg);
+        break;
+    }
+  }
+  double t2 = fSim_Now();
+
+  // totals
+  RFM26_EMU_STATS es;
+  uint64_t app_ok = 0, app_bad = 0, skipped = 0, nb = 0, heard = 0;
+  uint64_t spi = 0, cmds = 0, polls = 0, cts_busy = 0, unknown = 0, fifo_err = 0;
+  double uj = 0, rx_ms = 0, tx_ms = 0;
+
+  memset(&es, 0, sizeof(es));
+  for (int i = 0; i < nodes; i++) {
+    SIM_NODE& n = gt_Node[i];
+    RFM26_ENERGY_REPORT r;
+    app_ok += n.app_ok;
+    app_bad += n.app_bad;
+    skipped += n.skipped;
+    nb += n.nb.size();
+    for (size_t k = 0; k < n.nb.size(); k++)
+      heard += tx_dbm - n.nb[k].loss >= SENS_DBM;
+    spi += n.emu.stats.spi_bytes;
+    cmds += n.emu.stats.commands;
+    polls += n.emu.stats.cts_polls;
+    cts_busy += n.emu.stats.cts_busy;
+    unknown += n.emu.stats.unknown;
+    fifo_err += n.emu.stats.fifo_err;
+    RFM26_Emu_Enter(&n.emu, gf_End);
+    RFM26_GetEnergyReport(&r);
+    uj += r.total_uj;
+    rx_ms += r.ms[C_ENERGY_RX];
+    for (int k = C_ENERGY_TX; k < RFM26_ENERGY_STATES; k++)
+      tx_ms += r.ms[k];
+  }
+  for (int i = 0; i < nodes; i++)
+    RFM26_Emu_Free(&gt_Node[i].emu);
+
+  double mean_heard = (double)heard / nodes;
+  printf("%d nodes in %.0f m square, %.0f s, a frame every %.0f s each, path loss exponent %.1f, "
+         "shadowing %.0f dB, capture %.0f dB\n", nodes, area, seconds, period, exponent, SHADOW_DB, capture);
+  printf("%.1f dBm, %.1f ms on air; %.1f neighbours at or above %.0f dBm, %.0f in the model; "
+         "offered load per neighbourhood %.3f Erlang\n\n", tx_dbm, air / 1000, mean_heard, SENS_DBM,
+         (double)nb / nodes, (mean_heard + 1) * air / gf_Period);
+
+  SIM_STATS& s = gt_Stats;
+  double links = s.links ? (double)s.links : 1;
+  printf("frames sent %llu, skipped (previous Tx not done) %llu\n", (unsigned long long)s.frames,
+         (unsigned long long)skipped);
+  printf("links %llu: delivered %.2f%% (%.2f%% over interference), collided %.2f%%, blocked %.2f%%, "
+         "busy %.2f%%\n", (unsigned long long)s.links, 100 * s.delivered / links, 100 * s.captured / links,
+         100 * s.collided / links, 100 * s.blocked / links, 100 * s.busy / links);
+  printf("application: %llu good, %llu failed CRC\n\n", (unsigned long long)app_ok, (unsigned long long)app_bad);
+
+  printf("distance m   links     delivered\n");
+  for (int b = 0; b <= DIST_BINS; b++) {
+    if (!s.bin_links[b])
+      continue;
+    char name[16];
+    if (b < DIST_BINS)
+      snprintf(name, sizeof(name), "%d-%d", b * DIST_BIN_M, (b + 1) * DIST_BIN_M);
+    else
+      snprintf(name, sizeof(name), ">%d", b * DIST_BIN_M);
+    printf("%-10s %8llu  %8.2f%%\n", name, (unsigned long long)s.bin_links[b], 100.0 * s.bin_ok[b] / s.bin_links[b]);
+  }
+
+  printf("\nper node: %.0f SPI bytes, %.0f commands, %.0f CTS polls, %.1f commands before CTS, "
+         "%llu unknown, %llu FIFO errors in all\n", (double)spi / nodes, (double)cmds / nodes, (double)polls / nodes,
+         (double)cts_busy / nodes, (unsigned long long)unknown, (unsigned long long)fifo_err);
+  printf("driver energy per node: %.2f J, Rx %.0f s, Tx %.1f s\n", uj / nodes / 1e6, rx_ms / nodes / 1000,
+         tx_ms / nodes / 1000);
+  printf("\nsetup %.1f s, run %.1f s: %.0f simulated s per s, %.0f events/s\n", t1 - t0, t2 - t1,
+         seconds / (t2 - t1), s.events / (t2 - t1));
+
+  if (app_ok != s.delivered || app_bad != s.bad_rx) {
+    printf("\nFAIL: channel delivered %llu good and %llu bad frames, application saw %llu and %llu\n",
+           (unsigned long long)s.delivered, (unsigned long long)s.bad_rx, (unsigned long long)app_ok,
+           (unsigned long long)app_bad);
+    return 1;
+  }
+  return 0;
+}
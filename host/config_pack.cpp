@@ -0,0 +1,259 @@
+/************************Description************************
+  Builds rfm26_profiles.cpp, the radio configuration as the
+  encoded program memory streams of rfm26_config.cpp.
+
+  The base stream is RADIO_CONFIGURATION_DATA_ARRAY from
+  rfm26_wds.h. A profile per RFM26RateTbl row holds only the
+  properties that row sets to other values than the base.
+  Every stream is decoded back and has to give the chip what
+  the raw table gives it: the same commands other than
+  SET_PROPERTY in the same order, and every property written
+  to the same value. Then the sizes: the table in flash and in
+  AVR SRAM before and after, commands and command bytes
+  per configuration.
+
+  Without -o the streams are checked against the ones built in
+  from rfm26_profiles.cpp; they differ when rfm26_wds.h or the
+  rate table changed and the file was not made again.
+
+  Build:  g++ -O2 -I.. -o config_pack config_pack.cpp ../rfm26_config.cpp ../rfm26_profiles.cpp
+  Usage:  config_pack [-o ../rfm26_profiles.cpp]
+**********************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "rfm26_config.h"
+#include "rfm26_wds.h"
+
+static const uint8_t gb_Table[] = RADIO_CONFIGURATION_DATA_ARRAY;
+
+static const char* const gs_Rate[4] = {"1.2Kbps", "2.4Kbps", "4.8Kbps", "9.6Kbps"};
+
+//What a chip ends up with: properties by group and number, other commands in order
+typedef struct
+{
+  int prop[256][256];                                     // -1 never written
+  std::vector<std::vector<uint8_t> > raw;
+  unsigned cmds, bytes;
+} CHIP;
+
+static void vPack_Clear(CHIP* c)
+{
+  memset(c->prop, 0xFF, sizeof(c->prop));
+  c->raw.clear();
+  c->cmds = c->bytes = 0;
+}
+
+static void vPack_Apply(CHIP* c, const uint8_t* cmd, uint8_t n)
+{
+  c->cmds++;
+  c->bytes += n;
+  if (cmd[0] == 0x11) {
+    for (uint8_t i = 0; i < cmd[2]; i++)
+      c->prop[cmd[1]][(uint8_t)(cmd[3] + i)] = cmd[4 + i];
+  } else {
+    c->raw.push_back(std::vector<uint8_t>(cmd, cmd + n));
+  }
+}
+
+static void vPack_ApplyTable(CHIP* c, const uint8_t* t)
+{
+  for (unsigned i = 0; t[i]; i += 1 + t[i])
+    vPack_Apply(c, t + i + 1, t[i]);
+}
+
+// decodes through the same reader ParameterConfig uses
+static void vPack_ApplyStream(CHIP* c, const uint8_t* s)
+{
+  RFM26_CFG_RD r;
+  uint8_t cmd[RFM26_CFG_MAX_CMD];
+  uint8_t n;
+
+  RFM26_Cfg_Begin(&r, s);
+  while ((n = RFM26_Cfg_Next(&r, cmd)) != 0)
+    vPack_Apply(c, cmd, n);
+}
+
+static int iPack_Same(const CHIP* a, const CHIP* b)
+{
+  return !memcmp(a->prop, b->prop, sizeof(a->prop)) && a->raw == b->raw;
+}
+
+// table setting a rate row, in the layout RFM26_SetParameter_Rate writes it
+static void vPack_RateTable(uint8_t r, std::vector<uint8_t>* t)
+{
+  static const uint8_t start[2] = {0x03, 0x22}, count[2] = {3, 7};
+  uint8_t k = 0;
+
+  t->clear();
+  for (int j = 0; j < 2; j++) {
+    t->push_back((uint8_t)(4 + count[j]));
+    t->push_back(0x11);
+    t->push_back(0x20);                                   // PROP_MODEM_GROUP
+    t->push_back(count[j]);
+    t->push_back(start[j]);
+    for (uint8_t i = 0; i < count[j]; i++)
+      t->push_back(RFM26RateTbl[r][k++]);
+  }
+  t->push_back(0);
+}
+
+// one SET_PROPERTY per property where want differs from base, the encoder joins neighbours
+static void vPack_Diff(const CHIP* base, const CHIP* want, std::vector<uint8_t>* t)
+{
+  t->clear();
+  for (int g = 0; g < 256; g++)
+    for (int p = 0; p < 256; p++)
+      if (want->prop[g][p] >= 0 && want->prop[g][p] != base->prop[g][p]) {
+        uint8_t cmd[6] = {5, 0x11, (uint8_t)g, 1, (uint8_t)p, (uint8_t)want->prop[g][p]};
+        t->insert(t->end(), cmd, cmd + 6);
+      }
+  t->push_back(0);
+}
+
+static void vPack_Write(FILE* f, const std::vector<uint8_t>& base, const std::vector<std::vector<uint8_t> >& prof,
+                        unsigned raw_bytes, unsigned raw_cmds, unsigned cmds)
+{
+  unsigned ofs = 0;
+
+  fprintf(f, "#include \"rfm26_config.h\"\n\n");
+  fprintf(f, "/************************Description************************\n");
+  fprintf(f, "  Generated by host/config_pack from rfm26_wds.h and\n");
+  fprintf(f, "  RFM26RateTbl, do not edit; run config_pack -o again when\n");
+  fprintf(f, "  either changes.\n");
+  fprintf(f, "**********************************************************/\n\n");
+  fprintf(f, "//WDS table, %u bytes raw, %u encoded", raw_bytes, (unsigned)base.size());
+  if (cmds != raw_cmds)
+    fprintf(f, "; %u commands sent as %u", raw_cmds, cmds);
+  fprintf(f, "\n");
+  fprintf(f, "const uint8_t RFM26CfgBase[] CFG_ROM = {\n");
+  for (size_t i = 0; i < base.size(); i += 12) {
+    fprintf(f, " ");
+    for (size_t j = i; j < i + 12 && j < base.size(); j++)
+      fprintf(f, " 0x%02X,", base[j]);
+    fprintf(f, "\n");
+  }
+  fprintf(f, "};\n\n");
+  fprintf(f, "//Rate profiles, the properties each sets other than the base\n");
+  fprintf(f, "const uint8_t RFM26CfgProfile[] CFG_ROM = {\n");
+  for (size_t r = 0; r < prof.size(); r++) {
+    fprintf(f, "  //%s%s\n", gs_Rate[r], prof[r].size() == 1 ? ", as the base" : "");
+    for (size_t i = 0; i < prof[r].size(); i += 12) {
+      fprintf(f, " ");
+      for (size_t j = i; j < i + 12 && j < prof[r].size(); j++)
+        fprintf(f, " 0x%02X,", prof[r][j]);
+      fprintf(f, "\n");
+    }
+  }
+  fprintf(f, "};\n\n");
+  fprintf(f, "const uint16_t RFM26CfgProfileOfs[RFM26_PROFILES] CFG_ROM = {");
+  for (size_t r = 0; r < prof.size(); r++) {
+    fprintf(f, "%s%u", r ? ", " : "", ofs);
+    ofs += (unsigned)prof[r].size();
+  }
+  fprintf(f, "};\n");
+}
+
+int main(int argc, char** argv)
+{
+  static CHIP want, got, base_chip;
+  std::vector<uint8_t> base(1024), t;
+  std::vector<std::vector<uint8_t> > prof(RFM26_PROFILES);
+  const char* out = 0;
+  unsigned raw_cmds = 0, raw_cmd_bytes, prof_bytes = 0, i;
+  int fail = 0;
+
+  for (int a = 1; a < argc; a++) {
+    if (!strcmp(argv[a], "-o") && a + 1 < argc)
+      out = argv[++a];
+    else {
+      fprintf(stderr, "usage: %s [-o rfm26_profiles.cpp]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // base
+  base.resize(RFM26_Cfg_Encode(gb_Table, &base[0], (uint16_t)base.size()));
+  if (base.empty()) {
+    fprintf(stderr, "rfm26_wds.h: malformed command, or longer than %u bytes\n", RFM26_CFG_MAX_CMD);
+    return 1;
+  }
+  vPack_Clear(&want);
+  vPack_ApplyTable(&want, gb_Table);
+  raw_cmds = want.cmds;
+  raw_cmd_bytes = want.bytes;
+  vPack_Clear(&got);
+  vPack_ApplyStream(&got, &base[0]);
+  if (!iPack_Same(&want, &got)) {
+    fprintf(stderr, "FAIL: the base stream does not decode to the WDS table\n");
+    fail = 1;
+  }
+  base_chip = got;
+
+  // profiles
+  for (uint8_t r = 0; r < RFM26_PROFILES; r++) {
+    vPack_RateTable(r, &t);
+    want = base_chip;
+    vPack_ApplyTable(&want, &t[0]);
+    vPack_Diff(&base_chip, &want, &t);
+    prof[r].resize(64);
+    prof[r].resize(RFM26_Cfg_Encode(&t[0], &prof[r][0], (uint16_t)prof[r].size()));
+    got = base_chip;
+    if (!prof[r].empty())
+      vPack_ApplyStream(&got, &prof[r][0]);
+    if (prof[r].empty() || !iPack_Same(&want, &got)) {
+      fprintf(stderr, "FAIL: profile %s does not decode to its rate row\n", gs_Rate[r]);
+      fail = 1;
+    }
+    prof_bytes += (unsigned)prof[r].size();
+  }
+  if (fail)
+    return 1;
+
+  printf("WDS table     %4u bytes, %u commands, %u command bytes\n", (unsigned)sizeof(gb_Table), raw_cmds,
+         raw_cmd_bytes);
+  printf("base stream   %4u bytes, %u commands, %u command bytes\n", (unsigned)base.size(), base_chip.cmds,
+         base_chip.bytes);
+  for (uint8_t r = 0; r < RFM26_PROFILES; r++)
+    printf("  %-9s   %4u bytes\n", gs_Rate[r], (unsigned)prof[r].size());
+  printf("profiles      %4u bytes, +%u offsets\n", prof_bytes, (unsigned)(2 * RFM26_PROFILES));
+  printf("AVR SRAM      %4u bytes of tables before (WDS %u, freq %u, rate %u, power %u), 0 now\n",
+         (unsigned)(sizeof(gb_Table) + sizeof(RFM26FreqTbl) + sizeof(RFM26RateTbl) + sizeof(RFM26PowerTbl)),
+         (unsigned)sizeof(gb_Table), (unsigned)sizeof(RFM26FreqTbl), (unsigned)sizeof(RFM26RateTbl),
+         (unsigned)sizeof(RFM26PowerTbl));
+  printf("AVR flash     %4u bytes of WDS table before, %u with the profiles now\n", (unsigned)sizeof(gb_Table),
+         (unsigned)(base.size() + prof_bytes + 2 * RFM26_PROFILES));
+
+  if (out) {
+    FILE* f = fopen(out, "w");
+    if (!f) {
+      fprintf(stderr, "cannot write %s\n", out);
+      return 1;
+    }
+    vPack_Write(f, base, prof, (unsigned)sizeof(gb_Table), raw_cmds, base_chip.cmds);
+    if (fclose(f)) {
+      fprintf(stderr, "cannot write %s\n", out);
+      return 1;
+    }
+    printf("wrote %s\n", out);
+    return 0;
+  }
+
+  // against what rfm26_profiles.cpp built in, a stream ends on its first difference or its end byte
+  for (i = 0; i < base.size() && !fail; i++)
+    if (RFM26CfgBase[i] != base[i])
+      fail = 1;
+  for (uint8_t r = 0; r < RFM26_PROFILES; r++) {
+    const uint8_t* s = RFM26_Cfg_Profile(r);
+    for (i = 0; i < prof[r].size() && !fail; i++)
+      if (s[i] != prof[r][i])
+        fail = 1;
+  }
+  if (fail) {
+    printf("rfm26_profiles.cpp is out of date, run config_pack -o ../rfm26_profiles.cpp\n");
+    return 1;
+  }
+  printf("rfm26_profiles.cpp is up to date\n");
+  return 0;
+}
@@ -0,0 +1,211 @@
+/************************Description************************
+  Check and benchmark of the packet handler CRC and PN9
+  whitening (rfm26_crc.cpp).
+
+  1. Correctness: for every PKT_CRC_CONFIG polynomial, both
+     seeds and CRC_INVERT, random lengths must give the same
+     CRC as a bit at a time reference, host (slice-by-8) and
+     MCU (nibble table) code paths alike. Check values of
+     "123456789" are printed for comparison with catalogues.
+     PN9 must match a bit at a time LFSR and undo itself.
+  2. Speed: MB/s of the bitwise reference, the MCU path and
+     slice-by-8 on 21 byte packets and 64KB buffers, and of
+     whitening.
+
+  The MCU path is the same source included a second time with
+  RFM26_CRC_SLICES set to 0.
+
+  Build:  g++ -O2 -I.. -o crc_bench crc_bench.cpp ../rfm26_crc.cpp
+  Usage:  crc_bench [megabytes]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+#include "rfm26_crc.h"
+
+// MCU build of the same file, C names moved out of the way
+namespace mcu {
+#undef HopeDuino_26_CRC_H_
+#undef RFM26_CRC_SLICES
+#define RFM26_CRC_SLICES	0
+#define RFM26_Crc_Init		RFM26_Crc_Init_Mcu
+#define RFM26_Crc_Calc		RFM26_Crc_Calc_Mcu
+#define RFM26_Crc_Put		RFM26_Crc_Put_Mcu
+#define RFM26_Crc_Check		RFM26_Crc_Check_Mcu
+#define RFM26_Pn9_Init		RFM26_Pn9_Init_Mcu
+#define RFM26_Pn9_Apply		RFM26_Pn9_Apply_Mcu
+#include "../rfm26_crc.cpp"
+#undef RFM26_Crc_Init
+#undef RFM26_Crc_Calc
+#undef RFM26_Crc_Put
+#undef RFM26_Crc_Check
+#undef RFM26_Pn9_Init
+#undef RFM26_Pn9_Apply
+}
+#undef RFM26_CRC_SLICES
+#define RFM26_CRC_SLICES	8
+
+static uint32_t gl_Rand = 0x4B1D3A6F;
+
+static uint32_t lBench_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static const struct { uint32_t poly; uint8_t width; const char* name; } gt_Poly[10] = {
+  { 0, 0, "NO_CRC" },              { 0x07, 8, "ITU_T_CRC8" },        { 0x5B13, 16, "IEC_16" },
+  { 0x90D9, 16, "BAICHEVA_16" },   { 0x8005, 16, "CRC_16_IBM" },     { 0x1021, 16, "CCITT_16" },
+  { 0x741B8CD7, 32, "KOOPMAN" },   { 0x04C11DB7, 32, "IEEE_802_3" }, { 0x1EDC6F41, 32, "CASTAGNOLI" },
+  { 0x3D65, 16, "CRC_16_DNP" },
+};
+
+// One bit at a time, right aligned register
+static uint32_t lBench_Crc(uint8_t config, uint8_t pkt_config1, const uint8_t* p, unsigned n)
+{
+  uint8_t k = config & 0x0F;
+  uint8_t w = gt_Poly[k].width;
+  uint32_t mask = w == 32 ? 0xFFFFFFFFUL : (1UL << w) - 1;
+  uint32_t r = (config & C_CRC_SEED_ONES) ? mask : 0;
+
+  if (w == 0)
+    return 0;
+  for (unsigned i = 0; i < n; i++)
+    for (int b = 7; b >= 0; b--) {
+      uint32_t in = (p[i] >> b) & 1, top = (r >> (w - 1)) & 1;
+      r = (r << 1) & mask;
+      if (in ^ top)
+        r ^= gt_Poly[k].poly;
+    }
+  return (pkt_config1 & C_PKT_CRC_INVERT) ? r ^ mask : r;
+}
+
+static void vBench_Pn9(uint16_t seed, uint8_t* p, unsigned n)
+{
+  uint16_t s = seed & 0x1FF;
+
+  for (unsigned i = 0; i < n; i++) {
+    uint8_t key = 0;
+    for (int b = 0; b < 8; b++) {
+      key |= (s & 1) << b;
+      s = (s >> 1) | (((s ^ (s >> 5)) & 1) << 8);
+    }
+    p[i] ^= key;
+  }
+}
+
+static double fBench_Now(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv)
+{
+  double mb = argc > 1 ? atof(argv[1]) : 64;
+  static RFM26_CRC c;
+  static mcu::RFM26_CRC cm;
+  uint8_t buf[600], w1[600], w2[600];
+  int fail = 0;
+
+  if (mb <= 0) {
+    fprintf(stderr, "usage: %s [megabytes]\n", argv[0]);
+    return 1;
+  }
+
+  // 1. correctness
+  printf("polynomial      width  check (seed 0)  check (seed ones)  random lengths\n");
+  for (uint8_t k = 1; k < 10; k++) {
+    unsigned bad = 0;
+    uint32_t chk[2];
+    for (int seed = 0; seed < 2; seed++)
+      for (int inv = 0; inv < 2; inv++) {
+        uint8_t config = k | (seed ? C_CRC_SEED_ONES : 0);
+        uint8_t pc1 = C_PKT_CRC_ENDIAN | (inv ? C_PKT_CRC_INVERT : 0);
+        RFM26_Crc_Init(&c, config, pc1);
+        mcu::RFM26_Crc_Init_Mcu(&cm, config, pc1);
+        if (!inv)
+          chk[seed] = RFM26_Crc_Calc(&c, (const uint8_t*)"123456789", 9);
+        for (int t = 0; t < 2000; t++) {
+          unsigned n = lBench_Rand() % 300;
+          for (unsigned i = 0; i < n; i++)
+            buf[i] = (uint8_t)lBench_Rand();
+          uint32_t want = lBench_Crc(config, pc1, buf, n);
+          bad += RFM26_Crc_Calc(&c, buf, n) != want;
+          bad += mcu::RFM26_Crc_Calc_Mcu(&cm, buf, n) != want;
+          RFM26_Crc_Put(&c, want, buf + n);
+          bad += !RFM26_Crc_Check(&c, buf, n);
+          buf[lBench_Rand() % (n + 1)] ^= 1 << (lBench_Rand() % 8);
+          bad += RFM26_Crc_Check(&c, buf, n) && n > 0 && gt_Poly[k].width >= 16;  // single bit error must be seen
+        }
+      }
+    printf("%-14s  %5u  %14X  %17X  %s\n", gt_Poly[k].name, gt_Poly[k].width, chk[0], chk[1], bad ? "MISMATCH" : "ok");
+    fail |= bad != 0;
+  }
+
+  unsigned pbad = 0;
+  for (int t = 0; t < 2000; t++) {
+    RFM26_PN9 w;
+    mcu::RFM26_PN9 wm;
+    uint16_t seed = t ? lBench_Rand() & 0x1FF : RFM26_PN9_SEED;
+    unsigned n = lBench_Rand() % 600;
+    for (unsigned i = 0; i < n; i++)
+      buf[i] = w1[i] = w2[i] = (uint8_t)lBench_Rand();
+    RFM26_Pn9_Init(&w, seed);
+    mcu::RFM26_Pn9_Init_Mcu(&wm, seed);
+    RFM26_Pn9_Apply(&w, w1, n);
+    mcu::RFM26_Pn9_Apply_Mcu(&wm, w2, n);
+    vBench_Pn9(seed, buf, n);
+    pbad += memcmp(buf, w1, n) != 0 || memcmp(buf, w2, n) != 0;
+    RFM26_Pn9_Apply(&w, w1, n);
+    vBench_Pn9(seed, buf, n);
+    pbad += memcmp(buf, w1, n) != 0;
+  }
+  memset(buf, 0, 8);
+  vBench_Pn9(RFM26_PN9_SEED, buf, 8);
+  printf("\nPN9 seed 0x1FF: %02X %02X %02X %02X %02X %02X %02X %02X ..., random seeds and lengths: %s\n", buf[0],
+         buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7], pbad ? "MISMATCH" : "ok");
+  fail |= pbad != 0;
+
+  // 2. speed, CCITT_16 seed ones as in the direct mode decoder
+  std::vector<uint8_t> big((size_t)(mb * 1048576));
+  for (size_t i = 0; i < big.size(); i++)
+    big[i] = (uint8_t)lBench_Rand();
+  RFM26_Crc_Init(&c, C_CRC_SEED_ONES | C_CRC_CCITT_16, C_PKT_CRC_ENDIAN);
+  mcu::RFM26_Crc_Init_Mcu(&cm, C_CRC_SEED_ONES | C_CRC_CCITT_16, C_PKT_CRC_ENDIAN);
+  volatile uint32_t sink = 0;
+  double t0, ref, nib, s8, s8p, pn;
+
+  t0 = fBench_Now();
+  for (size_t i = 0; i < big.size() / 16; i += 65536)
+    sink ^= lBench_Crc(C_CRC_SEED_ONES | C_CRC_CCITT_16, 0, &big[i], 65536);
+  ref = big.size() / 16 / (fBench_Now() - t0) / 1e6;
+  t0 = fBench_Now();
+  for (size_t i = 0; i + 65536 <= big.size(); i += 65536)
+    sink ^= mcu::RFM26_Crc_Calc_Mcu(&cm, &big[i], 65535);
+  nib = big.size() / (fBench_Now() - t0) / 1e6;
+  t0 = fBench_Now();
+  for (size_t i = 0; i + 65536 <= big.size(); i += 65536)
+    sink ^= RFM26_Crc_Calc(&c, &big[i], 65535);
+  s8 = big.size() / (fBench_Now() - t0) / 1e6;
+  t0 = fBench_Now();
+  for (size_t i = 0; i + 21 <= big.size(); i += 21)
+    sink ^= RFM26_Crc_Calc(&c, &big[i], 21);
+  s8p = big.size() / (fBench_Now() - t0) / 1e6;
+  RFM26_PN9 w;
+  RFM26_Pn9_Init(&w, RFM26_PN9_SEED);
+  t0 = fBench_Now();
+  for (size_t i = 0; i + 65536 <= big.size(); i += 65536)
+    RFM26_Pn9_Apply(&w, &big[i], 65535);
+  pn = big.size() / (fBench_Now() - t0) / 1e6;
+
+  printf("\nCCITT_16 over %.0f MB: bitwise %.0f MB/s, nibble table %.0f MB/s, slice-by-8 %.0f MB/s "
+         "(%.0f MB/s on 21 byte packets); PN9 %.0f MB/s\n", mb, ref, nib, s8, s8p, pn);
+  if (fail)
+    printf("\nFAIL\n");
+  return fail;
+}
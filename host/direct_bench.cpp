@@ -0,0 +1,253 @@
+/************************Description************************
+  Check and benchmark of the direct mode decoder
+  (rfm26_direct.cpp) on recorded bitstreams.
+
+  A capture is the raw bytes the RFM26_Direct ISR would hand
+  to RFM26_Direct_Poll: frames at random bit offsets between
+  stretches of demodulator noise, every bit flipped with the
+  given error rate. Two formats are recorded:
+    manch   RFM26DirectProtoDefault: 0x2DD4 sync, Manchester,
+            length byte, CRC-16
+    nrz     32 bit sync 0x1ACFFC1D, 2 bit errors allowed,
+            inverted on air, 12 fixed bytes, CRC-16
+
+  1. Correctness: every frame must come out of an error free
+     capture, and no frame that passes the CRC may differ from
+     the one sent.
+  2. Speed: host cycles per captured byte, hunting noise and
+     in frames, against the byte period at the bit rate.
+
+  The capture can be saved, and a saved capture (or one dumped
+  from the ring on a board) decoded with -r.
+
+  Build:  g++ -O2 -I.. -o direct_bench direct_bench.cpp ../rfm26_direct.cpp ../rfm26_crc.cpp
+  Usage:  direct_bench [frames] [ber_ppm] [save.bin]
+          direct_bench -r capture.bin [nrz]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "rfm26_direct.h"
+
+#define BITRATE			9600
+#define PREAMBLE_LEN	4									// bytes of 1010 before the sync
+
+static uint32_t gl_Rand = 0x68E31DA4;
+
+static uint32_t lBench_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static uint64_t lBench_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static const RFM26_DIRECT_PROTO gt_Nrz = {
+  0x1ACFFC1D, 32, 2, 0, 1, C_DIRECT_FIXED, 12, C_DIRECT_CRC16,
+};
+
+typedef struct
+{
+  std::vector<uint8_t> bits;                              // one bit per entry, on air order
+  std::vector<std::vector<uint8_t> > sent;                // frames, CRC excluded
+} BENCH_CAPTURE;
+
+static void vBench_Bits(BENCH_CAPTURE* c, uint32_t v, int n)
+{
+  while (n--)
+    c->bits.push_back((v >> n) & 1);
+}
+
+static uint16_t wBench_Crc16(const uint8_t* p, unsigned n)
+{
+  uint16_t crc = 0xFFFF;
+
+  while (n--) {
+    crc ^= (uint16_t)*p++ << 8;
+    for (int i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static void vBench_Frame(BENCH_CAPTURE* c, const RFM26_DIRECT_PROTO* p)
+{
+  std::vector<uint8_t> f;
+  unsigned n = p->len_mode == C_DIRECT_FIXED ? p->fixed_len : 1 + 1 + lBench_Rand() % 40;
+  size_t start;
+
+  for (unsigned i = 0; i < n; i++)
+    f.push_back((uint8_t)lBench_Rand());
+  if (p->len_mode == C_DIRECT_LENBYTE)
+    f[0] = (uint8_t)(n - 1);
+  c->sent.push_back(f);
+  uint16_t crc = wBench_Crc16(&f[0], f.size());
+  f.push_back(crc >> 8);
+  f.push_back((uint8_t)crc);
+
+  start = c->bits.size();
+  for (int i = 0; i < PREAMBLE_LEN; i++)
+    vBench_Bits(c, 0xAA, 8);
+  vBench_Bits(c, p->sync, p->sync_bits);
+  for (size_t i = 0; i < f.size(); i++)
+    for (int k = 7; k >= 0; k--) {
+      uint8_t b = (f[i] >> k) & 1;
+      if (p->manchester)
+        vBench_Bits(c, b ? 2 : 1, 2);
+      else
+        c->bits.push_back(b);
+    }
+  if (p->invert)
+    for (size_t i = start; i < c->bits.size(); i++)
+      c->bits[i] ^= 1;
+}
+
+static std::vector<uint8_t> abBench_Capture(const RFM26_DIRECT_PROTO* p, int frames, double ber, BENCH_CAPTURE* c)
+{
+  std::vector<uint8_t> raw;
+  uint32_t flip = (uint32_t)(ber * 4294967295.0);
+
+  for (int f = 0; f < frames; f++) {
+    unsigned gap = 20 + lBench_Rand() % 200;              // noise, also shifts the frame off byte alignment
+    for (unsigned i = 0; i < gap; i++)
+      c->bits.push_back(lBench_Rand() & 1);
+    vBench_Frame(c, p);
+  }
+  vBench_Bits(c, lBench_Rand(), 32);
+  for (size_t i = 0; i < c->bits.size(); i++)
+    if (lBench_Rand() < flip)
+      c->bits[i] ^= 1;
+  raw.assign(c->bits.size() / 8, 0);
+  for (size_t i = 0; i < raw.size() * 8; i++)
+    raw[i / 8] |= c->bits[i] << (7 - i % 8);
+  return raw;
+}
+
+typedef struct
+{
+  unsigned got, wrong;
+  uint64_t cycles;
+} BENCH_RESULT;
+
+static BENCH_RESULT tBench_Decode(const RFM26_DIRECT_PROTO* p, const std::vector<uint8_t>& raw,
+                                  const std::vector<std::vector<uint8_t> >* sent, RFM26_DIRECT* d, int print)
+{
+  BENCH_RESULT r = { 0, 0, 0 };
+  size_t next = 0;
+
+  RFM26_Direct_Init(d, p);
+  for (size_t i = 0; i < raw.size(); i++) {
+    uint64_t t0 = lBench_Cycles();
+    uint8_t n = RFM26_Direct_Feed(d, raw[i]);
+    r.cycles += lBench_Cycles() - t0;
+    if (n == 0)
+      continue;
+    if (print) {
+      printf("%8zu  sync_err %u  len %2u :", i, d->sync_err, n);
+      for (uint8_t k = 0; k < n; k++)
+        printf(" %02X", d->data[k]);
+      printf("\n");
+    }
+    if (!sent)
+      continue;
+    size_t k = next;
+    while (k < sent->size() && ((*sent)[k].size() != n || memcmp(&(*sent)[k][0], d->data, n)))
+      k++;
+    if (k == sent->size()) {
+      r.wrong++;
+    } else {
+      r.got++;
+      next = k + 1;
+    }
+  }
+  return r;
+}
+
+static int iBench_Run(const char* name, const RFM26_DIRECT_PROTO* p, int frames, double ber, const char* save)
+{
+  BENCH_CAPTURE c;
+  RFM26_DIRECT d;
+  std::vector<uint8_t> raw = abBench_Capture(p, frames, ber, &c);
+
+  if (save) {
+    FILE* f = fopen(save, "wb");
+    if (!f || fwrite(&raw[0], 1, raw.size(), f) != raw.size()) {
+      fprintf(stderr, "cannot write %s\n", save);
+      return 1;
+    }
+    fclose(f);
+  }
+  BENCH_RESULT r = tBench_Decode(p, raw, &c.sent, &d, 0);
+
+  // noise only, the decoder never leaves sync hunting for long
+  std::vector<uint8_t> noise(raw.size());
+  for (size_t i = 0; i < noise.size(); i++)
+    noise[i] = (uint8_t)lBench_Rand();
+  RFM26_DIRECT dn;
+  BENCH_RESULT rn = tBench_Decode(p, noise, 0, &dn, 0);
+
+  printf("%-6s %9zu  %5u/%-5d  %5u  %6u  %8u  %8u  %8.1f  %8.1f\n", name, raw.size(), r.got, frames, r.wrong,
+         d.stats.syncs, d.stats.crc_fail, d.stats.code_err, (double)r.cycles / raw.size(),
+         (double)rn.cycles / noise.size());
+  return r.wrong != 0 || (ber == 0 && r.got != (unsigned)frames);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+    FILE* f = fopen(argv[2], "rb");
+    std::vector<uint8_t> raw;
+    int ch;
+    RFM26_DIRECT d;
+
+    if (!f) {
+      fprintf(stderr, "cannot read %s\n", argv[2]);
+      return 1;
+    }
+    while ((ch = fgetc(f)) != EOF)
+      raw.push_back((uint8_t)ch);
+    fclose(f);
+    tBench_Decode(argc > 3 && strcmp(argv[3], "nrz") == 0 ? &gt_Nrz : 0, raw, 0, &d, 1);
+    printf("%zu bytes, %u syncs, %u frames, %u CRC fail, %u code errors\n", raw.size(), d.stats.syncs,
+           d.stats.frames, d.stats.crc_fail, d.stats.code_err);
+    return 0;
+  }
+
+  int frames = argc > 1 ? atoi(argv[1]) : 2000;
+  double ber = (argc > 2 ? atof(argv[2]) : 0) / 1e6;
+  const char* save = argc > 3 ? argv[3] : 0;
+  int fail = 0;
+
+  if (frames < 1 || ber < 0 || ber >= 1) {
+    fprintf(stderr, "usage: %s [frames] [ber_ppm] [save.bin]\n       %s -r capture.bin [nrz]\n", argv[0], argv[0]);
+    return 1;
+  }
+  printf("%d frames per format, bit error rate %.0f ppm, byte period %.0f us at %d bps\n\n", frames, ber * 1e6,
+         8e6 / BITRATE, BITRATE);
+  printf("format     bytes     frames  wrong   syncs  crc fail  code err  cyc/byte  cyc/byte noise\n");
+  for (double b = 0; ; b = ber) {
+    fail |= iBench_Run("manch", &RFM26DirectProtoDefault, frames, b, b == ber ? save : 0);
+    fail |= iBench_Run("nrz", &gt_Nrz, frames, b, 0);
+    if (b == ber)
+      break;
+  }
+  if (fail)
+    printf("\nFAIL: frame lost without bit errors, or a wrong frame passed the CRC\n");
+  return fail;
+}
@@ -0,0 +1,371 @@
+/************************Description************************
+  Energy report of the sketch traffic, computed by the driver's
+  accountant (rfm26_energy.cpp) on the host:
+
+    exchange  two nodes run the unmodified driver on the radio
+              emulator (rfm26_emu.cpp) as rfm26.cpp does: the
+              initiator calls RFM26_StartExchange, the responder
+              answers with the hardware ack of RFM26_ArmResponse
+              and re-arms once the ack is off the air
+    stream    RFM26_SendVar frames of random length into
+              RFM26_ReceiveAll, packet handler CRC on; a lost
+              frame arrives hit and fails CRC, the receiver
+              drops the read it shows up in and its accountant
+              takes the CRC error (RFM26_Energy_OnPacketInvalid)
+    ldc       send_message with RFM26_SetLongPreamble against
+              RFM26_EntryLowPowerRx; the emulator has no wake-up
+              timer, so both nodes replay the API commands the
+              driver sends, byte for byte, into the accountant
+
+  Lost frames never reach the other node, but in stream. Both
+  nodes print the report RFM26_GetEnergyReport() gives on the
+  MCU, plus uJ per delivered packet for the pair. Fails when the
+  emulator sees a command it does not know, an exchange goes
+  missing, or the stream receiver counts other packets than it
+  handed over.
+
+  Build:  g++ -O2 -c -I.. ../rfm26_driver.cpp
+          objcopy --set-section-flags .bss=alloc,load,contents,data \
+                  --rename-section .data=rfm26_state \
+                  --rename-section .bss=rfm26_state rfm26_driver.o
+          g++ -O2 -I.. -o energy_report energy_report.cpp rfm26_emu.cpp rfm26_driver.o \
+              ../rfm26_energy.cpp ../rfm26_capture.cpp ../rfm26_config.cpp ../rfm26_profiles.cpp \
+              ../rfm26_cal.cpp ../rfm26_snap.cpp
+  Usage:  energy_report [exchange|stream|ldc] [packets] [interval_ms] [loss_%] [ldc_period_ms] [sniff_ms]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "rfm26_driver.h"
+#include "rfm26_emu.h"
+
+#define T_CMD_US			150									// SPI command + CTS at 1MHz
+#define T_ARM_US			1000								// as ARM_MARGIN_US of rfm26.cpp
+
+//Replayed node (ldc)
+struct Node
+{
+  RFM26_ENERGY e;
+  uint32_t now;                                           // node micros()
+  const char* name;
+};
+
+//Frame on air between the two emulated nodes (exchange)
+struct Frame
+{
+  RFM26_EMU* from;
+  double   end;
+  uint8_t  data[RFM26_EMU_FIFO];
+  uint16_t len;
+};
+
+static uint32_t gl_Rand = 0x9E3779B9;
+static std::vector<Frame> gt_Air;
+
+static double fReport_Uniform(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand / 4294967296.0;
+}
+
+static void vReport_Cmd(Node& n, uint8_t len, const uint8_t* cmd)
+{
+  RFM26_Energy_OnCommand(&n.e, len, cmd, n.now);
+  n.now += T_CMD_US;
+}
+
+static void vReport_Prop(Node& n, uint8_t group, uint8_t prop, uint8_t val)
+{
+  uint8_t cmd[5] = { 0x11, group, 1, prop, val };
+  vReport_Cmd(n, 5, cmd);
+}
+
+static uint32_t lReport_AirUs(uint8_t preamble, uint8_t len)
+{
+  return ((uint32_t)preamble + 2 + len) * 8000000UL / RFM26_BITRATE;
+}
+
+// RFM26_Config(): power up, the properties that matter here, 17dBm
+static void vReport_Config(Node& n)
+{
+  static const uint8_t pa[6] = { 0x11, 0x22, 2, 0x01, 0x30, 0x00 };
+  static const uint8_t power_up[7] = { 0x02, 0x01, 0x00, 0x01, 0xC9, 0xC3, 0x80 };
+  static const uint8_t rate[7] = { 0x11, 0x20, 3, 0x03, 0x00, (RFM26_BITRATE >> 8) & 0xFF, RFM26_BITRATE & 0xFF };
+
+  RFM26_Energy_Init(&n.e, n.now);
+  vReport_Cmd(n, 7, power_up);
+  vReport_Cmd(n, 7, rate);
+  vReport_Prop(n, 0x10, 0x00, RFM26_PREAMBLE_LEN);
+  vReport_Prop(n, 0x12, 0x0E, RFM26_PKT_LEN);
+  vReport_Cmd(n, 6, pa);
+  RFM26_Energy_SetLevel(&n.e, 1);                         // RFM26_SetParameter_Power(RFM26PowerTbl[C_17DBM])
+}
+
+static void vReport_StartRx(Node& n, uint8_t timeout, uint8_t valid, uint8_t invalid)
+{
+  uint8_t cmd[8] = { 0x32, 0, 0, 0, RFM26_PKT_LEN, timeout, valid, invalid };
+  vReport_Cmd(n, 8, cmd);
+}
+
+static void vReport_StartTx(Node& n, uint8_t cond)
+{
+  uint8_t cmd[5] = { 0x31, 0, cond, 0, RFM26_PKT_LEN };
+  vReport_Cmd(n, 5, cmd);
+}
+
+static void vReport_ChangeState(Node& n, uint8_t state)
+{
+  uint8_t cmd[2] = { 0x34, state };
+  vReport_Cmd(n, 2, cmd);
+}
+
+static void vReport_Print(const char* name, RFM26_ENERGY_REPORT* r)
+{
+  char buf[400];
+
+  RFM26_Energy_Format(r, buf, sizeof(buf));
+  printf("%s\n%s\n", name, buf);
+}
+
+// START_TX or the hardware ack of either node
+static void vReport_Tx(void* ctx, RFM26_EMU* e, double start, double end, const uint8_t* data, uint16_t len)
+{
+  Frame f;
+
+  (void)ctx;
+  (void)start;
+  f.from = e;
+  f.end = end;
+  f.len = len;
+  memcpy(f.data, data, len);
+  gt_Air.push_back(f);
+}
+
+static unsigned uReport_Ldc(unsigned packets, uint32_t interval_us, double loss, unsigned period_ms,
+                            unsigned sniff_ms, RFM26_ENERGY_REPORT* rt, RFM26_ENERGY_REPORT* rr)
+{
+  Node tx = { {}, 0, "initiator" }, rx = { {}, 0, "responder" };
+  unsigned delivered = 0, i;
+  uint8_t preamble;
+  uint32_t air;
+
+  vReport_Config(tx);
+  vReport_Config(rx);
+  // RFM26_EntryLowPowerRx(): Rx windows on the wake-up timer (R = 0 is fine up to 8 s)
+  uint32_t m = period_ms * 8192UL / 1000;
+  uint32_t w = (sniff_ms * 8192UL + 999) / 1000;
+  uint8_t wut[9] = { 0x11, 0x00, 5, 0x04, 0x40 | 0x02 | 0x01, (uint8_t)(m >> 8), (uint8_t)m, 0, (uint8_t)w };
+  vReport_StartRx(rx, 0x01, 0x03, 0x01);
+  vReport_Cmd(rx, 9, wut);
+  vReport_ChangeState(rx, 0x01);
+  // RFM26_SetLongPreamble()
+  unsigned long bytes = RFM26_PREAMBLE_LEN + ((unsigned long)period_ms + sniff_ms) * RFM26_BITRATE / 8000;
+  preamble = bytes > 255 ? 255 : (uint8_t)bytes;
+  vReport_Prop(tx, 0x10, 0x00, preamble);
+  air = lReport_AirUs(preamble, RFM26_PKT_LEN);
+
+  for (i = 0; i < packets; i++) {
+    uint32_t t0 = (i + 1) * interval_us;
+    tx.now = t0;
+    if (rx.now < t0)
+      rx.now = t0;
+
+    vReport_ChangeState(tx, 0x01);                        // send_message(): RFM26_Standby()
+    vReport_StartTx(tx, 0x30);
+    if (fReport_Uniform() < loss)
+      continue;
+    rx.now = t0 + T_CMD_US * 2 + air;
+    RFM26_Energy_OnPacketRx(&rx.e, rx.now);               // held in READY until read
+    rx.now += 2000;
+    vReport_ChangeState(rx, 0x01);                        // receive_message(): back to the wake-up timer
+    delivered++;
+  }
+
+  uint32_t end = (packets + 1) * interval_us;
+  RFM26_Energy_Report(&tx.e, end, rt);
+  RFM26_Energy_Report(&rx.e, end, rr);
+  printf("ldc, %u packets every %lu ms, loss %.1f%%, preamble %u bytes\n\n",
+         packets, (unsigned long)(interval_us / 1000), loss * 100, preamble);
+  return delivered;
+}
+
+// RFM26_ReceiveAll sink, frames handed over
+static void vReport_Sink(void* ctx, const uint8_t* p, uint8_t len)
+{
+  (void)p;
+  (void)len;
+  (*(unsigned*)ctx)++;
+}
+
+// packet handler CRC on: CRC-16 IBM, field 1 sends and checks it
+static void vReport_CrcOn(void)
+{
+  uint8_t crc[5] = { 0x11, 0x12, 1, 0x00, 0x04 };         // PKT_CRC_CONFIG
+  uint8_t f1[5] = { 0x11, 0x12, 1, 0x10, 0x2A };          // PKT_FIELD_1_CONFIG: SEND_CRC, CHECK_CRC, CRC_ENABLE
+
+  bApi_SendCommand(5, crc);
+  bApi_WaitforCTS();
+  bApi_SendCommand(5, f1);
+  bApi_WaitforCTS();
+}
+
+static unsigned uReport_Stream(unsigned packets, uint32_t interval_us, double loss,
+                               RFM26_ENERGY_REPORT* rt, RFM26_ENERGY_REPORT* rr, int* bad)
+{
+  RFM26_EMU tx, rx;
+  uint8_t data[RFM26_VAR_MAX];
+  unsigned delivered = 0, hit = 0, i, k;
+  double end = (double)(packets + 1) * interval_us;
+
+  RFM26_Emu_Init(&tx, 0, vReport_Tx, 0);
+  RFM26_Emu_Init(&rx, 0, vReport_Tx, 0);
+  RFM26_Emu_Enter(&tx, 0);
+  RFM26_Config();
+  RFM26_SetVarLen(1);
+  vReport_CrcOn();
+  RFM26_SetupTx();
+  RFM26_Emu_Enter(&rx, 0);
+  RFM26_Config();
+  RFM26_SetVarLen(1);
+  vReport_CrcOn();
+  RFM26_SetupRx();
+
+  for (i = 0; i < packets; i++) {
+    uint8_t n = (uint8_t)(4 + (unsigned)(fReport_Uniform() * 28));
+
+    for (k = 0; k < n; k++)
+      data[k] = (uint8_t)(fReport_Uniform() * 256);
+    RFM26_Emu_Enter(&tx, (double)(i + 1) * interval_us);
+    RFM26_SendVar(data, n);
+    for (k = 0; k < gt_Air.size(); k++) {
+      Frame f = gt_Air[k];
+      uint8_t ok = fReport_Uniform() >= loss;
+
+      if (!ok) {
+        f.data[f.len - 1] ^= 0x5A;                        // payload hit, the length byte is fine
+        hit++;
+      }
+      if (!RFM26_Emu_Receive(&rx, f.end, f.data, f.len, -60, ok))
+        continue;
+      RFM26_Emu_Enter(&rx, f.end);                        // nIRQ on PACKET_RX only: a hit frame waits for the next
+      while (RFM26_ReceiveAll(vReport_Sink, &delivered))
+        ;
+    }
+    gt_Air.clear();
+  }
+
+  RFM26_Emu_Enter(&tx, end);
+  RFM26_GetEnergyReport(rt);
+  RFM26_Emu_Enter(&rx, end);
+  RFM26_GetEnergyReport(rr);
+  printf("stream on the emulator, %u packets every %lu ms, loss %.1f%% (%u hit, %u CRC errors)\n\n",
+         packets, (unsigned long)(interval_us / 1000), loss * 100, hit, rx.stats.rx_crc_err);
+  if (tx.stats.unknown || rx.stats.unknown) {
+    printf("emulator: %u unknown commands\n", tx.stats.unknown + rx.stats.unknown);
+    *bad = 1;
+  }
+  if (rr->rx_packets != delivered || rx.stats.rx_crc_err != hit) {
+    printf("receiver counts %lu packets, handed over %u\n", (unsigned long)rr->rx_packets, delivered);
+    *bad = 1;
+  }
+  RFM26_Emu_Free(&tx);
+  RFM26_Emu_Free(&rx);
+  return delivered;
+}
+
+static unsigned uReport_Exchange(unsigned packets, uint32_t interval_us, double loss,
+                                 RFM26_ENERGY_REPORT* rt, RFM26_ENERGY_REPORT* rr, int* bad)
+{
+  RFM26_EMU tx, rx;
+  uint8_t req[RFM26_PKT_LEN], ack[RFM26_PKT_LEN], buf[RFM26_PKT_LEN];
+  unsigned delivered = 0, i, k;
+  double end = (double)(packets + 1) * interval_us;
+
+  memset(req, 'Q', sizeof(req));
+  memset(ack, 'A', sizeof(ack));
+  RFM26_Emu_Init(&tx, 0, vReport_Tx, 0);
+  RFM26_Emu_Init(&rx, 0, vReport_Tx, 0);
+  RFM26_Emu_Enter(&tx, 0);                                // start(): initiator
+  RFM26_Config();
+  RFM26_SetupTx();
+  RFM26_Emu_Enter(&rx, 0);                                // start(): responder
+  RFM26_Config();
+  RFM26_SetupRx();
+  RFM26_ArmResponse(ack, RFM26_PKT_LEN);
+
+  for (i = 0; i < packets; i++) {
+    RFM26_Emu_Enter(&tx, (double)(i + 1) * interval_us);  // tx(): request, turn around to Rx in hardware
+    RFM26_StartExchange(req, RFM26_PKT_LEN, RFM26_PKT_LEN);
+    for (k = 0; k < gt_Air.size(); k++) {                 // the ack joins while the request is served
+      Frame f = gt_Air[k];
+      RFM26_EMU* to = f.from == &tx ? &rx : &tx;
+
+      if (fReport_Uniform() < loss || !RFM26_Emu_Receive(to, f.end, f.data, f.len, -60, 1))
+        continue;
+      RFM26_Emu_Enter(to, f.end);                         // rx(): nIRQ edge
+      if (!receive_message(buf))
+        continue;
+      if (to == &tx) {
+        delivered++;
+      } else {                                            // arm(): once the ack is off the air
+        RFM26_Emu_Enter(&rx, rx.now + RFM26_Airtime(RFM26_PKT_LEN) + T_ARM_US);
+        RFM26_ArmResponse(ack, RFM26_PKT_LEN);
+      }
+    }
+    gt_Air.clear();
+  }
+
+  RFM26_Emu_Enter(&tx, end);
+  RFM26_GetEnergyReport(rt);
+  RFM26_Emu_Enter(&rx, end);
+  RFM26_GetEnergyReport(rr);
+  printf("exchange on the emulator, %u packets every %lu ms, loss %.1f%%\n\n",
+         packets, (unsigned long)(interval_us / 1000), loss * 100);
+  if (tx.stats.unknown || rx.stats.unknown) {
+    printf("emulator: %u unknown commands\n", tx.stats.unknown + rx.stats.unknown);
+    *bad = 1;
+  }
+  if (loss == 0 && delivered != packets) {
+    printf("%u of %u exchanges missing without loss\n", packets - delivered, packets);
+    *bad = 1;
+  }
+  RFM26_Emu_Free(&tx);
+  RFM26_Emu_Free(&rx);
+  return delivered;
+}
+
+int main(int argc, char** argv)
+{
+  int ldc = argc > 1 && strcmp(argv[1], "ldc") == 0;
+  int stream = argc > 1 && strcmp(argv[1], "stream") == 0;
+  unsigned packets = argc > 2 ? atoi(argv[2]) : 1000;
+  uint32_t interval_us = (argc > 3 ? atoi(argv[3]) : 2000) * 1000UL;
+  double loss = (argc > 4 ? atof(argv[4]) : 0.0) / 100.0;
+  unsigned period_ms = argc > 5 ? atoi(argv[5]) : 400;
+  unsigned sniff_ms = argc > 6 ? atoi(argv[6]) : 10;
+  RFM26_ENERGY_REPORT rt, rr;
+  unsigned delivered;
+  int bad = 0;
+
+  if (ldc) {
+    delivered = uReport_Ldc(packets, interval_us, loss, period_ms, sniff_ms, &rt, &rr);
+  } else {
+    if (!RFM26_Emu_Swaps()) {
+      fprintf(stderr, "driver globals are not kept per node, build rfm26_driver.o as shown in %s\n", __FILE__);
+      return 1;
+    }
+    if (stream)
+      delivered = uReport_Stream(packets, interval_us, loss, &rt, &rr, &bad);
+    else
+      delivered = uReport_Exchange(packets, interval_us, loss, &rt, &rr, &bad);
+  }
+  vReport_Print("initiator", &rt);
+  vReport_Print("responder", &rr);
+  printf("delivered %u, pair %lu uJ/delivered packet\n", delivered,
+         delivered ? (unsigned long)(((unsigned long long)rt.total_uj + rr.total_uj) / delivered) : 0UL);
+  return bad;
+}
@@ -0,0 +1,174 @@
+/************************Description************************
+  Benchmark of the Reed-Solomon layer (rfm26_fec.cpp).
+
+  1. Correctness: every error count 0..npar/2 must decode to the
+     sent frame; one more error must be refused, miscorrections
+     are counted.
+  2. Speed: encode and decode (clean and with npar/2 errors) in
+     host cycles per frame byte.
+  3. Goodput: frames through a binary symmetric channel. Plain
+     frames need every bit right, FEC frames carry fewer data
+     bytes but survive up to npar/2 byte errors. Goodput is data
+     bits delivered per second of airtime at 2.4Kbps, with ARQ.
+
+  Build:  g++ -O2 -I.. -o fec_bench fec_bench.cpp ../rfm26_fec.cpp
+  Usage:  fec_bench [npar] [frames]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "rfm26_fec.h"
+
+#define FRAME_LEN		21
+#define BITRATE			2400
+#define PREAMBLE_LEN	8
+
+static uint32_t gl_Rand = 0x2F6B1A3D;
+
+static uint32_t lBench_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static double fBench_Uniform(void)
+{
+  return lBench_Rand() / 4294967296.0;
+}
+
+static uint64_t lBench_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static void vBench_Random(uint8_t* p, unsigned n)
+{
+  for (unsigned i = 0; i < n; i++)
+    p[i] = (uint8_t)lBench_Rand();
+}
+
+// corrupt e distinct bytes
+static void vBench_Corrupt(uint8_t* p, unsigned n, unsigned e)
+{
+  uint8_t hit[256] = { 0 };
+
+  while (e) {
+    unsigned i = lBench_Rand() % n;
+    uint8_t x = (uint8_t)lBench_Rand();
+    if (hit[i] || x == 0)
+      continue;
+    hit[i] = 1;
+    p[i] ^= x;
+    e--;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  unsigned npar = argc > 1 ? atoi(argv[1]) : RFM26_FEC_PARITY;
+  unsigned frames = argc > 2 ? atoi(argv[2]) : 20000;
+  unsigned k = FRAME_LEN - npar;
+  uint8_t data[FRAME_LEN], frame[FRAME_LEN], rx[FRAME_LEN];
+  unsigned e, i;
+  int bad = 0;
+
+  if (npar < 2 || npar > RFM26_FEC_MAX_PARITY || (npar & 1) || frames == 0) {
+    fprintf(stderr, "usage: %s [npar 2..%d, even] [frames]\n", argv[0], RFM26_FEC_MAX_PARITY);
+    return 1;
+  }
+  RFM26_Fec_Init(npar);
+  printf("RS(%u,%u) over GF(256), corrects %u byte errors\n\n", FRAME_LEN, k, npar / 2);
+
+  // 1. correctness
+  printf("errors  decoded  refused  miscorrected\n");
+  for (e = 0; e <= npar / 2 + 1; e++) {
+    unsigned ok = 0, refused = 0, wrong = 0;
+    for (i = 0; i < frames; i++) {
+      vBench_Random(data, k);
+      RFM26_Fec_Encode(data, k, frame);
+      memcpy(rx, frame, FRAME_LEN);
+      vBench_Corrupt(rx, FRAME_LEN, e);
+      int8_t r = RFM26_Fec_Decode(rx, FRAME_LEN);
+      if (r < 0)
+        refused++;
+      else if (memcmp(rx, frame, FRAME_LEN) == 0 && (unsigned)r == e)
+        ok++;
+      else
+        wrong++;
+    }
+    printf("%6u  %7u  %7u  %12u\n", e, ok, refused, wrong);
+    if (e <= npar / 2 && ok != frames)
+      bad = 1;
+  }
+
+  // 2. speed
+  uint64_t c_enc = 0, c_dec = 0, c_fix = 0, t0;
+  for (i = 0; i < frames; i++) {
+    vBench_Random(data, k);
+    t0 = lBench_Cycles();
+    RFM26_Fec_Encode(data, k, frame);
+    c_enc += lBench_Cycles() - t0;
+    memcpy(rx, frame, FRAME_LEN);
+    t0 = lBench_Cycles();
+    RFM26_Fec_Decode(rx, FRAME_LEN);
+    c_dec += lBench_Cycles() - t0;
+    vBench_Corrupt(rx, FRAME_LEN, npar / 2);
+    t0 = lBench_Cycles();
+    RFM26_Fec_Decode(rx, FRAME_LEN);
+    c_fix += lBench_Cycles() - t0;
+  }
+#if defined(__x86_64__) || defined(__i386__)
+  const char* unit = "cycles";
+#else
+  const char* unit = "ns";
+#endif
+  printf("\nhost %s per frame byte: encode %.1f, decode clean %.1f, decode %u errors %.1f\n",
+         unit, (double)c_enc / frames / FRAME_LEN, (double)c_dec / frames / FRAME_LEN,
+         npar / 2, (double)c_fix / frames / FRAME_LEN);
+  printf("GF multiplies per frame: encode %u, syndromes %u\n", k * npar, FRAME_LEN * npar);
+
+  // 3. goodput on a binary symmetric channel
+  static const double ber[] = { 1e-4, 3e-4, 1e-3, 2e-3, 3e-3, 5e-3, 1e-2 };
+  double air = (PREAMBLE_LEN + 2 + FRAME_LEN) * 8.0 / BITRATE;
+  printf("\n    BER   plain ok   FEC ok  undetected   plain bps   FEC bps   gain\n");
+  for (unsigned b = 0; b < sizeof(ber) / sizeof(ber[0]); b++) {
+    unsigned plain_ok = 0, fec_ok = 0, undetected = 0;
+    for (i = 0; i < frames; i++) {
+      unsigned flips = 0;
+      vBench_Random(data, k);
+      RFM26_Fec_Encode(data, k, frame);
+      memcpy(rx, frame, FRAME_LEN);
+      for (unsigned bit = 0; bit < FRAME_LEN * 8; bit++)
+        if (fBench_Uniform() < ber[b]) {
+          rx[bit / 8] ^= 1 << (bit & 7);
+          flips++;
+        }
+      if (flips == 0)
+        plain_ok++;
+      if (RFM26_Fec_Decode(rx, FRAME_LEN) >= 0) {
+        if (memcmp(rx, data, k) == 0)
+          fec_ok++;
+        else
+          undetected++;
+      }
+    }
+    double plain_bps = FRAME_LEN * 8.0 * plain_ok / frames / air;
+    double fec_bps = k * 8.0 * fec_ok / frames / air;
+    printf("  %.0e  %7.2f%%  %6.2f%%  %10u  %10.1f  %8.1f  %4.2fx\n", ber[b],
+           100.0 * plain_ok / frames, 100.0 * fec_ok / frames, undetected, plain_bps, fec_bps,
+           plain_bps > 0 ? fec_bps / plain_bps : 0.0);
+  }
+  return bad;
+}
@@ -0,0 +1,211 @@
+/************************Description************************
+  Back-to-back frames against the Rx FIFO, on the radio
+  emulator: the receiver is busy while a burst of frames comes
+  in and serves nIRQ only after the last one ended.
+
+    fixed  RFM26_PKT_LEN packets read with receive_message(),
+           the radio leaves Rx after a packet and the FIFO is
+           reset once it is read: one frame a burst is kept
+    var    length byte framing (RFM26_SetVarLen), frames of
+           random length read with RFM26_ReceiveAll(): Rx goes
+           on and every complete frame in the FIFO is read
+    crc    var with the packet handler CRC on and one frame of
+           every 4th burst hit on air: CRC_ERROR drops the
+           frames of that read, none may reach the sink
+
+  The frames are sent by the driver first (send_message,
+  RFM26_SendVar) and what went on air is fed back to it in
+  bursts. Reports frames kept, SPI bytes per frame and FIFO
+  errors per mode; fails when var mode loses or changes a frame,
+  crc mode hands over a hit frame or loses a good burst, or
+  RFM26_SetVarLen(0) does not leave the packet handler as
+  RFM26_Config set it.
+
+  Build:  g++ -O2 -I.. -o fifo_drain fifo_drain.cpp rfm26_emu.cpp ../rfm26_driver.cpp \
+              ../rfm26_energy.cpp ../rfm26_capture.cpp ../rfm26_config.cpp ../rfm26_profiles.cpp \
+              ../rfm26_cal.cpp ../rfm26_snap.cpp
+  Usage:  fifo_drain [bursts] [frames_per_burst]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "rfm26_driver.h"
+#include "rfm26_emu.h"
+
+#define C_GAP_US			500							// between the frames of a burst
+#define C_BUSY_US			2000						// receiver busy after the last frame of a burst
+#define C_HIT_EVERY			4							// crc mode: bursts per burst with a frame hit
+
+enum { M_FIXED, M_VAR, M_CRC };
+
+static const char* const asDrain_Mode[] = { "fixed", "var", "crc" };
+
+struct Frame
+{
+  uint8_t  data[RFM26_EMU_FIFO];
+  uint16_t len;
+};
+
+struct Drain
+{
+  const std::vector<Frame>* sent;
+  uint32_t next;                                          // frame expected
+  uint32_t kept, bad;
+};
+
+static uint32_t gl_Rand = 0x1F2E3D4C;
+
+static uint32_t lDrain_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+// PKT_FIELD_1_LENGTH
+static uint32_t lDrain_Field1(const RFM26_EMU* e)
+{
+  return (uint32_t)RFM26_Emu_Prop(e, 0x12, 0x0D) << 8 | RFM26_Emu_Prop(e, 0x12, 0x0E);
+}
+
+static void vDrain_Tx(void* ctx, RFM26_EMU* e, double start, double end, const uint8_t* data, uint16_t len)
+{
+  Frame f;
+
+  (void)e;
+  (void)start;
+  (void)end;
+  f.len = len;
+  memcpy(f.data, data, len);
+  ((std::vector<Frame>*)ctx)->push_back(f);
+}
+
+// payload handed over by RFM26_ReceiveAll, frames come in order or not at all
+static void vDrain_Sink(void* ctx, const uint8_t* p, uint8_t len)
+{
+  Drain* d = (Drain*)ctx;
+  const std::vector<Frame>& s = *d->sent;
+
+  while (d->next < s.size() && (s[d->next].len != len + 1u || memcmp(s[d->next].data + 1, p, len)))
+    d->next++;                                            // lost on the way
+  if (d->next == s.size()) {
+    d->bad++;
+    return;
+  }
+  d->kept++;
+  d->next++;
+}
+
+// packet handler CRC on: CRC-16 IBM, field 1 sends and checks it
+static void vDrain_CrcOn(void)
+{
+  uint8_t crc[5] = { 0x11, 0x12, 1, 0x00, 0x04 };         // PKT_CRC_CONFIG
+  uint8_t f1[5] = { 0x11, 0x12, 1, 0x10, 0x2A };          // PKT_FIELD_1_CONFIG: SEND_CRC, CHECK_CRC, CRC_ENABLE
+
+  bApi_SendCommand(5, crc);
+  bApi_WaitforCTS();
+  bApi_SendCommand(5, f1);
+  bApi_WaitforCTS();
+}
+
+static int iDrain_Run(uint8_t mode, uint32_t bursts, uint32_t per, uint32_t* kept_out)
+{
+  std::vector<Frame> sent;
+  RFM26_EMU e;
+  Drain d;
+  uint8_t payload[RFM26_VAR_MAX], buf[RFM26_PKT_LEN], hit[RFM26_EMU_FIFO];
+  uint8_t var = mode != M_FIXED;
+  uint32_t frames = bursts * per, k, i, spi0, fixed_ok = 0, field1, hits = 0;
+  double t;
+
+  RFM26_Emu_Init(&e, 0, vDrain_Tx, &sent);
+  RFM26_Emu_Enter(&e, 0);
+  RFM26_Config();
+  field1 = lDrain_Field1(&e);
+  if (var)
+    RFM26_SetVarLen(1);
+  if (mode == M_CRC)
+    vDrain_CrcOn();
+  RFM26_SetupTx();
+  for (k = 0; k < frames; k++) {
+    uint8_t n = var ? (uint8_t)(4 + lDrain_Rand() % 13) : RFM26_PKT_LEN;  // per * 17 bytes fit the FIFO
+
+    for (i = 0; i < n; i++)
+      payload[i] = (uint8_t)lDrain_Rand();
+    if (var)
+      RFM26_SendVar(payload, n);
+    else
+      send_message(payload, n);
+    RFM26_Emu_Enter(&e, e.tx_end);
+  }
+
+  RFM26_SetupRx();
+  memset(&d, 0, sizeof(d));
+  d.sent = &sent;
+  spi0 = e.stats.spi_bytes;
+  t = e.now;
+  for (k = 0; k < frames; k += per) {
+    t += 100000;
+    for (i = k; i < k + per; i++) {                        // back to back while the MCU does something else
+      t += C_GAP_US + RFM26_Emu_Airtime(&e, sent[i].len);
+      if (t < e.now)
+        t = e.now;
+      if (mode == M_CRC && (k / per) % C_HIT_EVERY == 0 && i == k + per / 2) {
+        memcpy(hit, sent[i].data, sent[i].len);
+        hit[sent[i].len - 1] ^= 0x5A;                     // payload hit, the length byte is fine
+        RFM26_Emu_Receive(&e, t, hit, sent[i].len, -80, 0);
+        hits++;
+      } else {
+        RFM26_Emu_Receive(&e, t, sent[i].data, sent[i].len, -80, 1);
+      }
+    }
+    RFM26_Emu_Enter(&e, t + C_BUSY_US);
+    if (var) {
+      while (RFM26_ReceiveAll(vDrain_Sink, &d))
+        ;
+    } else {
+      while (receive_message(buf))
+        if (!memcmp(buf, sent[k].data, RFM26_PKT_LEN) || !memcmp(buf, sent[k + per - 1].data, RFM26_PKT_LEN))
+          fixed_ok++;
+    }
+    t = e.now;
+  }
+  if (!var)
+    d.kept = fixed_ok;
+  RFM26_SetVarLen(0);
+  if (lDrain_Field1(&e) != field1 ||
+      RFM26_Emu_Prop(&e, 0x12, 0x08) || RFM26_Emu_Prop(&e, 0x12, 0x12)) {
+    printf("%s: packet handler not back to the configured fixed length\n", asDrain_Mode[mode]);
+    d.bad++;
+  }
+  if (mode == M_CRC && e.stats.rx_crc_err != hits) {
+    printf("crc: %u frames hit, %u CRC errors\n", hits, e.stats.rx_crc_err);
+    d.bad++;
+  }
+  printf("%-6s %6u frames sent, %6u kept, %4u bad, %6.1f SPI bytes a frame kept, %u FIFO errors\n",
+         asDrain_Mode[mode], frames, d.kept, d.bad,
+         d.kept ? (double)(e.stats.spi_bytes - spi0) / d.kept : 0.0, e.stats.fifo_err);
+  *kept_out = d.kept + hits * per;                        // a hit drops its whole burst
+  RFM26_Emu_Free(&e);
+  return d.bad != 0;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t bursts = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000;
+  uint32_t per = argc > 2 ? (uint32_t)atoi(argv[2]) : 3;
+  uint32_t kept_fixed, kept_var, kept_crc;
+  int bad;
+
+  if (per < 1 || per > RFM26_EMU_FIFO / 17) {
+    fprintf(stderr, "frames_per_burst 1..%d, a burst fits the Rx FIFO\n", RFM26_EMU_FIFO / 17);
+    return 1;
+  }
+  bad = iDrain_Run(M_FIXED, bursts, per, &kept_fixed);
+  bad |= iDrain_Run(M_VAR, bursts, per, &kept_var);
+  bad |= iDrain_Run(M_CRC, bursts, per, &kept_crc);
+  return bad || kept_var != bursts * per || kept_crc != bursts * per;
+}
@@ -0,0 +1,212 @@
+/************************Description************************
+  Simulation of fragmentation and reassembly (rfm26_frag.cpp).
+
+  Several peers each keep a window of messages in flight and
+  send their fragments in random order, interleaved with the
+  other peers on one channel. Fragments are lost or duplicated
+  at the given rates. The receiver reassembles into a fixed
+  pool of slots (big x 1024 and 8 x 256 bytes) under a 6 KB
+  memory cap, expires partial messages and checks every completed
+  one against what was sent.
+
+  Reported: messages delivered against the loss bound
+  (1-loss)^fragments, drops by reason, peak reserved memory
+  and host cycles per fragment to place and mark.
+
+  Build:  g++ -O2 -I.. -o frag_sim frag_sim.cpp ../rfm26_frag.cpp
+  Usage:  frag_sim [messages_per_peer] [loss_%] [dup_%] [peers] [window] [big_slots]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "rfm26_frag.h"
+
+#define BITRATE			2400
+#define PREAMBLE_LEN	8
+#define SLOTS_BIG		8							// default, at most
+#define SLOTS_SMALL		8
+#define MEM_CAP			6144
+
+static uint32_t gl_Rand = 0x7A3C91E5;
+
+static uint32_t lSim_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static double fSim_Uniform(void)
+{
+  return lSim_Rand() / 4294967296.0;
+}
+
+static uint64_t lSim_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+typedef struct
+{
+  std::vector<uint8_t> data;
+  RFM26_FRAG_TX tx;
+  std::vector<uint8_t> order;                             // fragments not sent yet, shuffled
+} SIM_MSG;
+
+typedef struct
+{
+  std::vector<SIM_MSG> fly;                               // window of messages in flight
+  unsigned started;
+} SIM_PEER;
+
+static uint16_t wSim_Length(void)
+{
+  switch (lSim_Rand() % 4) {                              // mostly small config blobs, some large deltas
+    case 0:  return 1 + lSim_Rand() % RFM26_FRAG_MAX_LEN;
+    case 1:  return 1 + lSim_Rand() % 240;
+    default: return 1 + lSim_Rand() % 64;
+  }
+}
+
+static void vSim_Start(SIM_PEER* p, uint8_t src, std::vector<std::vector<uint8_t> >& sent)
+{
+  SIM_MSG m;
+  uint8_t msg = (uint8_t)p->started++;
+
+  m.data.resize(wSim_Length());
+  for (unsigned i = 0; i < m.data.size(); i++)
+    m.data[i] = (uint8_t)lSim_Rand();
+  uint8_t count = RFM26_Frag_TxInit(&m.tx, src, msg, &m.data[0], (uint16_t)m.data.size());
+  for (uint8_t i = 0; i < count; i++)
+    m.order.push_back(i);
+  for (unsigned i = count; i > 1; i--)
+    std::swap(m.order[i - 1], m.order[lSim_Rand() % i]);
+  sent[src * 256 + msg] = m.data;
+  p->fly.push_back(m);
+}
+
+int main(int argc, char** argv)
+{
+  unsigned per_peer = argc > 1 ? atoi(argv[1]) : 500;
+  double loss = (argc > 2 ? atof(argv[2]) : 1.0) / 100.0;
+  double dup = (argc > 3 ? atof(argv[3]) : 1.0) / 100.0;
+  unsigned peers = argc > 4 ? atoi(argv[4]) : 4;
+  unsigned window = argc > 5 ? atoi(argv[5]) : 2;
+  unsigned nbig = argc > 6 ? atoi(argv[6]) : SLOTS_BIG;
+
+  if (per_peer == 0 || peers == 0 || peers > 255 || window == 0 || window > RFM26_FRAG_PER_PEER ||
+      nbig > SLOTS_BIG) {
+    fprintf(stderr, "usage: %s [messages_per_peer] [loss_%%] [dup_%%] [peers 1..255] [window 1..%d] [big_slots 0..%d]\n",
+            argv[0], RFM26_FRAG_PER_PEER, SLOTS_BIG);
+    return 1;
+  }
+
+  static uint8_t big[SLOTS_BIG][RFM26_FRAG_MAX_LEN];
+  static uint8_t small[SLOTS_SMALL][256];
+  RFM26_FRAG_SLOT slot[SLOTS_BIG + SLOTS_SMALL];
+  RFM26_FRAG_RX rx;
+  for (unsigned i = 0; i < nbig; i++) {
+    slot[i].buf = big[i];
+    slot[i].cap = sizeof(big[i]);
+  }
+  for (unsigned i = 0; i < SLOTS_SMALL; i++) {
+    slot[nbig + i].buf = small[i];
+    slot[nbig + i].cap = sizeof(small[i]);
+  }
+  RFM26_Frag_RxInit(&rx, slot, (uint8_t)(nbig + SLOTS_SMALL), MEM_CAP);
+
+  std::vector<SIM_PEER> peer(peers);
+  std::vector<std::vector<uint8_t> > sent(peers * 256);
+  double air_ms = (PREAMBLE_LEN + 2 + RFM26_FRAG_FRAME_LEN) * 8000.0 / BITRATE;
+  double now = 0, bound = 0;
+  unsigned frames = 0, delivered = 0, bad = 0, peak = 0, total = 0;
+  uint64_t cyc = 0, t0;
+
+  for (unsigned p = 0; p < peers; p++)
+    for (unsigned w = 0; w < window && peer[p].started < per_peer; w++)
+      vSim_Start(&peer[p], (uint8_t)p, sent);
+
+  for (;;) {
+    std::vector<unsigned> live;
+    for (unsigned p = 0; p < peers; p++)
+      if (!peer[p].fly.empty())
+        live.push_back(p);
+    if (live.empty())
+      break;
+
+    // one fragment of a random message of a random peer
+    SIM_PEER* p = &peer[live[lSim_Rand() % live.size()]];
+    unsigned mi = lSim_Rand() % p->fly.size();
+    SIM_MSG* m = &p->fly[mi];
+    uint8_t frame[RFM26_FRAG_FRAME_LEN] = { 0 };
+    const uint8_t* pl;
+    uint8_t idx = m->order.back();
+    m->tx.data = &m->data[0];                             // the vector may have moved
+    uint8_t n = RFM26_Frag_TxFrag(&m->tx, idx, frame, &pl);
+    memcpy(frame + RFM26_FRAG_HDR_LEN, pl, n);
+    m->order.pop_back();
+    if (m->order.empty()) {
+      bound += pow(1.0 - loss, m->tx.count);
+      total++;
+      p->fly.erase(p->fly.begin() + mi);
+      if (p->started < per_peer)
+        vSim_Start(p, (uint8_t)(p - &peer[0]), sent);
+    }
+
+    for (int copies = fSim_Uniform() < dup ? 2 : 1; copies > 0; copies--) {
+      frames++;
+      now += air_ms;
+      RFM26_Frag_Tick(&rx, (uint32_t)now);
+      if (fSim_Uniform() < loss)
+        continue;
+      t0 = lSim_Cycles();
+      RFM26_FRAG_SLOT* s = RFM26_Frag_Put(&rx, frame, (uint32_t)now);
+      cyc += lSim_Cycles() - t0;
+      if (rx.mem_used > peak)
+        peak = rx.mem_used;
+      if (s) {
+        const std::vector<uint8_t>& want = sent[s->peer * 256 + s->msg];
+        if (RFM26_Frag_Length(s) != want.size() || memcmp(s->buf, &want[0], want.size()) != 0)
+          bad++;
+        delivered++;
+        RFM26_Frag_Release(&rx, s);
+      }
+    }
+  }
+  now += RFM26_FRAG_TIMEOUT_MS;
+  RFM26_Frag_Tick(&rx, (uint32_t)now);
+
+#if defined(__x86_64__) || defined(__i386__)
+  const char* unit = "cycles";
+#else
+  const char* unit = "ns";
+#endif
+  printf("%u peers x %u messages, window %u, loss %.1f%%, dup %.1f%%, %u frames, %.0f s on air\n",
+         peers, per_peer, window, loss * 100, dup * 100, frames, now / 1000);
+  printf("slots %u x %d + %d x 256 bytes, partial cap %d bytes\n\n",
+         nbig, RFM26_FRAG_MAX_LEN, SLOTS_SMALL, MEM_CAP);
+  printf("delivered      %u of %u (%.1f%%), loss bound %.1f%%, %u corrupt\n",
+         delivered, total, 100.0 * delivered / total, 100.0 * bound / total, bad);
+  printf("timed out      %u\n", rx.stats.timeout);
+  printf("duplicates     %u\n", rx.stats.dup);
+  printf("no slot        %u\n", rx.stats.no_slot);
+  printf("over cap       %u\n", rx.stats.over_cap);
+  printf("malformed      %u\n", rx.stats.bad);
+  printf("peak reserved  %u bytes\n", peak);
+  printf("place + mark   %.1f host %s per fragment, payload copied once\n",
+         (double)cyc / (frames ? frames : 1), unit);
+  return bad || rx.stats.complete != delivered || rx.mem_used != 0;
+}
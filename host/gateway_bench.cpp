@@ -0,0 +1,198 @@
+/************************Description************************
+  Load generator for the gateway runtime (rfm26_gateway.cpp):
+  frames per second against the number of threads.
+
+  Sources send numbered frames, each one heard by several
+  radios (copies) with a few copies corrupted on air. Every
+  radio runs its own driver image on the emulator; frames go
+  through receive_message(), the worker queues, CRC check and
+  duplicate suppression. Every ack_every-th unique frame is
+  answered with a downlink frame over the radio that heard it
+  best, sent with send_message().
+
+  For 1, 2, 4 ... threads (radio threads and as many workers)
+  the run is timed and checked: every copy must come out of a
+  radio, every frame with a good copy must come out once, and
+  every ack must be sent. Speedup is against one thread; it
+  can only show on as many cores as the host has.
+
+  Build:  g++ -O2 -fPIC -shared -Wl,-Bsymbolic -I.. -o rfm26_drv.so \
+              ../rfm26_driver.cpp ../rfm26_energy.cpp ../rfm26_capture.cpp \
+              ../rfm26_config.cpp ../rfm26_profiles.cpp ../rfm26_cal.cpp ../rfm26_snap.cpp
+          g++ -O2 -rdynamic -pthread -I.. -o gateway_bench gateway_bench.cpp \
+              rfm26_gateway.cpp rfm26_emu.cpp ../rfm26_crc.cpp -ldl
+  Usage:  gateway_bench [radios] [rounds] [copies] [max_threads] [bad_permille] [image]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include "rfm26_gateway.h"
+#include "rfm26_crc.h"
+
+#define SOURCES			500
+#define ACK_EVERY		32
+
+typedef struct
+{
+  alignas(64) uint64_t pos;                               // next copy for the radio, one cache line each
+} BENCH_CURSOR;
+
+typedef struct
+{
+  uint16_t radios, copies;
+  uint32_t rounds;
+  uint32_t bad;                                           // per mille of copies corrupted
+  std::vector<BENCH_CURSOR> cur;
+  RFM26_CRC crc;
+  std::atomic<uint64_t> acks;
+} BENCH;
+
+static uint32_t lBench_Hash(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDULL;
+  x ^= x >> 33;
+  x *= 0xC4CEB9FE1A85EC53ULL;
+  x ^= x >> 33;
+  return (uint32_t)x;
+}
+
+static uint8_t bBench_Corrupt(const BENCH* b, uint64_t k, uint16_t j)
+{
+  return lBench_Hash(k * 16 + j) % 1000 < b->bad;
+}
+
+static void vBench_Frame(const BENCH* b, uint64_t k, uint8_t* data)
+{
+  uint16_t id = (uint16_t)(k % SOURCES), seq = (uint16_t)(k / SOURCES);
+  uint8_t i;
+
+  data[RFM26_GW_ID] = (uint8_t)(id >> 8);
+  data[RFM26_GW_ID + 1] = (uint8_t)id;
+  data[RFM26_GW_SEQ] = (uint8_t)(seq >> 8);
+  data[RFM26_GW_SEQ + 1] = (uint8_t)seq;
+  for (i = RFM26_GW_SEQ + 2; i < RFM26_GW_CRC; i++)
+    data[i] = (uint8_t)(k + i);
+  RFM26_Crc_Put(&b->crc, RFM26_Crc_Calc(&b->crc, data, RFM26_GW_CRC), data + RFM26_GW_CRC);
+}
+
+// copy j of frame k is at radio (k + j) % radios; radio r takes its copies round by round
+static uint8_t bBench_Air(void* ctx, uint16_t radio, uint8_t* data, uint16_t* len, double* dbm)
+{
+  BENCH* b = (BENCH*)ctx;
+  uint64_t pos = b->cur[radio].pos;
+  uint16_t j;
+  uint64_t k;
+
+  if (pos >= (uint64_t)b->rounds * b->copies)
+    return 0;
+  b->cur[radio].pos++;
+  j = (uint16_t)(pos % b->copies);
+  k = pos / b->copies * b->radios + (radio + b->radios - j) % b->radios;
+  vBench_Frame(b, k, data);
+  if (bBench_Corrupt(b, k, j))
+    data[lBench_Hash(k) % RFM26_GW_FRAME_LEN] ^= 0x10;
+  *len = RFM26_GW_FRAME_LEN;
+  *dbm = -70 - 6.0 * j;
+  return 1;
+}
+
+static void vBench_Sink(void* ctx, RFM26_GW* gw, const RFM26_GW_FRAME* f)
+{
+  BENCH* b = (BENCH*)ctx;
+  uint8_t ack[RFM26_GW_FRAME_LEN];
+
+  if (((f->data[RFM26_GW_SEQ] << 8 | f->data[RFM26_GW_SEQ + 1]) + f->data[RFM26_GW_ID + 1]) % ACK_EVERY)
+    return;
+  memcpy(ack, f->data, RFM26_GW_SEQ + 2);
+  memset(ack + RFM26_GW_SEQ + 2, 'A', sizeof(ack) - RFM26_GW_SEQ - 2);
+  if (RFM26_Gw_Send(gw, f->radio, ack, sizeof(ack)))
+    b->acks.fetch_add(1, std::memory_order_relaxed);
+}
+
+static double fBench_Now(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv)
+{
+  int radios = argc > 1 ? atoi(argv[1]) : 32;
+  int rounds = argc > 2 ? atoi(argv[2]) : 4000;
+  int copies = argc > 3 ? atoi(argv[3]) : 3;
+  unsigned hw = std::thread::hardware_concurrency();
+  int max_threads = argc > 4 ? atoi(argv[4]) : (hw > 4 ? (int)hw : 4);
+  int bad = argc > 5 ? atoi(argv[5]) : 20;
+  const char* image = argc > 6 ? argv[6] : "./rfm26_drv.so";
+  BENCH b;
+  int fail = 0;
+  double base = 0;
+
+  if (radios < 1 || radios > RFM26_GW_RADIOS || rounds < 1 || copies < 1 || copies > radios || max_threads < 1 ||
+      max_threads > RFM26_GW_THREADS || bad < 0 || bad > 1000 ||
+      (uint64_t)rounds * radios / SOURCES >= 0x8000) {
+    fprintf(stderr, "usage: %s [radios] [rounds] [copies<=radios] [max_threads] [bad_permille] [image]\n", argv[0]);
+    return 1;
+  }
+  b.radios = (uint16_t)radios;
+  b.copies = (uint16_t)copies;
+  b.rounds = (uint32_t)rounds;
+  b.bad = (uint32_t)bad;
+  RFM26_Crc_Init(&b.crc, C_CRC_SEED_ONES | C_CRC_CCITT_16, C_PKT_CRC_ENDIAN);
+
+  uint64_t frames = (uint64_t)rounds * radios, good = 0;
+  for (uint64_t k = 0; k < frames; k++)
+    for (uint16_t j = 0; j < copies; j++)
+      if (!bBench_Corrupt(&b, k, j)) {
+        good++;
+        break;
+      }
+
+  printf("%d radios, %llu frames from %d sources, %d copies each, %d per mille corrupted, %u hardware threads\n\n",
+         radios, (unsigned long long)frames, SOURCES, copies, bad, hw);
+  printf("threads  copies in   unique    dups  bad crc  queue full  acks sent   wall s    frames/s  speedup\n");
+  for (int n = 1; n <= max_threads; n *= 2) {
+    b.cur.assign(radios, BENCH_CURSOR());
+    b.acks.store(0);
+    RFM26_GW* gw = RFM26_Gw_Open(image, (uint16_t)radios, (uint8_t)n, (uint8_t)n, bBench_Air, vBench_Sink, &b);
+    if (!gw) {
+      fprintf(stderr, "cannot open the gateway with %s\n", image);
+      return 1;
+    }
+    double t0 = fBench_Now();
+    RFM26_Gw_Run(gw);
+    double wall = fBench_Now() - t0;
+    RFM26_GW_STATS s;
+    RFM26_Gw_Stats(gw, &s);
+
+    uint64_t src_frames = 0;
+    for (int id = 0; id < SOURCES; id++) {
+      const RFM26_GW_SOURCE* a = RFM26_Gw_Source(gw, (uint16_t)id);
+      src_frames += a ? a->frames : 0;
+    }
+    double fps = s.rx / wall;
+    if (n == 1)
+      base = fps;
+    printf("%7d  %9llu  %7llu  %6llu  %7llu  %10llu  %9llu  %7.2f  %10.0f  %7.2f\n", n, (unsigned long long)s.rx,
+           (unsigned long long)s.unique, (unsigned long long)s.dup, (unsigned long long)s.bad_crc,
+           (unsigned long long)s.queue_full, (unsigned long long)s.tx, wall, fps, fps / base);
+    if (s.rx != frames * copies || s.missed || s.unique != good || src_frames != good || s.tx != b.acks.load() ||
+        s.rx != s.unique + s.dup + s.bad_crc) {
+      printf("FAIL: %llu copies out of %llu, %llu missed, %llu unique of %llu, %llu acks sent of %llu\n",
+             (unsigned long long)s.rx, (unsigned long long)(frames * copies), (unsigned long long)s.missed,
+             (unsigned long long)s.unique, (unsigned long long)good, (unsigned long long)s.tx,
+             (unsigned long long)b.acks.load());
+      fail = 1;
+    }
+    if (n == 1)
+      printf("         %.1f us of radio time and %.0f SPI bytes per copy\n", s.radio_us / s.rx,
+             (double)s.spi_bytes / s.rx);
+    RFM26_Gw_Close(gw);
+  }
+  return fail;
+}
@@ -0,0 +1,216 @@
+/************************Description************************
+  Host simulation of link adaptation (rfm26_link.cpp). A gateway
+  polls peers at different distances round robin with the sketch
+  exchange (request, hardware response). Every frame goes through
+  log-distance path loss, per peer shadowing that drifts slowly
+  and per frame fading, and is received when its RSSI clears the
+  sensitivity of the rate. The same run is made with the sketch
+  setting (2.4Kbps, 17dBm everywhere) and with the controller.
+
+  Reported: delivered exchanges and goodput in a fixed amount of
+  channel time, Tx energy per delivered exchange (both ends, from
+  RFM26EnergyCurrentTbl) and SET_PROPERTY commands spent retuning.
+
+  Build:  g++ -O2 -I.. -o link_sim link_sim.cpp ../rfm26_link.cpp ../rfm26_energy.cpp
+  Usage:  link_sim [peers] [seconds] [max_distance_m] [fading_db]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "rfm26_link.h"
+#include "rfm26_energy.h"
+
+#define PKT_LEN			21
+#define PREAMBLE_LEN	8
+#define T_TURN_US		200.0								// RXVALID -> TX in hardware
+#define T_TIMEOUT_US	5000.0								// response wait beyond its airtime
+#define T_GAP_US		2000.0								// MCU between exchanges
+#define PL_1M_DB		31.2								// 868MHz free space at 1m
+#define PL_EXP			3.0
+#define SHADOW_DB		4.0
+
+struct Peer
+{
+  double     dist;
+  double     shadow;                                      // slow part, AR(1)
+  RFM26_LINK gw;                                          // gateway side of the link
+  RFM26_LINK me;                                          // peer side
+  uint8_t    ack_hdr[RFM26_LINK_HDR_LEN];                 // response preloaded by RFM26_ArmResponse
+  uint8_t    ack_power;                                   // power the preloaded response goes out with
+  uint8_t    radio_rate, radio_power;                     // what the peer chip is set to
+  unsigned long tries, delivered;
+};
+
+struct Stats
+{
+  unsigned long exchanges, delivered, commands;
+  double tx_uj;
+};
+
+static uint32_t gl_Rand = 0x6C8E9CF5;
+
+static double fSim_Uniform(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return (gl_Rand + 0.5) / 4294967296.0;
+}
+
+static double fSim_Gauss(void)
+{
+  return sqrt(-2.0 * log(fSim_Uniform())) * cos(2.0 * M_PI * fSim_Uniform());
+}
+
+static double fSim_AirUs(uint8_t rate)
+{
+  return (PREAMBLE_LEN + 2 + PKT_LEN) * 8e6 / RFM26LinkBitrate[rate];
+}
+
+static double fSim_TxUj(uint8_t power, uint8_t rate)
+{
+  return CFG_RD32(&RFM26EnergyCurrentTbl[C_ENERGY_TX + power]) * 1e-9 * RFM26_ENERGY_MV * 1e-3 * fSim_AirUs(rate);
+}
+
+// RSSI of one frame as latched by the receiver, 0.5dB steps
+static uint8_t uSim_Rssi(const Peer& p, uint8_t power, double fading, double* dbm)
+{
+  double loss = PL_1M_DB + 10.0 * PL_EXP * log10(p.dist) + p.shadow + fading * fSim_Gauss();
+  double raw;
+
+  *dbm = RFM26LinkPowerDbm[power] - loss;
+  raw = (*dbm + 0x40 + 70) * 2;
+  return raw < 1 ? 1 : raw > 255 ? 255 : (uint8_t)raw;
+}
+
+// RFM26_SetLink(): commands spent to move a chip to rate/power
+static unsigned uSim_Retune(uint8_t* chip_rate, uint8_t* chip_power, uint8_t rate, uint8_t power)
+{
+  unsigned n = 0;
+
+  if (*chip_rate != rate)
+    n += 2;
+  if (*chip_power != power)
+    n += 1;
+  *chip_rate = rate;
+  *chip_power = power;
+  return n;
+}
+
+static Stats tSim_Run(std::vector<Peer> peers, double seconds, double fading, bool adapt)
+{
+  Stats s = { 0, 0, 0, 0 };
+  uint8_t gw_rate = RFM26_LINK_BASE_RATE, gw_power = 1;
+  double t = 0;
+  size_t i = 0;
+
+  for (size_t k = 0; k < peers.size(); k++) {
+    Peer& p = peers[k];
+    RFM26_Link_Init(&p.gw, C_LINK_INITIATOR);
+    RFM26_Link_Init(&p.me, C_LINK_RESPONDER);
+    if (!adapt)
+      p.gw.power = p.me.power = 1;                        // sketch: C_17DBM, C_2_4KHZ_35KHZ
+    RFM26_Link_BuildHeader(&p.me, p.ack_hdr);
+    p.ack_power = p.me.power;
+    p.radio_rate = p.me.rate;
+    p.radio_power = p.me.power;
+    p.tries = p.delivered = 0;
+  }
+
+  while (t < seconds * 1e6) {
+    Peer& p = peers[i];
+    uint8_t req[RFM26_LINK_HDR_LEN], rate, got = 0;
+    double dbm;
+
+    i = (i + 1) % peers.size();
+    p.shadow = 0.999 * p.shadow + sqrt(1 - 0.999 * 0.999) * SHADOW_DB * fSim_Gauss();
+
+    // gateway: retune for this peer, send the request
+    s.commands += uSim_Retune(&gw_rate, &gw_power, p.gw.rate, p.gw.power);
+    rate = p.gw.rate;
+    RFM26_Link_BuildHeader(&p.gw, req);
+    s.exchanges++;
+    p.tries++;
+    s.tx_uj += fSim_TxUj(p.gw.power, rate);
+    t += fSim_AirUs(rate);
+
+    uint8_t rssi = uSim_Rssi(p, p.gw.power, fading, &dbm);
+    if (p.radio_rate == rate && dbm >= RFM26LinkSensDbm[rate]) {
+      // peer: the preloaded response goes out in hardware, then the MCU reads the request
+      s.tx_uj += fSim_TxUj(p.ack_power, rate);
+      t += T_TURN_US + fSim_AirUs(rate);
+      uint8_t ack_rssi = uSim_Rssi(p, p.ack_power, fading, &dbm);
+      if (dbm >= RFM26LinkSensDbm[rate]) {
+        got = 1;
+        if (adapt)
+          RFM26_Link_OnFrame(&p.gw, p.ack_hdr, ack_rssi, (uint32_t)(t / 1000));
+      }
+      if (adapt && RFM26_Link_OnFrame(&p.me, req, rssi, (uint32_t)(t / 1000)))
+        s.commands += uSim_Retune(&p.radio_rate, &p.radio_power, p.me.rate, p.me.power);
+      RFM26_Link_BuildHeader(&p.me, p.ack_hdr);           // RFM26_ArmResponse
+      p.ack_power = p.me.power;
+    } else {
+      t += T_TURN_US + fSim_AirUs(rate) + T_TIMEOUT_US;
+    }
+    t += T_GAP_US;
+
+    if (got) {
+      s.delivered++;
+      p.delivered++;
+    }
+    if (adapt) {
+      RFM26_Link_OnExchange(&p.gw, got);
+      for (size_t k = 0; k < peers.size(); k++)
+        if (RFM26_Link_Tick(&peers[k].me, (uint32_t)(t / 1000)))
+          s.commands += uSim_Retune(&peers[k].radio_rate, &peers[k].radio_power, peers[k].me.rate, peers[k].me.power);
+    }
+  }
+
+  printf("  %s\n", adapt ? "adaptive" : "fixed 2.4Kbps / 17dBm");
+  printf("  peer  dist(m)  delivered   rate  power\n");
+  for (size_t k = 0; k < peers.size(); k++)
+    printf("  %4u  %7.0f  %8.1f%%  %5.1fk  %3ddBm\n", (unsigned)k, peers[k].dist,
+           peers[k].tries ? 100.0 * peers[k].delivered / peers[k].tries : 0.0,
+           RFM26LinkBitrate[peers[k].gw.rate] / 1000.0, RFM26LinkPowerDbm[peers[k].gw.power]);
+  return s;
+}
+
+int main(int argc, char** argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 12;
+  double seconds = argc > 2 ? atof(argv[2]) : 3600.0;
+  double max_d = argc > 3 ? atof(argv[3]) : 1500.0;
+  double fading = argc > 4 ? atof(argv[4]) : 3.0;
+  std::vector<Peer> peers(n);
+  Stats r[2];
+
+  if (n < 1) {
+    fprintf(stderr, "usage: %s [peers] [seconds] [max_distance_m] [fading_db]\n", argv[0]);
+    return 1;
+  }
+  for (int k = 0; k < n; k++) {
+    peers[k].dist = 20.0 * pow(max_d / 20.0, n > 1 ? (double)k / (n - 1) : 1.0);
+    peers[k].shadow = SHADOW_DB * fSim_Gauss();
+  }
+
+  printf("%d peers 20..%.0f m, %.0f s of channel time, fading %.1f dB\n\n", n, max_d, seconds, fading);
+  for (int a = 0; a < 2; a++) {
+    uint32_t seed = gl_Rand;
+    r[a] = tSim_Run(peers, seconds, fading, a == 1);
+    gl_Rand = seed;                                       // same channel draws for both runs
+    printf("\n");
+  }
+
+  printf("                      fixed    adaptive\n");
+  printf("exchanges        %10lu  %10lu\n", r[0].exchanges, r[1].exchanges);
+  printf("delivered        %10lu  %10lu\n", r[0].delivered, r[1].delivered);
+  printf("goodput (bps)    %10.1f  %10.1f\n",
+         r[0].delivered * (PKT_LEN - RFM26_LINK_HDR_LEN) * 8.0 / seconds,
+         r[1].delivered * (PKT_LEN - RFM26_LINK_HDR_LEN) * 8.0 / seconds);
+  printf("Tx uJ/delivered  %10.0f  %10.0f\n",
+         r[0].delivered ? r[0].tx_uj / r[0].delivered : 0.0, r[1].delivered ? r[1].tx_uj / r[1].delivered : 0.0);
+  printf("retune commands  %10lu  %10lu\n", r[0].commands, r[1].commands);
+  return 0;
+}
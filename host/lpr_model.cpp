@@ -0,0 +1,137 @@
+/************************Description************************
+  Energy model of duty-cycled Rx (RFM26_EntryLowPowerRx) against
+  continuous Rx, with the matching long Tx preamble
+  (RFM26_SetLongPreamble). A receiver is simulated over a random
+  packet stream: it sleeps on the wake-up timer, sniffs for
+  sniff_ms every period and stays in Rx only while a preamble is
+  on air. Reports average current, battery life, delivery ratio
+  and the latency the long preamble adds. Rate, lengths and the
+  preamble rule (RFM26_LongPreamble) are the driver's own.
+
+  Build:  g++ -O2 -I.. -o lpr_model lpr_model.cpp rfm26_emu.cpp ../rfm26_driver.cpp \
+              ../rfm26_energy.cpp ../rfm26_capture.cpp ../rfm26_config.cpp ../rfm26_profiles.cpp \
+              ../rfm26_cal.cpp ../rfm26_snap.cpp
+  Usage:  lpr_model [sniff_ms] [packets_per_hour] [hours]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "rfm26_driver.h"
+
+// Currents in uA, from the module header and the Si446x datasheet
+#define I_SLEEP_WUT		1.0									// sleep, 32kHz RC running
+#define I_READY			1800.0
+#define I_RX			14000.0
+#define I_TX_17DBM		50000.0
+#define I_WAKE			8000.0									// XO start + synth tune
+#define T_WAKE_MS		0.5
+#define T_DETECT_MS		(20.0*1000/RFM26_BITRATE)				// preamble bits to qualify
+#define T_READY_MS		1.0										// packet held in READY until read
+
+#define BATTERY_MAH			2400.0
+
+static uint32_t gl_Rand = 0x2545F491;
+
+static double fModel_Uniform(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand / 4294967296.0;
+}
+
+static double fModel_ByteMs(double bytes)
+{
+  return bytes * 8000.0 / RFM26_BITRATE;
+}
+
+struct Result
+{
+  double avg_ua;
+  double delivered;
+  double lat_mean_ms;
+  double lat_max_ms;
+  double tx_uj;
+};
+
+static Result tModel_Run(unsigned period_ms, unsigned sniff_ms, double pkts_per_hour, double hours)
+{
+  Result res;
+  double span_ms = hours * 3600e3;
+  double t_sleep = 0, t_rx = 0, t_ready = 0, t_wake = 0;
+  double lat_sum = 0, lat_max = 0;
+  unsigned long sent = 0, got = 0;
+  double phase = fModel_Uniform() * period_ms;
+  double pre_ms = fModel_ByteMs(RFM26_LongPreamble(period_ms, sniff_ms));
+  double frame_ms = fModel_ByteMs(2 + RFM26_PKT_LEN);
+  double next_pkt = -log(1.0 - fModel_Uniform()) * 3600e3 / pkts_per_hour;
+  double wakes;
+
+  // Background: every period one wake-up and one sniff window
+  wakes = floor(span_ms / period_ms);
+  t_wake = wakes * T_WAKE_MS;
+  t_rx = wakes * sniff_ms;
+
+  while (next_pkt < span_ms) {
+    double start = next_pkt;
+    double pre_end = start + pre_ms;
+    // first sniff window still open at the preamble start
+    double k = floor((start - phase) / period_ms);
+    double wake = phase + k * period_ms;
+    if (start + T_DETECT_MS > wake + sniff_ms)
+      wake += period_ms;
+
+    sent++;
+    if (wake + T_DETECT_MS <= pre_end) {
+      double end = pre_end + frame_ms;
+      double extra = end - wake - sniff_ms;               // Rx held beyond the normal window
+      if (extra > 0)
+        t_rx += extra;
+      t_ready += T_READY_MS;
+      got++;
+      double lat = (pre_ms - fModel_ByteMs(RFM26_PREAMBLE_LEN));
+      lat_sum += lat;
+      if (lat > lat_max)
+        lat_max = lat;
+    }
+    next_pkt += -log(1.0 - fModel_Uniform()) * 3600e3 / pkts_per_hour;
+  }
+
+  t_sleep = span_ms - t_rx - t_ready - t_wake;
+  res.avg_ua = (t_sleep * I_SLEEP_WUT + t_rx * I_RX + t_ready * I_READY + t_wake * I_WAKE) / span_ms;
+  res.delivered = sent ? 100.0 * got / sent : 100.0;
+  res.lat_mean_ms = got ? lat_sum / got : 0;
+  res.lat_max_ms = lat_max;
+  res.tx_uj = I_TX_17DBM * 3.3 * (pre_ms + frame_ms) / 1000.0;
+  return res;
+}
+
+int main(int argc, char** argv)
+{
+  static const unsigned periods[] = { 50, 100, 200, 400, 600, 800, 1000 };
+  unsigned sniff_ms = argc > 1 ? atoi(argv[1]) : 10;
+  double rate = argc > 2 ? atof(argv[2]) : 60.0;
+  double hours = argc > 3 ? atof(argv[3]) : 24.0;
+  double cont_tx_uj = I_TX_17DBM * 3.3 * fModel_ByteMs(RFM26_PREAMBLE_LEN + 2 + RFM26_PKT_LEN) / 1000.0;
+  unsigned i;
+
+  if (sniff_ms < 1 || sniff_ms > 255) {                   // RFM26_EntryLowPowerRx takes a byte
+    fprintf(stderr, "usage: %s [sniff_ms 1..255] [packets_per_hour] [hours]\n", argv[0]);
+    return 1;
+  }
+  printf("sniff %u ms, %.0f packets/hour, %.0f h simulated, %.0f mAh battery\n\n", sniff_ms, rate, hours, BATTERY_MAH);
+  printf("  period  preamble  avg current  vs cont.  battery   delivered  added latency  Tx energy\n");
+  printf("    (ms)   (bytes)         (uA)              (days)        (%%)   mean/max (ms)   (mJ/pkt)\n");
+  printf("    cont  %8u  %11.1f  %7.1fx  %7.1f  %9.1f  %6.1f/%6.1f  %9.2f\n",
+         RFM26_PREAMBLE_LEN, I_RX, 1.0, BATTERY_MAH * 1000 / I_RX / 24, 100.0, 0.0, 0.0, cont_tx_uj / 1000);
+
+  for (i = 0; i < sizeof(periods) / sizeof(periods[0]); i++) {
+    Result r = tModel_Run(periods[i], sniff_ms, rate, hours);
+    printf("  %6u  %8u  %11.1f  %7.1fx  %7.1f  %9.1f  %6.1f/%6.1f  %9.2f\n",
+           periods[i], (unsigned)RFM26_LongPreamble(periods[i], sniff_ms), r.avg_ua, I_RX / r.avg_ua,
+           BATTERY_MAH * 1000 / r.avg_ua / 24, r.delivered, r.lat_mean_ms, r.lat_max_ms, r.tx_uj / 1000);
+  }
+  return 0;
+}
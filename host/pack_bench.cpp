@@ -0,0 +1,185 @@
+/************************Description************************
+  Benchmark of telemetry packing (rfm26_pack.cpp) on recorded
+  payload streams:
+
+    sensor   12 byte records: node id, sequence, temperature,
+             humidity, pressure, battery, slow random walks
+    sketch   19 bytes of the sketch payload with a counter
+    noise    12 random bytes, the worst case
+
+  For each stream: records per frame, compression ratio (record
+  bytes over frame bytes used), airtime per record against one
+  record per packet, the mode chosen, and host cycles per record
+  byte to pack and unpack. Every frame is unpacked and compared.
+
+  With frame loss, a lost frame also takes the rest of its chain
+  up to the next key frame; delivered counts what still decodes.
+
+  Build:  g++ -O2 -I.. -o pack_bench pack_bench.cpp ../rfm26_pack.cpp
+  Usage:  pack_bench [records] [frame_loss_%]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "rfm26_pack.h"
+
+#define BITRATE			2400
+#define PREAMBLE_LEN	8
+
+static uint32_t gl_Rand = 0x51ED270B;
+
+static uint32_t lBench_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static uint64_t lBench_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static void vBench_Put16(uint8_t* p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static int iBench_Walk(int v, int step, int lo, int hi)
+{
+  v += (int)(lBench_Rand() % (2 * step + 1)) - step;
+  return v < lo ? lo : v > hi ? hi : v;
+}
+
+static std::vector<uint8_t> tBench_Sensor(unsigned n, uint8_t* len)
+{
+  std::vector<uint8_t> s(n * 12);
+  int temp = 2150, hum = 4800, press = 10132, batt = 3300;
+
+  for (unsigned i = 0; i < n; i++) {
+    uint8_t* r = &s[i * 12];
+    temp = iBench_Walk(temp, 3, -4000, 8500);             // 0.01 C
+    hum = iBench_Walk(hum, 5, 0, 10000);                  // 0.01 %
+    press = iBench_Walk(press, 1, 9000, 11000);           // 10 Pa
+    if (lBench_Rand() % 50 == 0)
+      batt--;
+    vBench_Put16(r + 0, 0x0107);                          // node id
+    vBench_Put16(r + 2, (uint16_t)i);
+    vBench_Put16(r + 4, (uint16_t)temp);
+    vBench_Put16(r + 6, (uint16_t)hum);
+    vBench_Put16(r + 8, (uint16_t)press);
+    vBench_Put16(r + 10, (uint16_t)batt);
+  }
+  *len = 12;
+  return s;
+}
+
+static std::vector<uint8_t> tBench_Sketch(unsigned n, uint8_t* len)
+{
+  std::vector<uint8_t> s(n * 19);
+  char buf[32];
+
+  for (unsigned i = 0; i < n; i++) {
+    snprintf(buf, sizeof(buf), "HopeRF RFM26 %06u", i % 1000000);
+    memcpy(&s[i * 19], buf, 19);
+  }
+  *len = 19;
+  return s;
+}
+
+static std::vector<uint8_t> tBench_Noise(unsigned n, uint8_t* len)
+{
+  std::vector<uint8_t> s(n * 12);
+
+  for (unsigned i = 0; i < n * 12; i++)
+    s[i] = (uint8_t)lBench_Rand();
+  *len = 12;
+  return s;
+}
+
+static double gf_Loss = 0;
+
+static int iBench_Run(const char* name, const std::vector<uint8_t>& s, uint8_t rec_len)
+{
+  RFM26_PACK tx, rx;
+  uint8_t frame[RFM26_PACK_FRAME_LEN];
+  std::vector<uint8_t> out(RFM26_PACK_MAX_COUNT * RFM26_PACK_MAX_REC);
+  unsigned n = s.size() / rec_len, frames = 0, used = 0, mode_lz = 0, got = 0, base = 0, i = 0;
+  uint64_t c_pack = 0, c_unpack = 0, t0;
+  int bad = 0;
+
+  RFM26_Pack_Init(&tx, rec_len, 0, 0);
+  RFM26_Pack_Init(&rx, rec_len, 0, 0);
+  while (i < n || RFM26_Pack_Pending(&tx)) {
+    uint8_t len = 0;
+
+    t0 = lBench_Cycles();
+    while (i < n && RFM26_Pack_Add(&tx, &s[i * rec_len]))
+      i++;
+    len = RFM26_Pack_Finish(&tx, frame);
+    c_pack += lBench_Cycles() - t0;
+
+    frames++;
+    used += len;
+    mode_lz += frame[0] >> 7;
+    base += frame[0] & 0x0F;
+    if (lBench_Rand() / 4294967296.0 < gf_Loss)
+      continue;
+    t0 = lBench_Cycles();
+    uint8_t k = RFM26_Pack_Unpack(&rx, frame, RFM26_PACK_FRAME_LEN, &out[0], RFM26_PACK_MAX_COUNT);
+    c_unpack += lBench_Cycles() - t0;
+    if (k && memcmp(&out[0], &s[(base - k) * rec_len], k * rec_len) != 0)
+      bad = 1;
+    got += k;
+  }
+  if (base != n || (gf_Loss == 0 && got != n))
+    bad = 1;
+
+  double air = (PREAMBLE_LEN + 2 + RFM26_PACK_FRAME_LEN) * 8000.0 / BITRATE;
+  printf("%-7s %4u  %9.2f  %6.2f  %7.1f  %8.1f  %5.1f%%  %9.1f  %9.1f  %8.1f%%  %s\n", name, rec_len,
+         (double)n / frames, (double)n * rec_len / used, air, air * frames / n,
+         100.0 * mode_lz / frames, (double)c_pack / (n * rec_len), (double)c_unpack / (n * rec_len),
+         100.0 * got / n, bad ? "MISMATCH" : "ok");
+  return bad;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned n = argc > 1 ? atoi(argv[1]) : 20000;
+  uint8_t len;
+  int bad = 0;
+
+  gf_Loss = (argc > 2 ? atof(argv[2]) : 0.0) / 100.0;
+  if (n == 0) {
+    fprintf(stderr, "usage: %s [records] [frame_loss_%%]\n", argv[0]);
+    return 1;
+  }
+#if defined(__x86_64__) || defined(__i386__)
+  const char* unit = "cyc";
+#else
+  const char* unit = "ns";
+#endif
+  printf("%u records per stream, %d byte packets at %d bps, frame loss %.1f%%, key frame every %d\n\n",
+         n, RFM26_PACK_FRAME_LEN, BITRATE, gf_Loss * 100, RFM26_PACK_KEY_INTERVAL);
+  printf("stream   rec  rec/frame   ratio  ms/pkt  ms/record     LZ  pack %s/B  unpack %s/B  delivered\n", unit, unit);
+  std::vector<uint8_t> s = tBench_Sensor(n, &len);
+  bad |= iBench_Run("sensor", s, len);
+  s = tBench_Sketch(n, &len);
+  bad |= iBench_Run("sketch", s, len);
+  s = tBench_Noise(n, &len);
+  bad |= iBench_Run("noise", s, len);
+  return bad;
+}
@@ -0,0 +1,339 @@
+/************************Description************************
+  Radio property snapshot (RFM26_Snapshot) against the
+  configuration the driver sends.
+
+  The snapshot comes as C_TEL_PROPS records: from the sketch
+  ('p' on its serial port) in a file or on stdin, or with -emu
+  from the driver itself on the radio emulator after
+  RFM26_EntryRx. Each property the encoded base stream and the
+  profile write is compared with the value read; a difference
+  is named, and marked when the driver writes the property
+  after the streams (RFM26_Config, calibration, Rx/Tx setup),
+  so what is left unmarked is a register the chip does not
+  hold as configured.
+
+  -emu also times the snapshot on the emulated SPI link,
+  passes it through the telemetry ring and decoder on its way
+  here, and fails when what arrives is not what the emulated
+  chip holds.
+
+  Build:  g++ -O2 -I.. -o prop_diff prop_diff.cpp rfm26_emu.cpp ../rfm26_driver.cpp \
+              ../rfm26_energy.cpp ../rfm26_capture.cpp ../rfm26_config.cpp ../rfm26_profiles.cpp \
+              ../rfm26_cal.cpp ../rfm26_snap.cpp ../rfm26_telem.cpp
+  Usage:  prop_diff [file|-] [-p profile] [-a]
+          prop_diff -emu [profile] [-a]
+          stty -F /dev/ttyUSB0 115200 raw && (printf p > /dev/ttyUSB0; timeout 2 cat /dev/ttyUSB0) | prop_diff -
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "rfm26_emu.h"
+#include "rfm26_driver.h"
+#include "rfm26_telem.h"
+
+//Snapshot as it arrived, -1 not read
+typedef struct
+{
+  int      v[RFM26_SNAP_GROUPS][256];
+  unsigned chunks, props, bad;
+} SNAP;
+
+typedef struct
+{
+  uint8_t group, first, last;
+  const char* name;
+  const char* by;                                         // 0: only the streams write it
+} PROP_NAME;
+
+static const char* const gs_Group[RFM26_SNAP_GROUPS] = {
+  "GLOBAL", "INT_CTL", "FRR_CTL", "PREAMBLE", "SYNC", "PKT",
+  "MODEM", "MODEM_CHFLT", "PA", "SYNTH", "MATCH", "FREQ_CONTROL",
+};
+
+// the properties rfm26_driver.cpp writes itself, and a few the profiles do
+static const PROP_NAME gt_Name[] = {
+  {0x00, 0x00, 0x00, "GLOBAL_XO_TUNE",          "RFM26_ApplyCal"},
+  {0x01, 0x00, 0x00, "INT_CTL_ENABLE",          "RFM26_SetINT_CTL"},
+  {0x01, 0x01, 0x01, "INT_CTL_PH_ENABLE",       "RFM26_SetINT_CTL"},
+  {0x01, 0x02, 0x02, "INT_CTL_MODEM_ENABLE",    "RFM26_SetINT_CTL"},
+  {0x01, 0x03, 0x03, "INT_CTL_CHIP_ENABLE",     "RFM26_SetINT_CTL"},
+  {0x02, 0x00, 0x03, "FRR_CTL_x_MODE",          "RFM26_Config"},
+  {0x10, 0x00, 0x00, "PREAMBLE_TX_LENGTH",      "RFM26_Config"},
+  {0x10, 0x01, 0x01, "PREAMBLE_CONFIG_STD_1",   "RFM26_Config"},
+  {0x10, 0x04, 0x04, "PREAMBLE_CONFIG",         "RFM26_Config"},
+  {0x11, 0x00, 0x00, "SYNC_CONFIG",             "RFM26_Config"},
+  {0x11, 0x01, 0x02, "SYNC_BITS",               "RFM26_Config"},
+  {0x12, 0x06, 0x06, "PKT_CONFIG1",             "RFM26_Config"},
+  {0x12, 0x0C, 0x0C, "PKT_RX_THRESHOLD",        "RFM26_SetRxThreshold"},
+  {0x12, 0x0D, 0x0E, "PKT_FIELD_1_LENGTH",      "RFM26_SetFieldLength"},
+  {0x20, 0x03, 0x05, "MODEM_DATA_RATE",         0},
+  {0x20, 0x0D, 0x0E, "MODEM_FREQ_OFFSET",       "RFM26_ApplyCal"},
+  {0x20, 0x1B, 0x1D, "MODEM_IF_FREQ",           "RFM26_SetParameter_Freq"},
+  {0x20, 0x22, 0x23, "MODEM_BCR_OSR",           0},
+  {0x20, 0x24, 0x26, "MODEM_BCR_NCO_OFFSET",    0},
+  {0x20, 0x27, 0x28, "MODEM_BCR_GAIN",          0},
+  {0x20, 0x4C, 0x4C, "MODEM_RSSI_CONTROL",      "RFM26_Config"},
+  {0x20, 0x4E, 0x4E, "MODEM_RSSI_COMP",         0},
+  {0x20, 0x51, 0x51, "MODEM_CLKGEN_BAND",       "RFM26_SetParameter_Freq"},
+  {0x22, 0x01, 0x01, "PA_PWR_LVL",              "RFM26_SetParameter_Power"},
+  {0x40, 0x00, 0x00, "FREQ_CONTROL_INTE",       "RFM26_SetParameter_Freq"},
+  {0x40, 0x01, 0x03, "FREQ_CONTROL_FRAC",       "RFM26_SetParameter_Freq"},
+};
+
+static int iDiff_Index(uint8_t group)
+{
+  uint8_t g, n;
+
+  for (uint8_t i = 0; i < RFM26_SNAP_GROUPS; i++) {
+    RFM26_Snap_Group(i, &g, &n);
+    if (g == group)
+      return i;
+  }
+  return -1;
+}
+
+static const PROP_NAME* pDiff_Name(uint8_t group, uint8_t p)
+{
+  for (size_t i = 0; i < sizeof(gt_Name) / sizeof(gt_Name[0]); i++)
+    if (gt_Name[i].group == group && p >= gt_Name[i].first && p <= gt_Name[i].last)
+      return &gt_Name[i];
+  return 0;
+}
+
+static void vDiff_Clear(SNAP* s)
+{
+  memset(s->v, 0xFF, sizeof(s->v));
+  s->chunks = s->props = s->bad = 0;
+}
+
+// a C_TEL_PROPS record; a later snapshot overwrites an earlier one
+static void vDiff_Record(SNAP* s, const RFM26_TEL_REC* r)
+{
+  int g;
+
+  if (r->type != C_TEL_PROPS)
+    return;
+  if (r->len < 2 || (g = iDiff_Index(r->data[0])) < 0 || r->data[1] + r->len - 2 > 256) {
+    s->bad++;
+    return;
+  }
+  s->chunks++;
+  for (uint8_t i = 0; i < r->len - 2; i++) {
+    s->v[g][r->data[1] + i] = r->data[2 + i];
+    s->props++;
+  }
+}
+
+static void vDiff_Feed(SNAP* s, std::vector<uint8_t>* part, const uint8_t* p, size_t n)
+{
+  uint8_t buf[RFM26_TEL_MAX_RAW];
+  RFM26_TEL_REC r;
+
+  for (size_t i = 0; i < n; i++) {
+    if (p[i]) {
+      if (part->size() <= RFM26_TEL_MAX_WIRE)
+        part->push_back(p[i]);
+      continue;
+    }
+    if (!part->empty()) {
+      if (RFM26_Tel_Decode(&(*part)[0], (uint16_t)part->size(), buf, &r))
+        vDiff_Record(s, &r);
+      else
+        s->bad++;
+    }
+    part->clear();
+  }
+}
+
+// differences from base stream plus profile; all: every property read, not only the differing ones
+static unsigned iDiff_Report(const SNAP* s, uint8_t profile, int all)
+{
+  unsigned same = 0, diff = 0, driver = 0, other = 0, unread = 0;
+  uint8_t group, count, start, n, want[RFM26_SNAP_CHUNK];
+  uint16_t known;
+
+  printf("against the base stream and profile %u\n", profile);
+  for (uint8_t i = 0; i < RFM26_SNAP_GROUPS; i++) {
+    RFM26_Snap_Group(i, &group, &count);
+    for (start = 0; start < count; start += n) {
+      n = count - start > RFM26_SNAP_CHUNK ? RFM26_SNAP_CHUNK : count - start;
+      known = 0;
+      RFM26_Snap_Expect(RFM26CfgBase, group, start, n, want, &known);
+      RFM26_Snap_Expect(RFM26_Cfg_Profile(profile), group, start, n, want, &known);
+      for (uint8_t k = 0; k < n; k++) {
+        uint8_t p = start + k;
+        int v = s->v[i][p];
+        const PROP_NAME* nm = pDiff_Name(group, p);
+        int set = (known >> k) & 1;
+
+        if (v < 0) {
+          unread++;
+          continue;
+        }
+        if (!set) {
+          other++;
+          if (all)
+            printf("  %-12s 0x%02X/0x%02X %-24s       read 0x%02X\n", gs_Group[i], group, p, nm ? nm->name : "",
+                   v);
+          continue;
+        }
+        if (v == want[k]) {
+          same++;
+          if (all)
+            printf("  %-12s 0x%02X/0x%02X %-24s 0x%02X  read 0x%02X\n", gs_Group[i], group, p, nm ? nm->name : "",
+                   want[k], v);
+          continue;
+        }
+        if (nm && nm->by)
+          driver++;
+        else
+          diff++;
+        printf("  %-12s 0x%02X/0x%02X %-24s 0x%02X  read 0x%02X  %s%s\n", gs_Group[i], group, p,
+               nm ? nm->name : "", want[k], v, nm && nm->by ? "by " : "DIFFERS", nm && nm->by ? nm->by : "");
+      }
+    }
+  }
+  printf("%u properties as configured, %u written after the streams, %u differ, %u not configured, %u not read\n",
+         same, driver, diff, other, unread);
+  return diff;
+}
+
+static int iDiff_File(const char* name, uint8_t profile, int all)
+{
+  static SNAP s;
+  std::vector<uint8_t> part;
+  uint8_t buf[4096];
+  ssize_t n;
+  int fd = strcmp(name, "-") ? open(name, O_RDONLY) : 0;
+
+  if (fd < 0) {
+    fprintf(stderr, "cannot open %s\n", name);
+    return 1;
+  }
+  vDiff_Clear(&s);
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    vDiff_Feed(&s, &part, buf, (size_t)n);
+  if (fd)
+    close(fd);
+  printf("%s: %u chunks, %u properties, %u bad records\n", name, s.chunks, s.props, s.bad);
+  if (!s.chunks) {
+    fprintf(stderr, "no C_TEL_PROPS records in %s\n", name);
+    return 1;
+  }
+  return iDiff_Report(&s, profile, all) != 0;
+}
+
+/**********************************************************
+  emu
+**********************************************************/
+
+typedef struct
+{
+  RFM26_TELEM t;
+  SNAP*    s;
+  std::vector<uint8_t> part;
+  uint32_t dropped;
+} EMU_SINK;
+
+// what the sketch does with a chunk, the host end of the serial port included
+static void vEmu_Sink(void* ctx, uint8_t group, uint8_t start, const uint8_t* v, uint8_t n)
+{
+  EMU_SINK* k = (EMU_SINK*)ctx;
+  uint8_t rec[2 + RFM26_SNAP_CHUNK], wire[RFM26_TEL_RING];
+  uint16_t w;
+
+  rec[0] = group;
+  rec[1] = start;
+  memcpy(rec + 2, v, n);
+  if (!RFM26_Tel_Put(&k->t, C_TEL_PROPS, 0, rec, (uint8_t)(2 + n)))
+    k->dropped++;
+  w = RFM26_Tel_Take(&k->t, wire, sizeof(wire));
+  vDiff_Feed(k->s, &k->part, wire, w);
+}
+
+static int iDiff_Emu(uint8_t profile, int all)
+{
+  static RFM26_EMU e;
+  static SNAP s;
+  static EMU_SINK k;
+  RFM26_EMU_STATS st;
+  uint8_t group, count;
+  double t0;
+  unsigned wrong = 0, total = 0;
+
+  RFM26_Emu_Init(&e, 0, 0, 0);
+  RFM26_Emu_Enter(&e, 0);
+  if (!RFM26_SetProfile(profile)) {
+    fprintf(stderr, "no profile %u\n", profile);
+    return 1;
+  }
+  RFM26_EntryRx();
+
+  vDiff_Clear(&s);
+  RFM26_Tel_Init(&k.t);
+  k.s = &s;
+  st = e.stats;
+  t0 = e.now;
+  if (!RFM26_Snapshot(vEmu_Sink, &k)) {
+    fprintf(stderr, "FAIL: no CTS during the snapshot\n");
+    return 1;
+  }
+  for (uint8_t i = 0; i < RFM26_SNAP_GROUPS; i++) {
+    RFM26_Snap_Group(i, &group, &count);
+    total += count;
+  }
+  printf("snapshot: %u groups, %u properties in %u GET_PROPERTY, %u SPI bytes, %u CTS polls, %.2f ms\n",
+         RFM26_SNAP_GROUPS, total, e.stats.commands - st.commands, e.stats.spi_bytes - st.spi_bytes,
+         e.stats.cts_polls - st.cts_polls, (e.now - t0) / 1e3);
+  printf("telemetry: %u C_TEL_PROPS records, %u dropped, %u bad\n", s.chunks, k.dropped, s.bad);
+
+  for (uint8_t i = 0; i < RFM26_SNAP_GROUPS; i++) {
+    RFM26_Snap_Group(i, &group, &count);
+    for (uint8_t p = 0; p < count; p++)
+      if (s.v[i][p] != RFM26_Emu_Prop(&e, group, p)) {
+        if (wrong++ < 8)
+          printf("FAIL: 0x%02X/0x%02X read 0x%02X, the chip holds 0x%02X\n", group, p, s.v[i][p] & 0xFF,
+                 RFM26_Emu_Prop(&e, group, p));
+      }
+  }
+  iDiff_Report(&s, profile, all);
+  if (wrong || s.props != total || k.dropped || s.bad) {
+    printf("FAIL: %u of %u properties wrong, %u arrived\n", wrong, total, s.props);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  const char* name = "-";
+  int profile = -1, emu = 0, all = 0;
+
+  for (int a = 1; a < argc; a++) {
+    if (!strcmp(argv[a], "-emu")) {
+      emu = 1;
+      if (a + 1 < argc && argv[a + 1][0] != '-')
+        profile = atoi(argv[++a]);
+    } else if (!strcmp(argv[a], "-p") && a + 1 < argc) {
+      profile = atoi(argv[++a]);
+    } else if (!strcmp(argv[a], "-a")) {
+      all = 1;
+    } else if (argv[a][0] != '-' || !strcmp(argv[a], "-")) {
+      name = argv[a];
+    } else {
+      fprintf(stderr, "usage: %s [file|-] [-p profile] [-a]\n       %s -emu [profile] [-a]\n", argv[0], argv[0]);
+      return 1;
+    }
+  }
+  if (profile < 0)
+    profile = C_2_4KHZ_35KHZ;                             // the WDS table
+  if (profile >= RFM26_PROFILES) {
+    fprintf(stderr, "profile %d, 0..%d\n", profile, RFM26_PROFILES - 1);
+    return 1;
+  }
+  return emu ? iDiff_Emu((uint8_t)profile, all) : iDiff_File(name, (uint8_t)profile, all);
+}
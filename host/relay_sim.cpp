@@ -0,0 +1,258 @@
+/************************Description************************
+  Multi-hop emulation of the relay (rfm26_relay.cpp).
+
+  Nodes 0..hops sit on a line; each hears its neighbours within
+  range. Node 0 sends frames to the last node. Every node runs
+  RFM26_Relay_Route on what it receives. Frames that overlap at
+  a receiver are lost, and a node that is transmitting or
+  reconfiguring hears nothing.
+
+  Two relay paths, both timed from the driver command sequences
+  with an SPI cost per byte and a CTS wait per command:
+
+    store   receive_message(), copy to the application, INT_CTL
+            to PACKET_SENT, send_message(); after Tx the node is
+            deaf until it is back in Rx (ChangeToRxMode)
+    cut     header routed and chunks moved to Tx FIFO while the
+            frame arrives; at PACKET_RX only GET_INT_STATUS and
+            START_TX, the tail goes in under the preamble, and
+            TXCOMPLETE_STATE returns to Rx
+
+  Reported per path: delivered frames, per-hop latency (frame
+  start at one hop to frame start at the next, airtime included
+  and on its own), end-to-end latency, copies reaching the
+  destination and transmissions per delivered frame. Each run
+  is made with and without duplicate suppression.
+
+  Build:  g++ -O2 -I.. -o relay_sim relay_sim.cpp ../rfm26_relay.cpp
+  Usage:  relay_sim [hops] [frames] [range] [interval_frames] [spi_us_per_byte] [cts_us]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <queue>
+
+#include "rfm26_relay.h"
+
+#define BITRATE			2400
+#define PREAMBLE_LEN	8
+#define SYNC_LEN		2
+#define T_WARMUP_US		200.0								// START_TX to first preamble bit
+#define T_RX_TURN_US	100.0								// Tx to Rx in hardware
+#define COPY_US			0.25								// MCU per byte copied
+
+static double gf_Spi, gf_Cts;
+
+// command of n bytes, optional response of r bytes after CTS
+static double fSim_Cmd(unsigned n, unsigned r)
+{
+  return n * gf_Spi + gf_Cts + (r ? (1 + r) * gf_Spi : 0);
+}
+
+// FIFO access of n bytes, no CTS
+static double fSim_Fifo(unsigned n)
+{
+  return (1 + n) * gf_Spi;
+}
+
+// PACKET_RX to START_TX of a forward
+static double fSim_StoreTurn(void)
+{
+  double t = 0;
+
+  t += fSim_Fifo(RFM26_RELAY_FRAME_LEN);                  // receive_message: READ_RX_FIFO
+  t += fSim_Cmd(2, 3);                                    // RSSI
+  t += fSim_Cmd(2, 0);                                    // ResetRxFifo
+  t += fSim_Cmd(4, 8);                                    // ClrAllInterrupt
+  t += fSim_Cmd(8, 0);                                    // START_RX
+  t += 2 * RFM26_RELAY_FRAME_LEN * COPY_US;               // to p_data, to tx_buf
+  t += fSim_Cmd(8, 0);                                    // INT_CTL: PACKET_SENT
+  t += fSim_Cmd(2, 0);                                    // send_message: Standby
+  t += fSim_Fifo(RFM26_RELAY_FRAME_LEN) + gf_Cts;         // WRITE_TX_FIFO, WaitforCTS
+  t += fSim_Cmd(4, 8);                                    // ClrAllInterrupt
+  t += fSim_Cmd(5, 0);                                    // START_TX
+  return t;
+}
+
+// end of Tx to back in Rx
+static double fSim_StoreBack(void)
+{
+  return fSim_Cmd(4, 8) + fSim_Cmd(8, 0) + fSim_Cmd(4, 8) + fSim_Cmd(8, 0);  // PACKET_SENT, ChangeToRxMode
+}
+
+static double fSim_CutTurn(void)
+{
+  return fSim_Cmd(4, 8) + fSim_Cmd(5, 0);                 // GetPHPending, START_TX
+}
+
+// after START_TX: the rest of the frame, at most one chunk, into Tx FIFO
+static double fSim_CutTail(void)
+{
+  return fSim_Fifo(RFM26_RELAY_CHUNK) * 2;
+}
+
+typedef struct
+{
+  double   start, end;
+  int      node;
+  uint8_t  frame[RFM26_RELAY_FRAME_LEN];
+} SIM_TX;
+
+typedef struct
+{
+  double t;
+  int    kind;                                            // 0 Tx start, 1 Rx end
+  int    tx;                                              // index in the Tx list
+  int    node;                                            // receiver for Rx end
+} SIM_EV;
+
+struct SimLater
+{
+  bool operator()(const SIM_EV& a, const SIM_EV& b) const { return a.t > b.t || (a.t == b.t && a.kind > b.kind); }
+};
+
+typedef struct
+{
+  unsigned delivered, copies, txs;
+  double   hop_sum, hop_max, e2e_sum;
+  unsigned hop_n;
+} SIM_RESULT;
+
+static SIM_RESULT tSim_Run(int hops, int frames, int range, double interval_us, int cut, int dedup)
+{
+  double air = (PREAMBLE_LEN + SYNC_LEN + RFM26_RELAY_FRAME_LEN) * 8e6 / BITRATE;
+  double turn = cut ? fSim_CutTurn() : fSim_StoreTurn();
+  double back = T_RX_TURN_US + (cut ? 0 : fSim_StoreBack());
+  std::vector<RFM26_RELAY> node(hops + 1);
+  std::vector<double> busy(hops + 1, -1);                 // deaf until, transmitting or reconfiguring
+  std::vector<SIM_TX> tx;
+  std::vector<double> sent(frames);
+  std::vector<char> got(frames, 0);
+  std::vector<std::vector<double> > first(frames, std::vector<double>(hops + 1, -1));
+  std::priority_queue<SIM_EV, std::vector<SIM_EV>, SimLater> q;
+  SIM_RESULT res;
+
+  memset(&res, 0, sizeof(res));
+  for (int i = 0; i <= hops; i++)
+    RFM26_Relay_Init(&node[i], (uint8_t)i);
+
+  for (int f = 0; f < frames; f++) {
+    SIM_TX t;
+    RFM26_Relay_Header(&node[0], (uint8_t)hops, (uint8_t)hops, t.frame);
+    t.frame[RFM26_RELAY_HDR_LEN] = (uint8_t)f;
+    t.frame[RFM26_RELAY_HDR_LEN + 1] = (uint8_t)(f >> 8);
+    t.node = 0;
+    t.start = f * interval_us;
+    t.end = t.start + air;
+    sent[f] = t.start;
+    tx.push_back(t);
+    SIM_EV e = { t.start, 0, (int)tx.size() - 1, 0 };
+    q.push(e);
+  }
+
+  while (!q.empty()) {
+    SIM_EV e = q.top();
+    q.pop();
+    SIM_TX t = tx[e.tx];
+    if (e.kind == 0) {
+      if (busy[t.node] > t.start)
+        continue;                                         // Still on the previous frame, this one is lost
+      busy[t.node] = t.end + back;
+      res.txs++;
+      int f = t.frame[RFM26_RELAY_HDR_LEN] | (t.frame[RFM26_RELAY_HDR_LEN + 1] << 8);
+      if (first[f][t.node] < 0)
+        first[f][t.node] = t.start;
+      for (int n = t.node - range; n <= t.node + range; n++)
+        if (n >= 0 && n <= hops && n != t.node) {
+          SIM_EV r = { t.end, 1, e.tx, n };
+          q.push(r);
+        }
+      continue;
+    }
+
+    // Rx end: lost if the receiver transmitted or another frame in range overlapped
+    int n = e.node, ok = 1;
+    if (busy[n] > t.start)
+      ok = 0;
+    for (unsigned i = 0; ok && i < tx.size(); i++) {
+      if ((int)i == e.tx || tx[i].start >= t.end || tx[i].end <= t.start || tx[i].start > e.t)
+        continue;
+      if (abs(tx[i].node - n) <= range || tx[i].node == n)
+        ok = 0;
+    }
+    if (!ok)
+      continue;
+
+    uint8_t frame[RFM26_RELAY_FRAME_LEN];
+    memcpy(frame, t.frame, sizeof(frame));
+    if (!dedup) {
+      RFM26_RELAY_STATS s = node[n].stats;
+      RFM26_Relay_Init(&node[n], (uint8_t)n);             // forget every frame seen
+      node[n].stats = s;
+    }
+    uint8_t action = RFM26_Relay_Route(&node[n], frame);
+    int f = frame[RFM26_RELAY_HDR_LEN] | (frame[RFM26_RELAY_HDR_LEN + 1] << 8);
+    if ((action & C_RELAY_DELIVER) && n == hops) {
+      res.copies++;
+      if (!got[f]) {
+        got[f] = 1;
+        res.delivered++;
+        res.e2e_sum += t.end - sent[f];
+      }
+    }
+    if (action & C_RELAY_FORWARD) {
+      SIM_TX fw;
+      memcpy(fw.frame, frame, sizeof(frame));
+      fw.node = n;
+      fw.start = t.end + turn + T_WARMUP_US;
+      fw.end = fw.start + air;
+      if (first[f][n] < 0 && first[f][t.node] >= 0 && n == t.node + 1) {
+        double hop = fw.start - t.start;
+        res.hop_sum += hop;
+        res.hop_n++;
+        if (hop > res.hop_max)
+          res.hop_max = hop;
+      }
+      tx.push_back(fw);
+      SIM_EV s = { fw.start, 0, (int)tx.size() - 1, 0 };
+      q.push(s);
+    }
+  }
+  return res;
+}
+
+int main(int argc, char** argv)
+{
+  int hops = argc > 1 ? atoi(argv[1]) : 6;
+  int frames = argc > 2 ? atoi(argv[2]) : 200;
+  int range = argc > 3 ? atoi(argv[3]) : 1;
+  double interval = argc > 4 ? atof(argv[4]) : 4;
+  gf_Spi = argc > 5 ? atof(argv[5]) : 3.0;                // 4MHz SPI on a 16MHz AVR, with the call
+  gf_Cts = argc > 6 ? atof(argv[6]) : 40.0;
+
+  if (hops < 1 || hops > 250 || frames < 1 || frames > 65535 || range < 1 || interval <= 0) {
+    fprintf(stderr, "usage: %s [hops] [frames] [range] [interval_frames] [spi_us_per_byte] [cts_us]\n", argv[0]);
+    return 1;
+  }
+  double air = (PREAMBLE_LEN + SYNC_LEN + RFM26_RELAY_FRAME_LEN) * 8e6 / BITRATE;
+  double under = (PREAMBLE_LEN + SYNC_LEN) * 8e6 / BITRATE + T_WARMUP_US;
+
+  printf("%d hops, range %d, %d frames every %.1f frame times, %d byte frames at %d bps (%.1f ms on air)\n",
+         hops, range, frames, interval, RFM26_RELAY_FRAME_LEN, BITRATE, air / 1000);
+  printf("PACKET_RX to START_TX: store %.0f us, cut %.0f us; cut tail %.0f us under %.0f us of preamble\n\n",
+         fSim_StoreTurn(), fSim_CutTurn(), fSim_CutTail(), under);
+  if (fSim_CutTail() > under)
+    printf("WARNING: tail does not fit under the preamble, Tx FIFO underflows\n\n");
+
+  printf("path   dedup  delivered  copies  per hop ms  over air ms  hop max ms  end-to-end ms  tx/frame\n");
+  for (int cut = 0; cut < 2; cut++)
+    for (int dedup = 1; dedup >= 0; dedup--) {
+      SIM_RESULT r = tSim_Run(hops, frames, range, interval * air, cut, dedup);
+      double hop = r.hop_n ? r.hop_sum / r.hop_n : 0;
+      printf("%-6s %5s  %4u/%-4d  %6u  %10.2f  %11.3f  %10.2f  %13.1f  %8.1f\n", cut ? "cut" : "store",
+             dedup ? "yes" : "no", r.delivered, frames, r.copies, hop / 1000, (hop - air) / 1000, r.hop_max / 1000,
+             r.delivered ? r.e2e_sum / r.delivered / 1000 : 0.0, r.delivered ? (double)r.txs / r.delivered : 0.0);
+    }
+  return 0;
+}
@@ -0,0 +1,749 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rfm26_emu.h"
+#include "rfm26_driver.h"
+
+/************************Description************************
+  Si446x emulator behind the driver's transport. Built for the
+  host the driver takes the RFM26_HAL_HOST backend of
+  rfm26_hal.h; this file supplies those functions for the node
+  last entered, and the chip behind them:
+
+    commands   POWER_UP, SET_PROPERTY, GET_PROPERTY,
+               GPIO_PIN_CFG, FIFO_INFO, GET_INT_STATUS,
+               START_TX, START_RX, REQUEST_DEVICE_STATE,
+               CHANGE_STATE; READ_CMD_BUFF with CTS timing,
+               FRR A..D, Tx and Rx FIFO
+    states     SLEEP, SPI_ACTIVE, READY, TX, RX with the
+               TXCOMPLETE, RXVALID and RXINVALID next states
+    nIRQ       INT_CTL enables over PH, MODEM and CHIP pending
+               bits, falling edges go to the attached ISR
+
+  Node time only moves with SPI bytes, pin calls and delays,
+  so a driver busy loop always ends. Frames leave through the
+  tx callback with their airtime and come back through
+  RFM26_Emu_Receive; what is heard is the caller's business.
+  A Tx cut short by a state change stays on air to its end.
+
+  Several nodes in one process: the driver keeps its state in
+  globals. With its .data and .bss renamed to one section, the
+  linker gives the bounds and every node keeps a copy that is
+  swapped in by RFM26_Emu_Enter:
+
+    g++ -O2 -c -I.. ../rfm26_driver.cpp
+    objcopy --set-section-flags .bss=alloc,load,contents,data \
+            --rename-section .data=rfm26_state \
+            --rename-section .bss=rfm26_state rfm26_driver.o
+
+  Built without it, nodes share the one set of driver globals:
+  one node per process, or one driver image per node, each
+  loaded on its own (dlopen of copies of a shared object).
+  The running node is per thread, so nodes on different images
+  can run on different threads.
+**********************************************************/
+
+extern "C" char __start_rfm26_state[] __attribute__((weak));
+extern "C" char __stop_rfm26_state[] __attribute__((weak));
+
+const RFM26_EMU_TIMING RFM26EmuTimingDefault = {
+  10.0,                                                   // SPI_CLOCK_DIV16, 8us a byte plus the call
+  4.0,                                                    // digitalRead/Write on an AVR
+  50.0,                                                   // SET_PROPERTY, START_xx, GET_INT_STATUS
+  15000.0,                                                // POWER_UP
+  150.0,                                                  // READY to TX
+  150.0,                                                  // READY to RX
+};
+
+//Property groups kept, the ones the driver and the WDS table write
+static const uint8_t gt_EmuGroup[RFM26_EMU_GROUPS] = {
+  0x00, 0x01, 0x02, 0x10, 0x11, 0x12, 0x20, 0x21, 0x22, 0x23, 0x30, 0x40,
+};
+
+//PA_PWR_LVL of RFM26PowerTbl and the output power the module header gives for it
+static const struct { uint8_t lvl; int8_t dbm; } gt_EmuPa[4] = {
+  { 0x16, 11 }, { 0x20, 14 }, { 0x30, 17 }, { 0x7F, 20 },
+};
+
+//CRC bytes per PKT_CRC_CONFIG polynomial
+static const uint8_t gt_EmuCrcBytes[16] = { 0, 1, 2, 2, 2, 2, 4, 4, 4, 2, 0, 0, 0, 0, 0, 0 };
+
+static thread_local RFM26_EMU* gt_EmuCur = 0;             // node the driver runs for, per thread
+static uint8_t* abEmu_Boot = 0;                           // driver globals before any node ran
+
+static size_t lEmu_StateSize(void)
+{
+  if (!__start_rfm26_state || !__stop_rfm26_state)
+    return 0;
+  return (size_t)(__stop_rfm26_state - __start_rfm26_state);
+}
+
+static uint8_t* pEmu_Prop(RFM26_EMU* e, uint8_t group, uint8_t index)
+{
+  uint8_t g;
+
+  if (index >= RFM26_EMU_PROPS)
+    return 0;
+  for (g = 0; g < RFM26_EMU_GROUPS; g++)
+    if (gt_EmuGroup[g] == group)
+      return &e->prop[g][index];
+  return 0;
+}
+
+uint8_t RFM26_Emu_Prop(const RFM26_EMU* e, uint8_t group, uint8_t index)
+{
+  uint8_t* p = pEmu_Prop((RFM26_EMU*)e, group, index);
+
+  return p ? *p : 0;
+}
+
+static void vEmu_SetProp(RFM26_EMU* e, uint8_t group, uint8_t index, uint8_t v)
+{
+  uint8_t* p = pEmu_Prop(e, group, index);
+
+  if (p)
+    *p = v;
+}
+
+/**********************************************************
+**Name:     vEmu_Reset
+**Function: Chip after POWER_UP: property reset values the
+            driver relies on, FIFOs and interrupts cleared
+**********************************************************/
+static void vEmu_Reset(RFM26_EMU* e)
+{
+  memset(e->prop, 0, sizeof(e->prop));
+  memset(e->gpio, 0, sizeof(e->gpio));
+  e->tx_n = e->rx_n = 0;
+  e->ph_pend = e->modem_pend = e->chip_pend = 0;
+  e->rssi = 0;
+  e->channel = 0;
+  e->rx_len = 0;
+  memset(e->rx_next, 0, sizeof(e->rx_next));
+  e->tx_next = C_STATE_READY;
+  vEmu_SetProp(e, 0x01, 0x00, 0x04);                      // INT_CTL_ENABLE: CHIP
+  vEmu_SetProp(e, 0x01, 0x03, 0x04);                      // INT_CTL_CHIP_ENABLE: CHIP_READY
+  vEmu_SetProp(e, 0x02, 0x00, 0x01);                      // FRR_CTL_A..C_MODE
+  vEmu_SetProp(e, 0x02, 0x01, 0x02);
+  vEmu_SetProp(e, 0x02, 0x02, 0x09);
+  vEmu_SetProp(e, 0x10, 0x00, 0x08);                      // PREAMBLE_TX_LENGTH
+  vEmu_SetProp(e, 0x10, 0x04, 0x21);                      // PREAMBLE_CONFIG: 1010, length in bytes
+  vEmu_SetProp(e, 0x11, 0x00, 0x01);                      // SYNC_CONFIG: 2 bytes
+  vEmu_SetProp(e, 0x11, 0x01, 0x2D);
+  vEmu_SetProp(e, 0x11, 0x02, 0xD4);
+  vEmu_SetProp(e, 0x20, 0x03, 0x0F);                      // MODEM_DATA_RATE
+  vEmu_SetProp(e, 0x20, 0x04, 0x42);
+  vEmu_SetProp(e, 0x20, 0x05, 0x40);
+  vEmu_SetProp(e, 0x20, 0x4E, 0x40);                      // MODEM_RSSI_COMP
+  vEmu_SetProp(e, 0x22, 0x01, 0x7F);                      // PA_PWR_LVL
+  vEmu_SetProp(e, 0x40, 0x00, 0x3C);                      // FREQ_CONTROL_INTE, FRAC
+  vEmu_SetProp(e, 0x40, 0x01, 0x08);
+}
+
+static uint16_t wEmu_FieldLen(const RFM26_EMU* e)
+{
+  return (uint16_t)(RFM26_Emu_Prop(e, 0x12, 0x0D) & 0x1F) << 8 | RFM26_Emu_Prop(e, 0x12, 0x0E);
+}
+
+//Rx packet length from a length field (PKT_LEN DST_FIELD set): field 1 is the length byte, 0 if fixed
+static uint16_t wEmu_VarLen(const RFM26_EMU* e, const uint8_t* data, uint16_t have)
+{
+  uint16_t f1 = wEmu_FieldLen(e);
+
+  if (!(RFM26_Emu_Prop(e, 0x12, 0x08) & 0x07) || !f1 || have < f1)
+    return 0;
+  return (uint16_t)(f1 + data[f1 - 1] + (int8_t)RFM26_Emu_Prop(e, 0x12, 0x0A));
+}
+
+//Tx length with TX_LEN 0: fields 1..5 as configured, up to the first of length 0; the length
+//byte in the FIFO is not looked at, PKT_LEN applies to Rx only
+static uint16_t wEmu_TxFieldsLen(const RFM26_EMU* e)
+{
+  uint16_t len = 0, f;
+  uint8_t i;
+
+  for (i = 0; i < 5; i++) {
+    f = (uint16_t)(RFM26_Emu_Prop(e, 0x12, 0x0D + 4 * i) & 0x1F) << 8 | RFM26_Emu_Prop(e, 0x12, 0x0E + 4 * i);
+    if (f == 0)
+      break;
+    len += f;
+  }
+  return len;
+}
+
+//CRC bytes on air: a polynomial and field 1 CRC_ENABLE with SEND_CRC
+static uint8_t bEmu_CrcBytes(const RFM26_EMU* e)
+{
+  if ((RFM26_Emu_Prop(e, 0x12, 0x10) & 0x22) != 0x22)
+    return 0;
+  return gt_EmuCrcBytes[RFM26_Emu_Prop(e, 0x12, 0x00) & 0x0F];
+}
+
+static void vEmu_Isr(RFM26_EMU* e)
+{
+  if (e->irq_pending && e == gt_EmuCur && !e->irq_off) {
+    e->irq_pending = 0;
+    if (e->isr)
+      e->isr();
+  }
+}
+
+/**********************************************************
+**Name:     vEmu_Nirq
+**Function: nIRQ pin from pending bits and INT_CTL enables, a
+            falling edge is counted and goes to the ISR as soon
+            as the node runs with interrupts on
+**********************************************************/
+static void vEmu_Nirq(RFM26_EMU* e)
+{
+  uint8_t en = RFM26_Emu_Prop(e, 0x01, 0x00);
+  uint8_t low = ((en & 0x01) && (e->ph_pend & RFM26_Emu_Prop(e, 0x01, 0x01))) ||
+                ((en & 0x02) && (e->modem_pend & RFM26_Emu_Prop(e, 0x01, 0x02))) ||
+                ((en & 0x04) && (e->chip_pend & RFM26_Emu_Prop(e, 0x01, 0x03)));
+
+  if (e->nirq && low) {
+    e->irq_edges++;
+    e->irq_pending = e->isr != 0;
+  }
+  e->nirq = !low;
+  vEmu_Isr(e);
+}
+
+static void vEmu_Cut(RFM26_EMU* e)
+{
+  if (e->state == C_STATE_TX && e->now < e->tx_end)
+    e->stats.tx_cut++;
+}
+
+/**********************************************************
+**Name:     vEmu_StartTx
+**Function: Put len bytes of Tx FIFO on air, the packet handler
+            field lengths if len is 0
+**********************************************************/
+static void vEmu_StartTx(RFM26_EMU* e, double t, uint16_t len)
+{
+  uint8_t data[RFM26_EMU_FIFO];
+  uint8_t n;
+  double start;
+
+  if (len == 0)
+    len = wEmu_TxFieldsLen(e);
+  if (len == 0) {                                         // nothing to send, stays where it is
+    e->stats.fifo_err++;
+    return;
+  }
+  if (len > RFM26_EMU_FIFO)
+    len = RFM26_EMU_FIFO;                                 // no refill while on air
+  n = len < e->tx_n ? (uint8_t)len : e->tx_n;
+  memset(data, 0, sizeof(data));
+  memcpy(data, e->tx_fifo, n);
+  memmove(e->tx_fifo, e->tx_fifo + n, e->tx_n - n);
+  e->tx_n -= n;
+  if (n < len) {
+    e->chip_pend |= C_EMU_CHIP_FIFO_ERR;
+    e->stats.fifo_err++;
+  }
+  start = t + e->tm->tx_tune_us;
+  e->state = C_STATE_TX;
+  e->tx_end = start + RFM26_Emu_Airtime(e, len);
+  e->stats.tx_frames++;
+  if (e->tx)
+    e->tx(e->ctx, e, start, e->tx_end, data, len);
+}
+
+static void vEmu_Goto(RFM26_EMU* e, uint8_t st, double t)
+{
+  switch (st) {
+    case C_STATE_NOCHANGE:
+      break;
+    case C_STATE_TX:
+      vEmu_StartTx(e, t, 0);
+      break;
+    case C_STATE_RX:
+    case C_EMU_RX_TUNE:
+      e->state = C_STATE_RX;
+      e->rx_since = t + e->tm->rx_tune_us;
+      break;
+    case C_STATE_SLEEP:
+    case C_STATE_SPI_ACTIVE:
+      e->state = st;
+      break;
+    default:                                              // READY, READY2, TX_TUNE
+      e->state = C_STATE_READY;
+      break;
+  }
+}
+
+/**********************************************************
+**Name:     vEmu_Chip
+**Function: Bring the chip to time t: the end of boot raises
+            CHIP_READY, the end of a Tx raises PACKET_SENT and
+            moves to TXCOMPLETE_STATE
+**********************************************************/
+static void vEmu_Chip(RFM26_EMU* e, double t)
+{
+  if (e->booting && t >= e->cts_at) {
+    e->booting = 0;
+    e->chip_pend |= C_EMU_CHIP_READY;
+  }
+  if (e->state == C_STATE_TX && t >= e->tx_end) {
+    e->ph_pend |= C_PH_PACKET_SENT;
+    vEmu_Goto(e, e->tx_next ? e->tx_next : C_STATE_READY, e->tx_end);
+    if (e->state == C_STATE_TX && e->tx_end <= t)        // TXCOMPLETE_STATE = TX with nothing to send
+      e->state = C_STATE_READY;
+  }
+  vEmu_Nirq(e);
+}
+
+static uint8_t bEmu_Frr(RFM26_EMU* e, uint8_t which)
+{
+  uint8_t ip = (e->ph_pend ? 0x01 : 0) | (e->modem_pend ? 0x02 : 0) | (e->chip_pend ? 0x04 : 0);
+
+  if (which > 3)
+    return 0;
+  switch (RFM26_Emu_Prop(e, 0x02, which)) {
+    case 1:  return ip;                                   // INT_STATUS
+    case 2:  return ip;                                   // INT_PEND
+    case 3:  return e->ph_pend;                           // PH_STATUS
+    case 4:  return e->ph_pend;                           // PH_PEND
+    case 5:  return e->modem_pend;
+    case 6:  return e->modem_pend;
+    case 7:  return e->chip_pend;
+    case 8:  return e->chip_pend;
+    case 9:  return e->state;
+    case 10: return e->rssi;                              // LATCHED_RSSI
+    default: return 0;
+  }
+}
+
+/**********************************************************
+**Name:     vEmu_Command
+**Function: Run the command collected in e->cmd at nCS rise
+**********************************************************/
+static void vEmu_Command(RFM26_EMU* e)
+{
+  const uint8_t* c = e->cmd;
+  uint8_t n = e->cmd_len, i;
+
+  e->stats.commands++;
+  memset(e->resp, 0, sizeof(e->resp));
+  e->cts_at = e->now + e->tm->cts_us;
+  switch (c[0]) {
+    case 0x02:                                            // POWER_UP
+      vEmu_Reset(e);
+      e->state = C_STATE_SPI_ACTIVE;
+      e->booting = 1;                                     // CHIP_READY with CTS
+      e->cts_at = e->now + e->tm->boot_us;
+      break;
+    case 0x11:                                            // SET_PROPERTY
+      for (i = 0; i < c[2] && 4 + i < n; i++)
+        vEmu_SetProp(e, c[1], (uint8_t)(c[3] + i), c[4 + i]);
+      break;
+    case 0x12:                                            // GET_PROPERTY
+      for (i = 0; i < c[2] && i < sizeof(e->resp); i++)
+        e->resp[i] = RFM26_Emu_Prop(e, c[1], (uint8_t)(c[3] + i));
+      break;
+    case 0x13:                                            // GPIO_PIN_CFG, 0 leaves a pin as it is
+      for (i = 0; i < 7; i++) {
+        if (1 + i < n && c[1 + i])
+          e->gpio[i] = c[1 + i];
+        e->resp[i] = e->gpio[i];
+      }
+      break;
+    case 0x15:                                            // FIFO_INFO
+      if (n > 1 && (c[1] & 0x02))
+        e->rx_n = 0;
+      if (n > 1 && (c[1] & 0x01))
+        e->tx_n = 0;
+      e->resp[0] = e->rx_n;
+      e->resp[1] = RFM26_EMU_FIFO - e->tx_n;
+      break;
+    case 0x20:                                            // GET_INT_STATUS, a 0 bit clears, no argument clears all
+      e->resp[0] = e->resp[1] = (e->ph_pend ? 0x01 : 0) | (e->modem_pend ? 0x02 : 0) | (e->chip_pend ? 0x04 : 0);
+      e->resp[2] = e->resp[3] = e->ph_pend;
+      e->resp[4] = e->resp[5] = e->modem_pend;
+      e->resp[6] = e->resp[7] = e->chip_pend;
+      e->ph_pend &= n > 1 ? c[1] : 0;
+      e->modem_pend &= n > 2 ? c[2] : 0;
+      e->chip_pend &= n > 3 ? c[3] : 0;
+      break;
+    case 0x22:                                            // GET_MODEM_STATUS, a 0 bit clears
+      e->resp[0] = e->resp[1] = e->modem_pend;
+      e->resp[2] = e->resp[3] = e->resp[4] = e->resp[5] = e->rssi;
+      e->resp[6] = (uint8_t)((uint16_t)e->afc >> 8);
+      e->resp[7] = (uint8_t)e->afc;
+      e->modem_pend &= n > 1 ? c[1] : 0;
+      break;
+    case 0x31:                                            // START_TX
+      vEmu_Cut(e);
+      e->channel = n > 1 ? c[1] : 0;
+      e->tx_next = n > 2 ? c[2] >> 4 : 0;
+      vEmu_StartTx(e, e->now, n > 4 ? (uint16_t)(c[3] & 0x1F) << 8 | c[4] : 0);
+      break;
+    case 0x32:                                            // START_RX
+      vEmu_Cut(e);
+      e->channel = n > 1 ? c[1] : 0;
+      e->rx_len = n > 4 ? (uint16_t)(c[3] & 0x1F) << 8 | c[4] : 0;
+      for (i = 0; i < 3; i++)
+        e->rx_next[i] = 5 + i < n ? c[5 + i] : 0;
+      vEmu_Goto(e, C_STATE_RX, e->now);
+      break;
+    case 0x33:                                            // REQUEST_DEVICE_STATE
+      e->resp[0] = e->state;
+      e->resp[1] = e->channel;
+      break;
+    case 0x34:                                            // CHANGE_STATE
+      vEmu_Cut(e);
+      if (n > 1 && (c[1] & 0x0F) != C_STATE_NOCHANGE) {
+        if (e->state == C_STATE_TX)
+          e->state = C_STATE_READY;                       // Tx left, START_TX below is a new one
+        vEmu_Goto(e, c[1] & 0x0F, e->now);
+      }
+      break;
+    default:
+      e->stats.unknown++;
+      break;
+  }
+  vEmu_Nirq(e);
+}
+
+uint8_t RFM26_Emu_Init(RFM26_EMU* e, const RFM26_EMU_TIMING* tm, RFM26_EMU_TX tx, void* ctx)
+{
+  size_t size = lEmu_StateSize();
+
+  memset(e, 0, sizeof(*e));
+  e->tm = tm ? tm : &RFM26EmuTimingDefault;
+  e->tx = tx;
+  e->ctx = ctx;
+  e->state = C_EMU_OFF;
+  e->nirq = 1;
+  if (size) {
+    if (!abEmu_Boot) {
+      abEmu_Boot = (uint8_t*)malloc(size);
+      memcpy(abEmu_Boot, __start_rfm26_state, size);
+    }
+    e->drv = (uint8_t*)malloc(size);
+    if (!e->drv)
+      return 0;
+    memcpy(e->drv, abEmu_Boot, size);
+  }
+  return 1;
+}
+
+uint8_t RFM26_Emu_Swaps(void)
+{
+  return lEmu_StateSize() != 0;
+}
+
+void RFM26_Emu_Free(RFM26_EMU* e)
+{
+  if (gt_EmuCur == e)
+    gt_EmuCur = 0;
+  free(e->drv);
+  e->drv = 0;
+}
+
+void RFM26_Emu_Enter(RFM26_EMU* e, double t)
+{
+  size_t size = lEmu_StateSize();
+
+  if (gt_EmuCur != e) {
+    if (size && gt_EmuCur)
+      memcpy(gt_EmuCur->drv, __start_rfm26_state, size);
+    if (size)
+      memcpy(__start_rfm26_state, e->drv, size);
+    gt_EmuCur = e;
+  }
+  if (t > e->now)
+    e->now = t;
+  vEmu_Chip(e, e->now);
+}
+
+uint32_t RFM26_Emu_Listen(RFM26_EMU* e, double t)
+{
+  vEmu_Chip(e, t);
+  return e->state == C_STATE_RX && e->rx_since <= t ? RFM26_Emu_Channel(e) : 0;
+}
+
+double RFM26_Emu_RxSince(const RFM26_EMU* e)
+{
+  return e->state == C_STATE_RX ? e->rx_since : -1.0;
+}
+
+uint8_t RFM26_Emu_Receive(RFM26_EMU* e, double t, const uint8_t* data, uint16_t len, double dbm, uint8_t ok)
+{
+  uint16_t n;
+  uint8_t next;
+  double v;
+
+  vEmu_Chip(e, t);
+  if (e->state != C_STATE_RX || e->rx_since > t)
+    return 0;
+  n = e->rx_len ? e->rx_len : wEmu_VarLen(e, data, len);
+  if (n == 0)
+    n = wEmu_FieldLen(e);
+  if (n > len)
+    ok = 0;                                               // the chip reads on past the frame
+  if (n > RFM26_EMU_FIFO - e->rx_n) {
+    n = RFM26_EMU_FIFO - e->rx_n;
+    e->chip_pend |= C_EMU_CHIP_FIFO_ERR;
+    e->stats.fifo_err++;
+  }
+  memset(e->rx_fifo + e->rx_n, 0, n);
+  memcpy(e->rx_fifo + e->rx_n, data, n < len ? n : len);
+  e->rx_n += n;
+  v = (dbm + RFM26_Emu_Prop(e, 0x20, 0x4E) + 70) * 2;     // RSSI/2 - MODEM_RSSI_COMP - 70 = dBm
+  e->rssi = v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+  e->modem_pend |= C_EMU_MODEM_SYNC | C_EMU_MODEM_PREAMBLE;
+  if (!ok && bEmu_CrcBytes(e) && (RFM26_Emu_Prop(e, 0x12, 0x10) & 0x08)) {
+    e->ph_pend |= C_EMU_PH_CRC_ERROR;
+    e->stats.rx_crc_err++;
+    next = e->rx_next[2];
+  } else {
+    e->ph_pend |= C_PH_PACKET_RX;
+    e->stats.rx_frames++;
+    next = e->rx_next[1];
+  }
+  if (next == C_STATE_NOCHANGE || next == C_STATE_RX)
+    e->rx_since = t;
+  else
+    vEmu_Goto(e, next, t);
+  vEmu_Nirq(e);
+  return 1;
+}
+
+uint32_t RFM26_Emu_Channel(const RFM26_EMU* e)
+{
+  uint32_t frac = (uint32_t)RFM26_Emu_Prop(e, 0x40, 0x01) << 16 | (uint32_t)RFM26_Emu_Prop(e, 0x40, 0x02) << 8 |
+                  RFM26_Emu_Prop(e, 0x40, 0x03);
+  uint32_t step = (uint32_t)RFM26_Emu_Prop(e, 0x40, 0x04) << 8 | RFM26_Emu_Prop(e, 0x40, 0x05);
+  uint32_t code = ((uint32_t)RFM26_Emu_Prop(e, 0x40, 0x00) << 20) + frac + e->channel * step;
+
+  code ^= (uint32_t)(RFM26_Emu_Prop(e, 0x20, 0x51) & 0x07) << 28;
+  return code ? code : 1;
+}
+
+double RFM26_Emu_TxDbm(const RFM26_EMU* e)
+{
+  uint8_t lvl = RFM26_Emu_Prop(e, 0x22, 0x01) & 0x7F, i;
+
+  if (lvl == 0)
+    return -60.0;
+  if (lvl <= gt_EmuPa[0].lvl)
+    return gt_EmuPa[0].dbm + 20.0 * log10((double)lvl / gt_EmuPa[0].lvl);
+  for (i = 1; i < 4; i++)
+    if (lvl <= gt_EmuPa[i].lvl)
+      return gt_EmuPa[i - 1].dbm + (double)(gt_EmuPa[i].dbm - gt_EmuPa[i - 1].dbm) *
+             (lvl - gt_EmuPa[i - 1].lvl) / (gt_EmuPa[i].lvl - gt_EmuPa[i - 1].lvl);
+  return gt_EmuPa[3].dbm;
+}
+
+double RFM26_Emu_Airtime(const RFM26_EMU* e, uint16_t len)
+{
+  uint32_t rate = (uint32_t)RFM26_Emu_Prop(e, 0x20, 0x03) << 16 | (uint32_t)RFM26_Emu_Prop(e, 0x20, 0x04) << 8 |
+                  RFM26_Emu_Prop(e, 0x20, 0x05);
+  uint8_t sync = RFM26_Emu_Prop(e, 0x11, 0x00);
+  double bits;
+
+  bits = RFM26_Emu_Prop(e, 0x10, 0x00) * ((RFM26_Emu_Prop(e, 0x10, 0x04) & 0x20) ? 8 : 4);
+  bits += (sync & 0x80) ? 0 : ((sync & 0x03) + 1) * 8;    // SKIP_TX
+  bits += (len + bEmu_CrcBytes(e)) * 8;
+  return bits * 1e6 / (rate ? rate : 1);
+}
+
+/**********************************************************
+  rfm26_hal.h transport of the running node
+**********************************************************/
+
+extern "C" {
+
+void RFM26_Hal_Init(void)
+{
+}
+
+void RFM26_Hal_Select(void)
+{
+  RFM26_EMU* e = gt_EmuCur;
+
+  if (!e)
+    return;
+  e->now += e->tm->pin_us;
+  if (!e->sel) {                                          // transaction starts
+    vEmu_Chip(e, e->now);
+    e->sel = 1;
+    e->pos = 0;
+    e->cmd_len = 0;
+  }
+}
+
+void RFM26_Hal_Release(void)
+{
+  RFM26_EMU* e = gt_EmuCur;
+
+  if (!e)
+    return;
+  e->now += e->tm->pin_us;
+  if (e->sel) {                                           // command runs at nCS rise
+    e->sel = 0;
+    if (e->pos && e->cmd_len && e->op == e->cmd[0] && !e->reset)
+      vEmu_Command(e);
+    e->cmd_len = 0;
+  }
+}
+
+uint8_t RFM26_Hal_Xfer(uint8_t dat)
+{
+  RFM26_EMU* e = gt_EmuCur;
+  uint8_t k;
+
+  if (!e)
+    return 0xFF;
+  e->now += e->tm->spi_us;
+  e->stats.spi_bytes++;
+  if (!e->sel || e->reset)
+    return 0x00;
+  k = e->pos;
+  if (e->pos < 0xFF)
+    e->pos++;
+  if (k == 0) {
+    e->op = dat;
+    if (dat == 0x44)
+      e->stats.cts_polls++;
+    else if (dat != 0x66 && dat != 0x77 && (dat & 0xF0) != 0x50) {
+      if (e->now < e->cts_at)
+        e->stats.cts_busy++;
+      e->cmd[0] = dat;
+      e->cmd_len = 1;
+    }
+    return 0xFF;
+  }
+  switch (e->op) {
+    case 0x44:                                            // READ_CMD_BUFF: CTS, then the response
+      if (k == 1)
+        return e->now >= e->cts_at && e->state != C_EMU_OFF ? 0xFF : 0x00;
+      return k - 2 < (int)sizeof(e->resp) ? e->resp[k - 2] : 0;
+    case 0x66:                                            // WRITE_TX_FIFO
+      if (e->tx_n < RFM26_EMU_FIFO) {
+        e->tx_fifo[e->tx_n++] = dat;
+      } else {
+        e->chip_pend |= C_EMU_CHIP_FIFO_ERR;
+        e->stats.fifo_err++;
+        vEmu_Nirq(e);
+      }
+      return 0xFF;
+    case 0x77:                                            // READ_RX_FIFO
+      if (e->rx_n) {
+        dat = e->rx_fifo[0];
+        memmove(e->rx_fifo, e->rx_fifo + 1, --e->rx_n);
+        return dat;
+      }
+      e->chip_pend |= C_EMU_CHIP_FIFO_ERR;
+      e->stats.fifo_err++;
+      vEmu_Nirq(e);
+      return 0;
+    case 0x50:                                            // FRR_A..D_READ, reads run on to the next FRR
+      return bEmu_Frr(e, (uint8_t)(k - 1));
+    case 0x51:
+      return bEmu_Frr(e, (uint8_t)k);
+    case 0x53:
+      return bEmu_Frr(e, (uint8_t)(k + 1));
+    case 0x57:
+      return bEmu_Frr(e, (uint8_t)(k + 2));
+    default:
+      if (e->cmd_len < sizeof(e->cmd))
+        e->cmd[e->cmd_len++] = dat;
+      return 0xFF;
+  }
+}
+
+void RFM26_Hal_Write(const uint8_t* p, uint16_t n)
+{
+  while (n--)
+    RFM26_Hal_Xfer(*p++);
+}
+
+void RFM26_Hal_Read(uint8_t* p, uint16_t n)
+{
+  while (n--)
+    *p++ = RFM26_Hal_Xfer(0x00);
+}
+
+void RFM26_Hal_Reset(uint8_t level)
+{
+  RFM26_EMU* e = gt_EmuCur;
+
+  if (!e)
+    return;
+  e->now += e->tm->pin_us;
+  if (level && !e->reset) {                               // shutdown
+    e->state = C_EMU_OFF;
+    e->booting = 0;
+    vEmu_Reset(e);
+    e->prop[1][0] = 0;                                    // no interrupts while off
+    vEmu_Nirq(e);
+  }
+  e->reset = level != 0;
+}
+
+uint8_t RFM26_Hal_Irq(void)
+{
+  RFM26_EMU* e = gt_EmuCur;
+
+  if (!e)
+    return 1;
+  e->now += e->tm->pin_us;
+  vEmu_Chip(e, e->now);
+  return e->nirq;
+}
+
+void RFM26_Hal_Attach(void (*isr)(void))
+{
+  if (gt_EmuCur)
+    gt_EmuCur->isr = isr;
+}
+
+uint32_t RFM26_Hal_Micros(void)
+{
+  RFM26_EMU* e = gt_EmuCur;
+
+  if (!e)
+    return 0;
+  e->now += e->tm->pin_us;
+  return (uint32_t)(uint64_t)e->now;                      // wraps as on the MCU
+}
+
+void RFM26_Hal_DelayUs(uint16_t us)
+{
+  RFM26_EMU* e = gt_EmuCur;
+
+  if (!e)
+    return;
+  e->now += us;
+  vEmu_Chip(e, e->now);
+}
+
+void RFM26_Hal_DelayMs(uint16_t ms)
+{
+  RFM26_EMU* e = gt_EmuCur;
+
+  if (!e)
+    return;
+  e->now += ms * 1000.0;
+  vEmu_Chip(e, e->now);
+}
+
+void RFM26_Hal_IrqOff(void)
+{
+  if (gt_EmuCur)
+    gt_EmuCur->irq_off = 1;
+}
+
+void RFM26_Hal_IrqOn(void)
+{
+  if (gt_EmuCur) {
+    gt_EmuCur->irq_off = 0;
+    vEmu_Isr(gt_EmuCur);
+  }
+}
+
+}
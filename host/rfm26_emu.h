@@ -0,0 +1,223 @@
+#ifndef HopeDuino_26_EMU_H_
+#define HopeDuino_26_EMU_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define emulated chip limits
+#define RFM26_EMU_FIFO		64							// Tx and Rx FIFO bytes
+#define RFM26_EMU_GROUPS	12							// property groups kept
+#define RFM26_EMU_PROPS		0x60						// properties per group
+
+//Define chip states beyond the driver's C_STATE_xxx
+#define C_EMU_OFF			0x00						// RESET high, or not powered up yet
+#define C_EMU_TX_TUNE		0x05
+#define C_EMU_RX_TUNE		0x06
+
+//Define interrupt bits the emulator raises
+#define C_EMU_PH_CRC_ERROR	0x08
+#define C_EMU_MODEM_SYNC	0x01
+#define C_EMU_MODEM_PREAMBLE	0x02
+#define C_EMU_CHIP_READY	0x04
+#define C_EMU_CHIP_FIFO_ERR	0x20						// FIFO_UNDERFLOW_OVERFLOW_ERROR
+
+typedef struct RFM26_EMU RFM26_EMU;
+
+//Frame put on air by START_TX or a hardware state change, start is the first preamble bit
+typedef void (*RFM26_EMU_TX)(void* ctx, RFM26_EMU* e, double start, double end, const uint8_t* data, uint16_t len);
+
+//Host side timing of the SPI link and the chip, in us
+typedef struct
+{
+  double spi_us;                                          // one SPI byte, call overhead included
+  double pin_us;                                          // nCS, RESET, nIRQ0 or clock access
+  double cts_us;                                          // command received to CTS
+  double boot_us;                                         // POWER_UP to CTS
+  double tx_tune_us;                                      // START_TX to the first preamble bit
+  double rx_tune_us;                                      // START_RX to listening
+} RFM26_EMU_TIMING;
+
+typedef struct
+{
+  uint32_t spi_bytes;
+  uint32_t commands;
+  uint32_t cts_polls;                                     // READ_CMD_BUFF transactions
+  uint32_t cts_busy;                                      // commands sent before CTS of the previous one
+  uint32_t unknown;                                       // commands the emulator does not know
+  uint32_t tx_frames;
+  uint32_t tx_cut;                                        // Tx left before the frame ended
+  uint32_t rx_frames;                                     // PACKET_RX raised
+  uint32_t rx_crc_err;                                    // CRC_ERROR raised
+  uint32_t fifo_err;
+} RFM26_EMU_STATS;
+
+struct RFM26_EMU
+{
+  double   now;                                           // node time, us: RFM26_Hal_Micros and the SPI clock
+  const RFM26_EMU_TIMING* tm;
+  RFM26_EMU_TX tx;
+  void*    ctx;
+  uint8_t* drv;                                           // driver globals of this node while another runs
+
+  // pins and SPI
+  uint8_t  reset;                                         // RESET pin level
+  uint8_t  sel;                                           // nCS low
+  uint8_t  op;                                            // first byte of the transaction
+  uint8_t  pos;                                           // bytes into the transaction
+  uint8_t  cmd[16];
+  uint8_t  cmd_len;
+  uint8_t  resp[16];
+  double   cts_at;                                        // CTS from this time on
+  uint8_t  booting;                                       // POWER_UP sent, CHIP_READY at cts_at
+
+  // chip
+  uint8_t  state;                                         // C_STATE_xxx, C_EMU_xxx
+  uint8_t  channel;
+  uint8_t  prop[RFM26_EMU_GROUPS][RFM26_EMU_PROPS];
+  uint8_t  gpio[7];                                       // GPIO_PIN_CFG
+  uint8_t  tx_fifo[RFM26_EMU_FIFO];
+  uint8_t  tx_n;
+  uint8_t  rx_fifo[RFM26_EMU_FIFO];
+  uint8_t  rx_n;
+  uint8_t  ph_pend, modem_pend, chip_pend;
+  uint8_t  rssi;                                          // latched, MODEM_RSSI_COMP applied
+  int16_t  afc;                                           // AFC_FREQ_OFFSET in GET_MODEM_STATUS, set by the caller
+  double   tx_end;                                        // last bit of the frame on air
+  uint8_t  tx_next;                                       // TXCOMPLETE_STATE
+  double   rx_since;                                      // listening from this time on
+  uint16_t rx_len;                                        // START_RX length, 0: length field or field 1 length
+  uint8_t  rx_next[3];                                    // RXTIMEOUT, RXVALID, RXINVALID states
+
+  // nIRQ
+  uint8_t  nirq;                                          // pin level
+  uint8_t  irq_off;                                       // RFM26_Hal_IrqOff
+  uint8_t  irq_pending;                                   // falling edge not yet given to the ISR
+  void   (*isr)(void);                                    // RFM26_Hal_Attach
+  uint32_t irq_edges;                                     // nIRQ falling edges so far
+
+  RFM26_EMU_STATS stats;
+};
+
+//Timing of an RFM26 at 1MHz SPI behind an Arduino
+extern const RFM26_EMU_TIMING RFM26EmuTimingDefault;
+
+/**********************************************************
+**Name:     RFM26_Emu_Init
+**Function: Emulated radio in shutdown, with a private copy of
+            the driver globals so several nodes can run the one
+            driver in a process
+**Input:    e, emulator
+            tm, timing, 0 for RFM26EmuTimingDefault
+            tx, called for every frame put on air
+            ctx, passed to tx
+**Output:   1 if ok, 0 out of memory
+**********************************************************/
+uint8_t RFM26_Emu_Init(RFM26_EMU* e, const RFM26_EMU_TIMING* tm, RFM26_EMU_TX tx, void* ctx);
+
+/**********************************************************
+**Name:     RFM26_Emu_Swaps
+**Function: Whether the driver globals are kept per node
+**Input:    None
+**Output:   1 if so, 0 if the driver object was not built for
+            it (see rfm26_emu.cpp) and all nodes share them
+**********************************************************/
+uint8_t RFM26_Emu_Swaps(void);
+
+/**********************************************************
+**Name:     RFM26_Emu_Free
+**Function: Release the driver globals copy
+**Input:    e, emulator
+**Output:   None
+**********************************************************/
+void RFM26_Emu_Free(RFM26_EMU* e);
+
+/**********************************************************
+**Name:     RFM26_Emu_Enter
+**Function: Make e the node the driver and the Arduino calls
+            act on, at time t or later if it is still busy;
+            a pending nIRQ edge reaches the ISR here
+**Input:    e, emulator
+            t, time in us
+**Output:   None
+**********************************************************/
+void RFM26_Emu_Enter(RFM26_EMU* e, double t);
+
+/**********************************************************
+**Name:     RFM26_Emu_Listen
+**Function: Whether the chip listens at a time
+**Input:    e, emulator
+            t, time in us
+**Output:   channel code (RFM26_Emu_Channel) if in Rx since t
+            or before, 0 if not
+**********************************************************/
+uint32_t RFM26_Emu_Listen(RFM26_EMU* e, double t);
+
+/**********************************************************
+**Name:     RFM26_Emu_RxSince
+**Function: Start of the current Rx
+**Input:    e, emulator
+**Output:   time in us, a negative value if not in Rx
+**********************************************************/
+double RFM26_Emu_RxSince(const RFM26_EMU* e);
+
+/**********************************************************
+**Name:     RFM26_Emu_Receive
+**Function: A frame ended at a listening chip: Rx FIFO,
+            latched RSSI, PACKET_RX or CRC_ERROR, RXVALID or
+            RXINVALID state. Without a CRC on air a bad frame
+            is taken as good, the caller corrupts it first
+**Input:    e, emulator
+            t, last bit time in us
+            data, frame bytes as sent
+            len, frame length
+            dbm, received power
+            ok, 0 if the frame was hit on air
+**Output:   1 if the chip took it
+**********************************************************/
+uint8_t RFM26_Emu_Receive(RFM26_EMU* e, double t, const uint8_t* data, uint16_t len, double dbm, uint8_t ok);
+
+/**********************************************************
+**Name:     RFM26_Emu_Channel
+**Function: Frequency of the chip as a code, frames meet only
+            on equal codes
+**Input:    e, emulator
+**Output:   FREQ_CONTROL, band and channel folded, never 0
+**********************************************************/
+uint32_t RFM26_Emu_Channel(const RFM26_EMU* e);
+
+/**********************************************************
+**Name:     RFM26_Emu_TxDbm
+**Function: Output power set by PA_PWR_LVL
+**Input:    e, emulator
+**Output:   dBm, RFM26PowerTbl rows are 20/17/14/11dBm
+**********************************************************/
+double RFM26_Emu_TxDbm(const RFM26_EMU* e);
+
+/**********************************************************
+**Name:     RFM26_Emu_Airtime
+**Function: Time on air of a frame as configured: preamble,
+            sync word, length bytes, CRC at MODEM_DATA_RATE
+**Input:    e, emulator
+            len, START_TX length
+**Output:   us
+**********************************************************/
+double RFM26_Emu_Airtime(const RFM26_EMU* e, uint16_t len);
+
+/**********************************************************
+**Name:     RFM26_Emu_Prop
+**Function: Property value as the chip holds it
+**Input:    e, emulator
+            group, property group
+            index, property index
+**Output:   value, 0 for a group the emulator does not keep
+**********************************************************/
+uint8_t RFM26_Emu_Prop(const RFM26_EMU* e, uint8_t group, uint8_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,478 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#include "rfm26_gateway.h"
+#include "rfm26_emu.h"
+#include "rfm26_driver.h"
+#include "rfm26_crc.h"
+
+/************************Description************************
+  Host gateway runtime: many radios, each with its own copy of
+  the driver, frames handed to worker threads.
+
+    radio threads   radio k % threads; each loop boots, polls
+                    and serves its radios through the driver
+                    calls the sketch uses: receive_message() on
+                    nIRQ, send_message() for downlink, then
+                    RFM26_ChangeToRxMode() after PACKET_SENT
+    worker queues   one bounded lock-free queue per worker,
+                    every radio thread pushes, the worker pops;
+                    a source always goes to the same worker, so
+                    deduplication state is never shared
+    workers         CRC check, duplicate suppression per source
+                    over half the 16 bit sequence space, lost
+                    frame count, strongest radio, then the sink
+    downlink        one queue per radio, any worker pushes
+
+  The driver keeps its state in globals, so every radio loads
+  its own image: the shared object is copied once per radio
+  and each copy dlopen'ed on its own. Arduino calls from the
+  images land in rfm26_emu.cpp in the executable, which keeps
+  the running radio per thread.
+
+    g++ -O2 -fPIC -shared -Wl,-Bsymbolic -I.. -o rfm26_drv.so \
+        ../rfm26_driver.cpp ../rfm26_energy.cpp ../rfm26_capture.cpp \
+        ../rfm26_config.cpp ../rfm26_profiles.cpp ../rfm26_cal.cpp ../rfm26_snap.cpp
+
+  and the executable linked with -rdynamic -pthread -ldl.
+**********************************************************/
+
+typedef struct
+{
+  std::atomic<uint64_t> seq;
+  RFM26_GW_FRAME f;
+} GW_SLOT;
+
+//Bounded queue, many producers and one consumer
+typedef struct
+{
+  alignas(64) std::atomic<uint64_t> head;                 // producers
+  alignas(64) uint64_t tail;                              // consumer only
+  uint64_t mask;
+  GW_SLOT* slot;
+} GW_MPSC;
+
+typedef struct
+{
+  RFM26_EMU emu;
+  void*    so;
+  void   (*EntryRx)(void);
+  uint8_t (*Receive)(uint8_t*);
+  void   (*Send)(uint8_t*, uint8_t);
+  void   (*SetIntCtl)(uint8_t, uint8_t, uint8_t, uint8_t);
+  uint32_t (*TxStamp)(void);
+  void   (*ToRx)(uint8_t);
+  const RFM26_PKT_INFO* (*RxInfo)(void);
+  GW_MPSC  txq;
+  uint8_t  tx_busy;
+  uint8_t  air_done;
+  uint64_t rx, missed, queue_full, tx;
+} GW_RADIO;
+
+typedef struct
+{
+  RFM26_GW_SOURCE a;
+  uint16_t max_seq;                                       // newest sequence seen
+  uint64_t bits[65536 / 64];                              // sequences seen, within half the space behind max_seq
+} GW_SRC;
+
+typedef struct
+{
+  GW_MPSC  q;
+  std::vector<GW_SRC*> src;                               // source id / workers
+  RFM26_CRC crc;
+  uint64_t unique, dup, bad_crc;
+} GW_WORKER;
+
+struct RFM26_GW
+{
+  uint16_t radios;
+  uint8_t  threads, workers;
+  GW_RADIO* radio;
+  GW_WORKER* worker;
+  RFM26_GW_AIR air;
+  RFM26_GW_SINK sink;
+  void*    ctx;
+  std::atomic<uint32_t> air_left;                         // radios with frames still to come
+  std::atomic<int64_t> in_flight;                         // pushed to a worker, not through it yet
+  std::atomic<int64_t> tx_left;                           // downlink queued, not sent yet
+  std::atomic<uint8_t> stop;
+  std::atomic<uint64_t> tx_drop;
+};
+
+static uint8_t bGw_QueueInit(GW_MPSC* q, uint32_t size)
+{
+  q->head.store(0);
+  q->tail = 0;
+  q->mask = size - 1;
+  q->slot = new (std::nothrow) GW_SLOT[size];
+  if (!q->slot)
+    return 0;
+  for (uint32_t i = 0; i < size; i++)
+    q->slot[i].seq.store(i, std::memory_order_relaxed);
+  return 1;
+}
+
+static uint8_t bGw_Push(GW_MPSC* q, const RFM26_GW_FRAME* f)
+{
+  uint64_t pos = q->head.load(std::memory_order_relaxed);
+
+  for (;;) {
+    GW_SLOT* s = &q->slot[pos & q->mask];
+    int64_t dif = (int64_t)(s->seq.load(std::memory_order_acquire) - pos);
+    if (dif == 0) {
+      if (q->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        s->f = *f;
+        s->seq.store(pos + 1, std::memory_order_release);
+        return 1;
+      }
+    } else if (dif < 0) {
+      return 0;                                           // full
+    } else {
+      pos = q->head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+static uint8_t bGw_Pop(GW_MPSC* q, RFM26_GW_FRAME* f)
+{
+  GW_SLOT* s = &q->slot[q->tail & q->mask];
+
+  if (s->seq.load(std::memory_order_acquire) != q->tail + 1)
+    return 0;
+  *f = s->f;
+  s->seq.store(q->tail + q->mask + 1, std::memory_order_release);
+  q->tail++;
+  return 1;
+}
+
+static uint16_t wGw_Id(const uint8_t* data)
+{
+  return (uint16_t)data[RFM26_GW_ID] << 8 | data[RFM26_GW_ID + 1];
+}
+
+/**********************************************************
+**Name:     bGw_RadioStep
+**Function: One pass over a radio: finish a Tx, start a
+            downlink Tx, or take the next frame off the air
+**Output:   1 if there was something to do
+**********************************************************/
+static uint8_t bGw_RadioStep(RFM26_GW* gw, uint16_t id)
+{
+  GW_RADIO* r = &gw->radio[id];
+  RFM26_GW_FRAME f;
+  uint8_t data[RFM26_EMU_FIFO], buf[RFM26_PKT_LEN], n;
+  uint16_t len = sizeof(data);
+  double dbm = -80, t;
+
+  RFM26_Emu_Enter(&r->emu, r->emu.now);
+  if (r->tx_busy) {
+    RFM26_Emu_Enter(&r->emu, r->emu.tx_end);              // nothing else to do until the frame is out
+    if (r->TxStamp()) {
+      r->tx_busy = 0;
+      r->ToRx(RFM26_PKT_LEN);
+      r->tx++;
+      gw->tx_left.fetch_sub(1, std::memory_order_release);
+    }
+    return 1;
+  }
+  if (bGw_Pop(&r->txq, &f)) {
+    r->SetIntCtl(0x01, 0x30, 0x00, 0x00);                 // PACKET_SENT and PACKET_RX
+    r->Send(f.data, f.len);
+    r->tx_busy = 1;
+    return 1;
+  }
+  if (r->air_done)
+    return 0;
+  if (!gw->air(gw->ctx, id, data, &len, &dbm)) {
+    r->air_done = 1;
+    gw->air_left.fetch_sub(1, std::memory_order_release);
+    return 0;
+  }
+  t = RFM26_Emu_RxSince(&r->emu);
+  if (t < r->emu.now)
+    t = r->emu.now;
+  RFM26_Emu_Enter(&r->emu, t);
+  if (!RFM26_Emu_Receive(&r->emu, t, data, len, dbm, 1)) {
+    r->missed++;
+    return 1;
+  }
+  n = r->Receive(buf);
+  if (!n)
+    return 1;
+  f.radio = id;
+  f.len = n < RFM26_GW_FRAME_LEN ? n : RFM26_GW_FRAME_LEN;
+  f.rssi = r->RxInfo()->rssi;
+  f.t_us = r->RxInfo()->irq_us;
+  memcpy(f.data, buf, f.len);
+  r->rx++;
+  gw->in_flight.fetch_add(1, std::memory_order_relaxed);
+  GW_MPSC* q = &gw->worker[wGw_Id(f.data) % gw->workers].q;
+  while (!bGw_Push(q, &f)) {
+    r->queue_full++;
+    std::this_thread::yield();
+  }
+  return 1;
+}
+
+static void vGw_RadioThread(RFM26_GW* gw, uint8_t k)
+{
+  uint16_t r;
+  uint8_t busy;
+
+  for (r = k; r < gw->radios; r += gw->threads) {
+    RFM26_Emu_Enter(&gw->radio[r].emu, 0);
+    gw->radio[r].EntryRx();
+  }
+  while (!gw->stop.load(std::memory_order_acquire)) {
+    busy = 0;
+    for (r = k; r < gw->radios; r += gw->threads)
+      busy |= bGw_RadioStep(gw, r);
+    if (!busy)
+      std::this_thread::yield();
+  }
+}
+
+/**********************************************************
+**Name:     vGw_Decode
+**Function: Check, deduplicate and aggregate one frame on the
+            worker that owns its source
+**********************************************************/
+static void vGw_Decode(RFM26_GW* gw, GW_WORKER* w, const RFM26_GW_FRAME* f)
+{
+  uint16_t id, seq, d;
+  size_t k;
+  GW_SRC* s;
+
+  if (f->len < RFM26_GW_FRAME_LEN || !RFM26_Crc_Check(&w->crc, f->data, RFM26_GW_CRC)) {
+    w->bad_crc++;
+    return;
+  }
+  id = wGw_Id(f->data);
+  seq = (uint16_t)f->data[RFM26_GW_SEQ] << 8 | f->data[RFM26_GW_SEQ + 1];
+  k = id / gw->workers;
+  if (k >= w->src.size())
+    w->src.resize(k + 1, 0);
+  s = w->src[k];
+  if (!s) {
+    s = w->src[k] = (GW_SRC*)calloc(1, sizeof(GW_SRC));
+    s->max_seq = seq;
+  }
+  s->a.copies++;
+  if (s->bits[seq / 64] & (1ULL << (seq % 64))) {
+    w->dup++;
+    if (seq == s->a.last_seq && f->rssi > s->a.best_rssi) {
+      s->a.best_rssi = f->rssi;
+      s->a.best_radio = f->radio;
+    }
+    return;
+  }
+  s->bits[seq / 64] |= 1ULL << (seq % 64);
+  d = (uint16_t)(seq - s->max_seq);
+  if (s->a.frames && d && d < 0x8000) {                   // newer: forget what is now half the space behind
+    s->a.lost += d - 1;
+    for (uint16_t c = (uint16_t)(s->max_seq + 0x8001); c != (uint16_t)(seq + 0x8001); c++)
+      s->bits[c / 64] &= ~(1ULL << (c % 64));
+    s->max_seq = seq;
+  } else if (s->a.frames && d && s->a.lost) {
+    s->a.lost--;                                          // late, fills a gap
+  }
+  s->a.frames++;
+  s->a.last_seq = seq;
+  s->a.best_radio = f->radio;
+  s->a.best_rssi = f->rssi;
+  w->unique++;
+  if (gw->sink)
+    gw->sink(gw->ctx, gw, f);
+}
+
+static void vGw_WorkerThread(RFM26_GW* gw, uint8_t k)
+{
+  GW_WORKER* w = &gw->worker[k];
+  RFM26_GW_FRAME f;
+
+  for (;;) {
+    if (bGw_Pop(&w->q, &f)) {
+      vGw_Decode(gw, w, &f);
+      gw->in_flight.fetch_sub(1, std::memory_order_release);
+      continue;
+    }
+    if (gw->stop.load(std::memory_order_acquire))
+      break;
+    std::this_thread::yield();
+  }
+}
+
+RFM26_GW* RFM26_Gw_Open(const char* image, uint16_t radios, uint8_t threads, uint8_t workers, RFM26_GW_AIR air,
+                        RFM26_GW_SINK sink, void* ctx)
+{
+  std::vector<char> so;
+  char dir[] = "/tmp/rfm26_gw_XXXXXX";
+  FILE* fp;
+  int ch;
+  uint16_t r;
+  RFM26_GW* gw;
+
+  if (!image || radios < 1 || radios > RFM26_GW_RADIOS || threads < 1 || threads > RFM26_GW_THREADS ||
+      workers < 1 || workers > RFM26_GW_THREADS || !air)
+    return 0;
+  fp = fopen(image, "rb");
+  if (!fp)
+    return 0;
+  while ((ch = fgetc(fp)) != EOF)
+    so.push_back((char)ch);
+  fclose(fp);
+  if (!mkdtemp(dir))
+    return 0;
+
+  gw = new RFM26_GW;
+  gw->radios = radios;
+  gw->threads = threads < radios ? threads : (uint8_t)radios;
+  gw->workers = workers;
+  gw->air = air;
+  gw->sink = sink;
+  gw->ctx = ctx;
+  gw->radio = new GW_RADIO[radios]();
+  gw->worker = new GW_WORKER[workers]();
+  for (r = 0; r < workers; r++) {
+    bGw_QueueInit(&gw->worker[r].q, RFM26_GW_QUEUE);
+    RFM26_Crc_Init(&gw->worker[r].crc, C_CRC_SEED_ONES | C_CRC_CCITT_16, C_PKT_CRC_ENDIAN);
+    gw->worker[r].unique = gw->worker[r].dup = gw->worker[r].bad_crc = 0;
+  }
+  for (r = 0; r < radios; r++) {
+    GW_RADIO* g = &gw->radio[r];
+    std::string path = std::string(dir) + "/drv" + std::to_string(r) + ".so";
+
+    bGw_QueueInit(&g->txq, RFM26_GW_TXQ);
+    RFM26_Emu_Init(&g->emu, 0, 0, 0);
+    fp = fopen(path.c_str(), "wb");                       // a copy per radio, or dlopen hands back the first
+    if (fp) {
+      fwrite(&so[0], 1, so.size(), fp);
+      fclose(fp);
+      g->so = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+      unlink(path.c_str());
+    }
+    if (!g->so) {
+      fprintf(stderr, "%s: %s\n", image, dlerror());
+      rmdir(dir);
+      RFM26_Gw_Close(gw);
+      return 0;
+    }
+    g->EntryRx = (void (*)(void))dlsym(g->so, "RFM26_EntryRx");
+    g->Receive = (uint8_t (*)(uint8_t*))dlsym(g->so, "receive_message");
+    g->Send = (void (*)(uint8_t*, uint8_t))dlsym(g->so, "send_message");
+    g->SetIntCtl = (void (*)(uint8_t, uint8_t, uint8_t, uint8_t))dlsym(g->so, "RFM26_SetINT_CTL");
+    g->TxStamp = (uint32_t (*)(void))dlsym(g->so, "RFM26_GetTxStamp");
+    g->ToRx = (void (*)(uint8_t))dlsym(g->so, "RFM26_ChangeToRxMode");
+    g->RxInfo = (const RFM26_PKT_INFO* (*)(void))dlsym(g->so, "RFM26_GetRxInfo");
+    if (!g->EntryRx || !g->Receive || !g->Send || !g->SetIntCtl || !g->TxStamp || !g->ToRx || !g->RxInfo) {
+      fprintf(stderr, "%s: driver entry points missing\n", image);
+      rmdir(dir);
+      RFM26_Gw_Close(gw);
+      return 0;
+    }
+  }
+  rmdir(dir);
+  return gw;
+}
+
+void RFM26_Gw_Run(RFM26_GW* gw)
+{
+  std::vector<std::thread> th;
+  uint8_t k;
+
+  gw->air_left.store(gw->radios);
+  gw->in_flight.store(0);
+  gw->tx_left.store(0);
+  gw->tx_drop.store(0);
+  gw->stop.store(0);
+  for (k = 0; k < gw->workers; k++)
+    th.push_back(std::thread(vGw_WorkerThread, gw, k));
+  for (k = 0; k < gw->threads; k++)
+    th.push_back(std::thread(vGw_RadioThread, gw, k));
+  while (gw->air_left.load(std::memory_order_acquire) || gw->in_flight.load(std::memory_order_acquire) ||
+         gw->tx_left.load(std::memory_order_acquire))
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  gw->stop.store(1, std::memory_order_release);
+  for (size_t i = 0; i < th.size(); i++)
+    th[i].join();
+}
+
+uint8_t RFM26_Gw_Send(RFM26_GW* gw, uint16_t radio, const uint8_t* data, uint8_t len)
+{
+  RFM26_GW_FRAME f;
+
+  if (radio >= gw->radios || len > RFM26_GW_FRAME_LEN)
+    return 0;
+  f.radio = radio;
+  f.len = len;
+  f.rssi = 0;
+  f.t_us = 0;
+  memcpy(f.data, data, len);
+  gw->tx_left.fetch_add(1, std::memory_order_relaxed);
+  if (!bGw_Push(&gw->radio[radio].txq, &f)) {
+    gw->tx_left.fetch_sub(1, std::memory_order_relaxed);
+    gw->tx_drop.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+  return 1;
+}
+
+void RFM26_Gw_Stats(RFM26_GW* gw, RFM26_GW_STATS* s)
+{
+  uint16_t i;
+
+  memset(s, 0, sizeof(*s));
+  for (i = 0; i < gw->radios; i++) {
+    s->rx += gw->radio[i].rx;
+    s->missed += gw->radio[i].missed;
+    s->queue_full += gw->radio[i].queue_full;
+    s->tx += gw->radio[i].tx;
+    s->spi_bytes += gw->radio[i].emu.stats.spi_bytes;
+    s->radio_us += gw->radio[i].emu.now;
+  }
+  for (i = 0; i < gw->workers; i++) {
+    s->unique += gw->worker[i].unique;
+    s->dup += gw->worker[i].dup;
+    s->bad_crc += gw->worker[i].bad_crc;
+  }
+  s->tx_drop = gw->tx_drop.load();
+}
+
+const RFM26_GW_SOURCE* RFM26_Gw_Source(RFM26_GW* gw, uint16_t id)
+{
+  GW_WORKER* w = &gw->worker[id % gw->workers];
+  size_t k = id / gw->workers;
+
+  return k < w->src.size() && w->src[k] ? &w->src[k]->a : 0;
+}
+
+void RFM26_Gw_Close(RFM26_GW* gw)
+{
+  uint16_t i;
+
+  if (!gw)
+    return;
+  for (i = 0; i < gw->radios; i++) {
+    RFM26_Emu_Free(&gw->radio[i].emu);
+    if (gw->radio[i].so)
+      dlclose(gw->radio[i].so);
+    delete[] gw->radio[i].txq.slot;
+  }
+  for (i = 0; i < gw->workers; i++) {
+    for (size_t k = 0; k < gw->worker[i].src.size(); k++)
+      free(gw->worker[i].src[k]);
+    delete[] gw->worker[i].q.slot;
+  }
+  delete[] gw->radio;
+  delete[] gw->worker;
+  delete gw;
+}
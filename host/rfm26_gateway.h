@@ -0,0 +1,135 @@
+#ifndef HopeDuino_26_GATEWAY_H_
+#define HopeDuino_26_GATEWAY_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define gateway limits
+#define RFM26_GW_RADIOS		256							// radios per gateway
+#define RFM26_GW_THREADS	64							// radio threads, and workers
+#define RFM26_GW_QUEUE		4096						// frames per worker queue, power of 2
+#define RFM26_GW_TXQ		64							// downlink frames per radio queue, power of 2
+#define RFM26_GW_FRAME_LEN	21							// RFM26_PKT_LEN
+
+//Define frame layout the workers decode
+#define RFM26_GW_ID			0							// source id, 2 bytes MSB first
+#define RFM26_GW_SEQ		2							// sequence, 2 bytes MSB first
+#define RFM26_GW_CRC		(RFM26_GW_FRAME_LEN-2)		// CRC-16 CCITT seed ones over the bytes before it
+
+//Frame received by a radio, or queued for one to send
+typedef struct
+{
+  uint16_t radio;
+  uint8_t  len;
+  uint8_t  rssi;                                          // latched RSSI, 0.5dB steps
+  uint32_t t_us;                                          // radio's micros() at nIRQ
+  uint8_t  data[RFM26_GW_FRAME_LEN];
+} RFM26_GW_FRAME;
+
+//Per source result of deduplication and aggregation
+typedef struct
+{
+  uint32_t frames;                                        // unique frames
+  uint32_t copies;                                        // good copies, duplicates included
+  uint32_t lost;                                          // sequence gaps
+  uint16_t last_seq;
+  uint16_t best_radio;                                    // radio with the strongest copy of the last frame
+  uint8_t  best_rssi;
+} RFM26_GW_SOURCE;
+
+typedef struct
+{
+  uint64_t rx;                                            // frames out of receive_message()
+  uint64_t missed;                                        // frames on air while a radio was not in Rx
+  uint64_t unique;
+  uint64_t dup;
+  uint64_t bad_crc;
+  uint64_t queue_full;                                    // pushes that had to wait for a worker
+  uint64_t tx;                                            // downlink frames sent
+  uint64_t tx_drop;                                       // downlink queue full
+  uint64_t spi_bytes;                                     // over all radios
+  double   radio_us;                                      // emulated radio time, all radios
+} RFM26_GW_STATS;
+
+typedef struct RFM26_GW RFM26_GW;
+
+//Frames on the air at a radio, called on the radio's thread: 1 with a frame, 0 when there will be no more
+typedef uint8_t (*RFM26_GW_AIR)(void* ctx, uint16_t radio, uint8_t* data, uint16_t* len, double* dbm);
+
+//Unique good frame, called on the worker that owns the source; RFM26_Gw_Send may be called from here
+typedef void (*RFM26_GW_SINK)(void* ctx, RFM26_GW* gw, const RFM26_GW_FRAME* f);
+
+/**********************************************************
+**Name:     RFM26_Gw_Open
+**Function: Gateway with one driver image per radio, each
+            radio on the Si446x emulator; radio threads run
+            the driver, workers decode, deduplicate and
+            aggregate
+**Input:    image, driver shared object (see rfm26_gateway.cpp)
+            radios, 1..RFM26_GW_RADIOS
+            threads, radio threads, 1..RFM26_GW_THREADS
+            workers, worker threads, 1..RFM26_GW_THREADS
+            air, frames for the radios
+            sink, unique frames, 0 for none
+            ctx, passed to air and sink
+**Output:   gateway, 0 on a bad argument or an image that does
+            not load
+**********************************************************/
+RFM26_GW* RFM26_Gw_Open(const char* image, uint16_t radios, uint8_t threads, uint8_t workers, RFM26_GW_AIR air,
+                        RFM26_GW_SINK sink, void* ctx);
+
+/**********************************************************
+**Name:     RFM26_Gw_Run
+**Function: Boot the radios (RFM26_EntryRx), then run until
+            air has nothing more, every frame has been through
+            a worker and every downlink frame is sent
+**Input:    gw, gateway
+**Output:   None
+**********************************************************/
+void RFM26_Gw_Run(RFM26_GW* gw);
+
+/**********************************************************
+**Name:     RFM26_Gw_Send
+**Function: Queue a frame for a radio to send with
+            send_message(), from any thread
+**Input:    gw, gateway
+            radio, radio index
+            data, len, frame, len <= RFM26_GW_FRAME_LEN
+**Output:   1 if queued, 0 if the radio's queue is full
+**********************************************************/
+uint8_t RFM26_Gw_Send(RFM26_GW* gw, uint16_t radio, const uint8_t* data, uint8_t len);
+
+/**********************************************************
+**Name:     RFM26_Gw_Stats
+**Function: Counters over all radios and workers, after Run
+**Input:    gw, gateway
+            s, stats out
+**Output:   None
+**********************************************************/
+void RFM26_Gw_Stats(RFM26_GW* gw, RFM26_GW_STATS* s);
+
+/**********************************************************
+**Name:     RFM26_Gw_Source
+**Function: Aggregate of one source, after Run
+**Input:    gw, gateway
+            id, source id
+**Output:   pointer to it, 0 if never heard
+**********************************************************/
+const RFM26_GW_SOURCE* RFM26_Gw_Source(RFM26_GW* gw, uint16_t id);
+
+/**********************************************************
+**Name:     RFM26_Gw_Close
+**Function: Free the gateway and unload the driver images
+**Input:    gw, gateway
+**Output:   None
+**********************************************************/
+void RFM26_Gw_Close(RFM26_GW* gw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,256 @@
+#include <string.h>
+#include "rfm26_scan.h"
+
+/************************Description************************
+  Sync word correlator and frame demultiplexer for captured
+  bitstreams, host side.
+
+  The stream is taken 64 bits at a time. For sync bit i the
+  word starting i bits later is XORed with that bit spread to
+  64 bits, which gives the mismatch of all 64 start offsets at
+  once. Mismatches are counted bit-sliced in saturating planes:
+  plane t has a bit set where at least t + 1 sync bits were
+  wrong, so after the last sync bit every clear bit of plane
+  max_err is a sync word within max_err errors. A sync bit
+  costs 4 + 2 * max_err word operations for 64 offsets, with
+  no branches; 0 and 1 error are unrolled. C_SCAN_LANES words
+  go side by side, which keeps the planes of one word from
+  waiting on each other and lets the compiler use SIMD.
+
+  Several formats can be searched in one pass, each frame goes
+  to the sink with the index of its format. After a frame the
+  search for that format resumes behind it, as the packet
+  handler does.
+
+  The CRC is the packet handler's (rfm26_crc.cpp), slice-by-8.
+**********************************************************/
+
+#define C_SCAN_LANES	8								// 64 bit words scanned together, 512 offsets
+
+static uint64_t lScan_Load(const uint8_t* p)
+{
+  uint64_t v;
+
+  memcpy(&v, p, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+// 64 stream bits from byte k, zeros past the end
+static uint64_t lScan_LoadTail(const uint8_t* buf, uint64_t bytes, uint64_t k)
+{
+  uint64_t v = 0;
+  uint8_t i;
+
+  for (i = 0; i < 8; i++)
+    v = (v << 8) | (k + i < bytes ? buf[k + i] : 0);
+  return v;
+}
+
+static uint8_t bScan_Byte(const uint8_t* buf, uint64_t bit)
+{
+  const uint8_t* p = buf + (bit >> 3);
+  uint8_t sh = bit & 7;
+
+  return sh ? (uint8_t)((p[0] << sh) | (p[1] >> (8 - sh))) : p[0];
+}
+
+static uint8_t bScan_Reverse(uint8_t b)
+{
+  b = (b >> 4) | (b << 4);
+  b = ((b >> 2) & 0x33) | ((b & 0x33) << 2);
+  return ((b >> 1) & 0x55) | ((b & 0x55) << 1);
+}
+
+/**********************************************************
+**Name:     RFM26_Scan_Init
+**Function: Scanner with no frame format yet
+**Input:    s, scanner
+            sink, called for every frame found, may be 0
+            ctx, passed to sink
+**Output:   None
+**********************************************************/
+void RFM26_Scan_Init(RFM26_SCAN* s, RFM26_SCAN_SINK sink, void* ctx)
+{
+  memset(s, 0, sizeof(*s));
+  s->sink = sink;
+  s->ctx = ctx;
+}
+
+/**********************************************************
+**Name:     RFM26_Scan_Add
+**Function: Search one more frame format, frames are told
+            apart by the proto index
+**Input:    s, scanner
+            p, frame format
+**Output:   proto index, 0xFF if full or p is out of range
+**********************************************************/
+uint8_t RFM26_Scan_Add(RFM26_SCAN* s, const RFM26_SCAN_PROTO* p)
+{
+  uint8_t i, k = s->count;
+
+  if (k >= RFM26_SCAN_MAX_PROTO || p->sync_bits < 8 || p->sync_bits > 32 || p->max_err > RFM26_SCAN_MAX_ERR ||
+      p->max_err >= p->sync_bits || (p->crc_config & 0x0F) >= 10)
+    return 0xFF;
+  s->proto[k] = *p;
+  RFM26_Crc_Init(&s->crc[k], p->crc_config, p->crc_msb ? C_PKT_CRC_ENDIAN : 0);
+  for (i = 0; i < p->sync_bits; i++)
+    s->pat[k][i] = ((p->sync >> (p->sync_bits - 1 - i)) & 1) ? ~0ULL : 0;
+  s->next[k] = 0;
+  s->count++;
+  return k;
+}
+
+/**********************************************************
+**Name:     RFM26_Scan_Config
+**Function: Frame format from a driver configuration table:
+            SYNC_CONFIG, PKT_CRC_CONFIG and PKT_CONFIG1
+**Input:    p, frame format out
+            table, RADIO_CONFIGURATION_DATA_ARRAY layout, a
+                   length byte before every command, 0 ends
+            frame_len, START_RX length
+            max_err, sync bits that may be wrong
+**Output:   1 if a sync word was found in the table
+**********************************************************/
+uint8_t RFM26_Scan_Config(RFM26_SCAN_PROTO* p, const uint8_t* table, uint8_t frame_len, uint8_t max_err)
+{
+  uint8_t sync[4] = { 0 }, sync_len = 0;
+  uint8_t i, prop;
+
+  memset(p, 0, sizeof(*p));
+  for (; *table; table += *table + 1) {
+    const uint8_t* c = table + 1;
+    if (c[0] != 0x11 || *table < 4)                       // SET_PROPERTY only
+      continue;
+    for (i = 0; i < c[2] && 4 + i < *table; i++) {
+      prop = c[3] + i;
+      if (c[1] == 0x11 && prop == 0x00)                   // SYNC_CONFIG: LENGTH + 1 bytes
+        sync_len = (c[4 + i] & 0x03) + 1;
+      else if (c[1] == 0x11 && prop >= 0x01 && prop <= 0x04)
+        sync[prop - 1] = bScan_Reverse(c[4 + i]);         // SYNC_BITS go on air LSB first
+      else if (c[1] == 0x12 && prop == 0x00)
+        p->crc_config = c[4 + i];
+      else if (c[1] == 0x12 && prop == 0x06)
+        p->crc_msb = (c[4 + i] >> 1) & 1;                 // PKT_CONFIG1 CRC_ENDIAN
+    }
+  }
+  for (i = 0; i < sync_len; i++)
+    p->sync = (p->sync << 8) | sync[i];
+  p->sync_bits = sync_len * 8;
+  p->max_err = max_err;
+  p->frame_len = frame_len;
+  return sync_len != 0;
+}
+
+// Frame behind a sync word at bit pos of format k
+static uint8_t bScan_Frame(RFM26_SCAN* s, uint8_t k, const uint8_t* buf, uint64_t bits, uint64_t pos, uint8_t err)
+{
+  const RFM26_SCAN_PROTO* p = &s->proto[k];
+  uint8_t data[RFM26_SCAN_MAX_LEN + 4];
+  uint8_t nc = s->crc[k].width / 8;
+  uint16_t i, n = p->frame_len + nc;
+  uint64_t q = pos + p->sync_bits;
+  RFM26_SCAN_FRAME f;
+
+  s->stats[k].hits++;
+  if (q + 8 * (uint64_t)n > bits) {
+    s->stats[k].truncated++;
+    s->next[k] = bits;
+    return 0;
+  }
+  for (i = 0; i < n; i++)
+    data[i] = bScan_Byte(buf, q + 8 * i);
+  s->next[k] = q + 8 * (uint64_t)n;
+
+  f.bit = pos;
+  f.proto = k;
+  f.sync_err = err;
+  f.len = p->frame_len;
+  f.data = data;
+  f.crc = C_SCAN_CRC_NONE;
+  if (nc) {
+    f.crc = RFM26_Crc_Check(&s->crc[k], data, p->frame_len) ? C_SCAN_CRC_OK : C_SCAN_CRC_BAD;
+    if (f.crc == C_SCAN_CRC_OK)
+      s->stats[k].crc_ok++;
+    else
+      s->stats[k].crc_fail++;
+  }
+  if (s->sink)
+    s->sink(s->ctx, &f);
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_Scan_Run
+**Function: Find every sync word at any bit offset, 64 offsets
+            at a time, and pass the frame behind it to the sink
+**Input:    s, scanner
+            buf, bitstream, first bit on air in the MSB of
+                 buf[0]
+            bits, stream length
+**Output:   frames found
+**********************************************************/
+uint64_t RFM26_Scan_Run(RFM26_SCAN* s, const uint8_t* buf, uint64_t bits)
+{
+  uint64_t bytes = (bits + 7) / 8, base, hits, m, frames = 0;
+  uint64_t w[C_SCAN_LANES + 1];                           // stream bits from base, 64 per lane
+  uint64_t e[RFM26_SCAN_MAX_ERR + 1][C_SCAN_LANES];
+  uint8_t k, i, j, t, z, L, me;
+
+  for (k = 0; k < s->count; k++)
+    s->next[k] = 0;
+  for (base = 0; base < bits; base += 64 * C_SCAN_LANES) {
+    for (j = 0; j <= C_SCAN_LANES; j++)
+      w[j] = base / 8 + 8 * j + 8 <= bytes ? lScan_Load(buf + base / 8 + 8 * j) : lScan_LoadTail(buf, bytes, base / 8 + 8 * j);
+
+    for (k = 0; k < s->count; k++) {
+      if (s->next[k] >= base + 64 * C_SCAN_LANES)
+        continue;                                         // Still inside the last frame
+      L = s->proto[k].sync_bits;
+      me = s->proto[k].max_err;
+      const uint64_t* pat = s->pat[k];
+      for (j = 0; j < C_SCAN_LANES; j++) {                // Sync bit 0, no shift
+        m = w[j] ^ pat[0];
+        e[0][j] = m;
+        for (t = 1; t <= me; t++)
+          e[t][j] = 0;
+      }
+      if (me == 0) {
+        for (i = 1; i < L; i++)
+          for (j = 0; j < C_SCAN_LANES; j++)
+            e[0][j] |= ((w[j] << i) | (w[j + 1] >> (64 - i))) ^ pat[i];
+      } else if (me == 1) {
+        for (i = 1; i < L; i++)
+          for (j = 0; j < C_SCAN_LANES; j++) {
+            m = ((w[j] << i) | (w[j + 1] >> (64 - i))) ^ pat[i];
+            e[1][j] |= e[0][j] & m;
+            e[0][j] |= m;
+          }
+      } else {
+        for (i = 1; i < L; i++)
+          for (j = 0; j < C_SCAN_LANES; j++) {
+            m = ((w[j] << i) | (w[j + 1] >> (64 - i))) ^ pat[i];
+            for (t = me; t > 0; t--)
+              e[t][j] |= e[t - 1][j] & m;
+            e[0][j] |= m;
+          }
+      }
+
+      for (j = 0; j < C_SCAN_LANES; j++) {
+        hits = ~e[me][j];
+        while (hits) {
+          z = (uint8_t)__builtin_clzll(hits);             // Offset z is stream bit base + 64 * j + z
+          hits &= ~(0x8000000000000000ULL >> z);
+          uint64_t pos = base + 64 * j + z;
+          if (pos < s->next[k] || pos + L > bits)
+            continue;
+          for (t = 0; t <= me && (e[t][j] & (0x8000000000000000ULL >> z)); t++);
+          frames += bScan_Frame(s, k, buf, bits, pos, t);
+        }
+      }
+    }
+  }
+  return frames;
+}
@@ -0,0 +1,113 @@
+#ifndef HopeDuino_26_SCAN_H_
+#define HopeDuino_26_SCAN_H_
+
+#include <stdint.h>
+#include "rfm26_crc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define scanner limits
+#define RFM26_SCAN_MAX_PROTO	4							// sync words searched in one pass
+#define RFM26_SCAN_MAX_ERR		7							// sync bits that may be wrong
+#define RFM26_SCAN_MAX_LEN		255							// frame bytes after the sync, CRC excluded
+
+//Define CRC result of a frame
+#define C_SCAN_CRC_BAD		0
+#define C_SCAN_CRC_OK		1
+#define C_SCAN_CRC_NONE		2							// PKT_CRC_CONFIG polynomial 0
+
+//One frame format, what the packet handler is configured for
+typedef struct
+{
+  uint32_t sync;                                          // on air order, first bit in the MSB of sync_bits
+  uint8_t  sync_bits;                                     // 8..32
+  uint8_t  max_err;
+  uint8_t  frame_len;                                     // bytes after the sync, CRC excluded
+  uint8_t  crc_config;                                    // PKT_CRC_CONFIG: bit 7 seed all ones, bits 3..0 polynomial
+  uint8_t  crc_msb;                                       // PKT_CONFIG1 CRC_ENDIAN: CRC sent MSB first
+} RFM26_SCAN_PROTO;
+
+typedef struct
+{
+  uint64_t bit;                                           // stream bit where the sync word starts
+  uint8_t  proto;                                         // index in RFM26_SCAN
+  uint8_t  sync_err;
+  uint8_t  crc;                                           // C_SCAN_CRC_xxx
+  uint8_t  len;                                           // frame_len
+  const uint8_t* data;                                    // len bytes then the CRC, valid during the call
+} RFM26_SCAN_FRAME;
+
+typedef void (*RFM26_SCAN_SINK)(void* ctx, const RFM26_SCAN_FRAME* f);
+
+typedef struct
+{
+  uint64_t hits;                                          // sync words found
+  uint64_t crc_ok;
+  uint64_t crc_fail;
+  uint64_t truncated;                                     // stream ended inside the frame
+} RFM26_SCAN_STATS;
+
+typedef struct
+{
+  RFM26_SCAN_PROTO proto[RFM26_SCAN_MAX_PROTO];
+  uint64_t pat[RFM26_SCAN_MAX_PROTO][32];                 // sync bit i as all zeros or all ones
+  uint64_t next[RFM26_SCAN_MAX_PROTO];                    // first bit a new sync may start, past the last frame
+  RFM26_CRC crc[RFM26_SCAN_MAX_PROTO];
+  uint8_t  count;
+  RFM26_SCAN_SINK sink;
+  void*    ctx;
+  RFM26_SCAN_STATS stats[RFM26_SCAN_MAX_PROTO];
+} RFM26_SCAN;
+
+/**********************************************************
+**Name:     RFM26_Scan_Init
+**Function: Scanner with no frame format yet
+**Input:    s, scanner
+            sink, called for every frame found, may be 0
+            ctx, passed to sink
+**Output:   None
+**********************************************************/
+void RFM26_Scan_Init(RFM26_SCAN* s, RFM26_SCAN_SINK sink, void* ctx);
+
+/**********************************************************
+**Name:     RFM26_Scan_Add
+**Function: Search one more frame format, frames are told
+            apart by the proto index
+**Input:    s, scanner
+            p, frame format
+**Output:   proto index, 0xFF if full or p is out of range
+**********************************************************/
+uint8_t RFM26_Scan_Add(RFM26_SCAN* s, const RFM26_SCAN_PROTO* p);
+
+/**********************************************************
+**Name:     RFM26_Scan_Config
+**Function: Frame format from a driver configuration table:
+            SYNC_CONFIG, PKT_CRC_CONFIG and PKT_CONFIG1
+**Input:    p, frame format out
+            table, RADIO_CONFIGURATION_DATA_ARRAY layout, a
+                   length byte before every command, 0 ends
+            frame_len, START_RX length
+            max_err, sync bits that may be wrong
+**Output:   1 if a sync word was found in the table
+**********************************************************/
+uint8_t RFM26_Scan_Config(RFM26_SCAN_PROTO* p, const uint8_t* table, uint8_t frame_len, uint8_t max_err);
+
+/**********************************************************
+**Name:     RFM26_Scan_Run
+**Function: Find every sync word at any bit offset, 64 offsets
+            at a time, and pass the frame behind it to the sink
+**Input:    s, scanner
+            buf, bitstream, first bit on air in the MSB of
+                 buf[0]
+            bits, stream length
+**Output:   frames found
+**********************************************************/
+uint64_t RFM26_Scan_Run(RFM26_SCAN* s, const uint8_t* buf, uint64_t bits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
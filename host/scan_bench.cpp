@@ -0,0 +1,324 @@
+/************************Description************************
+  Check and benchmark of the bit-parallel sync scanner
+  (rfm26_scan.cpp).
+
+  Two formats are searched in one pass:
+    pkt     taken from the driver configuration: SYNC_CONFIG
+            0x2DD4, PKT_CRC_CONFIG 0x80 (no CRC), RFM26_PKT_LEN
+            byte frames behind 8 bytes of preamble
+    legacy  32 bit sync 0x1ACFFC1D, 12 byte frames, CCITT_16
+            CRC seeded with ones
+
+  1. Correctness: on a stream of both formats at random bit
+     offsets in noise, with bit errors, every hit must match a
+     bit-serial reference scanner (position, format and sync
+     errors), and an error free stream must give back every
+     frame at its bit position, unless a sync word in the noise
+     just before it took the receiver (shadowed).
+  2. Speed: Gbit/s over a large stream, and hours of 2.4Kbps
+     air scanned per second.
+
+  With -r a raw capture (direct_bench, or the direct mode ring
+  dumped from a board) is scanned and the frames are listed.
+
+  Build:  g++ -O3 -march=native -I.. -o scan_bench scan_bench.cpp rfm26_scan.cpp ../rfm26_crc.cpp
+  Usage:  scan_bench [mbytes] [ber_ppm] [max_err]
+          scan_bench -r capture.bin [max_err]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "rfm26_scan.h"
+
+#define PKT_LEN			21									// RFM26_PKT_LEN
+#define PREAMBLE_LEN	8
+#define CHECK_FRAMES	4000
+
+//from rfm26_wds.h: RF_SYNC_CONFIG_5, RF_PKT_CRC_CONFIG_1, RF_PKT_CONFIG1_1
+static const uint8_t gb_Config[] = {
+  0x09, 0x11, 0x11, 0x05, 0x00, 0x01, 0xB4, 0x2B, 0x00, 0x00,
+  0x05, 0x11, 0x12, 0x01, 0x00, 0x80,
+  0x05, 0x11, 0x12, 0x01, 0x06, 0x02,
+  0x00
+};
+
+static uint64_t gl_Rand = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t lBench_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 7;
+  gl_Rand ^= gl_Rand << 17;
+  return gl_Rand;
+}
+
+typedef struct
+{
+  uint64_t bit;
+  uint8_t  proto;
+  uint8_t  err;
+  uint8_t  crc;
+  uint8_t  data[RFM26_SCAN_MAX_LEN + 4];
+} BENCH_HIT;
+
+typedef struct
+{
+  std::vector<uint8_t> buf;
+  uint64_t bits;
+} BENCH_STREAM;
+
+static void vBench_Put(BENCH_STREAM* s, uint64_t v, int n)
+{
+  while (n--) {
+    if (s->bits / 8 >= s->buf.size())
+      s->buf.push_back(0);
+    if ((v >> n) & 1)
+      s->buf[s->bits / 8] |= 0x80 >> (s->bits % 8);
+    s->bits++;
+  }
+}
+
+static void vBench_Sink(void* ctx, const RFM26_SCAN_FRAME* f)
+{
+  std::vector<BENCH_HIT>* v = (std::vector<BENCH_HIT>*)ctx;
+  BENCH_HIT h;
+
+  h.bit = f->bit;
+  h.proto = f->proto;
+  h.err = f->sync_err;
+  h.crc = f->crc;
+  memcpy(h.data, f->data, f->len);
+  v->push_back(h);
+}
+
+static void vBench_Count(void* ctx, const RFM26_SCAN_FRAME* f)
+{
+  (void)f;
+  (*(uint64_t*)ctx)++;
+}
+
+static uint16_t wBench_Ccitt(const uint8_t* p, unsigned n)
+{
+  uint16_t crc = 0xFFFF;
+
+  while (n--) {
+    crc ^= (uint16_t)*p++ << 8;
+    for (int i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Stream of frames of both formats in noise; truth gets the frames as sent
+static void vBench_Stream(BENCH_STREAM* s, const RFM26_SCAN_PROTO* pr, uint64_t frames, std::vector<BENCH_HIT>* truth)
+{
+  s->buf.clear();
+  s->bits = 0;
+  for (uint64_t f = 0; f < frames; f++) {
+    unsigned gap = 16 + lBench_Rand() % 300;
+    for (unsigned i = 0; i < gap; i += 32)
+      vBench_Put(s, lBench_Rand(), gap - i < 32 ? gap - i : 32);
+    uint8_t k = lBench_Rand() % 2;
+    const RFM26_SCAN_PROTO* p = &pr[k];
+    BENCH_HIT h;
+    for (int i = 0; i < PREAMBLE_LEN; i++)
+      vBench_Put(s, 0xAA, 8);
+    h.bit = s->bits;
+    h.proto = k;
+    h.err = 0;
+    h.crc = k ? C_SCAN_CRC_OK : C_SCAN_CRC_NONE;
+    vBench_Put(s, p->sync, p->sync_bits);
+    for (int i = 0; i < p->frame_len; i++) {
+      h.data[i] = (uint8_t)lBench_Rand();
+      vBench_Put(s, h.data[i], 8);
+    }
+    if (k) {
+      uint16_t crc = wBench_Ccitt(h.data, p->frame_len);
+      vBench_Put(s, crc, 16);
+    }
+    if (truth)
+      truth->push_back(h);
+  }
+  vBench_Put(s, lBench_Rand(), 64);
+}
+
+static void vBench_Flip(BENCH_STREAM* s, double ber)
+{
+  uint64_t flip = (uint64_t)(ber * 18446744073709551615.0);
+
+  if (flip == 0)
+    return;
+  for (uint64_t i = 0; i < s->bits; i++)
+    if (lBench_Rand() < flip)
+      s->buf[i / 8] ^= 0x80 >> (i % 8);
+}
+
+static int iBench_Bit(const BENCH_STREAM* s, uint64_t i)
+{
+  return (s->buf[i / 8] >> (7 - i % 8)) & 1;
+}
+
+// Bit-serial reference: every offset, every sync bit, same rules as RFM26_Scan_Run
+static void vBench_Reference(const BENCH_STREAM* s, const RFM26_SCAN_PROTO* pr, int n, std::vector<BENCH_HIT>* out)
+{
+  std::vector<uint64_t> next(n, 0);
+
+  for (uint64_t pos = 0; pos < s->bits; pos++)
+    for (int k = 0; k < n; k++) {
+      const RFM26_SCAN_PROTO* p = &pr[k];
+      if (pos < next[k] || pos + p->sync_bits > s->bits)
+        continue;
+      int err = 0;
+      for (int i = 0; i < p->sync_bits; i++)
+        err += iBench_Bit(s, pos + i) != (int)((p->sync >> (p->sync_bits - 1 - i)) & 1);
+      if (err > p->max_err)
+        continue;
+      uint64_t end = pos + p->sync_bits + 8 * (p->frame_len + (k ? 2 : 0));
+      if (end > s->bits) {
+        next[k] = s->bits;
+        continue;
+      }
+      next[k] = end;
+      BENCH_HIT h;
+      h.bit = pos;
+      h.proto = k;
+      h.err = err;
+      out->push_back(h);
+    }
+}
+
+static bool bBench_Order(const BENCH_HIT& a, const BENCH_HIT& b)
+{
+  return a.bit < b.bit || (a.bit == b.bit && a.proto < b.proto);
+}
+
+int main(int argc, char** argv)
+{
+  RFM26_SCAN_PROTO pr[2];
+  RFM26_SCAN s;
+  int fail = 0;
+
+  int max_err = argc > 3 ? atoi(argv[3]) : 1;
+  if (!RFM26_Scan_Config(&pr[0], gb_Config, PKT_LEN, (uint8_t)max_err)) {
+    fprintf(stderr, "no sync word in the configuration\n");
+    return 1;
+  }
+  pr[1] = pr[0];
+  pr[1].sync = 0x1ACFFC1D;
+  pr[1].sync_bits = 32;
+  pr[1].frame_len = 12;
+  pr[1].crc_config = 0x85;                                // seed ones, CCITT_16
+  pr[1].crc_msb = 1;
+
+  if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+    FILE* f = fopen(argv[2], "rb");
+    BENCH_STREAM st;
+    std::vector<BENCH_HIT> hits;
+    int ch;
+
+    if (!f) {
+      fprintf(stderr, "cannot read %s\n", argv[2]);
+      return 1;
+    }
+    while ((ch = fgetc(f)) != EOF)
+      st.buf.push_back((uint8_t)ch);
+    fclose(f);
+    st.bits = st.buf.size() * 8ULL;
+    RFM26_Scan_Init(&s, vBench_Sink, &hits);
+    RFM26_Scan_Add(&s, &pr[0]);
+    RFM26_Scan_Add(&s, &pr[1]);
+    RFM26_Scan_Run(&s, &st.buf[0], st.bits);
+    for (size_t i = 0; i < hits.size(); i++) {
+      printf("%10llu  %-6s  err %u  %s :", (unsigned long long)hits[i].bit, hits[i].proto ? "legacy" : "pkt",
+             hits[i].err, hits[i].crc == C_SCAN_CRC_OK ? "crc ok " : hits[i].crc == C_SCAN_CRC_BAD ? "crc bad" : "no crc ");
+      for (int k = 0; k < pr[hits[i].proto].frame_len; k++)
+        printf(" %02X", hits[i].data[k]);
+      printf("\n");
+    }
+    return 0;
+  }
+
+  double mbytes = argc > 1 ? atof(argv[1]) : 64;
+  double ber = (argc > 2 ? atof(argv[2]) : 1000) / 1e6;
+  if (mbytes <= 0 || ber < 0 || ber >= 1 || max_err < 0 || max_err > RFM26_SCAN_MAX_ERR) {
+    fprintf(stderr, "usage: %s [mbytes] [ber_ppm] [max_err]\n       %s -r capture.bin [max_err]\n", argv[0], argv[0]);
+    return 1;
+  }
+  printf("pkt: sync 0x%04X/%u from the driver configuration, %u bytes, CRC config 0x%02X\n", (unsigned)pr[0].sync,
+         pr[0].sync_bits, pr[0].frame_len, pr[0].crc_config);
+  printf("legacy: sync 0x%08X/%u, %u bytes, CRC config 0x%02X; max %d sync bit errors\n\n", (unsigned)pr[1].sync,
+         pr[1].sync_bits, pr[1].frame_len, pr[1].crc_config, max_err);
+
+  // 1. correctness, clean and with bit errors
+  for (int pass = 0; pass < 2; pass++) {
+    BENCH_STREAM st;
+    std::vector<BENCH_HIT> truth, got, ref;
+
+    vBench_Stream(&st, pr, CHECK_FRAMES, &truth);
+    if (pass)
+      vBench_Flip(&st, ber);
+    RFM26_Scan_Init(&s, vBench_Sink, &got);
+    RFM26_Scan_Add(&s, &pr[0]);
+    RFM26_Scan_Add(&s, &pr[1]);
+    RFM26_Scan_Run(&s, &st.buf[0], st.bits);
+    vBench_Reference(&st, pr, 2, &ref);
+    std::sort(got.begin(), got.end(), bBench_Order);
+
+    unsigned diff = got.size() != ref.size();
+    for (size_t i = 0; !diff && i < got.size(); i++)
+      diff += got[i].bit != ref[i].bit || got[i].proto != ref[i].proto || got[i].err != ref[i].err;
+    unsigned found = 0, shadowed = 0, j = 0;
+    for (size_t i = 0; i < truth.size(); i++) {
+      while (j < got.size() && bBench_Order(got[j], truth[i]))
+        j++;
+      if (j < got.size() && got[j].bit == truth[i].bit && got[j].proto == truth[i].proto &&
+          !memcmp(got[j].data, truth[i].data, pr[truth[i].proto].frame_len)) {
+        found++;
+        continue;
+      }
+      for (size_t b = j; b-- > 0;)
+        if (got[b].proto == truth[i].proto) {
+          const RFM26_SCAN_PROTO* p = &pr[got[b].proto];
+          shadowed += got[b].bit + p->sync_bits + 8 * (p->frame_len + 2 * got[b].proto) > truth[i].bit;
+          break;
+        }
+    }
+    printf("%s: %u frames sent, %u found intact, %u shadowed, %zu hits (reference %zu), CRC ok %llu, bad %llu: %s\n",
+           pass ? "bit errors" : "clean     ", CHECK_FRAMES, found, shadowed, got.size(), ref.size(),
+           (unsigned long long)s.stats[1].crc_ok, (unsigned long long)s.stats[1].crc_fail,
+           diff ? "MISMATCH" : "same as reference");
+    if (diff || (!pass && found + shadowed != CHECK_FRAMES))
+      fail = 1;
+  }
+
+  // 2. speed
+  BENCH_STREAM st;
+  uint64_t frames = (uint64_t)(mbytes * 1048576 * 8 / (PREAMBLE_LEN * 8 + 170 + 200));
+  uint64_t n = 0;
+  vBench_Stream(&st, pr, frames, 0);
+  vBench_Flip(&st, ber);
+  RFM26_Scan_Init(&s, vBench_Count, &n);
+  RFM26_Scan_Add(&s, &pr[0]);
+  RFM26_Scan_Add(&s, &pr[1]);
+  auto t0 = std::chrono::steady_clock::now();
+  RFM26_Scan_Run(&s, &st.buf[0], st.bits);
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  printf("\n%.1f Mbit, %llu frames sent, %llu found in %.3f s: %.2f Gbit/s, %.0f hours of 2.4Kbps air per second\n",
+         st.bits / 1e6, (unsigned long long)frames, (unsigned long long)n, sec, st.bits / sec / 1e9,
+         st.bits / sec / 2400 / 3600);
+
+  RFM26_Scan_Init(&s, vBench_Count, &n);
+  RFM26_Scan_Add(&s, &pr[0]);
+  t0 = std::chrono::steady_clock::now();
+  RFM26_Scan_Run(&s, &st.buf[0], st.bits);
+  sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  printf("pkt format alone: %.2f Gbit/s\n", st.bits / sec / 1e9);
+
+  if (fail)
+    printf("\nFAIL: scanner differs from the reference or lost a clean frame\n");
+  return fail;
+}
@@ -0,0 +1,193 @@
+/************************Description************************
+  The sketch's scheduler (rfm26_sched.cpp) and the driver on
+  the radio emulator, as a receiver: a cold boot through
+  RFM26_BootStep with the CHIP_READY edge ending the wait, then
+  frames at random times drained by the nIRQ task, answered by
+  the hardware ACK and re-armed by a timed task once the ACK is
+  off the air, a 4096us flush task and a periodic stats task.
+  The tasks are a hand copy of those of rfm26.cpp, their
+  constants included, without the calibration step of the arm
+  task and without telemetry: a change there is made here too.
+
+  Between runs the CPU sleeps to the time RFM26_Sched_Run
+  returns or to an nIRQ edge, checked every SIM_WAKE_US. The
+  report gives the boot time, frames received against sent,
+  time from the last bit to receive_message, the awake
+  fraction, the longest loop() pass after boot (no task may
+  wait on the radio) and how late timed tasks ran. Fails when a frame is
+  not received or the radio does not come up.
+
+  Build:  g++ -O2 -I.. -o sched_sim sched_sim.cpp rfm26_emu.cpp ../rfm26_driver.cpp ../rfm26_sched.cpp \
+              ../rfm26_energy.cpp ../rfm26_capture.cpp ../rfm26_config.cpp ../rfm26_profiles.cpp \
+              ../rfm26_cal.cpp ../rfm26_snap.cpp
+  Usage:  sched_sim [seconds] [mean_gap_ms]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rfm26_driver.h"
+#include "rfm26_sched.h"
+#include "rfm26_emu.h"
+
+#define SIM_WAKE_US			64							// nIRQ edge to the CPU awake
+#define SIM_FLUSH_US		4096
+#define SIM_STATS_US		10000000UL
+#define SIM_ARM_US			1000						// as ARM_MARGIN_US and ARM_RETRY_US of rfm26.cpp
+#define SIM_ARM_RETRY_US	1024
+
+static RFM26_EMU gt_Emu;
+static RFM26_SCHED gt_Sched;
+static RFM26_TASK gt_Boot, gt_Rx, gt_Arm, gt_Flush, gt_Stats;
+static uint8_t gb_Ack[RFM26_PKT_LEN] = "HopeRF RFM26 ACK    ";
+static uint32_t gl_ArmRetry = 0;
+static uint8_t gb_BootN = 0;
+static double gf_UpAt = -1;                                // radio up and in Rx
+static uint32_t gl_RxCnt = 0;
+static double gf_RxLat = 0, gf_RxLatMax = 0;
+static double gf_LastEnd = 0;                              // last bit of the latest frame
+static uint32_t gl_Flushes = 0, gl_Stats = 0;
+
+static uint32_t gl_Rand = 0x2545F491;
+
+static uint32_t lSim_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static void vSim_Rx(void* ctx)
+{
+  uint8_t buf[RFM26_PKT_LEN];
+  double lat;
+
+  (void)ctx;
+  if (receive_message(buf) == 0)
+    return;
+  gl_RxCnt++;
+  lat = gt_Emu.now - gf_LastEnd;
+  gf_RxLat += lat;
+  if (lat > gf_RxLatMax)
+    gf_RxLatMax = lat;
+  RFM26_Sched_Add(&gt_Sched, &gt_Arm, RFM26_Hal_Micros(), RFM26_Airtime(RFM26_PKT_LEN) + SIM_ARM_US, 0);
+}
+
+// the ACK went out in hardware, the next one is armed without waiting for it
+static void vSim_Arm(void* ctx)
+{
+  (void)ctx;
+  if (RFM26_GetState() == C_STATE_TX) {
+    gl_ArmRetry++;
+    RFM26_Sched_Add(&gt_Sched, &gt_Arm, RFM26_Hal_Micros(), SIM_ARM_RETRY_US, 0);
+    return;
+  }
+  RFM26_ArmResponse(gb_Ack, RFM26_PKT_LEN);
+}
+
+static void vSim_Flush(void* ctx)
+{
+  (void)ctx;
+  gl_Flushes++;
+}
+
+static void vSim_Stats(void* ctx)
+{
+  (void)ctx;
+  gl_Stats++;
+}
+
+static void vSim_Boot(void* ctx)
+{
+  uint16_t us;
+
+  (void)ctx;
+  RFM26_Sched_Cancel(&gt_Sched, &gt_Boot);
+  us = RFM26_BootStep();
+  if (us) {
+    if (++gb_BootN == 3)
+      RFM26_Sched_OnIrq(&gt_Sched, &gt_Boot);
+    RFM26_Sched_Add(&gt_Sched, &gt_Boot, RFM26_Hal_Micros(), us, 0);
+    return;
+  }
+  RFM26_Sched_OnIrq(&gt_Sched, 0);
+  RFM26_LoadConfig();
+  RFM26_SetupRx();
+  RFM26_ArmResponse(gb_Ack, RFM26_PKT_LEN);
+  RFM26_Sched_OnIrq(&gt_Sched, &gt_Rx);
+  gf_UpAt = gt_Emu.now;
+}
+
+static void vSim_OnIrq(void)
+{
+  RFM26_Sched_Irq(&gt_Sched);
+}
+
+int main(int argc, char** argv)
+{
+  double secs = argc > 1 ? atof(argv[1]) : 60;
+  double gap = (argc > 2 ? atof(argv[2]) : 500) * 1000;
+  double end = secs * 1e6, next, awake = 0, pass_max = 0, t0;
+  uint8_t data[RFM26_PKT_LEN];
+  uint32_t sent = 0, wait, i;
+
+  RFM26_Emu_Init(&gt_Emu, 0, 0, 0);
+  RFM26_Emu_Enter(&gt_Emu, 0);
+  RFM26_Sched_Init(&gt_Sched, RFM26_Hal_Micros());
+  RFM26_Sched_Task(&gt_Boot, vSim_Boot, 0);
+  RFM26_Sched_Task(&gt_Rx, vSim_Rx, 0);
+  RFM26_Sched_Task(&gt_Arm, vSim_Arm, 0);
+  RFM26_Sched_Task(&gt_Flush, vSim_Flush, 0);
+  RFM26_Sched_Task(&gt_Stats, vSim_Stats, 0);
+  RFM26_Sched_Add(&gt_Sched, &gt_Flush, RFM26_Hal_Micros(), SIM_FLUSH_US, SIM_FLUSH_US);
+  RFM26_Sched_Add(&gt_Sched, &gt_Stats, RFM26_Hal_Micros(), SIM_STATS_US, SIM_STATS_US);
+  RFM26_Sched_Add(&gt_Sched, &gt_Boot, RFM26_Hal_Micros(), 0, 0);
+  RFM26_SetIrqHook(vSim_OnIrq);                            // as setup(): after the boot task is armed
+
+  next = 100000;
+  while (gt_Emu.now < end) {
+    t0 = gt_Emu.now;                                       // loop() of the sketch
+    if (!RFM26_Hal_Irq())
+      RFM26_Sched_Irq(&gt_Sched);
+    wait = RFM26_Sched_Run(&gt_Sched, RFM26_Hal_Micros());
+    awake += gt_Emu.now - t0;
+    if (gf_UpAt >= 0 && t0 > gf_UpAt && gt_Emu.now - t0 > pass_max)
+      pass_max = gt_Emu.now - t0;
+    if (!wait)
+      continue;
+
+    // asleep: the frame due meanwhile goes on air, nIRQ or the wheel wakes the CPU
+    t0 = gt_Emu.now;
+    while (gt_Emu.now < t0 + wait && !gt_Sched.irq_pending) {
+      if (gf_UpAt >= 0 && next <= gt_Emu.now + SIM_WAKE_US) {
+        for (i = 0; i < RFM26_PKT_LEN; i++)
+          data[i] = (uint8_t)lSim_Rand();
+        if (next < gt_Emu.now)
+          next = gt_Emu.now;
+        RFM26_Emu_Enter(&gt_Emu, next);
+        if (RFM26_Emu_RxSince(&gt_Emu) >= 0 && RFM26_Emu_Receive(&gt_Emu, gt_Emu.now, data, RFM26_PKT_LEN, -80, 1)) {
+          gf_LastEnd = gt_Emu.now;
+          sent++;
+        } else {
+          printf("frame at %.0f us: radio not listening\n", gt_Emu.now);
+          sent++;
+        }
+        next = gt_Emu.now + gap / 2 + lSim_Rand() % (uint32_t)gap;
+        RFM26_Emu_Enter(&gt_Emu, gt_Emu.now);                // the edge to the isr
+        continue;
+      }
+      RFM26_Emu_Enter(&gt_Emu, gt_Emu.now + SIM_WAKE_US);
+    }
+  }
+
+  printf("boot            %.2f ms to Rx\n", gf_UpAt / 1000);
+  printf("frames          %u sent, %u received\n", sent, gl_RxCnt);
+  printf("edge to data    %.0f us mean, %.0f us max\n", gl_RxCnt ? gf_RxLat / gl_RxCnt : 0, gf_RxLatMax);
+  printf("tasks           %u runs, %u flushes, %u stats, %u re-arms early, %u us late at most\n",
+         gt_Sched.runs, gl_Flushes, gl_Stats, gl_ArmRetry, gt_Sched.late_max);
+  printf("awake           %.2f %% of %.0f s, %.0f us the longest pass\n", 100 * awake / gt_Emu.now,
+         gt_Emu.now / 1e6, pass_max);
+  RFM26_Emu_Free(&gt_Emu);
+  return gf_UpAt < 0 || gl_RxCnt != sent;
+}
@@ -0,0 +1,191 @@
+/************************Description************************
+  Host simulation of the TDMA MAC (rfm26_tdma.cpp) with many
+  virtual nodes. Each node runs the unmodified clock discipline
+  and slot scheduling code against its own crystal (ppm offset,
+  random phase, 32 bit micros() wrap) and a noisy nIRQ capture.
+  Every slot frame is also heard by the next node, with a
+  payload that starts like a beacon; the run fails if one is
+  taken for a beacon, on a collision or on a guard violation.
+  The frame airtime is RFM26_Airtime of the driver at its
+  default rate, the driver is linked for it alone.
+
+  Build:  g++ -O2 -I.. -o tdma_sim tdma_sim.cpp ../rfm26_tdma.cpp rfm26_emu.cpp ../rfm26_driver.cpp \
+              ../rfm26_energy.cpp ../rfm26_capture.cpp ../rfm26_config.cpp ../rfm26_profiles.cpp \
+              ../rfm26_cal.cpp ../rfm26_snap.cpp
+  Usage:  tdma_sim [nodes] [superframes] [beacon_loss_%] [jitter_us] [load_%]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "rfm26_driver.h"
+#include "rfm26_tdma.h"
+
+struct Node
+{
+  RFM26_TDMA tdma;
+  double   ppm;                                           // crystal error
+  uint32_t phase;                                         // micros() at true time 0
+  uint32_t sync_sf;                                       // first superframe with a slot
+};
+
+struct Tx
+{
+  double   start;                                         // true START_TX time
+  int      node;
+};
+
+static uint32_t gl_Rand = 0x12345678;
+
+static uint32_t lSim_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static double fSim_Uniform(double lo, double hi)
+{
+  return lo + (hi - lo) * (lSim_Rand() / 4294967296.0);
+}
+
+// local micros() of a node at a true time
+static uint32_t lSim_Local(const Node& n, double t)
+{
+  return n.phase + (uint32_t)(uint64_t)llround(t * (1.0 + n.ppm * 1e-6));
+}
+
+// true time of a local micros() value, near a known true time
+static double fSim_True(const Node& n, uint32_t local, double near)
+{
+  int32_t dl = (int32_t)(local - lSim_Local(n, near));
+  return near + dl / (1.0 + n.ppm * 1e-6);
+}
+
+int main(int argc, char** argv)
+{
+  int nodes = argc > 1 ? atoi(argv[1]) : 48;
+  int superframes = argc > 2 ? atoi(argv[2]) : 1000;
+  double loss = (argc > 3 ? atof(argv[3]) : 5.0) / 100.0;
+  double jitter = argc > 4 ? atof(argv[4]) : 30.0;
+  double load = (argc > 5 ? atof(argv[5]) : 80.0) / 100.0;
+  int slots = nodes + 1;
+  uint32_t air_us = RFM26_Airtime(RFM26_TDMA_FRAME_LEN);
+
+  if (nodes < 1 || nodes > 254 || superframes < 2) {
+    fprintf(stderr, "usage: %s [nodes 1..254] [superframes] [beacon_loss_%%] [jitter_us] [load_%%]\n", argv[0]);
+    return 1;
+  }
+
+  RFM26_TDMA coord;
+  RFM26_Tdma_Init(&coord, C_TDMA_COORDINATOR, slots, 0, air_us);
+  double sf_us = (double)slots * coord.slot_us;
+
+  std::vector<Node> node(nodes);
+  for (int i = 0; i < nodes; i++) {
+    RFM26_Tdma_Init(&node[i].tdma, C_TDMA_NODE, 0, i + 1, air_us);
+    node[i].ppm = fSim_Uniform(-40.0, 40.0);
+    node[i].phase = lSim_Rand();
+    node[i].sync_sf = 0;
+  }
+
+  uint64_t offered = 0, sent = 0, unsynced = 0, collisions = 0, misread = 0;
+  double err_sum2 = 0, err_max = 0;
+  uint32_t sync_err_max = 0;
+  std::vector<Tx> air;
+
+  for (int sf = 0; sf < superframes; sf++) {
+    double t_beacon = sf * sf_us + RFM26_TDMA_LEAD_US;
+    uint8_t beacon[RFM26_TDMA_FRAME_LEN];
+
+    RFM26_Tdma_BuildBeacon(&coord, beacon, (uint32_t)(uint64_t)t_beacon);
+    air.clear();
+
+    for (int i = 0; i < nodes; i++) {
+      Node& n = node[i];
+      double t_rx = t_beacon + air_us;
+
+      if (fSim_Uniform(0, 1) >= loss) {
+        uint32_t stamp = lSim_Local(n, t_rx + fSim_Uniform(0, jitter));
+        RFM26_Tdma_OnBeacon(&n.tdma, beacon, stamp);
+        if (n.tdma.beacons > 2 && sf > 10) {
+          uint32_t e = (uint32_t)abs(n.tdma.last_err);
+          sync_err_max = std::max(sync_err_max, e);
+        }
+      }
+
+      if (fSim_Uniform(0, 1) >= load)
+        continue;
+      offered++;
+
+      // the application asks for its slot a little after the beacon
+      double t_now = t_rx + 1000.0;
+      uint32_t now = lSim_Local(n, t_now);
+      if (!RFM26_Tdma_Tick(&n.tdma, now)) {
+        unsynced++;
+        continue;
+      }
+      if (n.sync_sf == 0)
+        n.sync_sf = sf;
+
+      uint32_t tx = RFM26_Tdma_NextTx(&n.tdma, now, RFM26_TDMA_LEAD_US);
+      double t_tx = fSim_True(n, tx, t_now) + fSim_Uniform(0, 4.0);   // micros() resolution
+      Tx a = { t_tx, i };
+      air.push_back(a);
+      sent++;
+
+      // true error against the ideal START_TX of the slot
+      double ideal = t_beacon + (double)n.tdma.my_slot * coord.slot_us + coord.guard_us;
+      while (t_tx - ideal > sf_us / 2)
+        ideal += sf_us;
+      double e = t_tx - ideal;
+      err_sum2 += e * e;
+      err_max = std::max(err_max, fabs(e));
+
+      RFM26_Tdma_OnSlotRx(&coord, (uint32_t)(uint64_t)(t_tx + air_us + fSim_Uniform(0, jitter)));
+
+      // the neighbour hears it too (RFM26_Tdma_Receive), payload[0] as a beacon type
+      uint8_t payload[RFM26_TDMA_DATA_LEN], frame[RFM26_TDMA_FRAME_LEN];
+      Node& nb = node[(i + 1) % nodes];
+      for (int k = 0; k < RFM26_TDMA_DATA_LEN; k++)
+        payload[k] = (uint8_t)lSim_Rand();
+      payload[0] = RFM26_TDMA_BEACON;
+      RFM26_Tdma_BuildData(frame, payload);
+      if (nodes > 1 && RFM26_Tdma_OnBeacon(&nb.tdma, frame, lSim_Local(nb, t_tx + air_us)))
+        misread++;
+    }
+
+    // frames overlapping on air
+    std::sort(air.begin(), air.end(), [](const Tx& a, const Tx& b) { return a.start < b.start; });
+    for (size_t k = 1; k < air.size(); k++)
+      if (air[k].start < air[k - 1].start + air_us)
+        collisions++;
+  }
+
+  uint32_t sync_last = 0;
+  for (int i = 0; i < nodes; i++)
+    sync_last = std::max(sync_last, node[i].sync_sf);
+
+  printf("nodes %d, slots %d x %lu us, superframes %d (%.1f min)\n",
+         nodes, slots, (unsigned long)coord.slot_us, superframes, superframes * sf_us / 60e6);
+  printf("beacon loss %.1f%%, capture jitter %.0f us, offered load %.0f%%\n", loss * 100, jitter, load * 100);
+  printf("slot utilization      %6.2f%% (%lu of %lu data slots)\n",
+         coord.slots_seen ? 100.0 * coord.slots_used / coord.slots_seen : 0.0,
+         (unsigned long)coord.slots_used, (unsigned long)coord.slots_seen);
+  printf("airtime in data slots %6.2f%%\n", 100.0 * air_us / coord.slot_us);
+  printf("frames offered/sent   %lu / %lu, not synced %lu\n",
+         (unsigned long)offered, (unsigned long)sent, (unsigned long)unsynced);
+  printf("all nodes synced by   superframe %lu\n", (unsigned long)sync_last);
+  printf("slot timing error     rms %.1f us, max %.1f us (true time)\n",
+         sent ? sqrt(err_sum2 / sent) : 0.0, err_max);
+  printf("coordinator view      min %ld us, max %ld us\n", (long)coord.slot_err_min, (long)coord.slot_err_max);
+  printf("guard time            %u us, margin %.1f us, violations %u\n",
+         coord.guard_us, coord.guard_us - err_max, coord.guard_violations);
+  printf("beacon phase error    max %lu us after convergence\n", (unsigned long)sync_err_max);
+  printf("collisions            %lu\n", (unsigned long)collisions);
+  printf("slot frames as beacon %lu\n", (unsigned long)misread);
+  return (collisions || coord.guard_violations || misread) ? 2 : 0;
+}
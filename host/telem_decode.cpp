@@ -0,0 +1,297 @@
+/************************Description************************
+  Host side of the binary telemetry (rfm26_telem.cpp).
+
+  decode   reads the byte stream from the sketch (a file, or
+           stdin from the serial port), splits it at 0x00,
+           undoes COBS and prints one line per record the way
+           the sketch used to print them; at the end the
+           metrics: records per type, records lost (sequence
+           gaps), frames that failed their check, the ring
+           counters the device reported, RSSI and round trip
+  sim      the receiver sketch at 1ms steps: a frame every
+           period ms for the ring, drained by a UART with a 64
+           byte Tx buffer at the given baud rate; the stream is
+           decoded back and every record must come out or be
+           counted as dropped. Beside it the time loop() used
+           to block in Serial.print for the same traffic.
+
+  Build:  g++ -O2 -I.. -o telem_decode telem_decode.cpp ../rfm26_telem.cpp
+  Usage:  telem_decode [file|-] [-q]
+          telem_decode -sim [seconds] [period_ms] [baud]
+          stty -F /dev/ttyUSB0 115200 raw && telem_decode /dev/ttyUSB0
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "rfm26_telem.h"
+
+#define UART_TXBUF		64								// Arduino core Tx buffer
+#define FRAME_LEN		21
+#define STATS_EVERY_MS	10000							// as rfm26.cpp
+
+typedef struct
+{
+  uint64_t records, lost, bad, bytes;
+  uint64_t type[256];
+  int      seq;                                           // -1 before the first record
+  uint32_t dev_records, dev_dropped;
+  uint16_t dev_high;
+  int      dev_seen;
+  uint64_t rssi_n;
+  double   rssi_sum;
+  uint64_t rtt_n;
+  uint32_t rtt_min, rtt_max;
+  double   rtt_sum;
+  int      quiet;
+} DEC;
+
+static uint32_t lDec_U32(const uint8_t* p)
+{
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void vDec_Record(DEC* d, const RFM26_TEL_REC* r)
+{
+  const uint8_t* p = r->data;
+  unsigned cnt = r->len >= 2 ? p[0] | p[1] << 8 : 0;
+
+  d->records++;
+  d->type[r->type]++;
+  if (d->seq >= 0)
+    d->lost += (uint8_t)(r->seq - d->seq - 1);
+  d->seq = r->seq;
+  if (r->type == C_TEL_RX && r->len >= 3) {
+    d->rssi_n++;
+    d->rssi_sum += p[2] / 2.0 - 134;
+  } else if (r->type == C_TEL_ACK && r->len >= 6) {
+    uint32_t us = lDec_U32(p + 2);
+    if (d->rtt_n == 0 || us < d->rtt_min)
+      d->rtt_min = us;
+    if (d->rtt_n == 0 || us > d->rtt_max)
+      d->rtt_max = us;
+    d->rtt_n++;
+    d->rtt_sum += us;
+  } else if (r->type == C_TEL_STATS && r->len >= 10) {
+    d->dev_records = lDec_U32(p);
+    d->dev_dropped = lDec_U32(p + 4);
+    d->dev_high = (uint16_t)(p[8] | p[9] << 8);
+    d->dev_seen = 1;
+  }
+  if (d->quiet)
+    return;
+
+  printf("%10.3f ", r->t_ms / 1e3);
+  switch (r->type) {
+  case C_TEL_BOOT:
+    printf("boot as %s\n", r->len && r->data[0] ? "transmitter" : "receiver");
+    break;
+  case C_TEL_RX:
+    printf("%u packet received, rssi %.1f dBm: ", cnt, r->len >= 3 ? p[2] / 2.0 - 134 : 0);
+    for (uint8_t i = 3; i < r->len; i++)
+      putchar(p[i] >= 0x20 && p[i] < 0x7F ? p[i] : '.');
+    printf("\n");
+    break;
+  case C_TEL_TX:
+    printf("%u packet had sended\n", cnt);
+    break;
+  case C_TEL_ACK:
+    printf("%u ack after %u us\n", cnt, r->len >= 6 ? lDec_U32(p + 2) : 0);
+    break;
+  case C_TEL_NOACK:
+    printf("%u no ack\n", cnt);
+    break;
+  case C_TEL_STATS:
+    printf("telemetry: %u records, %u dropped, ring high water %u of %u bytes\n", d->dev_records, d->dev_dropped,
+           d->dev_high, RFM26_TEL_RING);
+    break;
+  case C_TEL_PROPS:
+    printf("properties 0x%02X/0x%02X:", r->len >= 2 ? p[0] : 0, r->len >= 2 ? p[1] : 0);
+    for (uint8_t i = 2; i < r->len; i++)
+      printf(" %02X", p[i]);
+    printf("\n");
+    break;
+  default:
+    printf("type 0x%02X, %u bytes\n", r->type, r->len);
+    break;
+  }
+}
+
+// feed stream bytes, records come out at each 0x00
+static void vDec_Feed(DEC* d, std::vector<uint8_t>* part, const uint8_t* p, size_t n)
+{
+  uint8_t buf[RFM26_TEL_MAX_RAW];
+  RFM26_TEL_REC r;
+
+  d->bytes += n;
+  for (size_t i = 0; i < n; i++) {
+    if (p[i]) {
+      if (part->size() <= RFM26_TEL_MAX_WIRE)
+        part->push_back(p[i]);
+      continue;
+    }
+    if (!part->empty()) {
+      if (RFM26_Tel_Decode(&(*part)[0], (uint16_t)part->size(), buf, &r))
+        vDec_Record(d, &r);
+      else
+        d->bad++;
+    }
+    part->clear();
+  }
+}
+
+static void vDec_Report(const DEC* d)
+{
+  printf("\n%llu bytes, %llu records, %llu lost, %llu failed the check\n", (unsigned long long)d->bytes,
+         (unsigned long long)d->records, (unsigned long long)d->lost, (unsigned long long)d->bad);
+  printf("  rx %llu  tx %llu  ack %llu  no ack %llu  stats %llu  boot %llu\n", (unsigned long long)d->type[C_TEL_RX],
+         (unsigned long long)d->type[C_TEL_TX], (unsigned long long)d->type[C_TEL_ACK],
+         (unsigned long long)d->type[C_TEL_NOACK], (unsigned long long)d->type[C_TEL_STATS],
+         (unsigned long long)d->type[C_TEL_BOOT]);
+  if (d->dev_seen)
+    printf("  device: %u records, %u dropped, ring high water %u of %u bytes\n", d->dev_records, d->dev_dropped,
+           d->dev_high, RFM26_TEL_RING);
+  if (d->rssi_n)
+    printf("  rssi mean %.1f dBm over %llu frames\n", d->rssi_sum / d->rssi_n, (unsigned long long)d->rssi_n);
+  if (d->rtt_n)
+    printf("  round trip %u / %.0f / %u us min / mean / max\n", d->rtt_min, d->rtt_sum / d->rtt_n, d->rtt_max);
+}
+
+/**********************************************************
+  sim
+**********************************************************/
+
+static uint32_t gl_Rand = 0x2545F491;
+
+static uint32_t lSim_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+// bytes the old sketch printed for one received frame: "\r\n", the count, " packet received: ", the frame
+static unsigned iSim_TextBytes(unsigned cnt)
+{
+  char s[16];
+
+  return 2 + snprintf(s, sizeof(s), "%u", cnt) + 18 + FRAME_LEN;
+}
+
+static int iSim(double seconds, double period_ms, double baud)
+{
+  static RFM26_TELEM t;
+  DEC d;
+  std::vector<uint8_t> part;
+  uint8_t rec[2 + 1 + FRAME_LEN], wire[UART_TXBUF];
+  double per_ms = baud / 10 / 1000;                        // 8N1
+  double uart = 0, next = 0;
+  double old_done = 0, old_free = 0, old_block = 0, old_block_max = 0;
+  uint32_t end = (uint32_t)(seconds * 1000), frames = 0, old_missed = 0;
+
+  memset(&d, 0, sizeof(d));
+  d.seq = -1;
+  d.quiet = 1;
+  RFM26_Tel_Init(&t);
+  for (uint32_t ms = 0; ms < end; ms++) {
+    // UART: the Tx buffer drains per_ms bytes each ms
+    uart = uart > per_ms ? uart - per_ms : 0;
+    if (ms >= next) {
+      next += period_ms * (0.5 + (lSim_Rand() % 1000) / 1000.0);
+      rec[0] = (uint8_t)frames;
+      rec[1] = (uint8_t)(frames >> 8);
+      rec[2] = (uint8_t)(lSim_Rand() % 160 + 20);
+      for (int i = 0; i < FRAME_LEN; i++)
+        rec[3 + i] = (uint8_t)lSim_Rand();
+      RFM26_Tel_Put(&t, C_TEL_RX, ms, rec, sizeof(rec));
+
+      // Serial.print: loop() waits while the text does not fit in the Tx buffer, frames meanwhile are missed
+      if (ms < old_free) {
+        old_missed++;
+      } else {
+        double text = iSim_TextBytes(frames);
+        double level = old_done > ms ? (old_done - ms) * per_ms : 0;
+        double wait = level + text > UART_TXBUF ? (level + text - UART_TXBUF) / per_ms : 0;
+        old_done = (old_done > ms ? old_done : ms) + text / per_ms;
+        old_free = ms + wait;
+        old_block += wait;
+        if (wait > old_block_max)
+          old_block_max = wait;
+      }
+      frames++;
+    }
+    if (ms % STATS_EVERY_MS == 0)
+      RFM26_Tel_Stats(&t, ms);
+    // RFM26_Tel_Flush: what the Tx buffer has room for
+    uint16_t room = (uint16_t)(UART_TXBUF - uart);
+    uint16_t n = RFM26_Tel_Take(&t, wire, room);
+    uart += n;
+    vDec_Feed(&d, &part, wire, n);
+  }
+  while (uint16_t n = RFM26_Tel_Take(&t, wire, sizeof(wire)))
+    vDec_Feed(&d, &part, wire, n);
+
+  printf("%.0f s, a frame every %.0f ms on average, %.0f baud: %u frames\n\n", seconds, period_ms, baud, frames);
+  printf("telemetry ring (%u bytes): %u records, %u dropped, high water %u bytes; loop() never waits\n",
+         RFM26_TEL_RING, t.records, t.dropped, t.high);
+  printf("  host decoded %llu records, %llu lost by sequence, %llu failed the check, %.1f bytes per Rx record\n",
+         (unsigned long long)d.records, (unsigned long long)d.lost, (unsigned long long)d.bad,
+         (double)d.bytes / (d.records ? d.records : 1));
+  printf("Serial.print: loop() blocked %.1f s in all, %.1f ms at most, %u frames (%.1f%%) came while blocked\n",
+         old_block / 1e3, old_block_max, old_missed, 100.0 * old_missed / (frames ? frames : 1));
+
+  // a gap of 256 or more records, or drops after the last record, do not show in the sequence
+  if (d.records != t.records || d.lost > t.dropped || d.bad) {
+    printf("FAIL: decoded %llu of %u records, %llu lost against %u dropped\n", (unsigned long long)d.records,
+           t.records, (unsigned long long)d.lost, t.dropped);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1 && !strcmp(argv[1], "-sim")) {
+    double seconds = argc > 2 ? atof(argv[2]) : 600;
+    double period = argc > 3 ? atof(argv[3]) : 20;
+    double baud = argc > 4 ? atof(argv[4]) : 115200;
+    if (seconds <= 0 || period < 1 || baud < 300) {
+      fprintf(stderr, "usage: %s -sim [seconds] [period_ms>=1] [baud]\n", argv[0]);
+      return 1;
+    }
+    return iSim(seconds, period, baud);
+  }
+
+  const char* name = "-";
+  DEC d;
+  std::vector<uint8_t> part;
+  uint8_t buf[4096];
+  ssize_t n;
+
+  memset(&d, 0, sizeof(d));
+  d.seq = -1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-q"))
+      d.quiet = 1;
+    else
+      name = argv[i];
+  }
+  int fd = strcmp(name, "-") ? open(name, O_RDONLY) : 0;
+  if (fd < 0) {
+    fprintf(stderr, "cannot read %s\n", name);
+    return 1;
+  }
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {         // returns what a serial port has, no waiting for more
+    vDec_Feed(&d, &part, buf, (size_t)n);
+    if (!d.quiet)
+      fflush(stdout);
+  }
+  if (fd)
+    close(fd);
+  vDec_Report(&d);
+  return d.records == 0;
+}
@@ -0,0 +1,218 @@
+/************************Description************************
+  Simulation of the Tx queue (rfm26_txq.cpp) against the sketch
+  path, where every frame goes to send_message() in the order
+  it was produced and an upload runs to its end before anything
+  else is sent.
+
+  Traffic on one 2.4Kbps channel:
+    alarm    Poisson, deadline RFM26_TXQ_DL_ALARM
+    control  every 2 s with jitter, deadline RFM26_TXQ_DL_CONTROL
+    bulk     uploads of 200 frames, spaced for the offered load;
+             with the queue the producer pushes while its class
+             has room, the rest waits in the producer
+
+  Reported per class and path: frames sent, on time (off air by
+  the deadline), expired, dropped, and latency from production
+  to end of airtime at p50, p99 and max.
+
+  Build:  g++ -O2 -I.. -o txq_sim txq_sim.cpp ../rfm26_txq.cpp
+  Usage:  txq_sim [seconds] [bulk_load_%] [alarms_per_min]
+**********************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include "rfm26_txq.h"
+
+#define BITRATE			2400
+#define PREAMBLE_LEN	8
+#define UPLOAD_FRAMES	200
+#define CONTROL_MS		2000
+
+static uint32_t gl_Rand = 0x1B873593;
+
+static uint32_t lSim_Rand(void)
+{
+  gl_Rand ^= gl_Rand << 13;
+  gl_Rand ^= gl_Rand >> 17;
+  gl_Rand ^= gl_Rand << 5;
+  return gl_Rand;
+}
+
+static double fSim_Uniform(void)
+{
+  return (lSim_Rand() + 0.5) / 4294967296.0;
+}
+
+typedef struct
+{
+  uint32_t t;                                             // ms
+  uint8_t  cls;
+  uint16_t n;                                             // frames, bulk uploads
+} SIM_ARRIVAL;
+
+typedef struct
+{
+  std::vector<double> lat;
+  unsigned made, on_time, expired, dropped;
+} SIM_CLASS;
+
+static const uint32_t gl_Deadline[RFM26_TXQ_CLASSES] = {
+  RFM26_TXQ_DL_ALARM, RFM26_TXQ_DL_CONTROL, RFM26_TXQ_DL_BULK,
+};
+static const char* gs_Name[RFM26_TXQ_CLASSES] = { "alarm", "control", "bulk" };
+
+static void vSim_Record(SIM_CLASS* c, uint8_t cls, uint32_t made, uint32_t pushed, uint32_t done)
+{
+  c[cls].lat.push_back(done - made);
+  if ((int32_t)(done - (pushed + gl_Deadline[cls])) <= 0)
+    c[cls].on_time++;
+}
+
+static double fSim_Pct(std::vector<double>& v, double p)
+{
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(p * (v.size() - 1))];
+}
+
+// the sketch: one send_message() after the other, in production order
+static void vSim_Direct(const std::vector<SIM_ARRIVAL>& arr, uint32_t air, SIM_CLASS* c)
+{
+  uint32_t free_at = 0;
+
+  for (size_t i = 0; i < arr.size(); i++) {
+    const SIM_ARRIVAL& a = arr[i];
+    for (unsigned k = 0; k < a.n; k++) {
+      uint32_t start = std::max(free_at, a.t);
+      free_at = start + air;
+      c[a.cls].made++;
+      vSim_Record(c, a.cls, a.t, a.t, free_at);
+    }
+  }
+}
+
+static void vSim_Put32(uint8_t* p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t lSim_Get32(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// the queue: frames carry class, production and push time
+static void vSim_Queue(const std::vector<SIM_ARRIVAL>& arr, uint32_t air, SIM_CLASS* c)
+{
+  RFM26_TXQ q;
+  std::deque<uint32_t> backlog;                           // bulk frames not pushed yet, production time
+  uint8_t frame[RFM26_TXQ_FRAME_LEN] = { 0 };
+  uint32_t now = 0, free_at = 0;
+  size_t ai = 0;
+  uint8_t cls;
+
+  RFM26_TxQ_Init(&q, (uint16_t)air);
+  while (ai < arr.size() || RFM26_TxQ_Pending(&q) || !backlog.empty()) {
+    int work = RFM26_TxQ_Pending(&q) || !backlog.empty();
+    if (ai < arr.size() && (arr[ai].t <= free_at || !work)) {
+      const SIM_ARRIVAL& a = arr[ai++];
+      now = std::max(now, a.t);
+      if (a.cls == C_TXQ_BULK) {
+        for (unsigned k = 0; k < a.n; k++)
+          backlog.push_back(a.t);
+      } else {
+        c[a.cls].made++;
+        vSim_Put32(frame, a.t);
+        vSim_Put32(frame + 4, a.t);
+        if (!RFM26_TxQ_Push(&q, a.cls, frame, RFM26_TXQ_FRAME_LEN, 0, now))
+          c[a.cls].dropped++;
+      }
+    } else {
+      now = std::max(now, free_at);
+    }
+
+    // the producer tops up the bulk class, the rest of the upload waits
+    while (!backlog.empty() && q.count[C_TXQ_BULK] < q.cap[C_TXQ_BULK] && RFM26_TxQ_Pending(&q) < RFM26_TXQ_DEPTH) {
+      c[C_TXQ_BULK].made++;
+      vSim_Put32(frame, backlog.front());
+      vSim_Put32(frame + 4, now);
+      backlog.pop_front();
+      RFM26_TxQ_Push(&q, C_TXQ_BULK, frame, RFM26_TXQ_FRAME_LEN, 0, now);
+    }
+
+    if (now >= free_at && RFM26_TxQ_Pop(&q, now, frame, &cls)) {
+      free_at = now + air;
+      vSim_Record(c, cls, lSim_Get32(frame), lSim_Get32(frame + 4), free_at);
+    }
+  }
+  for (int k = 0; k < RFM26_TXQ_CLASSES; k++) {
+    c[k].expired = q.stats[k].expired;
+    c[k].dropped += q.stats[k].evicted;
+  }
+}
+
+static bool bSim_Earlier(const SIM_ARRIVAL& a, const SIM_ARRIVAL& b)
+{
+  return a.t < b.t;
+}
+
+static void vSim_Print(const char* path, SIM_CLASS* c)
+{
+  for (int k = 0; k < RFM26_TXQ_CLASSES; k++)
+    printf("%-6s %-8s %6u %6u  %6.1f%%  %7u  %7u  %8.0f  %8.0f  %8.0f\n", path, gs_Name[k], c[k].made,
+           (unsigned)c[k].lat.size(), c[k].made ? 100.0 * c[k].on_time / c[k].made : 0.0, c[k].expired,
+           c[k].dropped, fSim_Pct(c[k].lat, 0.5), fSim_Pct(c[k].lat, 0.99), fSim_Pct(c[k].lat, 1.0));
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t seconds = argc > 1 ? atoi(argv[1]) : 3600;
+  double load = (argc > 2 ? atof(argv[2]) : 60) / 100.0;
+  double alarms = argc > 3 ? atof(argv[3]) : 2;
+  uint32_t air = (uint32_t)ceil((PREAMBLE_LEN + 2 + RFM26_TXQ_FRAME_LEN) * 8000.0 / BITRATE);
+  uint32_t end = seconds * 1000;
+  std::vector<SIM_ARRIVAL> arr;
+
+  if (seconds == 0 || load <= 0 || alarms < 0) {
+    fprintf(stderr, "usage: %s [seconds] [bulk_load_%%] [alarms_per_min]\n", argv[0]);
+    return 1;
+  }
+
+  double t;
+  if (alarms > 0)
+    for (t = -log(fSim_Uniform()) * 60000 / alarms; t < end; t += -log(fSim_Uniform()) * 60000 / alarms) {
+      SIM_ARRIVAL a = { (uint32_t)t, C_TXQ_ALARM, 1 };
+      arr.push_back(a);
+    }
+  for (t = 0; t < end; t += CONTROL_MS) {
+    SIM_ARRIVAL a = { (uint32_t)t + lSim_Rand() % 200, C_TXQ_CONTROL, 1 };
+    arr.push_back(a);
+  }
+  double gap = UPLOAD_FRAMES * air / load;
+  for (t = gap * fSim_Uniform(); t < end; t += gap * (0.5 + fSim_Uniform())) {
+    SIM_ARRIVAL a = { (uint32_t)t, C_TXQ_BULK, UPLOAD_FRAMES };
+    arr.push_back(a);
+  }
+  std::stable_sort(arr.begin(), arr.end(), bSim_Earlier);
+
+  SIM_CLASS direct[RFM26_TXQ_CLASSES] = {}, queued[RFM26_TXQ_CLASSES] = {};
+  vSim_Direct(arr, air, direct);
+  vSim_Queue(arr, air, queued);
+
+  printf("%u s, %u ms per frame, bulk load %.0f%% in uploads of %d, %.1f alarms/min, control every %d ms\n",
+         seconds, air, load * 100, UPLOAD_FRAMES, alarms, CONTROL_MS);
+  printf("queue %d entries, deadlines alarm %d ms, control %d ms, bulk %d ms\n\n",
+         RFM26_TXQ_DEPTH, RFM26_TXQ_DL_ALARM, RFM26_TXQ_DL_CONTROL, RFM26_TXQ_DL_BULK);
+  printf("path   class      made   sent  on time  expired  dropped   p50 ms    p99 ms    max ms\n");
+  vSim_Print("direct", direct);
+  vSim_Print("queue", queued);
+  return 0;
+}
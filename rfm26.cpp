@@ -1,50 +1,211 @@
 #include "rfm26_driver.h"
+#include "rfm26_telem.h"
+#include "rfm26_sched.h"
 
 #define MODE_PIN			2
+#define STATS_MS			10000						// telemetry ring counters every 10s
+#define TX_US				2000000UL					// transmitter: an exchange every 2s
+#define FLUSH_US			4096						// telemetry to the UART, about 45 bytes at 115200
+#define CAL_FRAMES			16							// packets the receiver averages the AFC over
+#define ARM_MARGIN_US		1000						// request to ACK turnaround, on top of the ACK airtime
+#define ARM_RETRY_US		1024						// ACK still on air when the re-arm came
 
 byte mode = 0;             //0: default receiver mode	, 1: transmitter mode
-byte tx_buf[64]={"HopeRF RFM COBRFM26-S"};
-byte rx_buf[64];
+byte tx_buf[RFM26_PKT_LEN+1]={"HopeRF RFM COBRFM26-S"};
+byte rx_buf[RFM26_PKT_LEN];
+byte ack_buf[RFM26_PKT_LEN]={"HopeRF RFM26 ACK    "};
+RFM26_TELEM telem;         //binary log to the host, read with host/telem_decode
+RFM26_CAL cal;             //XO trim, frequency offset and profile, kept in EEPROM
+byte cal_n = 0;            //AFC readings taken, CAL_FRAMES: calibrated
+long afc_sum = 0;
+byte cal_new = 0;          //offset learnt, applied at the next re-arm
+RFM26_SCHED sched;         //tasks instead of delay(); host/sched_sim is a copy of them for the emulator, no calibration
+RFM26_TASK boot_task, tx_task, rx_task, arm_task, flush_task, stats_task;
+byte boot_n = 0;           //RFM26_BootStep calls
+byte acked = 1;            //transmitter: the last exchange was answered
+unsigned int cnt_tx = 0;
+unsigned int cnt_rx = 0;
 
-void setup() 
+static void put_count(byte type, unsigned int cnt, const byte* p, byte n)
 {
-  //system init,
-  pinMode(MODE_PIN,INPUT_PULLUP);
+  byte rec[2 + 1 + RFM26_PKT_LEN];
 
-  Serial.begin(115200);
+  rec[0] = (byte)cnt;
+  rec[1] = (byte)(cnt >> 8);
+  if (n)
+    memcpy(rec + 2, p, n);
+  RFM26_Tel_Put(&telem, type, millis(), rec, 2 + n);
+}
+
+//a snapshot chunk, waits for the ring when a dump outruns the UART
+static void put_props(void* ctx, uint8_t group, uint8_t start, const uint8_t* v, uint8_t n)
+{
+  byte rec[2 + RFM26_SNAP_CHUNK];
+
+  (void)ctx;
+  rec[0] = group;
+  rec[1] = start;
+  memcpy(rec + 2, v, n);
+  while (RFM26_Tel_Room(&telem) < RFM26_TEL_MAX_WIRE)
+    RFM26_Tel_Flush(&telem);
+  RFM26_Tel_Put(&telem, C_TEL_PROPS, millis(), rec, 2 + n);
+}
+
+static void tx(void* ctx)
+{
+  (void)ctx;
+  if (!acked)
+    put_count(C_TEL_NOACK, cnt_tx - 1, 0, 0);
+  RFM26_StartExchange(tx_buf,RFM26_PKT_LEN,RFM26_PKT_LEN);
+  put_count(C_TEL_TX, cnt_tx++, 0, 0);
+  acked = 0;
+}
+
+//nIRQ: a packet, or the ACK to ours
+static void rx(void* ctx)
+{
+  byte rec[1 + RFM26_PKT_LEN];
 
-  //radio configuration
-  RFM26_Config();
+  (void)ctx;
+  if (receive_message((uint8_t*)rx_buf) == 0)
+    return;
+  if (mode) {
+    if (!acked) {
+      uint32_t rtt = RFM26_GetRoundTrip();
+      rec[0] = (byte)rtt;
+      rec[1] = (byte)(rtt >> 8);
+      rec[2] = (byte)(rtt >> 16);
+      rec[3] = (byte)(rtt >> 24);
+      put_count(C_TEL_ACK, cnt_tx - 1, rec, 4);
+      acked = 1;
+    }
+    return;
+  }
+  if (cal_n < CAL_FRAMES) {                               // first packets: learn the offset to the transmitter
+    afc_sum += RFM26_GetAfcOffset();
+    cal_new = ++cal_n == CAL_FRAMES;
+  }
+  //the radio sends the ACK now, re-armed once it is off the air
+  RFM26_Sched_Add(&sched, &arm_task, micros(), RFM26_Airtime(RFM26_PKT_LEN) + ARM_MARGIN_US, 0);
+  rec[0] = RFM26_GetRxInfo()->rssi;
+  memcpy(rec + 1, rx_buf, RFM26_PKT_LEN);
+  put_count(C_TEL_RX, cnt_rx++, rec, sizeof(rec));
+}
 
-	 //determine as receiver or transmitter
-	if(digitalRead(MODE_PIN)==0){
-    mode = 1;
-    RFM26_EntryTx();
+//receiver: the next ACK into Tx FIFO, the calibration first when it
+//is new, neither may retune under the ACK still on air
+static void arm(void* ctx)
+{
+  (void)ctx;
+  if (RFM26_GetState() == C_STATE_TX) {
+    RFM26_Sched_Add(&sched, &arm_task, micros(), ARM_RETRY_US, 0);
+    return;
   }
-  else{
-    mode = 0;
-    RFM26_EntryRx();    
+  if (cal_new) {
+    RFM26_GetCal(&cal);
+    cal.freq_ofs += (int16_t)(afc_sum / CAL_FRAMES);
+    RFM26_Cal_Seal(&cal);                                 // the edit broke the check byte
+    if (RFM26_SetCal(&cal)) {
+      RFM26_ApplyCal();
+      RFM26_Cal_Save(&cal);
+    }
+    cal_new = 0;
   }
+  RFM26_ArmResponse(ack_buf,RFM26_PKT_LEN);               // not in Tx: returns without waiting
 }
 
-void loop() {
-  byte num;
-  static unsigned int cnt=0;
-  static unsigned int cnt_tx=0;
+static void flush(void* ctx)
+{
+  (void)ctx;
+  if (Serial.available() && Serial.read() == 'p')         // property dump, read with host/prop_diff
+    RFM26_Snapshot(put_props, 0);
+  RFM26_Tel_Flush(&telem);
+}
+
+static void stats(void* ctx)
+{
+  (void)ctx;
+  RFM26_Tel_Stats(&telem, millis());
+}
 
+//radio up and configured: role, then Tx every TX_US or Rx on nIRQ
+static void start(void)
+{
   if (mode) {
-    send_message(tx_buf,21);
-    Serial.println("");
-    Serial.print(cnt_tx++);
-  	Serial.print(" packet had sended");
-    delay(2000);
+    RFM26_SetupTx();
+    RFM26_Sched_Add(&sched, &tx_task, micros(), 0, TX_US);
   } else {
-    num = receive_message((uint8_t*)rx_buf);
-    if (num>0) {
-      Serial.println("");
-      Serial.print(cnt++);
-      Serial.print(" packet received: ");
-      Serial.write(rx_buf, 21);
-    }
+    RFM26_SetupRx();
+    RFM26_ArmResponse(ack_buf,RFM26_PKT_LEN);
   }
+  RFM26_Sched_OnIrq(&sched, &rx_task);
+  RFM26_Tel_Put(&telem, C_TEL_BOOT, millis(), &mode, 1);
+}
+
+//cold boot a step at a time, the UART is served meanwhile; the boot
+//wait after POWER_UP ends on CHIP_READY
+static void boot(void* ctx)
+{
+  uint16_t us;
+
+  (void)ctx;
+  RFM26_Sched_Cancel(&sched, &boot_task);                 // run early by nIRQ
+  us = RFM26_BootStep();
+  if (us) {
+    if (++boot_n == 3)                                    // POWER_UP sent
+      RFM26_Sched_OnIrq(&sched, &boot_task);
+    RFM26_Sched_Add(&sched, &boot_task, micros(), us, 0);
+    return;
+  }
+  RFM26_Sched_OnIrq(&sched, 0);
+  RFM26_LoadConfig();
+  start();
+}
+
+static void on_irq(void)
+{
+  RFM26_Sched_Irq(&sched);
+}
+
+void setup() 
+{
+  unsigned long now;
+
+  //system init,
+  pinMode(MODE_PIN,INPUT_PULLUP);
+
+  Serial.begin(115200);
+  RFM26_Tel_Init(&telem);
+
+  //determine as receiver or transmitter
+  mode = digitalRead(MODE_PIN) == 0;
+
+  now = micros();
+  RFM26_Sched_Init(&sched, now);
+  RFM26_Sched_Task(&boot_task, boot, 0);
+  RFM26_Sched_Task(&tx_task, tx, 0);
+  RFM26_Sched_Task(&rx_task, rx, 0);
+  RFM26_Sched_Task(&arm_task, arm, 0);
+  RFM26_Sched_Task(&flush_task, flush, 0);
+  RFM26_Sched_Task(&stats_task, stats, 0);
+  RFM26_Sched_Add(&sched, &flush_task, now, FLUSH_US, FLUSH_US);
+  RFM26_Sched_Add(&sched, &stats_task, now, STATS_MS * 1000UL, STATS_MS * 1000UL);
+
+  //radio configuration, none needed when the radio kept it through our reset
+  if (RFM26_Cal_Load(&cal))
+    cal_n = CAL_FRAMES;
+  RFM26_SetCal(&cal);
+  if (RFM26_WarmBoot())
+    start();
+  else
+    RFM26_Sched_Add(&sched, &boot_task, now, 0, 0);
+  RFM26_SetIrqHook(on_irq);
+}
+
+//what is due, then sleep to the next interrupt; no delay() anywhere
+void loop() {
+  if (!nIRQ0_READ())                                      // level: an edge before the hook or a missed one
+    RFM26_Sched_Irq(&sched);
+  if (RFM26_Sched_Run(&sched, micros()))
+    RFM26_Sched_Sleep(&sched);
 }
@@ -0,0 +1,71 @@
+#include "rfm26_cal.h"
+#ifdef ARDUINO
+#include <EEPROM.h>
+#endif
+
+/************************Description************************
+  Per unit calibration: crystal trim, the frequency offset the
+  AFC measured against a peer, and the profile the unit runs.
+
+  RFM26_Config writes the trim and offset after the profile;
+  RFM26_WarmBoot reads them back from a radio that slept through
+  an MCU reset, and when they and the profile are still there
+  the property download is skipped. A blank or torn EEPROM fails
+  the check byte and the unit runs uncalibrated.
+**********************************************************/
+
+static uint8_t bCal_Crc(const uint8_t* p, uint8_t n)
+{
+  uint8_t crc = 0xFF, i;
+
+  while (n--) {
+    crc ^= *p++;
+    for (i = 0; i < 8; i++)
+      crc = (crc & 0x80) ? (uint8_t)(crc << 1) ^ 0x07 : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+void RFM26_Cal_Default(RFM26_CAL* c)
+{
+  c->xo_tune = C_CAL_XO_TUNE;
+  c->freq_ofs = 0;
+  c->profile = 1;                                         // C_2_4KHZ_35KHZ, the WDS table
+  RFM26_Cal_Seal(c);
+}
+
+void RFM26_Cal_Seal(RFM26_CAL* c)
+{
+  c->version = C_CAL_VERSION;
+  c->check = bCal_Crc((const uint8_t*)c, sizeof(*c) - 1);
+}
+
+uint8_t RFM26_Cal_Check(const RFM26_CAL* c)
+{
+  return c->version == C_CAL_VERSION && c->check == bCal_Crc((const uint8_t*)c, sizeof(*c) - 1);
+}
+
+#ifdef ARDUINO
+uint8_t RFM26_Cal_Load(RFM26_CAL* c)
+{
+  uint8_t* p = (uint8_t*)c;
+  uint8_t i;
+
+  for (i = 0; i < sizeof(*c); i++)
+    p[i] = EEPROM.read(RFM26_CAL_EE_ADDR + i);
+  if (RFM26_Cal_Check(c))
+    return 1;
+  RFM26_Cal_Default(c);
+  return 0;
+}
+
+void RFM26_Cal_Save(RFM26_CAL* c)
+{
+  const uint8_t* p = (const uint8_t*)c;
+  uint8_t i;
+
+  RFM26_Cal_Seal(c);
+  for (i = 0; i < sizeof(*c); i++)
+    EEPROM.update(RFM26_CAL_EE_ADDR + i, p[i]);           // a cell takes 100k writes
+}
+#endif
@@ -0,0 +1,74 @@
+#ifndef HopeDuino_26_CAL_H_
+#define HopeDuino_26_CAL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define calibration record, kept in EEPROM from RFM26_CAL_EE_ADDR
+#define C_CAL_VERSION		0x01						// changes with the layout, an old record is not used
+#define C_CAL_XO_TUNE		0x5D						// GLOBAL_XO_TUNE of an uncalibrated unit, as rfm26_wds.h
+#ifndef RFM26_CAL_EE_ADDR
+#define RFM26_CAL_EE_ADDR	0
+#endif
+
+typedef struct
+{
+  uint8_t version;                                        // C_CAL_VERSION
+  uint8_t xo_tune;                                        // GLOBAL_XO_TUNE, crystal load capacitance
+  int16_t freq_ofs;                                       // MODEM_FREQ_OFFSET, synthesizer steps, from AFC
+  uint8_t profile;                                        // rfm26_config.h profile, C_1_2KHZ_35KHZ..C_9_6KHZ_35KHZ
+  uint8_t check;                                          // CRC-8 of the bytes before
+} RFM26_CAL;
+
+/**********************************************************
+**Name:     RFM26_Cal_Default
+**Function: Record of an uncalibrated unit, sealed
+**Input:    c, record
+**Output:   None
+**********************************************************/
+void RFM26_Cal_Default(RFM26_CAL* c);
+
+/**********************************************************
+**Name:     RFM26_Cal_Seal
+**Function: Set version and check byte after a change
+**Input:    c, record
+**Output:   None
+**********************************************************/
+void RFM26_Cal_Seal(RFM26_CAL* c);
+
+/**********************************************************
+**Name:     RFM26_Cal_Check
+**Function: Check version and check byte
+**Input:    c, record
+**Output:   1 if the record can be used
+**********************************************************/
+uint8_t RFM26_Cal_Check(const RFM26_CAL* c);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Cal_Load
+**Function: Read the record from EEPROM
+**Input:    c, record out, the default one when EEPROM holds
+            none that checks
+**Output:   1 if EEPROM held a record
+**********************************************************/
+uint8_t RFM26_Cal_Load(RFM26_CAL* c);
+
+/**********************************************************
+**Name:     RFM26_Cal_Save
+**Function: Seal the record and write it to EEPROM, bytes
+            that did not change are not written
+**Input:    c, record
+**Output:   None
+**********************************************************/
+void RFM26_Cal_Save(RFM26_CAL* c);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#include <string.h>
+#include "rfm26_capture.h"
+
+/************************Description************************
+  Append-only frame capture. The driver hands every frame it
+  receives or sends to RFM26_Cap_Frame when a capture is set
+  (RFM26_SetCapture); the bytes go to a sink the sketch
+  provides, an SD card file or a serial link.
+
+  A record is self-delimiting: sync byte, 9 header bytes, the
+  payload. The check byte covers header and payload, so a
+  record torn by a reset or a full sink is found and skipped,
+  and a reader can pick up again at the next sync byte.
+**********************************************************/
+
+/**********************************************************
+**Name:     bCap_Sum
+**Function: Check byte: one's complement of the byte sum
+**********************************************************/
+static uint8_t bCap_Sum(uint8_t sum, const uint8_t* p, uint8_t n)
+{
+  while (n--)
+    sum += *p++;
+  return sum;
+}
+
+void RFM26_Cap_Init(RFM26_CAPTURE* c, RFM26_CAP_WRITE write, void* ctx, uint8_t crc_on)
+{
+  c->write = write;
+  c->ctx = ctx;
+  c->crc_on = crc_on;
+  c->records = 0;
+  c->dropped = 0;
+}
+
+uint8_t RFM26_Cap_Start(RFM26_CAPTURE* c)
+{
+  uint8_t h[RFM26_CAP_FILE_HDR] = { 'R', '2', '6', 'C', RFM26_CAP_VERSION, 0, 0, 0 };
+
+  return c->write(c->ctx, h, sizeof(h));
+}
+
+uint8_t RFM26_Cap_Frame(RFM26_CAPTURE* c, uint8_t kind_status, uint8_t channel, uint8_t rssi, uint32_t t_us,
+                        const uint8_t* p1, uint8_t n1, const uint8_t* p2, uint8_t n2)
+{
+  uint8_t h[RFM26_CAP_HDR];
+
+  if (n1 > RFM26_CAP_MAX_LEN)
+    n1 = RFM26_CAP_MAX_LEN;
+  if (n2 > RFM26_CAP_MAX_LEN - n1)
+    n2 = RFM26_CAP_MAX_LEN - n1;
+  h[0] = RFM26_CAP_SYNC;
+  h[1] = kind_status;
+  h[2] = n1 + n2;
+  h[3] = rssi;
+  h[4] = channel;
+  h[5] = (uint8_t)t_us;
+  h[6] = (uint8_t)(t_us >> 8);
+  h[7] = (uint8_t)(t_us >> 16);
+  h[8] = (uint8_t)(t_us >> 24);
+  h[9] = ~bCap_Sum(bCap_Sum(bCap_Sum(0, h, 9), p1, n1), p2, n2);
+  if (!c->write(c->ctx, h, RFM26_CAP_HDR) || (n1 && !c->write(c->ctx, p1, n1)) || (n2 && !c->write(c->ctx, p2, n2))) {
+    c->dropped++;
+    return 0;
+  }
+  c->records++;
+  return 1;
+}
+
+uint16_t RFM26_Cap_Parse(const uint8_t* p, uint32_t avail, RFM26_CAP_REC* r)
+{
+  uint8_t len;
+
+  if (avail < RFM26_CAP_HDR || p[0] != RFM26_CAP_SYNC || (p[1] & 0xF0) || p[2] > RFM26_CAP_MAX_LEN)
+    return 0;
+  len = p[2];
+  if (avail < (uint32_t)RFM26_CAP_HDR + len)
+    return 0;
+  if ((uint8_t)~bCap_Sum(bCap_Sum(0, p, 9), p + RFM26_CAP_HDR, len) != p[9])
+    return 0;
+  r->kind = p[1] & C_CAP_KIND;
+  r->status = p[1] & C_CAP_CRC;
+  r->len = len;
+  r->rssi = p[3];
+  r->channel = p[4];
+  r->t_us = (uint32_t)p[5] | (uint32_t)p[6] << 8 | (uint32_t)p[7] << 16 | (uint32_t)p[8] << 24;
+  r->data = p + RFM26_CAP_HDR;
+  return RFM26_CAP_HDR + len;
+}
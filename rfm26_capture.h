@@ -0,0 +1,106 @@
+#ifndef HopeDuino_26_CAPTURE_H_
+#define HopeDuino_26_CAPTURE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define capture file header: magic, version, 3 bytes reserved
+#define RFM26_CAP_MAGIC		"R26C"
+#define RFM26_CAP_VERSION	1
+#define RFM26_CAP_FILE_HDR	8
+
+//Define record: sync, kind|status, len, rssi, channel, t_us (4, little endian), check, then len bytes
+#define RFM26_CAP_SYNC		0xA5
+#define RFM26_CAP_HDR		10
+#define RFM26_CAP_MAX_LEN	64							// FIFO size
+
+//Define record kind, bits 1..0
+#define C_CAP_RX			0x00
+#define C_CAP_TX			0x01						// START_TX by the driver
+#define C_CAP_TX_ARMED		0x02						// response preloaded, sent by the radio on a valid request
+#define C_CAP_KIND			0x03
+
+//Define CRC status, bits 3..2
+#define C_CAP_CRC_NONE		0x00						// packet handler CRC off, or a Tx frame
+#define C_CAP_CRC_OK		0x04
+#define C_CAP_CRC_BAD		0x08
+#define C_CAP_CRC			0x0C
+
+//Byte sink, 1 if all n bytes were taken; a record is written as its header then its payload
+typedef uint8_t (*RFM26_CAP_WRITE)(void* ctx, const uint8_t* p, uint16_t n);
+
+typedef struct
+{
+  RFM26_CAP_WRITE write;
+  void*    ctx;
+  uint8_t  crc_on;                                        // config has the packet handler CRC on
+  uint32_t records;
+  uint32_t dropped;                                       // sink refused, the record is lost or torn
+} RFM26_CAPTURE;
+
+//Record as read back
+typedef struct
+{
+  uint8_t  kind;                                          // C_CAP_xxx
+  uint8_t  status;                                        // C_CAP_CRC_xxx
+  uint8_t  len;
+  uint8_t  rssi;                                          // latched RSSI, 0.5dB steps, 0 for Tx
+  uint8_t  channel;
+  uint32_t t_us;                                          // micros(), wraps after 71 minutes
+  const uint8_t* data;
+} RFM26_CAP_REC;
+
+/**********************************************************
+**Name:     RFM26_Cap_Init
+**Function: Capture writer, nothing written yet
+**Input:    c, capture
+            write, byte sink
+            ctx, passed to write
+            crc_on, packet handler CRC enabled in the config
+**Output:   None
+**********************************************************/
+void RFM26_Cap_Init(RFM26_CAPTURE* c, RFM26_CAP_WRITE write, void* ctx, uint8_t crc_on);
+
+/**********************************************************
+**Name:     RFM26_Cap_Start
+**Function: Write the file header, for a new file only: a
+            capture is appended to as it is
+**Input:    c, capture
+**Output:   1 if written
+**********************************************************/
+uint8_t RFM26_Cap_Start(RFM26_CAPTURE* c);
+
+/**********************************************************
+**Name:     RFM26_Cap_Frame
+**Function: Append one frame record, the payload from up to
+            two parts (header and rest of a split receive)
+**Input:    c, capture
+            kind_status, C_CAP_xxx | C_CAP_CRC_xxx
+            channel, channel number
+            rssi, latched RSSI
+            t_us, time of the frame
+            p1, n1, first part
+            p2, n2, second part, n2 may be 0
+**Output:   1 if written
+**********************************************************/
+uint8_t RFM26_Cap_Frame(RFM26_CAPTURE* c, uint8_t kind_status, uint8_t channel, uint8_t rssi, uint32_t t_us,
+                        const uint8_t* p1, uint8_t n1, const uint8_t* p2, uint8_t n2);
+
+/**********************************************************
+**Name:     RFM26_Cap_Parse
+**Function: Record at p, if there is a whole valid one
+**Input:    p, bytes
+            avail, bytes from p to the end of the capture
+            r, record out, data points into p
+**Output:   record length, 0 if no valid record starts at p
+**********************************************************/
+uint16_t RFM26_Cap_Parse(const uint8_t* p, uint32_t avail, RFM26_CAP_REC* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
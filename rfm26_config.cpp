@@ -0,0 +1,221 @@
+#include <string.h>
+#include "rfm26_config.h"
+
+/************************Description************************
+  Radio configuration kept in program memory.
+
+  On AVR a const table without PROGMEM is copied to SRAM at
+  start up, so the WDS table and the rate, frequency and power
+  rows used to cost their size twice, once in RAM. Here they
+  stay in flash and are read a byte at a time; the WDS table is
+  also encoded, ParameterConfig decodes a command at a time into
+  the 16 byte API buffer.
+
+  Stream:  header byte per record, C_CFG_END last
+    raw    C_CFG_RAW | n, n command bytes
+    run    [group] [start] values, count in the header; group
+           and start are left out when they follow from the
+           run before; C_CFG_DELTA values are the first one,
+           then a signed nibble step per property, high nibble
+           first
+  A run decodes to SET_PROPERTY group, count, start, values.
+
+  Profiles are short streams sent after the base one, only the
+  properties that differ from it, so one more costs flash only.
+**********************************************************/
+
+const uint8_t RFM26FreqTbl[4][8] CFG_ROM = {
+  {0x03, 0x40, 0x00, 0x0B, 0x3E, 0x08, 0x00, 0x00},  //315MHz
+  {0x03, 0x80, 0x00, 0x0A, 0x38, 0x0E, 0xEE, 0xEE},  //434MHz
+  {0x03, 0xC0, 0x00, 0x08, 0x38, 0x0E, 0xEE, 0xEE},  //868MHz
+  {0x03, 0xC0, 0x00, 0x08, 0x3C, 0x08, 0x00, 0x00},  //915MHz
+};
+
+//MODEM_DATA_RATE and MODEM_BCR_OSR..BCR_GAIN per rate, the 2.4Kbps row is the WDS profile,
+//the others scale the clock recovery loop; deviation and the 150KHz Rx filter are shared
+const uint8_t RFM26RateTbl[4][10] CFG_ROM = {
+  {0x00, 0x04, 0xB0, 0x08, 0x24, 0x00, 0x3E, 0xEA, 0x00, 0x20},  //1.2Kbps
+  {0x00, 0x09, 0x60, 0x04, 0x12, 0x00, 0x7D, 0xD4, 0x00, 0x3F},  //2.4Kbps
+  {0x00, 0x12, 0xC0, 0x02, 0x09, 0x00, 0xFB, 0xA8, 0x00, 0x7E},  //4.8Kbps
+  {0x00, 0x25, 0x80, 0x01, 0x04, 0x01, 0xF7, 0x50, 0x00, 0xFC},  //9.6Kbps
+};
+
+const uint8_t RFM26PowerTbl[4][2] CFG_ROM = {
+  {0x7F,0x00},                            //20dbm
+  {0x30,0x00},                            //17dbm
+  {0x20,0x00},                            //14dbm
+  {0x16,0x00},                            //11dbm
+};
+
+void RFM26_Cfg_Begin(RFM26_CFG_RD* r, const uint8_t* stream)
+{
+  r->p = stream;
+  r->group = 0;
+  r->next = 0;
+}
+
+uint8_t RFM26_Cfg_Next(RFM26_CFG_RD* r, uint8_t* cmd)
+{
+  uint8_t h, n, i, v, d;
+
+  h = CFG_RD(r->p);
+  if (h == C_CFG_END)
+    return 0;                                             // stays on the end byte
+  r->p++;
+  if (h & C_CFG_RAW) {
+    n = h & ~C_CFG_RAW;
+    for (i = 0; i < n; i++)
+      cmd[i] = CFG_RD(r->p++);
+    return n;
+  }
+  n = h & C_CFG_COUNT;
+  if (h & C_CFG_GROUP)
+    r->group = CFG_RD(r->p++);
+  if (h & C_CFG_START)
+    r->next = CFG_RD(r->p++);
+  cmd[0] = 0x11;                                          // CMD_SET_PROPERTY
+  cmd[1] = r->group;
+  cmd[2] = n;
+  cmd[3] = r->next;
+  if (h & C_CFG_DELTA) {
+    v = CFG_RD(r->p++);
+    cmd[4] = v;
+    for (i = 1; i < n; i++) {
+      d = CFG_RD(r->p + ((i - 1) >> 1));
+      d = (i & 1) ? d >> 4 : d & 0x0F;
+      v += (uint8_t)((d ^ 0x08) - 0x08);                  // sign extend the nibble
+      cmd[4 + i] = v;
+    }
+    r->p += n >> 1;                                       // (n - 1) steps, rounded up
+  } else {
+    for (i = 0; i < n; i++)
+      cmd[4 + i] = CFG_RD(r->p++);
+  }
+  r->next += n;
+  return 4 + n;
+}
+
+const uint8_t* RFM26_Cfg_Profile(uint8_t profile)
+{
+  if (profile >= RFM26_PROFILES)
+    return 0;
+  return RFM26CfgProfile + CFG_RD16(&RFM26CfgProfileOfs[profile]);
+}
+
+void RFM26_Cfg_Copy(uint8_t* dst, const uint8_t* src, uint8_t n)
+{
+  while (n--)
+    *dst++ = CFG_RD(src++);
+}
+
+#ifndef ARDUINO
+/**********************************************************
+**Name:     wCfg_Run
+**Function: Encode one property run, delta coded when every
+            step fits a nibble and that is shorter
+**********************************************************/
+static uint16_t wCfg_Run(uint8_t* out, uint8_t group, uint8_t start, const uint8_t* v, uint8_t n,
+                         uint8_t* cur_group, uint8_t* cur_next, uint8_t first)
+{
+  uint8_t h = n, i, delta = n >= 3;
+  uint16_t len = 0;
+  int8_t s;
+
+  for (i = 1; i < n && delta; i++) {
+    s = (int8_t)(v[i] - v[i - 1]);
+    if (s < -8 || s > 7)
+      delta = 0;
+  }
+  if (first || group != *cur_group)
+    h |= C_CFG_GROUP;
+  if (first || start != *cur_next)
+    h |= C_CFG_START;
+  if (delta)
+    h |= C_CFG_DELTA;
+  out[len++] = h;
+  if (h & C_CFG_GROUP)
+    out[len++] = group;
+  if (h & C_CFG_START)
+    out[len++] = start;
+  if (delta) {
+    out[len++] = v[0];
+    for (i = 1; i < n; i++) {
+      s = (int8_t)(v[i] - v[i - 1]);
+      if (i & 1)
+        out[len] = (uint8_t)((s & 0x0F) << 4);
+      else
+        out[len++] |= (uint8_t)(s & 0x0F);
+    }
+    if (!(n & 1))                                         // odd step count, last byte half used
+      len++;
+  } else {
+    memcpy(out + len, v, n);
+    len += n;
+  }
+  *cur_group = group;
+  *cur_next = (uint8_t)(start + n);
+  return len;
+}
+
+uint16_t RFM26_Cfg_Encode(const uint8_t* table, uint8_t* out, uint16_t max)
+{
+  uint8_t run[RFM26_CFG_MAX_PROPS];
+  uint8_t run_n = 0, run_group = 0, run_start = 0;
+  uint8_t cur_group = 0, cur_next = 0, first = 1;
+  uint8_t tmp[1 + 2 + 1 + RFM26_CFG_MAX_PROPS];
+  uint16_t len = 0, k, i = 0;
+  const uint8_t* c;
+  uint8_t n, j;
+
+  for (;;) {
+    n = table[i];
+    c = table + i + 1;
+    // close the open run unless this command continues it
+    if (run_n && (n == 0 || c[0] != 0x11 || c[1] != run_group || c[3] != (uint8_t)(run_start + run_n))) {
+      k = wCfg_Run(tmp, run_group, run_start, run, run_n, &cur_group, &cur_next, first);
+      if (len + k > max)
+        return 0;
+      memcpy(out + len, tmp, k);
+      len += k;
+      run_n = 0;
+      first = 0;
+    }
+    if (n == 0)
+      break;
+    if (n > RFM26_CFG_MAX_CMD)
+      return 0;
+    if (c[0] == 0x11) {
+      if (n < 5 || c[2] == 0 || c[2] > RFM26_CFG_MAX_PROPS || n != 4 + c[2])
+        return 0;
+      if (!run_n) {
+        run_group = c[1];
+        run_start = c[3];
+      }
+      for (j = 0; j < c[2]; j++) {
+        if (run_n == RFM26_CFG_MAX_PROPS) {               // full, the rest starts the next run
+          k = wCfg_Run(tmp, run_group, run_start, run, run_n, &cur_group, &cur_next, first);
+          if (len + k > max)
+            return 0;
+          memcpy(out + len, tmp, k);
+          len += k;
+          run_start = (uint8_t)(run_start + run_n);
+          run_n = 0;
+          first = 0;
+        }
+        run[run_n++] = c[4 + j];
+      }
+    } else {
+      if (len + 1 + n > max)
+        return 0;
+      out[len++] = (uint8_t)(C_CFG_RAW | n);
+      memcpy(out + len, c, n);
+      len += n;
+    }
+    i += 1 + n;
+  }
+  if (len + 1 > max)
+    return 0;
+  out[len++] = C_CFG_END;
+  return len;
+}
+#endif
@@ -0,0 +1,111 @@
+#ifndef HopeDuino_26_CONFIG_H_
+#define HopeDuino_26_CONFIG_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define where the tables live: program memory on AVR, read back a byte at a time
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define CFG_ROM			PROGMEM
+#define CFG_RD(p)		pgm_read_byte(p)
+#define CFG_RD16(p)		pgm_read_word(p)
+#define CFG_RD32(p)		pgm_read_dword(p)
+#else
+#define CFG_ROM
+#define CFG_RD(p)		(*(p))
+#define CFG_RD16(p)		(*(p))
+#define CFG_RD32(p)		(*(p))
+#endif
+
+//Define encoded stream, one header byte per record
+#define C_CFG_END		0x00						// end of stream
+#define C_CFG_RAW		0x80						// | length: command bytes as they are, POWER_UP, GPIO_PIN_CFG
+#define C_CFG_GROUP		0x40						// property run: group byte follows, else the group of the run before
+#define C_CFG_START		0x20						// property run: start byte follows, else where the run before ended
+#define C_CFG_DELTA		0x10						// property run: first value, then 4-bit signed steps two per byte
+#define C_CFG_COUNT		0x0F						// property run: properties, 1..RFM26_CFG_MAX_PROPS
+
+#define RFM26_CFG_MAX_PROPS	12						// SET_PROPERTY limit
+#define RFM26_CFG_MAX_CMD	16						// longest command decoded, abApi_Write
+
+//Define profiles, overlays on the base stream, one per RFM26RateTbl row
+#define RFM26_PROFILES		4
+
+//Stream reader
+typedef struct
+{
+  const uint8_t* p;                                       // next header, in program memory
+  uint8_t group;                                          // property group of the last run
+  uint8_t next;                                           // property after the last run
+} RFM26_CFG_RD;
+
+//Generated by host/config_pack into rfm26_profiles.cpp
+extern const uint8_t RFM26CfgBase[] CFG_ROM;               // the WDS table
+extern const uint8_t RFM26CfgProfile[] CFG_ROM;            // profile overlays, one after the other
+extern const uint16_t RFM26CfgProfileOfs[RFM26_PROFILES] CFG_ROM;
+
+//Rows for RFM26_SetParameter_Freq/Rate/Power, read with CFG_RD or RFM26_Cfg_Copy
+extern const uint8_t RFM26FreqTbl[4][8] CFG_ROM;
+extern const uint8_t RFM26RateTbl[4][10] CFG_ROM;
+extern const uint8_t RFM26PowerTbl[4][2] CFG_ROM;
+
+/**********************************************************
+**Name:     RFM26_Cfg_Begin
+**Function: Start reading an encoded stream
+**Input:    r, reader
+            stream, in program memory
+**Output:   None
+**********************************************************/
+void RFM26_Cfg_Begin(RFM26_CFG_RD* r, const uint8_t* stream);
+
+/**********************************************************
+**Name:     RFM26_Cfg_Next
+**Function: Decode the next record into an API command
+**Input:    r, reader
+            cmd, RFM26_CFG_MAX_CMD bytes
+**Output:   command length, 0 at the end of the stream
+**********************************************************/
+uint8_t RFM26_Cfg_Next(RFM26_CFG_RD* r, uint8_t* cmd);
+
+/**********************************************************
+**Name:     RFM26_Cfg_Profile
+**Function: Overlay stream of a profile
+**Input:    profile, 0..RFM26_PROFILES-1
+**Output:   stream in program memory, 0 if there is no such
+            profile
+**********************************************************/
+const uint8_t* RFM26_Cfg_Profile(uint8_t profile);
+
+/**********************************************************
+**Name:     RFM26_Cfg_Copy
+**Function: Copy a table row out of program memory
+**Input:    dst, RAM
+            src, row in program memory
+            n, bytes
+**Output:   None
+**********************************************************/
+void RFM26_Cfg_Copy(uint8_t* dst, const uint8_t* src, uint8_t n);
+
+#ifndef ARDUINO
+/**********************************************************
+**Name:     RFM26_Cfg_Encode
+**Function: Encode a table in RADIO_CONFIGURATION_DATA_ARRAY
+            layout; SET_PROPERTY commands that continue each
+            other are merged, up to RFM26_CFG_MAX_PROPS
+**Input:    table, [length, command...] records ended by 0x00
+            out, max, stream out
+**Output:   stream bytes with the end byte, 0 if a command is
+            malformed or out is too small
+**********************************************************/
+uint16_t RFM26_Cfg_Encode(const uint8_t* table, uint8_t* out, uint16_t max);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+#include <string.h>
+#include "rfm26_crc.h"
+
+/************************Description************************
+  CRC and PN9 whitening as the Si446x packet handler does
+  them, for the emulator, the direct mode decoder and capture
+  checks.
+
+  CRC: polynomial and seed from PKT_CRC_CONFIG, inversion and
+  byte order from PKT_CONFIG1, data MSB first, no reflection.
+  The register is kept left aligned in 32 bits, so 8, 16 and
+  32 bit polynomials share one code path.
+    host   slice-by-8: 8 table reads per 8 bytes and no
+           dependency from one byte to the next within a word
+    MCU    one 16 entry table, two reads per byte, 64 bytes of
+           RAM per polynomial
+
+  PN9: x^9 + x^5 + 1 from PKT_WHT_SEED, the whitening byte is
+  the low 8 bits of the register before 8 shifts. The sequence
+  repeats every 511 bytes; a host keeps one period and XORs 8
+  bytes at a time, an MCU shifts the register.
+**********************************************************/
+
+typedef struct
+{
+  uint32_t poly;
+  uint8_t  width;
+} CRC_POLY;
+
+//PKT_CRC_CONFIG CRC_POLYNOMIAL 0..9
+static const CRC_POLY gt_CrcPoly[10] = {
+  { 0, 0 },                                               // NO_CRC
+  { 0x07, 8 },                                            // ITU_T_CRC8
+  { 0x5B13, 16 },                                         // IEC_16
+  { 0x90D9, 16 },                                         // BAICHEVA_16
+  { 0x8005, 16 },                                         // CRC_16_IBM
+  { 0x1021, 16 },                                         // CCITT_16
+  { 0x741B8CD7, 32 },                                     // KOOPMAN
+  { 0x04C11DB7, 32 },                                     // IEEE_802_3
+  { 0x1EDC6F41, 32 },                                     // CASTAGNOLI
+  { 0x3D65, 16 },                                         // CRC_16_DNP
+};
+
+static uint32_t lCrc_Shift(uint32_t r, uint32_t poly, uint8_t bits)
+{
+  while (bits--)
+    r = (r & 0x80000000UL) ? (r << 1) ^ poly : r << 1;
+  return r;
+}
+
+/**********************************************************
+**Name:     RFM26_Crc_Init
+**Function: Set up the CRC the packet handler is configured
+            for, tables included
+**Input:    c, CRC
+            crc_config, PKT_CRC_CONFIG
+            pkt_config1, PKT_CONFIG1
+**Output:   CRC bytes per packet, 0 if none or out of range
+**********************************************************/
+uint8_t RFM26_Crc_Init(RFM26_CRC* c, uint8_t crc_config, uint8_t pkt_config1)
+{
+  uint8_t k = crc_config & 0x0F;
+  uint16_t i;
+
+  memset(c, 0, sizeof(*c));
+  if (k >= 10 || gt_CrcPoly[k].width == 0)
+    return 0;
+  c->width = gt_CrcPoly[k].width;
+  c->poly = gt_CrcPoly[k].poly << (32 - c->width);
+  c->mask = c->width == 32 ? 0xFFFFFFFFUL : (1UL << c->width) - 1;
+  c->seed = (crc_config & C_CRC_SEED_ONES) ? c->mask << (32 - c->width) : 0;
+  c->invert = (pkt_config1 & C_PKT_CRC_INVERT) != 0;
+  c->msb = (pkt_config1 & C_PKT_CRC_ENDIAN) != 0;
+#if RFM26_CRC_SLICES
+  for (i = 0; i < 256; i++)
+    c->t[0][i] = lCrc_Shift((uint32_t)i << 24, c->poly, 8);
+  for (k = 1; k < RFM26_CRC_SLICES; k++)
+    for (i = 0; i < 256; i++)
+      c->t[k][i] = (c->t[k - 1][i] << 8) ^ c->t[0][c->t[k - 1][i] >> 24];
+#else
+  for (i = 0; i < 16; i++)
+    c->t[i] = lCrc_Shift((uint32_t)i << 28, c->poly, 4);
+#endif
+  return c->width / 8;
+}
+
+/**********************************************************
+**Name:     RFM26_Crc_Calc
+**Function: CRC of a buffer
+**Input:    c, CRC
+            p, data
+            n, length
+**Output:   CRC, right aligned, inverted if configured
+**********************************************************/
+uint32_t RFM26_Crc_Calc(const RFM26_CRC* c, const uint8_t* p, uint16_t n)
+{
+  uint32_t r = c->seed;
+
+  if (c->width == 0)
+    return 0;
+#if RFM26_CRC_SLICES
+  uint32_t x;
+  for (; n >= 8; n -= 8, p += 8) {
+    x = r ^ ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+    r = c->t[7][x >> 24] ^ c->t[6][(x >> 16) & 0xFF] ^ c->t[5][(x >> 8) & 0xFF] ^ c->t[4][x & 0xFF] ^
+        c->t[3][p[4]] ^ c->t[2][p[5]] ^ c->t[1][p[6]] ^ c->t[0][p[7]];
+  }
+  while (n--)
+    r = (r << 8) ^ c->t[0][(r >> 24) ^ *p++];
+#else
+  while (n--) {
+    r ^= (uint32_t)*p++ << 24;
+    r = (r << 4) ^ c->t[r >> 28];
+    r = (r << 4) ^ c->t[r >> 28];
+  }
+#endif
+  r >>= 32 - c->width;
+  return c->invert ? r ^ c->mask : r;
+}
+
+/**********************************************************
+**Name:     RFM26_Crc_Put
+**Function: Append the CRC bytes in on air order
+**Input:    c, CRC
+            crc, from RFM26_Crc_Calc
+            out, c->width / 8 bytes
+**Output:   None
+**********************************************************/
+void RFM26_Crc_Put(const RFM26_CRC* c, uint32_t crc, uint8_t* out)
+{
+  uint8_t i, nc = c->width / 8;
+
+  for (i = 0; i < nc && i < 4; i++)
+    out[i] = (uint8_t)(crc >> (c->msb ? 8 * (nc - 1 - i) : 8 * i));
+}
+
+/**********************************************************
+**Name:     RFM26_Crc_Check
+**Function: Check data followed by its CRC bytes
+**Input:    c, CRC
+            p, data then CRC
+            n, data length, CRC excluded
+**Output:   1 if the CRC matches or there is none
+**********************************************************/
+uint8_t RFM26_Crc_Check(const RFM26_CRC* c, const uint8_t* p, uint16_t n)
+{
+  uint8_t want[4];
+
+  if (c->width == 0)
+    return 1;
+  RFM26_Crc_Put(c, RFM26_Crc_Calc(c, p, n), want);
+  return memcmp(want, p + n, c->width / 8) == 0;
+}
+
+/**********************************************************
+**Name:     RFM26_Pn9_Init
+**Function: Whitening sequence from a seed
+**Input:    w, whitening
+            seed, PKT_WHT_SEED, 9 bits
+**Output:   None
+**********************************************************/
+void RFM26_Pn9_Init(RFM26_PN9* w, uint16_t seed)
+{
+  w->seed = seed & 0x1FF;
+#if RFM26_CRC_SLICES
+  uint16_t s = w->seed, i;
+  uint8_t k;
+  for (i = 0; i < 511; i++) {
+    w->key[i] = (uint8_t)s;
+    for (k = 0; k < 8; k++)
+      s = (s >> 1) | (((s ^ (s >> 5)) & 1) << 8);
+  }
+  memcpy(w->key + 511, w->key, 7);
+#endif
+}
+
+/**********************************************************
+**Name:     RFM26_Pn9_Apply
+**Function: Whiten or dewhiten in place, the sequence starts
+            from the seed at p[0]
+**Input:    w, whitening
+            p, data
+            n, length
+**Output:   None
+**********************************************************/
+void RFM26_Pn9_Apply(const RFM26_PN9* w, uint8_t* p, uint16_t n)
+{
+#if RFM26_CRC_SLICES
+  uint64_t a, b;
+  uint16_t k = 0;
+  for (; n >= 8; n -= 8, p += 8) {
+    memcpy(&a, p, 8);
+    memcpy(&b, w->key + k, 8);
+    a ^= b;
+    memcpy(p, &a, 8);
+    k += 8;
+    if (k >= 511)
+      k -= 511;
+  }
+  while (n--) {
+    *p++ ^= w->key[k++];
+    if (k == 511)
+      k = 0;
+  }
+#else
+  uint16_t s = w->seed;
+  uint8_t k;
+  while (n--) {
+    *p++ ^= (uint8_t)s;
+    for (k = 0; k < 8; k++)
+      s = (s >> 1) | (((s ^ (s >> 5)) & 1) << 8);
+  }
+#endif
+}
@@ -0,0 +1,129 @@
+#ifndef HopeDuino_26_CRC_H_
+#define HopeDuino_26_CRC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define CRC table size: slice-by-8 tables (8KB) on a host, a 16 entry nibble table (64 bytes) on an MCU
+#ifndef RFM26_CRC_SLICES
+#if defined(__AVR__) || defined(ARDUINO)
+#define RFM26_CRC_SLICES	0
+#else
+#define RFM26_CRC_SLICES	8
+#endif
+#endif
+
+//Define PKT_CRC_CONFIG
+#define C_CRC_SEED_ONES		0x80						// CRC_SEED: start from all ones
+#define C_CRC_NONE			0x00						// CRC_POLYNOMIAL 0..9, low nibble
+#define C_CRC_ITU_T_CRC8	0x01
+#define C_CRC_IEC_16		0x02
+#define C_CRC_BAICHEVA_16	0x03
+#define C_CRC_16_IBM		0x04
+#define C_CRC_CCITT_16		0x05
+#define C_CRC_KOOPMAN		0x06
+#define C_CRC_IEEE_802_3	0x07
+#define C_CRC_CASTAGNOLI	0x08
+#define C_CRC_16_DNP		0x09
+
+//Define PKT_CONFIG1 bits used by the CRC
+#define C_PKT_CRC_INVERT	0x04						// CRC sent inverted
+#define C_PKT_CRC_ENDIAN	0x02						// CRC sent MSB first
+
+//Define PN9 whitening seed, PKT_WHT_SEED reset value
+#define RFM26_PN9_SEED		0x01FF
+
+//CRC as the packet handler computes it, from PKT_CRC_CONFIG and PKT_CONFIG1
+typedef struct
+{
+  uint32_t poly;                                          // left aligned in 32 bits
+  uint32_t seed;                                          // left aligned
+  uint32_t mask;                                          // width bits, right aligned
+  uint8_t  width;                                         // 0, 8, 16 or 32
+  uint8_t  invert;
+  uint8_t  msb;                                           // CRC bytes MSB first
+#if RFM26_CRC_SLICES
+  uint32_t t[RFM26_CRC_SLICES][256];
+#else
+  uint32_t t[16];
+#endif
+} RFM26_CRC;
+
+//PN9 data whitening, x^9 + x^5 + 1
+typedef struct
+{
+  uint16_t seed;
+#if RFM26_CRC_SLICES
+  uint8_t  key[511 + 7];                                  // one period of whitening bytes, wrapped for 8 byte reads
+#endif
+} RFM26_PN9;
+
+/**********************************************************
+**Name:     RFM26_Crc_Init
+**Function: Set up the CRC the packet handler is configured
+            for, tables included
+**Input:    c, CRC
+            crc_config, PKT_CRC_CONFIG
+            pkt_config1, PKT_CONFIG1
+**Output:   CRC bytes per packet, 0 if none or out of range
+**********************************************************/
+uint8_t RFM26_Crc_Init(RFM26_CRC* c, uint8_t crc_config, uint8_t pkt_config1);
+
+/**********************************************************
+**Name:     RFM26_Crc_Calc
+**Function: CRC of a buffer
+**Input:    c, CRC
+            p, data
+            n, length
+**Output:   CRC, right aligned, inverted if configured
+**********************************************************/
+uint32_t RFM26_Crc_Calc(const RFM26_CRC* c, const uint8_t* p, uint16_t n);
+
+/**********************************************************
+**Name:     RFM26_Crc_Put
+**Function: Append the CRC bytes in on air order
+**Input:    c, CRC
+            crc, from RFM26_Crc_Calc
+            out, c->width / 8 bytes
+**Output:   None
+**********************************************************/
+void RFM26_Crc_Put(const RFM26_CRC* c, uint32_t crc, uint8_t* out);
+
+/**********************************************************
+**Name:     RFM26_Crc_Check
+**Function: Check data followed by its CRC bytes
+**Input:    c, CRC
+            p, data then CRC
+            n, data length, CRC excluded
+**Output:   1 if the CRC matches or there is none
+**********************************************************/
+uint8_t RFM26_Crc_Check(const RFM26_CRC* c, const uint8_t* p, uint16_t n);
+
+/**********************************************************
+**Name:     RFM26_Pn9_Init
+**Function: Whitening sequence from a seed
+**Input:    w, whitening
+            seed, PKT_WHT_SEED, 9 bits
+**Output:   None
+**********************************************************/
+void RFM26_Pn9_Init(RFM26_PN9* w, uint16_t seed);
+
+/**********************************************************
+**Name:     RFM26_Pn9_Apply
+**Function: Whiten or dewhiten in place, the sequence starts
+            from the seed at p[0]
+**Input:    w, whitening
+            p, data
+            n, length
+**Output:   None
+**********************************************************/
+void RFM26_Pn9_Apply(const RFM26_PN9* w, uint8_t* p, uint16_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
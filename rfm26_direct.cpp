@@ -0,0 +1,371 @@
+#include <string.h>
+#include "rfm26_direct.h"
+#ifdef ARDUINO
+#include "rfm26_driver.h"
+#endif
+
+/************************Description************************
+  Direct mode receiver for legacy frames the packet handler
+  cannot parse.
+
+  Capture: the modem puts demodulated bits on GPIO1 (RFData,
+  D6) and the recovered bit clock on GPIO3 (nIRQ1, D7). The
+  clock edge interrupt shifts one bit in; every 8 bits go to a
+  ring of RFM26_DIRECT_RING bytes. The ISR does nothing else,
+  decoding runs from loop() on whole bytes, so the ring only
+  has to cover the longest gap between RFM26_Direct_Poll calls
+  (64 bytes: 213ms at 2.4Kbps).
+
+  Decode, all per byte, no per bit loops:
+    sync     the last 32 raw bits are compared with the sync
+             word at each of the 8 bit offsets the byte adds,
+             wrong bits counted with a popcount table; the
+             first offset within max_err wins and fixes the
+             byte alignment of the frame
+    bytes    raw bits after the sync are realigned by a shift;
+             Manchester pairs decode through a 256 entry table
+             to a nibble, an invalid pair ends the frame
+    length   fixed, or the first decoded byte
+    check    any packet handler CRC (rfm26_crc.cpp), sent MSB
+             first after the data
+**********************************************************/
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define DIRECT_ROM		PROGMEM
+#define DIRECT_RD(p)	pgm_read_byte(p)
+#else
+#define DIRECT_ROM
+#define DIRECT_RD(p)	(*(p))
+#endif
+
+#define C_DIRECT_BAD	0xFF							// abDirect_Manch: not a Manchester byte
+
+const RFM26_DIRECT_PROTO RFM26DirectProtoDefault = {
+  0x2DD4, 16, 1, 1, 0, C_DIRECT_LENBYTE, 0, C_DIRECT_CRC16,
+};
+
+//bits set in x
+static const uint8_t abDirect_Ones[256] DIRECT_ROM = {
+  0x00, 0x01, 0x01, 0x02, 0x01, 0x02, 0x02, 0x03, 0x01, 0x02, 0x02, 0x03, 0x02, 0x03, 0x03, 0x04,
+  0x01, 0x02, 0x02, 0x03, 0x02, 0x03, 0x03, 0x04, 0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05,
+  0x01, 0x02, 0x02, 0x03, 0x02, 0x03, 0x03, 0x04, 0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05,
+  0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05, 0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06,
+  0x01, 0x02, 0x02, 0x03, 0x02, 0x03, 0x03, 0x04, 0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05,
+  0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05, 0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06,
+  0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05, 0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06,
+  0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06, 0x04, 0x05, 0x05, 0x06, 0x05, 0x06, 0x06, 0x07,
+  0x01, 0x02, 0x02, 0x03, 0x02, 0x03, 0x03, 0x04, 0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05,
+  0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05, 0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06,
+  0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05, 0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06,
+  0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06, 0x04, 0x05, 0x05, 0x06, 0x05, 0x06, 0x06, 0x07,
+  0x02, 0x03, 0x03, 0x04, 0x03, 0x04, 0x04, 0x05, 0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06,
+  0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06, 0x04, 0x05, 0x05, 0x06, 0x05, 0x06, 0x06, 0x07,
+  0x03, 0x04, 0x04, 0x05, 0x04, 0x05, 0x05, 0x06, 0x04, 0x05, 0x05, 0x06, 0x05, 0x06, 0x06, 0x07,
+  0x04, 0x05, 0x05, 0x06, 0x05, 0x06, 0x06, 0x07, 0x05, 0x06, 0x06, 0x07, 0x06, 0x07, 0x07, 0x08,
+};
+
+//4 chip pairs to a nibble, 10 is 1 and 01 is 0, first pair in the MSB
+static const uint8_t abDirect_Manch[256] DIRECT_ROM = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x01, 0xFF, 0xFF, 0x02, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x04, 0x05, 0xFF, 0xFF, 0x06, 0x07, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x08, 0x09, 0xFF, 0xFF, 0x0A, 0x0B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x0C, 0x0D, 0xFF, 0xFF, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static uint8_t bDirect_Ones32(uint32_t x)
+{
+  return DIRECT_RD(&abDirect_Ones[(uint8_t)x]) + DIRECT_RD(&abDirect_Ones[(uint8_t)(x >> 8)]) +
+         DIRECT_RD(&abDirect_Ones[(uint8_t)(x >> 16)]) + DIRECT_RD(&abDirect_Ones[(uint8_t)(x >> 24)]);
+}
+
+static void vDirect_Hunt(RFM26_DIRECT* d)
+{
+  d->hist = ~d->p->sync;                                  // As far from the sync word as it gets
+  d->hunting = 1;
+}
+
+// First offset in the new byte where the sync word ends within max_err, 0 for none
+static uint8_t bDirect_Sync(RFM26_DIRECT* d, uint32_t prev)
+{
+  const RFM26_DIRECT_PROTO* p = d->p;
+  uint32_t mask = p->sync_bits >= 32 ? 0xFFFFFFFFUL : (1UL << p->sync_bits) - 1;
+  uint8_t j, err;
+
+  for (j = 1; j <= 8; j++) {
+    err = bDirect_Ones32((((prev << j) | ((d->hist >> (8 - j)) & ((1U << j) - 1))) ^ p->sync) & mask);
+    if (err <= p->max_err) {
+      d->sync_err = err;
+      return j;
+    }
+  }
+  return 0;
+}
+
+// A frame byte complete in data[len - 1], returns the frame length at its end
+static uint8_t bDirect_Byte(RFM26_DIRECT* d)
+{
+  uint8_t crc_len = d->crc_len;
+  uint8_t n;
+
+  if (d->need == 0) {                                     // Length byte
+    if (d->data[0] == 0 || 1 + d->data[0] + crc_len > RFM26_DIRECT_MAX_LEN) {
+      d->stats.code_err++;
+      vDirect_Hunt(d);
+      return 0;
+    }
+    d->need = 1 + d->data[0] + crc_len;
+  }
+  if (d->len < d->need)
+    return 0;
+
+  vDirect_Hunt(d);
+  n = d->len - crc_len;
+  if (!RFM26_Crc_Check(&d->crc, d->data, n)) {
+    d->stats.crc_fail++;
+    return 0;
+  }
+  d->stats.frames++;
+  return n;
+}
+
+/**********************************************************
+**Name:     RFM26_Direct_Init
+**Function: Reset the decoder to sync hunting
+**Input:    d, decoder
+            p, frame format, 0 for RFM26DirectProtoDefault
+**Output:   None
+**********************************************************/
+void RFM26_Direct_Init(RFM26_DIRECT* d, const RFM26_DIRECT_PROTO* p)
+{
+  memset(d, 0, sizeof(*d));
+  d->p = p ? p : &RFM26DirectProtoDefault;
+  d->crc_len = RFM26_Crc_Init(&d->crc, d->p->crc, C_PKT_CRC_ENDIAN);
+  vDirect_Hunt(d);
+}
+
+/**********************************************************
+**Name:     RFM26_Direct_Feed
+**Function: Decode the next 8 raw bits, first bit on air in
+            the MSB
+**Input:    d, decoder
+            raw, captured byte
+**Output:   frame length, CRC excluded, when a frame passed its
+            check in this byte; bytes in d->data until the next
+            call. 0 otherwise
+**********************************************************/
+uint8_t RFM26_Direct_Feed(RFM26_DIRECT* d, uint8_t raw)
+{
+  const RFM26_DIRECT_PROTO* p = d->p;
+  uint32_t prev;
+  uint8_t b, j, nib;
+
+  if (p->invert)
+    raw = ~raw;
+  d->stats.bytes++;
+  prev = d->hist;
+  d->hist = (d->hist << 8) | raw;
+
+  if (d->hunting) {
+    j = bDirect_Sync(d, prev);
+    if (j == 0)
+      return 0;
+    d->stats.syncs++;
+    d->hunting = 0;
+    d->half = 0;
+    d->len = 0;
+    d->need = p->len_mode == C_DIRECT_FIXED ? p->fixed_len + d->crc_len : 0;
+    d->acc = raw & ((1U << (8 - j)) - 1);                 // Frame starts right after the sync word
+    d->pend = 8 - j;
+    return 0;
+  }
+
+  d->acc = (d->acc << 8) | raw;
+  b = (uint8_t)(d->acc >> d->pend);                       // 8 frame bits, the rest stays in acc
+  d->acc &= (1U << d->pend) - 1;
+  if (!p->manchester) {
+    d->data[d->len++] = b;
+    return bDirect_Byte(d);
+  }
+  nib = DIRECT_RD(&abDirect_Manch[b]);
+  if (nib == C_DIRECT_BAD) {
+    d->stats.code_err++;
+    vDirect_Hunt(d);
+    return 0;
+  }
+  if (!d->half) {
+    d->data[d->len] = nib << 4;
+    d->half = 1;
+    return 0;
+  }
+  d->data[d->len++] |= nib;
+  d->half = 0;
+  return bDirect_Byte(d);
+}
+
+#ifdef ARDUINO
+static volatile uint8_t gb_DirectRing[RFM26_DIRECT_RING];
+static volatile uint8_t gb_DirectHead = 0;                // written by the ISR
+static volatile uint8_t gb_DirectTail = 0;                // written by RFM26_Direct_Poll
+static volatile uint16_t gw_DirectOverrun = 0;
+static uint8_t gb_DirectShift = 0;                        // ISR only, bits of the byte being captured
+static uint8_t gb_DirectBits = 0;
+
+static void vDirect_Bit(uint8_t bit)
+{
+  gb_DirectShift = (gb_DirectShift << 1) | bit;
+  if (++gb_DirectBits < 8)
+    return;
+  gb_DirectBits = 0;
+  if ((uint8_t)(gb_DirectHead - gb_DirectTail) >= RFM26_DIRECT_RING) {
+    gw_DirectOverrun++;
+    return;
+  }
+  gb_DirectRing[gb_DirectHead & (RFM26_DIRECT_RING - 1)] = gb_DirectShift;
+  gb_DirectHead++;
+}
+
+#if RFM26_DIRECT_ISR && (defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__))
+// nIRQ1 (D7) is PD7, RFData (D6) is PD6: one port read gives clock and data
+ISR(PCINT2_vect)
+{
+  uint8_t pin = PIND;
+
+  if (pin & _BV(PIND7))
+    vDirect_Bit((pin >> PIND6) & 1);
+}
+#else
+static void vDirect_Clock(void)
+{
+  vDirect_Bit(digitalRead(RFData));
+}
+#endif
+
+static void vDirect_SetModType(uint8_t mod)
+{
+  uint8_t cmd[5];
+
+  cmd[0] = 0x11;                                          // CMD_SET_PROPERTY
+  cmd[1] = 0x20;                                          // PROP_MODEM_GROUP
+  cmd[2] = 1;
+  cmd[3] = 0x00;                                          // MODEM_MOD_TYPE
+  cmd[4] = mod;
+  bApi_SendCommand(5, cmd);
+  bApi_WaitforCTS();
+}
+
+static void vDirect_SetGpio(uint8_t gpio1, uint8_t gpio3)
+{
+  uint8_t cmd[8];
+
+  cmd[0] = 0x13;                                          // CMD_GPIO_PIN_CFG
+  cmd[1] = 0x00;                                          // GPIO0 unchanged
+  cmd[2] = gpio1;
+  cmd[3] = 0x00;                                          // GPIO2 unchanged
+  cmd[4] = gpio3;
+  cmd[5] = 0x00;                                          // NIRQ unchanged
+  cmd[6] = 0x00;                                          // SDO unchanged
+  cmd[7] = 0x00;                                          // GEN_CONFIG
+  bApi_SendCommand(8, cmd);
+  bApi_WaitforCTS();
+}
+
+/**********************************************************
+**Name:     RFM26_Direct_Start
+**Function: Put the radio in direct synchronous Rx and capture
+            a bit on every Rx data clock rising edge
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_Direct_Start(void)
+{
+  RFM26_SetINT_CTL(0x00, 0x00, 0x00, 0x00);               // Nothing on nIRQ0 while the packet handler is idle
+  vDirect_SetModType(0x0A);                               // MOD_SOURCE direct, 2FSK
+  vDirect_SetGpio(0x14, 0x11);                            // GPIO1 RX_DATA, GPIO3 RX_DATA_CLK
+  RFM26_ClrAllInterrupt();
+  RFM26_Start_Rx(0, 0, 0, 0, C_STATE_RX, C_STATE_RX);     // Stay in Rx, the packet handler result is ignored
+
+  pinMode(RFData, INPUT);
+  pinMode(nIRQ1, INPUT);
+  gb_DirectBits = 0;
+  gb_DirectTail = gb_DirectHead;
+  gw_DirectOverrun = 0;
+#if RFM26_DIRECT_ISR && (defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__))
+  PCMSK2 |= _BV(PCINT23);                                 // PD7 only, D0/D1 are the serial port
+  PCIFR = _BV(PCIF2);
+  PCICR |= _BV(PCIE2);
+#else
+  attachInterrupt(digitalPinToInterrupt(nIRQ1), vDirect_Clock, RISING);
+#endif
+}
+
+/**********************************************************
+**Name:     RFM26_Direct_Stop
+**Function: Stop capture, back to the packet handler in Rx
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_Direct_Stop(void)
+{
+#if RFM26_DIRECT_ISR && (defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__))
+  PCMSK2 &= ~_BV(PCINT23);
+  if (PCMSK2 == 0)
+    PCICR &= ~_BV(PCIE2);
+#else
+  detachInterrupt(digitalPinToInterrupt(nIRQ1));
+#endif
+  vDirect_SetModType(0x02);                               // RF_MODEM_MOD_TYPE_12: packet handler, 2FSK
+  vDirect_SetGpio(20, 17);                                // as RFM26_LoadConfig: GPIO1 Rx data, GPIO3 Rx data clock
+  RFM26_ChangeToRxMode(RFM26_PKT_LEN);
+}
+
+/**********************************************************
+**Name:     RFM26_Direct_Poll
+**Function: Decode the captured bytes, up to the end of the
+            next frame
+**Input:    d, decoder
+**Output:   frame length, CRC excluded, bytes in d->data; 0
+            for none
+**********************************************************/
+uint8_t RFM26_Direct_Poll(RFM26_DIRECT* d)
+{
+  uint8_t n;
+
+  while (gb_DirectTail != gb_DirectHead) {
+    n = RFM26_Direct_Feed(d, gb_DirectRing[gb_DirectTail & (RFM26_DIRECT_RING - 1)]);
+    gb_DirectTail++;
+    if (n)
+      return n;
+  }
+  return 0;
+}
+
+/**********************************************************
+**Name:     RFM26_Direct_Overruns
+**Function: Captured bytes lost because the decoder fell
+            behind
+**Input:    None
+**Output:   count since RFM26_Direct_Start
+**********************************************************/
+uint16_t RFM26_Direct_Overruns(void)
+{
+  uint16_t n;
+
+  noInterrupts();
+  n = gw_DirectOverrun;
+  interrupts();
+  return n;
+}
+#endif
@@ -0,0 +1,135 @@
+#ifndef HopeDuino_26_DIRECT_H_
+#define HopeDuino_26_DIRECT_H_
+
+#include <stdint.h>
+#include "rfm26_crc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define direct mode capture: Rx data on GPIO1 (RFData, D6), Rx data clock on GPIO3 (nIRQ1, D7)
+#define RFM26_DIRECT_RING		64							// captured bytes waiting for the decoder, power of 2
+#define RFM26_DIRECT_MAX_LEN	64							// decoded frame bytes, length and CRC included
+
+//Define clock interrupt on ATmega328P/168, where D7 is no external interrupt: 1 has rfm26_direct.cpp
+//define PCINT2_vect, 0 leaves the vector to the sketch (SoftwareSerial defines every PCINT vector)
+//and RFM26_Direct_Start uses attachInterrupt, which captures nothing on these parts
+#ifndef RFM26_DIRECT_ISR
+#define RFM26_DIRECT_ISR		0
+#endif
+
+//Define frame length mode
+#define C_DIRECT_FIXED		0							// fixed_len bytes after sync
+#define C_DIRECT_LENBYTE	1							// first byte is the count of bytes that follow, CRC excluded
+
+//Define frame check, a PKT_CRC_CONFIG value; the CRC covers all bytes before it and is sent MSB first
+#define C_DIRECT_CRC_NONE	C_CRC_NONE
+#define C_DIRECT_CRC16		(C_CRC_SEED_ONES|C_CRC_CCITT_16)	// CRC-16/CCITT-FALSE
+
+//Legacy frame format, decoded in software
+typedef struct
+{
+  uint32_t sync;                                          // raw chips after invert, right aligned, first on air in the MSB
+  uint8_t  sync_bits;                                     // 8..32
+  uint8_t  max_err;                                       // sync bits that may be wrong
+  uint8_t  manchester;                                    // 1: data bit 1 is chips 10, 0 is 01
+  uint8_t  invert;                                        // 1: data bits are inverted on air
+  uint8_t  len_mode;                                      // C_DIRECT_xxx
+  uint8_t  fixed_len;                                     // C_DIRECT_FIXED, 1.., without CRC
+  uint8_t  crc;                                           // C_DIRECT_CRC_xxx or any PKT_CRC_CONFIG
+} RFM26_DIRECT_PROTO;
+
+typedef struct
+{
+  uint32_t bytes;                                         // raw bytes decoded
+  uint32_t syncs;                                         // sync words found
+  uint32_t frames;                                        // frames that passed the check
+  uint32_t crc_fail;
+  uint32_t code_err;                                      // invalid Manchester pair or length, frame dropped
+} RFM26_DIRECT_STATS;
+
+typedef struct
+{
+  const RFM26_DIRECT_PROTO* p;
+  uint32_t hist;                                          // last raw bits
+  uint16_t acc;                                           // raw bits of the frame not yet in a byte
+  uint8_t  pend;                                          // bits in acc
+  uint8_t  hunting;                                       // 1: looking for sync
+  uint8_t  half;                                          // Manchester: high nibble done, in data[len]
+  uint8_t  need;                                          // frame bytes expected, 0 until known
+  uint8_t  len;                                           // frame bytes decoded
+  uint8_t  sync_err;                                      // sync bits wrong in this frame
+  uint8_t  crc_len;
+  uint8_t  data[RFM26_DIRECT_MAX_LEN];
+  RFM26_CRC crc;
+  RFM26_DIRECT_STATS stats;
+} RFM26_DIRECT;
+
+//Default legacy format: 0x2DD4 sync, Manchester, length byte, CRC-16
+extern const RFM26_DIRECT_PROTO RFM26DirectProtoDefault;
+
+/**********************************************************
+**Name:     RFM26_Direct_Init
+**Function: Reset the decoder to sync hunting
+**Input:    d, decoder
+            p, frame format, 0 for RFM26DirectProtoDefault
+**Output:   None
+**********************************************************/
+void RFM26_Direct_Init(RFM26_DIRECT* d, const RFM26_DIRECT_PROTO* p);
+
+/**********************************************************
+**Name:     RFM26_Direct_Feed
+**Function: Decode the next 8 raw bits, first bit on air in
+            the MSB
+**Input:    d, decoder
+            raw, captured byte
+**Output:   frame length, CRC excluded, when a frame passed its
+            check in this byte; bytes in d->data until the next
+            call. 0 otherwise
+**********************************************************/
+uint8_t RFM26_Direct_Feed(RFM26_DIRECT* d, uint8_t raw);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Direct_Start
+**Function: Put the radio in direct synchronous Rx and capture
+            a bit on every Rx data clock rising edge
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_Direct_Start(void);
+
+/**********************************************************
+**Name:     RFM26_Direct_Stop
+**Function: Stop capture, back to the packet handler in Rx
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_Direct_Stop(void);
+
+/**********************************************************
+**Name:     RFM26_Direct_Poll
+**Function: Decode the captured bytes, up to the end of the
+            next frame
+**Input:    d, decoder
+**Output:   frame length, CRC excluded, bytes in d->data; 0
+            for none
+**********************************************************/
+uint8_t RFM26_Direct_Poll(RFM26_DIRECT* d);
+
+/**********************************************************
+**Name:     RFM26_Direct_Overruns
+**Function: Captured bytes lost because the decoder fell
+            behind
+**Input:    None
+**Output:   count since RFM26_Direct_Start
+**********************************************************/
+uint16_t RFM26_Direct_Overruns(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,5 @@
+#include <string.h>
 #include "rfm26_driver.h"
-#include "arduino_spi.h"
 
 /************************Description************************
                       ________________
@@ -32,93 +32,10 @@
 //  Rx Current:          about 14mA  (typ.)                 
 **********************************************************/
 
-//WDS3 CONFIGURATION COMMANDS
-#define RF_POWER_UP 0x02, 0x01, 0x01, 0x01, 0xC9, 0xC3, 0x80
-#define RF_GPIO_PIN_CFG 0x13, 0x5C, 0x53, 0x5B, 0x51, 0x00, 0x00
-#define RF_GLOBAL_XO_TUNE_1 0x11, 0x00, 0x01, 0x00, 0x3F
-#define RF_GLOBAL_CONFIG_1 0x11, 0x00, 0x01, 0x03, 0x40
-#define RF_INT_CTL_ENABLE_2 0x11, 0x01, 0x02, 0x00, 0x01, 0x30
-#define RF_FRR_CTL_A_MODE_4 0x11, 0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00
-#define RF_PREAMBLE_TX_LENGTH_9 0x11, 0x10, 0x09, 0x00, 0x08, 0x14, 0x00, 0x0F, 0x31, 0x00, 0x00, 0x00, 0x00
-#define RF_SYNC_CONFIG_5 0x11, 0x11, 0x05, 0x00, 0x01, 0xB4, 0x2B, 0x00, 0x00
-#define RF_PKT_CRC_CONFIG_1 0x11, 0x12, 0x01, 0x00, 0x80
-#define RF_PKT_CONFIG1_1 0x11, 0x12, 0x01, 0x06, 0x02
-#define RF_PKT_LEN_3 0x11, 0x12, 0x03, 0x08, 0x00, 0x00, 0x00
-#define RF_PKT_FIELD_1_LENGTH_12_8_12 0x11, 0x12, 0x0C, 0x0D, 0x00, 0x40, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-#define RF_PKT_FIELD_4_LENGTH_12_8_8 0x11, 0x12, 0x08, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-//#define RF_MODEM_MOD_TYPE_12 0x11, 0x20, 0x0C, 0x00, 0x02, 0x00, 0x07, 0x00, 0x09, 0x60, 0x00, 0x2D, 0xC6, 0xC0, 0x00, 0x09
-#define RF_MODEM_MOD_TYPE_12 0x11, 0x20, 0x0C, 0x00, 0x02, 0x00, 0x07, 0x00, 0x09, 0x60, 0x00, 0x2D, 0xC6, 0xC0, 0x00, 0x04
-//#define RF_MODEM_FREQ_DEV_0_1 0x11, 0x20, 0x01, 0x0C, 0x8F
-#define RF_MODEM_FREQ_DEV_0_1 0x11, 0x20, 0x01, 0x0C, 0xC7
-//#define RF_MODEM_TX_RAMP_DELAY_8 0x11, 0x20, 0x08, 0x18, 0x01, 0x80, 0x08, 0x03, 0x80, 0x00, 0x12, 0x10
-#define RF_MODEM_TX_RAMP_DELAY_8 0x11, 0x20, 0x08, 0x18, 0x01, 0x80, 0x08, 0x03, 0xC0, 0x00, 0x12, 0x10
-#define RF_MODEM_BCR_OSR_1_9 0x11, 0x20, 0x09, 0x22, 0x04, 0x12, 0x00, 0x7D, 0xD4, 0x00, 0x3F, 0x02, 0xC2
-//#define RF_MODEM_AFC_GEAR_7 0x11, 0x20, 0x07, 0x2C, 0x04, 0x36, 0x80, 0x02, 0x75, 0x0B, 0x80
-#define RF_MODEM_AFC_GEAR_7 0x11, 0x20, 0x07, 0x2C, 0x04, 0x36, 0x80, 0x01, 0x75, 0x0B, 0x80
-#define RF_MODEM_AGC_CONTROL_1 0x11, 0x20, 0x01, 0x35, 0xE2
-#define RF_MODEM_AGC_WINDOW_SIZE_9 0x11, 0x20, 0x09, 0x38, 0x11, 0xE4, 0xE4, 0x00, 0x02, 0x74, 0xAA, 0x00, 0x2B
-#define RF_MODEM_OOK_CNT1_11 0x11, 0x20, 0x0B, 0x42, 0xA4, 0x02, 0xD6, 0x81, 0x05, 0xEA, 0x01, 0x80, 0xFF, 0x0C, 0x00
-#define RF_MODEM_RSSI_COMP_1 0x11, 0x20, 0x01, 0x4E, 0x40
-#define RF_MODEM_CLKGEN_BAND_1 0x11, 0x20, 0x01, 0x51, 0x08
-#define RF_MODEM_CHFLT_RX1_CHFLT_COE13_7_0_12 0x11, 0x21, 0x0C, 0x00, 0xFF, 0xBA, 0x0F, 0x51, 0xCF, 0xA9, 0xC9, 0xFC, 0x1B, 0x1E, 0x0F, 0x01
-#define RF_MODEM_CHFLT_RX1_CHFLT_COE1_7_0_12 0x11, 0x21, 0x0C, 0x0C, 0xFC, 0xFD, 0x15, 0xFF, 0x00, 0x0F, 0xFF, 0xBA, 0x0F, 0x51, 0xCF, 0xA9
-#define RF_MODEM_CHFLT_RX2_CHFLT_COE7_7_0_12 0x11, 0x21, 0x0C, 0x18, 0xC9, 0xFC, 0x1B, 0x1E, 0x0F, 0x01, 0xFC, 0xFD, 0x15, 0xFF, 0x00, 0x0F
-#define RF_PA_MODE_4 0x11, 0x22, 0x04, 0x00, 0x08, 0x7F, 0x00, 0x0E
-#define RF_SYNTH_PFDCP_CPFF_7 0x11, 0x23, 0x07, 0x00, 0x2C, 0x0E, 0x0B, 0x04, 0x0C, 0x73, 0x03
-#define RF_MATCH_VALUE_1_12 0x11, 0x30, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-#define RF_FREQ_CONTROL_INTE_8 0x11, 0x40, 0x08, 0x00, 0x3C, 0x08, 0x00, 0x00, 0x00, 0x00, 0x20, 0xFF
-
-#define RADIO_CONFIGURATION_DATA_ARRAY { \
-        0x07, RF_POWER_UP, \
-        0x07, RF_GPIO_PIN_CFG, \
-        0x05, RF_GLOBAL_XO_TUNE_1, \
-        0x05, RF_GLOBAL_CONFIG_1, \
-        0x06, RF_INT_CTL_ENABLE_2, \
-        0x08, RF_FRR_CTL_A_MODE_4, \
-        0x0D, RF_PREAMBLE_TX_LENGTH_9, \
-        0x09, RF_SYNC_CONFIG_5, \
-        0x05, RF_PKT_CRC_CONFIG_1, \
-        0x05, RF_PKT_CONFIG1_1, \
-        0x07, RF_PKT_LEN_3, \
-        0x10, RF_PKT_FIELD_1_LENGTH_12_8_12, \
-        0x0C, RF_PKT_FIELD_4_LENGTH_12_8_8, \
-        0x10, RF_MODEM_MOD_TYPE_12, \
-        0x05, RF_MODEM_FREQ_DEV_0_1, \
-        0x0C, RF_MODEM_TX_RAMP_DELAY_8, \
-        0x0D, RF_MODEM_BCR_OSR_1_9, \
-        0x0B, RF_MODEM_AFC_GEAR_7, \
-        0x05, RF_MODEM_AGC_CONTROL_1, \
-        0x0D, RF_MODEM_AGC_WINDOW_SIZE_9, \
-        0x0F, RF_MODEM_OOK_CNT1_11, \
-        0x05, RF_MODEM_RSSI_COMP_1, \
-        0x05, RF_MODEM_CLKGEN_BAND_1, \
-        0x10, RF_MODEM_CHFLT_RX1_CHFLT_COE13_7_0_12, \
-        0x10, RF_MODEM_CHFLT_RX1_CHFLT_COE1_7_0_12, \
-        0x10, RF_MODEM_CHFLT_RX2_CHFLT_COE7_7_0_12, \
-        0x08, RF_PA_MODE_4, \
-        0x0B, RF_SYNTH_PFDCP_CPFF_7, \
-        0x10, RF_MATCH_VALUE_1_12, \
-        0x0C, RF_FREQ_CONTROL_INTE_8, \
-        0x00 \
-} 
-
-const uint8_t RFM26_CONFIGURATION_DATA[]=RADIO_CONFIGURATION_DATA_ARRAY;
-
-const uint8_t RFM26FreqTbl[4][8] = {
-  {0x03, 0x40, 0x00, 0x0B, 0x3E, 0x08, 0x00, 0x00},  //315MHz
-  {0x03, 0x80, 0x00, 0x0A, 0x38, 0x0E, 0xEE, 0xEE},  //434MHz
-  {0x03, 0xC0, 0x00, 0x08, 0x38, 0x0E, 0xEE, 0xEE},  //868MHz
-  {0x03, 0xC0, 0x00, 0x08, 0x3C, 0x08, 0x00, 0x00},  //915MHz
-};
-
-const uint8_t RFM26PowerTbl[4][2] = {
-  {0x7F,0x00},                            //20dbm 
-  {0x30,0x00},                            //17dbm
-  {0x20,0x00},                            //14dbm
-  {0x16,0x00},                            //11dbm
-};          
+//Configuration streams and the frequency, rate and power rows are in rfm26_config.cpp and
+//rfm26_profiles.cpp, in program memory; the WDS table they come from is rfm26_wds.h
 
-byte gb_RxData[64];           
+uint8_t gb_RxData[RFM26_PKT_LEN];           
 
 /**********************************************************
 **Variable define
@@ -126,6 +43,48 @@ byte gb_RxData[64];
 //uint8_t gb_WaitStableFlag=0;                                    //State stable flag
 uint8_t abApi_Write[16];                                        // Write buffer for API communication
 uint8_t abApi_Read[16];                                         // Read buffer for API communication
+uint8_t gb_IntCtlPH=0x30;                                       // INT_CTL_PH_ENABLE currently set in the chip
+uint8_t gb_FieldLen=0;                                          // PKT_FIELD_1_LENGTH currently set in the chip, 0: from config table
+uint8_t gb_Exchange=0;                                          // 1: request sent, waiting response; 2: response armed
+uint8_t gb_LdcMode=0;                                           // 1: duty-cycled Rx on the wake-up timer
+uint32_t gl_ExchangeStart=0;                                    // START_TX time of the pending exchange, in us
+uint32_t gl_RoundTrip=0;                                        // Round trip time of the last exchange, in us
+volatile uint32_t gl_IrqStamp=0;                                // Time of the last nIRQ falling edge, in us
+volatile uint32_t gl_TxStamp=0;                                 // Time of the last PACKET_SENT edge, in us
+volatile uint8_t gb_IrqCount=0;                                 // Number of captured nIRQ falling edges
+volatile uint8_t gb_TxPending=0;                                // send_message() waiting for PACKET_SENT
+uint8_t gb_IrqSeen=0;                                           // gb_IrqCount already consumed by receive_message()
+RFM26_PKT_INFO gt_RxInfo;                                       // Timestamps of the last received packet
+uint16_t aw_LatHist[2][RFM26_LAT_BINS];                         // Receive latency histograms
+RFM26_ENERGY gt_Energy;                                         // Time and energy per radio state
+RFM26_CAPTURE* gt_Capture=0;                                   // Frame log, 0: off
+uint8_t gb_Rate=C_2_4KHZ_35KHZ;                                 // RFM26RateTbl row currently set in the chip
+RFM26_CAL gt_Cal={C_CAL_VERSION,C_CAL_XO_TUNE,0,C_2_4KHZ_35KHZ,0};// calibration and profile RFM26_Config sends
+uint8_t gb_CalSet=0;                                            // 1: gt_Cal came from RFM26_SetCal, RFM26_WarmBoot may use it
+uint8_t gb_Power=C_17DBM;                                       // RFM26PowerTbl row currently set in the chip
+uint8_t gb_VarLen=0;                                            // 1: length byte framing, RFM26_SetVarLen
+uint8_t gb_RxNeed=0;                                            // payload bytes of a frame whose length byte was read
+uint16_t gw_FieldLenFixed=0x40;                                 // PKT_FIELD_1_LENGTH before RFM26_SetVarLen(1)
+uint8_t gb_FieldLenFixed=0;                                     // gb_FieldLen before RFM26_SetVarLen(1)
+uint8_t gb_BootStep=0;                                          // next RFM26_BootStep
+void (*gt_IrqHook)(void)=0;                                     // called on every nIRQ edge, RFM26_SetIrqHook
+
+#if RFM26_INSTRUMENT
+RFM26_INSTR gt_Instr;                                           // SPI, command and error counters, command trace
+#define INSTR_SPI(n)			(gt_Instr.spi_bytes += (n))
+#define INSTR_XFER()			(gt_Instr.spi_xfers++)
+#define INSTR_CMD(op,arg)		RFM26_Instr_OnCmd(&gt_Instr, op, arg, time_us())
+#define INSTR_CTS(polls,ok)		RFM26_Instr_OnCts(&gt_Instr, polls, ok)
+#define INSTR_INT(resp)			RFM26_Instr_OnInt(&gt_Instr, resp)
+#define INSTR_MISSED(n)			(gt_Instr.rx_missed += (n))
+#else
+#define INSTR_SPI(n)			((void)0)
+#define INSTR_XFER()			((void)0)
+#define INSTR_CMD(op,arg)		((void)0)
+#define INSTR_CTS(polls,ok)		((void)0)
+#define INSTR_INT(resp)			((void)0)
+#define INSTR_MISSED(n)			((void)0)
+#endif
 
 /**********************************************************
 **Name:     bSpi_SendDataNoResp
@@ -136,12 +95,8 @@ uint8_t abApi_Read[16];                                         // Read buffer f
 **********************************************************/
 uint8_t bSpi_SendDataNoResp(uint16_t bDataInLength, uint8_t *pbDataIn)
 {
-  uint16_t bCnt;
-
-  for (bCnt=0; bCnt<bDataInLength; bCnt++)                 // Send input data array via SPI
-  {
-    bSpiTransfer(pbDataIn[bCnt]);
-  }
+  INSTR_SPI(bDataInLength);
+  RFM26_Hal_Write(pbDataIn, bDataInLength);               // Send input data array via SPI
   return 0;
 }
 
@@ -154,13 +109,9 @@ uint8_t bSpi_SendDataNoResp(uint16_t bDataInLength, uint8_t *pbDataIn)
 **********************************************************/
 uint8_t bSpi_SendDataGetResp(uint8_t bDataOutLength, uint8_t *pbDataOut)  
 {
-  uint8_t bCnt;
-
   // send command and get response from the radio IC
-  for (bCnt=0; bCnt<bDataOutLength; bCnt++)
-  {
-    pbDataOut[bCnt] = bSpiTransfer(0x00);                       // Store data uint8_t that came from the radio IC
-  }
+  INSTR_SPI(bDataOutLength);
+  RFM26_Hal_Read(pbDataOut, bDataOutLength);              // Store data bytes that came from the radio IC
   return 0;
 }
 
@@ -173,9 +124,12 @@ uint8_t bSpi_SendDataGetResp(uint8_t bDataOutLength, uint8_t *pbDataOut)
 **********************************************************/
 uint8_t bApi_SendCommand(uint8_t bCmdLength, uint8_t *pbCmdData)   
 {
-  nCS_LOW();					
+  RFM26_Energy_OnCommand(&gt_Energy, bCmdLength, pbCmdData, time_us());
+  INSTR_CMD(pbCmdData[0], bCmdLength>1 ? pbCmdData[1] : 0);
+  INSTR_XFER();
+  RFM26_Hal_Select();					
   bSpi_SendDataNoResp(bCmdLength, pbCmdData);             // Send data array to the radio IC via SPI
-	nCS_HIGH();
+	RFM26_Hal_Release();
   return 0;
 }
 
@@ -187,6 +141,7 @@ uint8_t bApi_SendCommand(uint8_t bCmdLength, uint8_t *pbCmdData)
             1 , CTS didn't arrive within MAX_CTS_RETRY
 **********************************************************/
 #define MAX_CTS_RETRY   5000
+#define RFM26_BOOT_US   20000                             // POWER_UP to CHIP_READY, 15ms on the datasheet
 uint8_t bApi_WaitforCTS(void)
 {
   uint8_t bCtsValue;
@@ -197,15 +152,19 @@ uint8_t bApi_WaitforCTS(void)
 
   while (bCtsValue!=0xFF)                                // Wait until radio IC is ready with the data
   {
-	nCS_LOW();
-	bSpiTransfer(0x44);                               // CMD_READ_CMD_BUFF,Read command buffer; send command uint8_t
+	INSTR_XFER();
+	RFM26_Hal_Select();
+	RFM26_Hal_Xfer(0x44);                             // CMD_READ_CMD_BUFF,Read command buffer; send command uint8_t
+	INSTR_SPI(1);
     bSpi_SendDataGetResp(1, &bCtsValue);                 // Read command buffer; get CTS value
- 	nCS_HIGH();
+ 	RFM26_Hal_Release();
 	if(++bErrCnt > MAX_CTS_RETRY)
     {
+       INSTR_CTS(bErrCnt-1, 0);
        return 1;                                          // Error handling; if wrong CTS reads exceeds a limit
     }
   }
+  INSTR_CTS(bErrCnt, 1);
   return 0;
 }
 
@@ -219,9 +178,31 @@ uint8_t bApi_WaitforCTS(void)
 **********************************************************/
 uint8_t bApi_GetResponse(uint8_t bRespLength, uint8_t *pbRespData) 
 {
-  bApi_WaitforCTS();
+  uint8_t bCtsValue;
+  uint16_t bErrCnt;
+
+  bCtsValue = 0;
+  bErrCnt = 0;
+
+  while (1)
+  {
+    INSTR_XFER();
+    RFM26_Hal_Select();
+    RFM26_Hal_Xfer(0x44);                                 // CMD_READ_CMD_BUFF,Read command buffer; send command uint8_t
+    INSTR_SPI(1);
+    bSpi_SendDataGetResp(1, &bCtsValue);                  // Read command buffer; get CTS value
+    if(bCtsValue==0xFF)
+      break;                                              // Keep nCS low, the response follows the CTS byte
+    RFM26_Hal_Release();
+    if(++bErrCnt > MAX_CTS_RETRY)
+    {
+      INSTR_CTS(bErrCnt-1, 0);
+      return 1;                                           // Error handling; if wrong CTS reads exceeds a limit
+    }
+  }
+  INSTR_CTS(bErrCnt+1, 1);
   bSpi_SendDataGetResp(bRespLength, pbRespData);          // CTS value ok, get the response data from the radio IC
-  nCS_HIGH();
+  RFM26_Hal_Release();
   return 0;
 }
 
@@ -234,10 +215,13 @@ uint8_t bApi_GetResponse(uint8_t bRespLength, uint8_t *pbRespData)
 **********************************************************/
 uint8_t bApi_ReadRxDataBuffer(uint8_t bRxFifoLength, uint8_t *pbRxFifoData)
 {
-  nCS_LOW();
-  bSpiTransfer(0x77);                                  // CMD_READ_RX_FIFO,Send Rx read command
+  INSTR_CMD(0x77, bRxFifoLength);
+  INSTR_XFER();
+  INSTR_SPI(1);
+  RFM26_Hal_Select();
+  RFM26_Hal_Xfer(0x77);                                // CMD_READ_RX_FIFO,Send Rx read command
   bSpi_SendDataGetResp(bRxFifoLength, pbRxFifoData);      // Write Tx FIFO
-  nCS_HIGH();
+  RFM26_Hal_Release();
   return 0;
 }
 
@@ -251,10 +235,13 @@ uint8_t bApi_ReadRxDataBuffer(uint8_t bRxFifoLength, uint8_t *pbRxFifoData)
 **********************************************************/
 uint8_t bApi_WriteTxDataBuffer(uint8_t bTxFifoLength, uint8_t *pbTxFifoData) 
 {
- nCS_LOW();
-  bSpiTransfer(0x66);                                  // CMD_WRITE_TX_FIFO,Send Tx write command
+  INSTR_CMD(0x66, bTxFifoLength);
+  INSTR_XFER();
+  INSTR_SPI(1);
+ RFM26_Hal_Select();
+  RFM26_Hal_Xfer(0x66);                                // CMD_WRITE_TX_FIFO,Send Tx write command
   bSpi_SendDataNoResp(bTxFifoLength, pbTxFifoData);       // Write Tx FIFO
- nCS_HIGH();
+ RFM26_Hal_Release();
   return 0;
 }
 
@@ -271,7 +258,8 @@ void RFM26_ClrAllInterrupt(void)
   abApi_Write[2] = 0;                                     // Clear MODEM_CLR_PEND
   abApi_Write[3] = 0;                                     // Clear CHIP_CLR_PEND
   bApi_SendCommand(4,abApi_Write);                        // Send command to the radio IC
-  bApi_GetResponse(8, abApi_Read );                       // Make sure that CTS is ready then get the response
+  if (bApi_GetResponse(8, abApi_Read )==0)                // Make sure that CTS is ready then get the response
+    INSTR_INT(abApi_Read);
 }
 
 /**********************************************************
@@ -301,6 +289,54 @@ void RFM26_WakeUp(void)
   bApi_WaitforCTS();
 }
 
+/**********************************************************
+**Name:     RFM26_InitIo
+**Function: MCU pins, nIRQ capture and SPI
+**********************************************************/
+static void RFM26_InitIo(void)
+{
+  //Input_DIO0();                                            
+  //Input_DIO1();
+  //Input_RFData();
+  RFM26_Hal_Init();
+  RFM26_EnableTimestamp();
+}
+
+/**********************************************************
+**Name:     RFM26_BootStep
+**Function: Reset sequence a step at a time, for a scheduler:
+            RESET pulse, power on reset, POWER_UP, boot; call
+            again after the time returned, from the POWER_UP
+            step on as soon as nIRQ falls (CHIP_READY)
+**Input:    None
+**Output:   us to wait, 0 when the radio is up; the next
+            call starts a new sequence
+**********************************************************/
+uint16_t RFM26_BootStep(void)
+{
+  switch (gb_BootStep++) {
+    case 0:
+      RFM26_InitIo();
+      RESET_HIGH();
+      return 300;                                         //about 300us
+    case 1:
+      RESET_LOW();
+      return 5000;                                        //power on reset
+    case 2:
+      // Start the radio
+      abApi_Write[0] = 0x02;                              // CMD_POWER_UP,Use API command to power up the radio IC
+      abApi_Write[1] = 0x01;                              // Write global control registers
+      abApi_Write[2] = 0x00;                              // Write global control registers
+      bApi_SendCommand(3,abApi_Write);                    // Send command to the radio IC
+      return RFM26_BOOT_US;                               // Boot: CHIP_READY pulls nIRQ low, no CTS polling meanwhile
+    default:
+      gb_BootStep = 0;
+      bApi_WaitforCTS();                                  // Wait for CTS
+      RFM26_ClrAllInterrupt();
+      return 0;
+  }
+}
+
 /**********************************************************
 **Name:     RFM26_StartRadio
 **Function: start radio
@@ -309,36 +345,34 @@ void RFM26_WakeUp(void)
 **********************************************************/
 void RFM26_StartRadio(void)
 { 
-  RESET_HIGH();                           
-  delay_us(300);											//about 300us
-  RESET_LOW();
-  delay_ms(5);
-  
-  // Start the radio
-  abApi_Write[0] = 0x02;                                  // CMD_POWER_UP,Use API command to power up the radio IC
-  abApi_Write[1] = 0x01;                                  // Write global control registers
-  abApi_Write[2] = 0x00;                                  // Write global control registers
-  bApi_SendCommand(3,abApi_Write);                        // Send command to the radio IC
-  // Wait for boot
-  bApi_WaitforCTS();                                       // Wait for CTS
-  
-  RFM26_ClrAllInterrupt();
+  uint16_t us;
+
+  gb_BootStep = 0;
+  while ((us = RFM26_BootStep()) != 0) {
+    if (gb_BootStep == 3)
+      RFM26_Hal_WaitIrq(us);                              // Ends at CHIP_READY
+    else
+      delay_us(us);
+  }
 }
 
 /**********************************************************
 **Name:     ParameterConfig
-**Function: Parameter config
-**Input:    * configurationTable,Parameter table
+**Function: Parameter config, decodes an encoded stream a
+            command at a time into the API buffer
+**Input:    * stream, rfm26_config.h stream in program memory
 **Output:   None
 **********************************************************/
-void ParameterConfig(uint8_t *configurationTable)
+void ParameterConfig(const uint8_t *stream)
 {
-  uint16_t Count=0;
-  while(configurationTable[Count]!=0)
+  RFM26_CFG_RD rd;
+  uint8_t n;
+
+  RFM26_Cfg_Begin(&rd, stream);
+  while((n=RFM26_Cfg_Next(&rd,abApi_Write))!=0)
   {
-    bApi_SendCommand(configurationTable[Count],&configurationTable[Count+1]);
+    bApi_SendCommand(n,abApi_Write);
     bApi_WaitforCTS();
-    Count+=(configurationTable[Count]+1);
   }
 }
 
@@ -388,6 +422,13 @@ void RFM26_SetParameter_Freq(uint8_t *FreqConfig)
 **********************************************************/
 void RFM26_SetParameter_Power(uint8_t *PA)
 {
+  uint8_t i;
+
+  for (i = 0; i < 4; i++)                                 // Tx current row for energy accounting
+    if (CFG_RD(&RFM26PowerTbl[i][0]) == PA[0]) {
+      RFM26_Energy_SetLevel(&gt_Energy, i);
+      gb_Power = i;
+    }
   abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY
   abApi_Write[1] = 0x22;                                  // PROP_PA_GROUP
   abApi_Write[2] = 2;
@@ -397,6 +438,73 @@ void RFM26_SetParameter_Power(uint8_t *PA)
   bApi_SendCommand(6,abApi_Write);
   bApi_WaitforCTS();
 } 
+
+/**********************************************************
+**Name:     RFM26_SetParameter_Rate
+**Function: Set data rate and clock recovery
+**Input:    *RateConfig,Rate table
+**Output:   None
+**********************************************************/
+void RFM26_SetParameter_Rate(uint8_t *RateConfig)
+{
+  uint8_t i;
+
+  for (i = 0; i < 4; i++)
+    if (CFG_RD(&RFM26RateTbl[i][2]) == RateConfig[2])
+      gb_Rate = i;
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY
+  abApi_Write[1] = 0x20;                                  // PROP_MODEM_GROUP
+  abApi_Write[2] = 3;
+  abApi_Write[3] = 0x03;                                  // MODEM_DATA_RATE
+  abApi_Write[4] = RateConfig[0];
+  abApi_Write[5] = RateConfig[1];
+  abApi_Write[6] = RateConfig[2];
+  bApi_SendCommand(7,abApi_Write);
+  bApi_WaitforCTS();
+
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY
+  abApi_Write[1] = 0x20;                                  // PROP_MODEM_GROUP
+  abApi_Write[2] = 7;
+  abApi_Write[3] = 0x22;                                  // MODEM_BCR_OSR, BCR_NCO_OFFSET, BCR_GAIN
+  for (i = 0; i < 7; i++)
+    abApi_Write[4+i] = RateConfig[3+i];
+  bApi_SendCommand(11,abApi_Write);
+  bApi_WaitforCTS();
+}
+
+/**********************************************************
+**Name:     RFM26_SetLink
+**Function: Set rate and power of a link, only what differs
+            from the chip is written; waits for a running Tx
+            (hardware response) to finish first
+**Input:    rate, C_1_2KHZ_35KHZ..C_9_6KHZ_35KHZ
+            power, C_20DBM..C_11DBM
+**Output:   number of SET_PROPERTY commands sent,
+            RFM26_LINK_BUSY if the Tx did not end (see
+            RFM26_WaitTxDone), nothing written
+**********************************************************/
+uint8_t RFM26_SetLink(uint8_t rate, uint8_t power)
+{
+  uint8_t row[10];
+  uint8_t n = 0;
+
+  if (rate == gb_Rate && power == gb_Power)
+    return 0;
+  if (!RFM26_WaitTxDone())                                // Don't retune under a response on air
+    return RFM26_LINK_BUSY;
+  if (rate != gb_Rate && rate < 4) {
+    RFM26_Cfg_Copy(row, RFM26RateTbl[rate], 10);
+    RFM26_SetParameter_Rate(row);
+    n += 2;
+  }
+  if (power != gb_Power && power < 4) {
+    RFM26_Cfg_Copy(row, RFM26PowerTbl[power], 2);
+    RFM26_SetParameter_Power(row);
+    n++;
+  }
+  return n;
+}
+
 /**********************************************************
 **Name:     RFM26_Start_Tx
 **Function: Start Tx
@@ -462,6 +570,27 @@ void RFM26_SetINT_CTL(uint8_t status, uint8_t ctl_PH, uint8_t ctl_modem, uint8_t
   abApi_Write[7] = ctl_chip;                              // INT_CTL_CHIP_EN
   bApi_SendCommand(8,abApi_Write);                        // Send API command       
   bApi_WaitforCTS();                                      // Wait for CTS
+  gb_IntCtlPH = ctl_PH;
+}
+
+/**********************************************************
+**Name:     RFM26_SetFieldLength
+**Function: Set packet handler field 1 length, used when the
+            radio enters Rx or Tx by itself (next state)
+**Input:    length,data length
+**Output:   None
+**********************************************************/
+void RFM26_SetFieldLength(uint8_t length)
+{
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x12;                                  // PROP_PKT_GROUP,Select property group
+  abApi_Write[2] = 2;                                     // Number of properties to be written
+  abApi_Write[3] = 0x0D;                                  // PROP_PKT_FIELD_1_LENGTH_12_8,Specify property
+  abApi_Write[4] = 0x00;                                  // Upper bits of field 1 length
+  abApi_Write[5] = length;                                // Lower byte of field 1 length
+  bApi_SendCommand(6,abApi_Write);                        // Send API command
+  bApi_WaitforCTS();                                      // Wait for CTS
+  gb_FieldLen = length;
 }
 
 /**********************************************************
@@ -505,6 +634,229 @@ void RFM26_ResetRxFifo(void)
   bApi_WaitforCTS();                                      // Wait for CTS
 }
 
+/**********************************************************
+**Name:     RFM26_GetRxFifoCount
+**Function: Bytes waiting in Rx FIFO
+**Input:    None
+**Output:   RX_FIFO_COUNT
+**********************************************************/
+uint8_t RFM26_GetRxFifoCount(void)
+{
+  abApi_Write[0] = 0x15;                                  // CMD_FIFO_INFO,Use FIFO INFO command
+  abApi_Write[1] = 0x00;                                  // No reset
+  bApi_SendCommand(2,abApi_Write);                        // Send API command to the radio IC
+  bApi_GetResponse(2,abApi_Read);                         // RX_FIFO_COUNT, TX_FIFO_SPACE
+  return abApi_Read[0];
+}
+
+/**********************************************************
+**Name:     RFM26_SetRxThreshold
+**Function: Set the Rx FIFO almost full threshold
+**Input:    bytes, RX_FIFO_ALMOST_FULL fires at this count
+**Output:   None
+**********************************************************/
+void RFM26_SetRxThreshold(uint8_t bytes)
+{
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x12;                                  // PROP_PKT_GROUP,Select property group
+  abApi_Write[2] = 1;                                     // Number of properties to be written
+  abApi_Write[3] = 0x0C;                                  // PROP_PKT_RX_THRESHOLD,Specify property
+  abApi_Write[4] = bytes;
+  bApi_SendCommand(5,abApi_Write);                        // Send API command to the radio IC
+  bApi_WaitforCTS();                                      // Wait for CTS
+}
+
+/**********************************************************
+**Name:     RFM26_GetPHPending
+**Function: Read and clear all pending interrupts
+**Input:    None
+**Output:   PH_PEND, C_PH_xxx bits
+**********************************************************/
+uint8_t RFM26_GetPHPending(void)
+{
+  RFM26_ClrAllInterrupt();
+  return abApi_Read[2];                                   // INT_PEND, INT_STATUS, PH_PEND, ...
+}
+
+/**********************************************************
+**Name:     RFM26_SetProfile
+**Function: Select the profile the next RFM26_Config sends
+**Input:    profile, C_1_2KHZ_35KHZ..C_9_6KHZ_35KHZ
+**Output:   1 if there is such a profile
+**********************************************************/
+uint8_t RFM26_SetProfile(uint8_t profile)
+{
+  if (profile >= RFM26_PROFILES)
+    return 0;
+  gt_Cal.profile = profile;
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_SetCal
+**Function: Take a unit's calibration, used from the next
+            RFM26_Config or RFM26_WarmBoot on
+**Input:    c, record, from RFM26_Cal_Load
+**Output:   1 if the record checks and its profile exists
+**********************************************************/
+uint8_t RFM26_SetCal(const RFM26_CAL* c)
+{
+  if (!RFM26_Cal_Check(c) || c->profile >= RFM26_PROFILES)
+    return 0;
+  gt_Cal = *c;
+  gb_CalSet = 1;
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_GetCal
+**Function: Calibration in use, to change and save
+**Input:    c, record out, sealed
+**Output:   None
+**********************************************************/
+void RFM26_GetCal(RFM26_CAL* c)
+{
+  *c = gt_Cal;
+  RFM26_Cal_Seal(c);
+}
+
+/**********************************************************
+**Name:     RFM26_ApplyCal
+**Function: Write crystal trim and frequency offset to the
+            chip; Rx and Tx started after it use them
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ApplyCal(void)
+{
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x00;                                  // PROP_GLOBAL_GROUP,Select property group
+  abApi_Write[2] = 1;                                     // Number of properties to be written
+  abApi_Write[3] = 0x00;                                  // PROP_GLOBAL_XO_TUNE,Specify property
+  abApi_Write[4] = gt_Cal.xo_tune;                        // Set cap bank value to adjust XTAL clock frequency
+  bApi_SendCommand(5,abApi_Write);                        // Send command to the radio IC
+  bApi_WaitforCTS();                                      // Wait for CTS
+
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x20;                                  // PROP_MODEM_GROUP,Select property group
+  abApi_Write[2] = 2;                                     // Number of properties to be written
+  abApi_Write[3] = 0x0D;                                  // PROP_MODEM_FREQ_OFFSET,Specify property
+  abApi_Write[4] = (uint8_t)((uint16_t)gt_Cal.freq_ofs >> 8);
+  abApi_Write[5] = (uint8_t)gt_Cal.freq_ofs;
+  bApi_SendCommand(6,abApi_Write);                        // Send command to the radio IC
+  bApi_WaitforCTS();                                      // Wait for CTS
+}
+
+/**********************************************************
+**Name:     RFM26_GetAfcOffset
+**Function: Frequency error the AFC corrected on the last
+            packet, read before the radio enters Rx again
+**Input:    None
+**Output:   AFC_FREQ_OFFSET, MODEM_FREQ_OFFSET steps; add to
+            the calibration's freq_ofs to take it out
+**********************************************************/
+int16_t RFM26_GetAfcOffset(void)
+{
+  abApi_Write[0] = 0x22;                                  // CMD_GET_MODEM_STATUS
+  abApi_Write[1] = 0xFF;                                  // Leave pending bits as they are
+  bApi_SendCommand(2,abApi_Write);
+  if (bApi_GetResponse(8,abApi_Read))                     // MODEM_PEND, MODEM_STATUS, 4 x RSSI, AFC_FREQ_OFFSET
+    return 0;
+  return (int16_t)((uint16_t)abApi_Read[6] << 8 | abApi_Read[7]);
+}
+
+/**********************************************************
+**Name:     RFM26_GetProperty
+**Function: Read properties
+**Input:    group, start, n (up to 16)
+**Output:   0 with the values in abApi_Read, 1 no CTS
+**********************************************************/
+static uint8_t RFM26_GetProperty(uint8_t group, uint8_t start, uint8_t n)
+{
+  abApi_Write[0] = 0x12;                                  // CMD_GET_PROPERTY
+  abApi_Write[1] = group;
+  abApi_Write[2] = n;
+  abApi_Write[3] = start;
+  bApi_SendCommand(4,abApi_Write);
+  return bApi_GetResponse(n,abApi_Read);
+}
+
+/**********************************************************
+**Name:     RFM26_Snapshot
+**Function: Read the property groups of rfm26_snap.cpp, one
+            GET_PROPERTY per RFM26_SNAP_CHUNK properties
+**Input:    sink, called with each chunk as it is read
+            ctx, passed to sink
+**Output:   1 all read, 0 no CTS, the snapshot is short
+**********************************************************/
+uint8_t RFM26_Snapshot(RFM26_SNAP_SINK sink, void* ctx)
+{
+  uint8_t i, group, count, start, n;
+
+  for (i = 0; i < RFM26_SNAP_GROUPS; i++) {
+    RFM26_Snap_Group(i, &group, &count);
+    for (start = 0; start < count; start += n) {
+      n = count - start > RFM26_SNAP_CHUNK ? RFM26_SNAP_CHUNK : count - start;
+      if (RFM26_GetProperty(group, start, n))
+        return 0;
+      sink(ctx, group, start, abApi_Read, n);
+    }
+  }
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_WarmBoot
+**Function: Bring up a radio that slept through an MCU reset
+            or deep sleep without a reset pulse, POWER_UP or
+            property download: it is woken to READY and the
+            calibration and profile set by RFM26_SetCal are
+            read back from it. Then RFM26_SetupRx/Tx as after
+            RFM26_Config.
+**Input:    None
+**Output:   1 the radio kept its configuration, 0 it did not
+            (or no calibration was set): call RFM26_Config
+**********************************************************/
+uint8_t RFM26_WarmBoot(void)
+{
+  uint8_t row[3];
+  uint8_t i;
+
+  if (!gb_CalSet)
+    return 0;
+  RFM26_InitIo();
+
+  abApi_Write[0] = 0x34;                                  // CMD_CHANGE_STATE,Change state command
+  abApi_Write[1] = C_STATE_READY;                         // XO running, Rx or Tx start from here
+  bApi_SendCommand(2,abApi_Write);
+  if (bApi_WaitforCTS())
+    return 0;                                             // not powered up
+
+  if (RFM26_GetProperty(0x00, 0x00, 1) || abApi_Read[0] != gt_Cal.xo_tune)
+    return 0;                                             // GLOBAL_XO_TUNE
+  RFM26_Cfg_Copy(row, RFM26RateTbl[gt_Cal.profile], 3);
+  if (RFM26_GetProperty(0x20, 0x03, 12))                  // MODEM_DATA_RATE .. MODEM_FREQ_OFFSET
+    return 0;
+  for (i = 0; i < 3; i++)
+    if (abApi_Read[i] != row[i])
+      return 0;
+  if (abApi_Read[10] != (uint8_t)((uint16_t)gt_Cal.freq_ofs >> 8) || abApi_Read[11] != (uint8_t)gt_Cal.freq_ofs)
+    return 0;
+  if (RFM26_GetProperty(0x22, 0x01, 1))                   // PA_PWR_LVL, for SetLink and the energy account
+    return 0;
+
+  gb_Power = C_17DBM;
+  for (i = 0; i < 4; i++)
+    if (CFG_RD(&RFM26PowerTbl[i][0]) == abApi_Read[0])
+      gb_Power = i;
+  RFM26_Energy_SetLevel(&gt_Energy, gb_Power);
+  gb_Rate = gt_Cal.profile;
+  gb_Exchange = 0;
+  gb_LdcMode = 0;
+  RFM26_ClrAllInterrupt();
+  return 1;
+}
+
 /**********************************************************
 **Name:     RFM26_Config
 **Function: Initialize RFM26 & set it entry to standby mode
@@ -513,20 +865,34 @@ void RFM26_ResetRxFifo(void)
 **********************************************************/
 void RFM26_Config(void)
 {
-  //Input_DIO0();                                            
-  //Input_DIO1();
-  //Input_RFData();
-  pinMode(nIRQ0, INPUT);
-  pinMode(RESET, OUTPUT);
-  digitalWrite(RESET, LOW);
+  RFM26_StartRadio();                                          // Start the radio
 
-  vSpiInit();
+  RFM26_LoadConfig();
+}
 
-  RFM26_StartRadio();                                          // Start the radio
+/**********************************************************
+**Name:     RFM26_LoadConfig
+**Function: Properties, calibration and driver state, the
+            part of RFM26_Config after the radio is up
+**Input:    none
+**Output:   none
+**********************************************************/
+void RFM26_LoadConfig(void)
+{
+  uint8_t row[8];
 
-  ParameterConfig((uint8_t*)RFM26_CONFIGURATION_DATA);         //Set basic parameter
-  RFM26_SetParameter_Freq((uint8_t*)RFM26FreqTbl[C_868MHZ]);  //Set frequency parameter  
-  RFM26_SetParameter_Power((uint8_t*)RFM26PowerTbl[C_17DBM]); //Set power parameter
+  ParameterConfig(RFM26CfgBase);                               //Set basic parameter
+  ParameterConfig(RFM26_Cfg_Profile(gt_Cal.profile));          //and what the profile changes
+  gb_IntCtlPH = 0x30;                                          //INT_CTL_PH_ENABLE from RF_INT_CTL_ENABLE_2
+  gb_FieldLen = 0;
+  gb_VarLen = 0;
+  gb_Exchange = 0;
+  gb_LdcMode = 0;
+  gb_Rate = gt_Cal.profile;                                    //MODEM_DATA_RATE from the profile
+  RFM26_Cfg_Copy(row, RFM26FreqTbl[C_868MHZ], 8);
+  RFM26_SetParameter_Freq(row);                                //Set frequency parameter
+  RFM26_Cfg_Copy(row, RFM26PowerTbl[C_17DBM], 2);
+  RFM26_SetParameter_Power(row);                               //Set power parameter
                    
   // Configure Fast response registers
   abApi_Write[0] = 0x11;                                   // CMD_SET_PROPERTY,Use property command
@@ -540,6 +906,15 @@ void RFM26_Config(void)
   bApi_SendCommand(8,abApi_Write);                         // Send API command to the radio IC
   bApi_WaitforCTS();                                       // Wait for CTS
 
+  // Latch RSSI on sync word, read back through FRR C
+  abApi_Write[0] = 0x11;                                   // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x20;                                   // PROP_MODEM_GROUP,Select property group
+  abApi_Write[2] = 1;                                      // Number of properties to be written
+  abApi_Write[3] = 0x4C;                                   // PROP_MODEM_RSSI_CONTROL,Specify property
+  abApi_Write[4] = 0x02;                                   // RSSI_LATCH: on sync word detect
+  bApi_SendCommand(5,abApi_Write);                         // Send API command to the radio IC
+  bApi_WaitforCTS();                                       // Wait for CTS
+
   //Set packet content  
   // Set tx preamble length
   abApi_Write[0] = 0x11;                                   // CMD_SET_PROPERTY,Use property command
@@ -597,14 +972,9 @@ void RFM26_Config(void)
   bApi_SendCommand(5,abApi_Write);                         // Send command to the radio IC
   bApi_WaitforCTS();
 
-  // Adjust XTAL clock frequency
-  abApi_Write[0] = 0x11;                                   // CMD_SET_PROPERTY,Use property command
-  abApi_Write[1] = 0x00;                                   // PROP_GLOBAL_GROUP,Select property group
-  abApi_Write[2] = 1;                                      // Number of properties to be written
-  abApi_Write[3] = 0x00;                                   // PROP_GLOBAL_XO_TUNE,Specify property
-  abApi_Write[4] = 0x5D;                                   // Set cap bank value to adjust XTAL clock frequency
-  bApi_SendCommand(5,abApi_Write);                         // Send command to the radio IC
-  bApi_WaitforCTS();                                       // Wait for CTS 
+  // Adjust XTAL clock frequency and offset, the table has the trim of an uncalibrated unit
+  if (gb_CalSet)
+    RFM26_ApplyCal();
             
   // Reset Tx/Rx FIFO
   abApi_Write[0] = 0x15;                                   // CMD_FIFO_INFO,Use FIFO INFO command
@@ -624,11 +994,30 @@ void RFM26_Config(void)
 void RFM26_EntryRx(void)
 {
   RFM26_Config();                                         // config RFM26 base parameters
+  RFM26_SetupRx();
+}
+
+/**********************************************************
+**Name:     RFM26_SetupRx
+**Function: Rx interrupts on, Rx FIFO empty, start Rx; after
+            RFM26_Config or RFM26_WarmBoot
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_SetupRx(void)
+{
   RFM26_SetINT_CTL(0x01, 0x10, 0x00, 0x00);               // INT_CTL_PH: PACKET_RX  enabled
   RFM26_ClrAllInterrupt();                                // clear interrupt
+  RFM26_Hal_IrqOff();
+  gb_IrqSeen = gb_IrqCount;                               // Edges so far were from power up, not packets
+  RFM26_Hal_IrqOn();
 
   RFM26_ResetRxFifo();                                    // Reset Rx FIFO
-  RFM26_Start_Rx(0, 0, 21, 0, 0x03, 0x03);                // Start Rx                             
+  gb_RxNeed = 0;
+  if (gb_VarLen)
+    RFM26_Start_Rx(0, 0, 0, 0, C_STATE_RX, C_STATE_RX);   // Length from the packet, stays in Rx: the FIFO queues frames
+  else
+    RFM26_Start_Rx(0, 0, RFM26_PKT_LEN, 0, 0x03, 0x03);   // Start Rx                             
 }
 
 /**********************************************************
@@ -640,6 +1029,18 @@ void RFM26_EntryRx(void)
 void RFM26_EntryTx(void)
 {
   RFM26_Config(); 
+  RFM26_SetupTx();
+}
+
+/**********************************************************
+**Name:     RFM26_SetupTx
+**Function: Tx interrupts on, Tx FIFO empty; after
+            RFM26_Config or RFM26_WarmBoot
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_SetupTx(void)
+{
   RFM26_SetINT_CTL(0x01, 0x20, 0x00, 0x00);               // INT_CTL_PH:  PACKET_SENT ITs enable  
   RFM26_ClrAllInterrupt();
   RFM26_ResetTxFifo();                                    // Reset Tx FIFO
@@ -681,6 +1082,120 @@ void RFM26_Standby(void)
   bApi_SendCommand(2,abApi_Write);                        // Send command to the radio IC
 }
 
+/**********************************************************
+**Name:     RFM26_EntryLowPowerRx
+**Function: Duty-cycled Rx: the wake-up timer wakes the radio
+            every period, it sniffs for a preamble and only
+            stays in Rx when one is seen
+**Input:    period_ms, wake-up period
+            sniff_ms, Rx window per wake-up
+**Output:   None
+**********************************************************/
+void RFM26_EntryLowPowerRx(uint16_t period_ms, uint8_t sniff_ms)
+{
+  uint32_t m, ldc;
+  uint8_t r;
+
+  // WUT period = 4*M*2^R/32768 s, Rx window = 4*LDC*2^R/32768 s; take the finest R that fits
+  for (r = 0; r < 20; r++) {
+    m = ((uint32_t)period_ms * (RFM26_WUT_HZ/4) / 1000) >> r;
+    ldc = (((uint32_t)sniff_ms * (RFM26_WUT_HZ/4) + 999) / 1000 + (1UL<<r) - 1) >> r;
+    if (m <= 0xFFFF && ldc <= 0xFF)
+      break;
+  }
+  if (ldc == 0)
+    ldc = 1;
+
+  RFM26_SetINT_CTL(0x01, 0x10, 0x00, 0x00);               // INT_CTL_PH: PACKET_RX  enabled
+  RFM26_ClrAllInterrupt();                                // clear interrupt
+  RFM26_ResetRxFifo();                                    // Reset Rx FIFO
+
+  // Every wake-up enters Rx with these arguments: no preamble, back to sleep; packet, hold it in READY
+  RFM26_Start_Rx(0, 0, RFM26_PKT_LEN, C_STATE_SLEEP, C_STATE_READY, C_STATE_SLEEP);
+
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x00;                                  // PROP_GLOBAL_GROUP,Select property group
+  abApi_Write[2] = 5;                                     // Number of properties to be written
+  abApi_Write[3] = 0x04;                                  // PROP_GLOBAL_WUT_CONFIG,Specify property
+  abApi_Write[4] = C_WUT_LDC_RX|C_WUT_EN|C_WUT_CAL_EN;    // Rx low duty cycle on the wake-up timer
+  abApi_Write[5] = (uint8_t)(m>>8);                       // WUT_M_15_8
+  abApi_Write[6] = (uint8_t)m;                            // WUT_M_7_0
+  abApi_Write[7] = r;                                     // WUT_R
+  abApi_Write[8] = (uint8_t)ldc;                          // WUT_LDC
+  bApi_SendCommand(9,abApi_Write);                        // Send API command to the radio IC
+  bApi_WaitforCTS();                                      // Wait for CTS
+
+  gb_LdcMode = 1;
+  RFM26_IntoSleep();                                      // The wake-up timer takes over
+}
+
+/**********************************************************
+**Name:     RFM26_ExitLowPowerRx
+**Function: Stop the wake-up timer and return to continuous Rx
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ExitLowPowerRx(void)
+{
+  RFM26_WakeUp();
+
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x00;                                  // PROP_GLOBAL_GROUP,Select property group
+  abApi_Write[2] = 1;                                     // Number of properties to be written
+  abApi_Write[3] = 0x04;                                  // PROP_GLOBAL_WUT_CONFIG,Specify property
+  abApi_Write[4] = 0x00;                                  // Wake-up timer off
+  bApi_SendCommand(5,abApi_Write);                        // Send API command to the radio IC
+  bApi_WaitforCTS();                                      // Wait for CTS
+
+  gb_LdcMode = 0;
+  RFM26_ChangeToRxMode(RFM26_PKT_LEN);
+}
+
+/**********************************************************
+**Name:     RFM26_LongPreamble
+**Function: Tx preamble long enough to hit one sniff window of
+            a duty-cycled receiver, no radio access
+**Input:    period_ms, receiver wake-up period, 0 for normal
+            sniff_ms, receiver Rx window per wake-up
+**Output:   preamble length in bytes, clamped to 255
+**********************************************************/
+uint8_t RFM26_LongPreamble(uint16_t period_ms, uint8_t sniff_ms)
+{
+  uint32_t bytes;
+
+  bytes = RFM26_PREAMBLE_LEN;
+  if (period_ms != 0)                                     // A full period plus one window, whatever the phase
+    bytes += ((uint32_t)period_ms + sniff_ms) * RFM26_BITRATE / 8000;
+  if (bytes > 0xFF)
+    bytes = 0xFF;
+  return (uint8_t)bytes;
+}
+
+/**********************************************************
+**Name:     RFM26_SetLongPreamble
+**Function: Set a Tx preamble long enough to hit one sniff
+            window of a duty-cycled receiver
+**Input:    period_ms, receiver wake-up period, 0 for normal
+            sniff_ms, receiver Rx window per wake-up
+**Output:   preamble length in bytes, RFM26_LongPreamble
+**********************************************************/
+uint8_t RFM26_SetLongPreamble(uint16_t period_ms, uint8_t sniff_ms)
+{
+  uint8_t bytes;
+
+  bytes = RFM26_LongPreamble(period_ms, sniff_ms);
+
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x10;                                  // PROP_PREAMBLE_GROUP,Select property group
+  abApi_Write[2] = 1;                                     // Number of properties to be written
+  abApi_Write[3] = 0x00;                                  // PROP_PREAMBLE_TX_LENGTH,Specify property
+  abApi_Write[4] = bytes;                                 // Tx preamble in bytes
+  bApi_SendCommand(5,abApi_Write);                        // Send command to the radio IC
+  bApi_WaitforCTS();                                      // Wait for CTS
+
+  return bytes;
+}
+
 /**********************************************************
 **Name:     RFM26_ReadRSSI
 **Function: Read the RSSI value
@@ -689,16 +1204,17 @@ void RFM26_Standby(void)
 **********************************************************/
 uint8_t RFM26_ReadRSSI(void)
 {
-  uint16_t temp=0xff;
-  
-//  abApi_Write[0] = 0x22;                                  // CMD_GET_MODEM_STATUS
-//  abApi_Write[1] = 0x00;                                  // don't clear PEND
-//  bApi_SendCommand(2,abApi_Write);                        // Send command to the radio IC
-//  bApi_WaitforCTS();
-//  bApi_GetResponse(8, abApi_Read );                       // Make sure that CTS is ready then get the response
-//  temp=abApi_Read[3];
-  
-  return (uint8_t)temp;
+  uint8_t temp;
+
+  INSTR_CMD(0x53, 0);
+  INSTR_XFER();
+  INSTR_SPI(2);
+  RFM26_Hal_Select();
+  RFM26_Hal_Xfer(0x53);                                   // CMD_FRR_C_READ, FRR C: latched RSSI
+  temp = RFM26_Hal_Xfer(0x00);
+  RFM26_Hal_Release();
+
+  return temp;
 }
 
 
@@ -794,22 +1310,413 @@ void RFM26_TestTx(void)
 
 }
 
+/**********************************************************
+**Name:     RFM26_GetState
+**Function: Read the current radio state
+**Input:    None
+**Output:   CURR_STATE, one of C_STATE_xxx
+**********************************************************/
+uint8_t RFM26_GetState(void)
+{
+  abApi_Write[0] = 0x33;                                  // CMD_REQUEST_DEVICE_STATE
+  bApi_SendCommand(1,abApi_Write);                        // Send command to the radio IC
+  if (bApi_GetResponse(2,abApi_Read))                     // CURR_STATE, CURRENT_CHANNEL
+    return C_STATE_ERR;                                   // abApi_Read is stale
+  return abApi_Read[0]&0x0F;
+}
+
+/**********************************************************
+**Name:     RFM26_Airtime
+**Function: Time on air of a frame at the current rate
+**Input:    len, bytes after the sync word
+**Output:   us
+**********************************************************/
+uint32_t RFM26_Airtime(uint8_t len)
+{
+  uint32_t bits = ((uint32_t)RFM26_PREAMBLE_LEN + 2 + len) * 8;  // Preamble, 2 byte sync, data
+
+  return bits * 1000000UL / ((uint32_t)1200 << gb_Rate);         // C_1_2KHZ_35KHZ.. double the rate each
+}
+
+/**********************************************************
+**Name:     RFM26_WaitTxDone
+**Function: Wait for a Tx on air (a hardware response) to end,
+            at most the airtime of a full Tx FIFO; on nIRQ when
+            PACKET_SENT is enabled, else polling every
+            C_TX_POLL_US
+**Input:    None
+**Output:   1 not in Tx, 0 still in Tx at the deadline or the
+            radio does not answer
+**********************************************************/
+#define C_TX_MAX_LEN    64                                // Tx FIFO
+#define C_TX_MARGIN_US  2000                              // START_TX to the first preamble bit and more
+#define C_TX_POLL_US    500
+
+uint8_t RFM26_WaitTxDone(void)
+{
+  uint32_t t0 = time_us();
+  uint32_t limit = RFM26_Airtime(C_TX_MAX_LEN) + C_TX_MARGIN_US;
+  uint32_t gone;
+  uint8_t st;
+
+  for (;;) {
+    st = RFM26_GetState();
+    if (st != C_STATE_TX)
+      return st != C_STATE_ERR;
+    gone = time_us() - t0;
+    if (gone >= limit)
+      return 0;
+    if (gb_IntCtlPH & 0x20)
+      RFM26_Hal_WaitIrq(limit - gone);                    // PACKET_SENT, no SPI meanwhile
+    else
+      delay_us(C_TX_POLL_US);
+  }
+}
+
+/**********************************************************
+**Name:     RFM26_PreloadTx
+**Function: Write Tx FIFO and prepare a Tx that turns around to
+            Rx, START_TX with C_TXCOMPLETE_RX is left to the
+            caller so it can be timed
+**Input:    p_data, data to send
+            num, data length
+            resp_len, length of the frame expected back
+**Output:   None
+**********************************************************/
+void RFM26_PreloadTx(uint8_t* p_data, uint8_t num, uint8_t resp_len)
+{
+  // Only touch properties that differ, the common path is FIFO write + START_TX
+  if(gb_IntCtlPH!=0x10)
+    RFM26_SetINT_CTL(0x01, 0x10, 0x00, 0x00);             // INT_CTL_PH: PACKET_RX only, Tx end is handled by the radio
+  if(gb_FieldLen!=resp_len)
+    RFM26_SetFieldLength(resp_len);                       // Rx entered from TXCOMPLETE_STATE uses field 1 length
+
+  bApi_WriteTxDataBuffer(num,p_data);                     // Write data to Tx FIFO
+  if(!nIRQ0_READ())
+  {
+    RFM26_ClrAllInterrupt();
+  }
+}
+
+/**********************************************************
+**Name:     RFM26_StartExchange
+**Function: Send a request and let the radio turn around to Rx
+            in hardware (TXCOMPLETE_STATE = RX), the response
+            is picked up by receive_message()
+**Input:    p_data, request data
+            num, request length
+            resp_len, expected response length
+**Output:   None
+**********************************************************/
+void RFM26_StartExchange(uint8_t* p_data, uint8_t num, uint8_t resp_len)
+{
+  RFM26_PreloadTx(p_data, num, resp_len);
+  gb_Exchange = 1;
+  gl_ExchangeStart = time_us();
+  RFM26_Start_Tx(0x00, C_TXCOMPLETE_RX, num);
+  if(gt_Capture)
+    RFM26_Cap_Frame(gt_Capture, C_CAP_TX, 0, 0, gl_ExchangeStart, p_data, num, 0, 0);
+}
+
+/**********************************************************
+**Name:     RFM26_ArmResponse
+**Function: Preload a response into Tx FIFO and start Rx, the
+            radio sends it in hardware (RXVALID_STATE = TX) as
+            soon as a valid request is received
+**Input:    p_data, response data
+            num, response length, also the request length
+**Output:   1 armed, 0 the previous response did not end
+            (RFM26_WaitTxDone), nothing changed
+**********************************************************/
+uint8_t RFM26_ArmResponse(uint8_t* p_data, uint8_t num)
+{
+  if (!RFM26_WaitTxDone())                                // Let the previous response go out
+    return 0;
+
+  if(gb_IntCtlPH!=0x10)
+    RFM26_SetINT_CTL(0x01, 0x10, 0x00, 0x00);             // INT_CTL_PH: PACKET_RX only
+  if(gb_FieldLen!=num)
+    RFM26_SetFieldLength(num);                            // Tx entered from RXVALID_STATE uses field 1 length
+
+  RFM26_ResetTxFifo();                                    // Drop a response that was never sent
+  bApi_WriteTxDataBuffer(num,p_data);                     // Write data to Tx FIFO
+  RFM26_ClrAllInterrupt();
+  gb_Exchange = 2;
+  RFM26_Start_Rx(0, 0, num, 0, C_STATE_TX, C_STATE_RX);   // Valid request: send response, invalid: keep listening
+  if(gt_Capture)
+    RFM26_Cap_Frame(gt_Capture, C_CAP_TX_ARMED, 0, 0, time_us(), p_data, num, 0, 0);
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_GetRoundTrip
+**Function: Round trip time of the last completed exchange
+**Input:    None
+**Output:   time from START_TX to response read, in us
+**********************************************************/
+uint32_t RFM26_GetRoundTrip(void)
+{
+  return gl_RoundTrip;
+}
+
+/**********************************************************
+**Name:     RFM26_IrqCapture
+**Function: nIRQ falling edge handler, stamp the event
+**Input:    None
+**Output:   None
+**********************************************************/
+static void RFM26_IrqCapture(void)
+{
+  uint32_t now = time_us();
+
+  if (gb_TxPending) {
+    gl_TxStamp = now;
+    gb_TxPending = 0;
+  } else {
+    gl_IrqStamp = now;
+    gb_IrqCount++;
+  }
+  if (gt_IrqHook)
+    gt_IrqHook();
+}
+
+#if RFM26_HAL == RFM26_HAL_AVR && RFM26_PCINT_ISR
+// nIRQ0 (D8) is PB0, a pin change interrupt rather than an external interrupt on these parts
+ISR(PCINT0_vect)
+{
+  if (!(PINB & _BV(PINB0)))
+    RFM26_IrqCapture();
+}
+#endif
+
+/**********************************************************
+**Name:     RFM26_EnableTimestamp
+**Function: Capture time of every nIRQ falling edge
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_EnableTimestamp(void)
+{
+  RFM26_Hal_Attach(RFM26_IrqCapture);
+}
+
+/**********************************************************
+**Name:     RFM26_SetIrqHook
+**Function: Have the nIRQ interrupt call hook after it took
+            its timestamp, to wake a scheduler
+**Input:    hook, runs in interrupt context, 0: none
+**Output:   None
+**********************************************************/
+void RFM26_SetIrqHook(void (*hook)(void))
+{
+  RFM26_Hal_IrqOff();
+  gt_IrqHook = hook;
+  RFM26_Hal_IrqOn();
+}
+
+/**********************************************************
+**Name:     RFM26_GetRxInfo
+**Function: Timestamps and RSSI of the last received packet
+**Input:    None
+**Output:   pointer to the packet info
+**********************************************************/
+const RFM26_PKT_INFO* RFM26_GetRxInfo(void)
+{
+  return &gt_RxInfo;
+}
+
+/**********************************************************
+**Name:     RFM26_GetTxStamp
+**Function: Time of the last send_message() completion
+**Input:    None
+**Output:   nIRQ (PACKET_SENT) time in us, 0 while Tx pending
+**********************************************************/
+uint32_t RFM26_GetTxStamp(void)
+{
+  uint32_t stamp;
+
+  RFM26_Hal_IrqOff();
+  stamp = gb_TxPending ? 0 : gl_TxStamp;
+  RFM26_Hal_IrqOn();
+  return stamp;
+}
+
+/**********************************************************
+**Name:     RFM26_LatencyAdd
+**Function: Add a delay to a latency histogram
+**Input:    which, C_LAT_IRQ_TO_FIFO or C_LAT_FIFO_TO_APP
+            us, delay in us
+**Output:   None
+**********************************************************/
+static void RFM26_LatencyAdd(uint8_t which, uint32_t us)
+{
+  uint8_t bin = 0;
+
+  while (us > 1 && bin < RFM26_LAT_BINS-1) {
+    us >>= 1;
+    bin++;
+  }
+  if (aw_LatHist[which][bin] != 0xFFFF)                   // Saturate, don't wrap
+    aw_LatHist[which][bin]++;
+}
+
+/**********************************************************
+**Name:     RFM26_GetLatencyHist
+**Function: Read a receive latency histogram
+**Input:    which, C_LAT_IRQ_TO_FIFO or C_LAT_FIFO_TO_APP
+**Output:   RFM26_LAT_BINS counters
+**********************************************************/
+const uint16_t* RFM26_GetLatencyHist(uint8_t which)
+{
+  return aw_LatHist[which];
+}
+
+/**********************************************************
+**Name:     RFM26_ClearLatencyHist
+**Function: Clear both receive latency histograms
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ClearLatencyHist(void)
+{
+  memset(aw_LatHist, 0, sizeof(aw_LatHist));
+}
+
+/**********************************************************
+**Name:     RFM26_GetEnergyReport
+**Function: Time and energy per radio state since reset
+**Input:    r, report to fill
+**Output:   None
+**********************************************************/
+void RFM26_GetEnergyReport(RFM26_ENERGY_REPORT* r)
+{
+  RFM26_Energy_Report(&gt_Energy, time_us(), r);
+}
+
+/**********************************************************
+**Name:     RFM26_ClearEnergy
+**Function: Restart energy accounting, the radio state is kept
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ClearEnergy(void)
+{
+  RFM26_Energy_Init(&gt_Energy, time_us());
+}
+
+/**********************************************************
+**Name:     RFM26_SetCapture
+**Function: Log every frame received or sent to a capture
+**Input:    c, capture, 0 for none
+**Output:   None
+**********************************************************/
+void RFM26_SetCapture(RFM26_CAPTURE* c)
+{
+  gt_Capture = c;
+}
+
+#if RFM26_INSTRUMENT
+/**********************************************************
+**Name:     RFM26_GetInstr
+**Function: Driver counters and command trace
+**Input:    None
+**Output:   pointer to the instrumentation
+**********************************************************/
+const RFM26_INSTR* RFM26_GetInstr(void)
+{
+  return &gt_Instr;
+}
+
+/**********************************************************
+**Name:     RFM26_ClearInstr
+**Function: Zero driver counters and command trace
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ClearInstr(void)
+{
+  RFM26_Instr_Clear(&gt_Instr);
+}
+#endif
+
 uint8_t receive_message(uint8_t* p_data)
 {
   unsigned char  i,num;
 
-  num = 21;
+  for(i=0;i<RFM26_PKT_LEN;i++) 
+    gb_RxData[i] = 0x00;
+  num = RFM26_ReceiveSplit(gb_RxData, RFM26_PKT_LEN, 0, 0);
+  if (num) {
+    for (i = 0; i < num; i++) {
+      p_data[i] = gb_RxData[i];
+    }
+    gt_RxInfo.app_us = time_us();
+    RFM26_LatencyAdd(C_LAT_FIFO_TO_APP, gt_RxInfo.app_us - gt_RxInfo.fifo_us);
+  }
+  return num;
+}
+
+/**********************************************************
+**Name:     RFM26_ReceiveSplit
+**Function: Read a received packet in two parts: the first
+            hdr_len bytes, then the rest straight to where
+            place() says, so a layer above can reassemble
+            without a copy through gb_RxData
+**Input:    hdr, hdr_len bytes out
+            hdr_len, 1..RFM26_PKT_LEN
+            place, called with the header, returns the buffer
+                   for RFM26_PKT_LEN-hdr_len bytes, 0 to drop
+                   them; 0 to read the header only
+            ctx, passed to place
+**Output:   packet length, 0 for none
+**********************************************************/
+uint8_t RFM26_ReceiveSplit(uint8_t* hdr, uint8_t hdr_len, RFM26_RX_PLACE place, void* ctx)
+{
+  uint8_t num,bCount,bStatus;
+  uint8_t* dst = 0;
+
+  num = RFM26_PKT_LEN;
   if (!nIRQ0_READ()) {
-  	
-    for(i=0;i<num;i++) 
-      gb_RxData[i] = 0x00;
-    bApi_ReadRxDataBuffer(num,gb_RxData);
+    RFM26_Hal_IrqOff();
+    bCount = gb_IrqCount;
+    gt_RxInfo.irq_us = gl_IrqStamp;
+    RFM26_Hal_IrqOn();
+
+    bApi_ReadRxDataBuffer(hdr_len,hdr);
+    if (place)
+      dst = place(ctx, hdr, hdr_len);
+    if (dst && hdr_len < num)
+      bApi_ReadRxDataBuffer(num-hdr_len,dst);             // Rest of the FIFO, else dropped by RFM26_ClearFIFO
+    gt_RxInfo.fifo_us = time_us();
+    if (bCount != gb_IrqSeen) {                           // Edge was captured, else timestamps are disabled
+      INSTR_MISSED((uint8_t)(bCount - gb_IrqSeen - 1));   // Edges since the last read were packets lost
+      gb_IrqSeen = bCount;
+      RFM26_LatencyAdd(C_LAT_IRQ_TO_FIFO, gt_RxInfo.fifo_us - gt_RxInfo.irq_us);
+    } else {
+      gt_RxInfo.irq_us = gt_RxInfo.fifo_us;
+    }
+    gt_RxInfo.rssi = RFM26_ReadRSSI();                    // Read before Rx restarts and latches again
     RFM26_ClearFIFO();
     RFM26_ClrAllInterrupt();
-    RFM26_Start_Rx(0, 0, num, 0, 0x03, 0x03);
-
-    for (i = 0; i < num; i++) {
-      p_data[i] = gb_RxData[i];
+    if (abApi_Read[2] & 0x08)                             // CRC_ERROR: a frame failed before this one, Rx went on
+      RFM26_Energy_OnPacketInvalid(&gt_Energy, gt_RxInfo.irq_us);
+    RFM26_Energy_OnPacketRx(&gt_Energy, gt_RxInfo.irq_us);
+    if (gb_Exchange==2) {
+      gb_Exchange = 0;                                    // Radio is sending the armed response, don't restart Rx
+    } else {
+      if (gb_Exchange==1) {
+        gl_RoundTrip = time_us() - gl_ExchangeStart;
+        gb_Exchange = 0;
+      }
+      if (gb_LdcMode)
+        RFM26_IntoSleep();                                // Back to the wake-up timer, START_RX arguments are kept
+      else
+        RFM26_Start_Rx(0, 0, num, 0, 0x03, 0x03);
+    }
+    if (gt_Capture) {                                     // abApi_Read still holds GET_INT_STATUS, PH_PEND in [2]
+      bStatus = !gt_Capture->crc_on ? C_CAP_CRC_NONE : (abApi_Read[2] & 0x08) ? C_CAP_CRC_BAD : C_CAP_CRC_OK;
+      RFM26_Cap_Frame(gt_Capture, C_CAP_RX | bStatus, 0, gt_RxInfo.rssi, gt_RxInfo.irq_us,
+                      hdr, hdr_len, dst, dst ? num-hdr_len : 0);
     }
 	  return num;
   }
@@ -825,5 +1732,194 @@ void send_message(uint8_t* p_data,uint8_t num)
 	{
 	  RFM26_ClrAllInterrupt();
 	}
+	if(gb_IntCtlPH & 0x20)
+	  gb_TxPending = 1;                                       // Next nIRQ edge is PACKET_SENT
 	RFM26_Start_Tx(0x00, 0x30, num);  
+	if(gt_Capture)
+	  RFM26_Cap_Frame(gt_Capture, C_CAP_TX, 0, 0, time_us(), p_data, num, 0, 0);
+}
+
+/**********************************************************
+**Name:     RFM26_SendSplit
+**Function: Send a header and a payload as one packet, both
+            written to Tx FIFO from where they are, zero padded
+            to RFM26_PKT_LEN
+**Input:    hdr, header data
+            hdr_len, header length
+            p_data, payload data
+            num, payload length, hdr_len+num <= RFM26_PKT_LEN
+**Output:   None
+**********************************************************/
+void RFM26_SendSplit(const uint8_t* hdr, uint8_t hdr_len, const uint8_t* p_data, uint8_t num)
+{
+  uint8_t i,pad[RFM26_PKT_LEN];
+
+  for(i=0;i<RFM26_PKT_LEN-hdr_len-num;i++)
+    pad[i] = 0x00;
+  RFM26_Standby();
+  bApi_WriteTxDataBuffer(hdr_len,(uint8_t*)hdr);          // Tx FIFO appends, one packet from three writes
+  if(num)
+    bApi_WriteTxDataBuffer(num,(uint8_t*)p_data);
+  if(i)
+    bApi_WriteTxDataBuffer(i,pad);
+  bApi_WaitforCTS();
+  if(!nIRQ0_READ())                                       // RevB1A workaround;
+  {
+    RFM26_ClrAllInterrupt();
+  }
+  if(gb_IntCtlPH & 0x20)
+    gb_TxPending = 1;                                     // Next nIRQ edge is PACKET_SENT
+  RFM26_Start_Tx(0x00, 0x30, RFM26_PKT_LEN);
+  if(gt_Capture)
+    RFM26_Cap_Frame(gt_Capture, C_CAP_TX, 0, 0, time_us(), hdr, hdr_len, p_data, num);  // padding not logged
+}
+
+/**********************************************************
+**Name:     RFM26_SetVarLen
+**Function: Frame format: field 1 is a length byte the packet
+            handler takes field 2's length from, or back to
+            the fixed packets with field 1 as it was before
+**Input:    on, 1 variable length, 0 fixed
+**Output:   None
+**********************************************************/
+void RFM26_SetVarLen(uint8_t on)
+{
+  on = on != 0;
+  if (on == gb_VarLen)
+    return;
+  if (on) {
+    if (RFM26_GetProperty(0x12, 0x0D, 2) == 0)            // PKT_FIELD_1_LENGTH, from the config table or SetFieldLength
+      gw_FieldLenFixed = (uint16_t)abApi_Read[0] << 8 | abApi_Read[1];
+    gb_FieldLenFixed = gb_FieldLen;
+    RFM26_SetFieldLength(1);
+  } else {
+    abApi_Write[0] = 0x11;                                // CMD_SET_PROPERTY,Use property command
+    abApi_Write[1] = 0x12;                                // PROP_PKT_GROUP,Select property group
+    abApi_Write[2] = 2;                                   // Number of properties to be written
+    abApi_Write[3] = 0x0D;                                // PROP_PKT_FIELD_1_LENGTH_12_8,Specify property
+    abApi_Write[4] = (uint8_t)(gw_FieldLenFixed >> 8);
+    abApi_Write[5] = (uint8_t)gw_FieldLenFixed;
+    bApi_SendCommand(6,abApi_Write);
+    bApi_WaitforCTS();
+    gb_FieldLen = gb_FieldLenFixed;
+  }
+  abApi_Write[0] = 0x11;                                  // CMD_SET_PROPERTY,Use property command
+  abApi_Write[1] = 0x12;                                  // PROP_PKT_GROUP,Select property group
+  abApi_Write[2] = 3;                                     // Number of properties to be written
+  abApi_Write[3] = 0x08;                                  // PROP_PKT_LEN,Specify property
+  abApi_Write[4] = on ? 0x2A : 0x00;                      // Length byte in FIFO, one byte, field 2 takes it
+  abApi_Write[5] = on ? 0x01 : 0x00;                      // PKT_LEN_FIELD_SOURCE: field 1
+  abApi_Write[6] = 0x00;                                  // PKT_LEN_ADJUST
+  bApi_SendCommand(7,abApi_Write);
+  bApi_WaitforCTS();
+  abApi_Write[2] = 2;
+  abApi_Write[3] = 0x11;                                  // PROP_PKT_FIELD_2_LENGTH_12_8, the most field 2 takes
+  abApi_Write[4] = 0x00;
+  abApi_Write[5] = on ? RFM26_VAR_MAX : 0x00;
+  bApi_SendCommand(6,abApi_Write);
+  bApi_WaitforCTS();
+  gb_VarLen = on;
+  gb_RxNeed = 0;
+}
+
+/**********************************************************
+**Name:     RFM26_SendVar
+**Function: Send a variable length frame, the length byte
+            first; after RFM26_SetVarLen(1)
+**Input:    p_data, payload
+            num, 1..RFM26_VAR_MAX
+**Output:   1 sent, 0 bad length
+**********************************************************/
+uint8_t RFM26_SendVar(const uint8_t* p_data, uint8_t num)
+{
+  if (num == 0 || num > RFM26_VAR_MAX)
+    return 0;
+  RFM26_Standby();
+  bApi_WriteTxDataBuffer(1,&num);                         // Field 1
+  bApi_WriteTxDataBuffer(num,(uint8_t*)p_data);           // Field 2
+  bApi_WaitforCTS();
+  if(!nIRQ0_READ())                                       // RevB1A workaround;
+  {
+    RFM26_ClrAllInterrupt();
+  }
+  if(gb_IntCtlPH & 0x20)
+    gb_TxPending = 1;                                     // Next nIRQ edge is PACKET_SENT
+  RFM26_Start_Tx(0x00, 0x30, (uint16_t)num + 1);          // Length byte + payload, the fields only size Rx
+  if(gt_Capture)
+    RFM26_Cap_Frame(gt_Capture, C_CAP_TX, 0, 0, time_us(), &num, 1, p_data, num);
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_ReceiveAll
+**Function: Hand every complete variable length frame in the
+            Rx FIFO to sink, without resetting the FIFO; a
+            frame still coming stays for its own PACKET_RX.
+            After RFM26_SetVarLen(1) and RFM26_SetupRx, the
+            radio stays in Rx between frames. CRC_ERROR does
+            not tell which frame failed, the frames complete
+            in the FIFO are all dropped then
+**Input:    sink, called per frame, the bytes are valid until
+            it returns
+            ctx, passed to sink
+**Output:   frames handed over, 0 for none
+**********************************************************/
+uint8_t RFM26_ReceiveAll(RFM26_RX_SINK sink, void* ctx)
+{
+  uint8_t buf[RFM26_VAR_MAX];
+  uint8_t cnt,num,bCount,bCrcBad,bStatus;
+
+  if (nIRQ0_READ())
+    return 0;
+  RFM26_Hal_IrqOff();
+  bCount = gb_IrqCount;
+  gt_RxInfo.irq_us = gl_IrqStamp;
+  RFM26_Hal_IrqOn();
+
+  RFM26_ClrAllInterrupt();                                // First: a frame done from here on raises nIRQ again
+  if (abApi_Read[6] & 0x20) {                             // FIFO_UNDERFLOW_OVERFLOW_ERROR, framing is lost
+    RFM26_ResetRxFifo();
+    gb_RxNeed = 0;
+    return 0;
+  }
+  bCrcBad = abApi_Read[2] & 0x08;                         // PH_PEND CRC_ERROR, a frame since the last read failed
+  if (bCrcBad)
+    RFM26_Energy_OnPacketInvalid(&gt_Energy, gt_RxInfo.irq_us);
+  bStatus = bCrcBad ? C_CAP_CRC_BAD : (gt_Capture && gt_Capture->crc_on) ? C_CAP_CRC_OK : C_CAP_CRC_NONE;
+  gt_RxInfo.rssi = RFM26_ReadRSSI();                      // Of the last frame
+  cnt = RFM26_GetRxFifoCount();
+  num = 0;
+  for (;;) {
+    if (!gb_RxNeed) {
+      if (!cnt)
+        break;
+      bApi_ReadRxDataBuffer(1,&gb_RxNeed);
+      cnt--;
+      if (gb_RxNeed == 0 || gb_RxNeed > RFM26_VAR_MAX) {  // Not a length byte, framing is lost
+        RFM26_ResetRxFifo();
+        gb_RxNeed = 0;
+        break;
+      }
+    }
+    if (cnt < gb_RxNeed)
+      break;                                              // Still on air
+    bApi_ReadRxDataBuffer(gb_RxNeed,buf);
+    cnt -= gb_RxNeed;
+    gt_RxInfo.fifo_us = time_us();
+    if (!bCrcBad)
+      RFM26_Energy_OnPacketRx(&gt_Energy, gt_RxInfo.irq_us);
+    if (gt_Capture)
+      RFM26_Cap_Frame(gt_Capture, C_CAP_RX | bStatus, 0, gt_RxInfo.rssi, gt_RxInfo.irq_us,
+                      &gb_RxNeed, 1, buf, gb_RxNeed);
+    if (!bCrcBad) {
+      num++;
+      sink(ctx, buf, gb_RxNeed);
+    }
+    gb_RxNeed = 0;
+  }
+  if (num && bCount != gb_IrqSeen) {                      // Edges per frame, not one per read: none were lost
+    gb_IrqSeen = bCount;
+    RFM26_LatencyAdd(C_LAT_IRQ_TO_FIFO, gt_RxInfo.fifo_us - gt_RxInfo.irq_us);
+  }
+  return num;
 }
@@ -1,27 +1,26 @@
 #ifndef HopeDuino_26_H_
 #define HopeDuino_26_H_
 
-#include <Arduino.h>
+#include "rfm26_hal.h"
+#include "rfm26_energy.h"
+#include "rfm26_capture.h"
+#include "rfm26_instr.h"
+#include "rfm26_config.h"
+#include "rfm26_cal.h"
+#include "rfm26_snap.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-//Dirver hardware I/O define
-#define DIO0			4
-#define DIO2			5
-#define RFData 		    6
-#define nIRQ1			7
-#define nIRQ0			8
-#define RESET		    9
+#define RESET_HIGH()	RFM26_Hal_Reset(1)
+#define RESET_LOW()		RFM26_Hal_Reset(0)
 
-#define RESET_HIGH()	digitalWrite(RESET,HIGH)
-#define RESET_LOW()		digitalWrite(RESET,LOW)
+#define nIRQ0_READ()	RFM26_Hal_Irq()
 
-#define nIRQ0_READ()	digitalRead(nIRQ0)
-
-#define delay_ms(x)		delay(x)
-#define delay_us(x)		delayMicroseconds(x)
+#define delay_ms(x)		RFM26_Hal_DelayMs(x)
+#define delay_us(x)		RFM26_Hal_DelayUs(x)
+#define time_us()		RFM26_Hal_Micros()
 
 //Define module work mode
 #define C_ModuleWorkMode_FSK     0
@@ -42,12 +41,65 @@ extern "C" {
 #define C_4_8KHZ_35KHZ		2
 #define C_9_6KHZ_35KHZ		3
 
+//RFM26_SetLink could not wait out a Tx
+#define RFM26_LINK_BUSY		0xFF
+
 //Define module out power
 #define C_20DBM		0
 #define C_17DBM		1
 #define C_14DBM		2
 #define C_11DBM		3
 
+//Define radio states, used as START_RX next states and START_TX TXCOMPLETE_STATE
+#define C_STATE_NOCHANGE	0x00
+#define C_STATE_SLEEP		0x01
+#define C_STATE_SPI_ACTIVE	0x02
+#define C_STATE_READY		0x03
+#define C_STATE_TX		    0x07
+#define C_STATE_RX		    0x08
+#define C_STATE_ERR		    0xFF						// RFM26_GetState: no answer from the radio
+
+//Define START_TX condition, TXCOMPLETE_STATE in upper nibble
+#define C_TXCOMPLETE_READY	(C_STATE_READY<<4)
+#define C_TXCOMPLETE_RX		(C_STATE_RX<<4)
+
+//Define INT_CTL_PH_ENABLE / PH_PEND bits
+#define C_PH_RX_ALMOST_FULL	0x01
+#define C_PH_PACKET_RX		0x10
+#define C_PH_PACKET_SENT	0x20
+
+//Define packet length and air rate
+#define RFM26_PKT_LEN		21
+#define RFM26_BITRATE		2400
+#define RFM26_PREAMBLE_LEN	8
+#define RFM26_VAR_MAX		63							// variable length payload, with its length byte one Rx FIFO
+
+//Define GLOBAL_WUT_CONFIG, wake-up timer runs from the 32kHz RC
+#define C_WUT_LDC_RX		0x40
+#define C_WUT_EN			0x02
+#define C_WUT_CAL_EN		0x01
+#define RFM26_WUT_HZ		32768
+
+//Define latency histograms, bin n counts delays in [2^n, 2^(n+1)) us, bin 0 also counts 0
+#define C_LAT_IRQ_TO_FIFO	0
+#define C_LAT_FIFO_TO_APP	1
+#define RFM26_LAT_BINS		16
+
+//Packet timestamps, captured at the nIRQ falling edge
+typedef struct
+{
+  uint32_t irq_us;                                        // nIRQ falling edge (PACKET_RX)
+  uint32_t fifo_us;                                       // Rx FIFO read done
+  uint32_t app_us;                                        // Handed to the application
+  uint8_t  rssi;                                          // Latched RSSI, 0.5dB steps
+} RFM26_PKT_INFO;
+
+//Receive placement: where the bytes after the header go, 0 to drop them
+typedef uint8_t* (*RFM26_RX_PLACE)(void* ctx, const uint8_t* hdr, uint8_t hdr_len);
+
+//Receive sink: one variable length frame, payload only
+typedef void (*RFM26_RX_SINK)(void* ctx, const uint8_t* p, uint8_t len);
+
 /**********************************************************
 **Name:     bSpi_SendDataNoResp
 **Function: send data over SPI no response expected
@@ -145,13 +197,24 @@ void RFM26_WakeUp(void);
 **********************************************************/
 void RFM26_StartRadio(void);
 
+/**********************************************************
+**Name:     RFM26_BootStep
+**Function: RFM26_StartRadio a step at a time: RESET pulse,
+            POWER_UP, boot; call again after the time
+            returned, after POWER_UP as soon as nIRQ falls
+**Input:    None
+**Output:   us to wait, 0 when the radio is up
+**********************************************************/
+uint16_t RFM26_BootStep(void);
+
 /**********************************************************
 **Name:     ParameterConfig
-**Function: Parameter config
-**Input:    * configurationTable,Parameter table
+**Function: Parameter config, decodes an encoded stream a
+            command at a time into the API buffer
+**Input:    * stream, rfm26_config.h stream in program memory
 **Output:   None
 **********************************************************/
-void ParameterConfig(uint8_t *configurationTable);
+void ParameterConfig(const uint8_t *stream);
 
 /**********************************************************
 **Name:     RFM26_SetParameter_Freq
@@ -169,6 +232,27 @@ void RFM26_SetParameter_Freq(uint8_t *FreqConfig);
 **********************************************************/
 void RFM26_SetParameter_Power(uint8_t *PA);
 
+/**********************************************************
+**Name:     RFM26_SetParameter_Rate
+**Function: Set data rate and clock recovery
+**Input:    *RateConfig,Rate table
+**Output:   None
+**********************************************************/
+void RFM26_SetParameter_Rate(uint8_t *RateConfig);
+
+/**********************************************************
+**Name:     RFM26_SetLink
+**Function: Set rate and power of a link, only what differs
+            from the chip is written; waits for a running Tx
+            (hardware response) to finish first
+**Input:    rate, C_1_2KHZ_35KHZ..C_9_6KHZ_35KHZ
+            power, C_20DBM..C_11DBM
+**Output:   number of SET_PROPERTY commands sent,
+            RFM26_LINK_BUSY if the Tx did not end (see
+            RFM26_WaitTxDone), nothing written
+**********************************************************/
+uint8_t RFM26_SetLink(uint8_t rate, uint8_t power);
+
 /**********************************************************
 **Name:     RFM26_Start_Tx
 **Function: Start Tx
@@ -203,6 +287,15 @@ void RFM26_Start_Rx(uint8_t Channel, uint8_t Condition, uint16_t Rx_Length, uint
 **********************************************************/
 void RFM26_SetINT_CTL(uint8_t status, uint8_t ctl_PH, uint8_t ctl_modem, uint8_t ctl_chip);
 
+/**********************************************************
+**Name:     RFM26_SetFieldLength
+**Function: Set packet handler field 1 length, used when the
+            radio enters Rx or Tx by itself (next state)
+**Input:    length,data length
+**Output:   None
+**********************************************************/
+void RFM26_SetFieldLength(uint8_t length);
+
 /**********************************************************
 **Name:     RFM26_ChangeToRxMode
 **Function: Change to rx mode
@@ -227,6 +320,98 @@ void RFM26_ResetTxFifo(void);
 **********************************************************/
 void RFM26_ResetRxFifo(void);
 
+/**********************************************************
+**Name:     RFM26_GetRxFifoCount
+**Function: Bytes waiting in Rx FIFO
+**Input:    None
+**Output:   RX_FIFO_COUNT
+**********************************************************/
+uint8_t RFM26_GetRxFifoCount(void);
+
+/**********************************************************
+**Name:     RFM26_SetRxThreshold
+**Function: Set the Rx FIFO almost full threshold
+**Input:    bytes, RX_FIFO_ALMOST_FULL fires at this count
+**Output:   None
+**********************************************************/
+void RFM26_SetRxThreshold(uint8_t bytes);
+
+/**********************************************************
+**Name:     RFM26_GetPHPending
+**Function: Read and clear all pending interrupts
+**Input:    None
+**Output:   PH_PEND, C_PH_xxx bits
+**********************************************************/
+uint8_t RFM26_GetPHPending(void);
+
+/**********************************************************
+**Name:     RFM26_SetProfile
+**Function: Select the profile the next RFM26_Config sends
+**Input:    profile, C_1_2KHZ_35KHZ..C_9_6KHZ_35KHZ
+**Output:   1 if there is such a profile
+**********************************************************/
+uint8_t RFM26_SetProfile(uint8_t profile);
+
+/**********************************************************
+**Name:     RFM26_SetCal
+**Function: Take a unit's calibration, used from the next
+            RFM26_Config or RFM26_WarmBoot on
+**Input:    c, record, from RFM26_Cal_Load
+**Output:   1 if the record checks and its profile exists
+**********************************************************/
+uint8_t RFM26_SetCal(const RFM26_CAL* c);
+
+/**********************************************************
+**Name:     RFM26_GetCal
+**Function: Calibration in use, to change and save
+**Input:    c, record out, sealed
+**Output:   None
+**********************************************************/
+void RFM26_GetCal(RFM26_CAL* c);
+
+/**********************************************************
+**Name:     RFM26_ApplyCal
+**Function: Write crystal trim and frequency offset to the
+            chip; Rx and Tx started after it use them
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ApplyCal(void);
+
+/**********************************************************
+**Name:     RFM26_GetAfcOffset
+**Function: Frequency error the AFC corrected on the last
+            packet, read before the radio enters Rx again
+**Input:    None
+**Output:   AFC_FREQ_OFFSET, MODEM_FREQ_OFFSET steps; add to
+            the calibration's freq_ofs to take it out
+**********************************************************/
+int16_t RFM26_GetAfcOffset(void);
+
+/**********************************************************
+**Name:     RFM26_Snapshot
+**Function: Read the property groups of rfm26_snap.cpp, one
+            GET_PROPERTY per RFM26_SNAP_CHUNK properties
+**Input:    sink, called with each chunk as it is read
+            ctx, passed to sink
+**Output:   1 all read, 0 no CTS, the snapshot is short
+**********************************************************/
+uint8_t RFM26_Snapshot(RFM26_SNAP_SINK sink, void* ctx);
+
+/**********************************************************
+**Name:     RFM26_WarmBoot
+**Function: Bring up a radio that slept through an MCU reset
+            or deep sleep without a reset pulse, POWER_UP or
+            property download: it is woken to READY and the
+            calibration and profile set by RFM26_SetCal are
+            read back from it. Then RFM26_SetupRx/Tx as after
+            RFM26_Config.
+**Input:    None
+**Output:   1 the radio kept its configuration, 0 it did not
+            (or no calibration was set): call RFM26_Config
+**********************************************************/
+uint8_t RFM26_WarmBoot(void);
+
 /**********************************************************
 **Name:     RFM26_Config
 **Function: Initialize RFM26 & set it entry to standby mode
@@ -235,6 +420,15 @@ void RFM26_ResetRxFifo(void);
 **********************************************************/
 void RFM26_Config(void);
 
+/**********************************************************
+**Name:     RFM26_LoadConfig
+**Function: RFM26_Config once the radio is up, after
+            RFM26_BootStep returned 0
+**Input:    none
+**Output:   none
+**********************************************************/
+void RFM26_LoadConfig(void);
+
 /**********************************************************
 **Name:     RFM26_EntryRx
 **Function: Set RFM26 entry Rx_mode
@@ -243,6 +437,15 @@ void RFM26_Config(void);
 **********************************************************/
 void RFM26_EntryRx(void);
 
+/**********************************************************
+**Name:     RFM26_SetupRx
+**Function: Rx interrupts on, Rx FIFO empty, start Rx; after
+            RFM26_Config or RFM26_WarmBoot
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_SetupRx(void);
+
 /**********************************************************
 **Name:     RFM26_EntryTx
 **Function: Set RFM26 entry Tx_mode
@@ -251,6 +454,15 @@ void RFM26_EntryRx(void);
 **********************************************************/
 void RFM26_EntryTx(void);
 
+/**********************************************************
+**Name:     RFM26_SetupTx
+**Function: Tx interrupts on, Tx FIFO empty; after
+            RFM26_Config or RFM26_WarmBoot
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_SetupTx(void);
+
 /**********************************************************
 **Name:     RFM26_ClearFIFO
 **Function: Change to RxMode from StandbyMode, can clear FIFO buffer
@@ -275,6 +487,45 @@ void RFM26_Sleep(void);
 **********************************************************/
 void RFM26_Standby(void);
 
+/**********************************************************
+**Name:     RFM26_EntryLowPowerRx
+**Function: Duty-cycled Rx: the wake-up timer wakes the radio
+            every period, it sniffs for a preamble and only
+            stays in Rx when one is seen
+**Input:    period_ms, wake-up period
+            sniff_ms, Rx window per wake-up
+**Output:   None
+**********************************************************/
+void RFM26_EntryLowPowerRx(uint16_t period_ms, uint8_t sniff_ms);
+
+/**********************************************************
+**Name:     RFM26_ExitLowPowerRx
+**Function: Stop the wake-up timer and return to continuous Rx
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ExitLowPowerRx(void);
+
+/**********************************************************
+**Name:     RFM26_LongPreamble
+**Function: Tx preamble long enough to hit one sniff window of
+            a duty-cycled receiver, no radio access
+**Input:    period_ms, receiver wake-up period, 0 for normal
+            sniff_ms, receiver Rx window per wake-up
+**Output:   preamble length in bytes, clamped to 255
+**********************************************************/
+uint8_t RFM26_LongPreamble(uint16_t period_ms, uint8_t sniff_ms);
+
+/**********************************************************
+**Name:     RFM26_SetLongPreamble
+**Function: Set a Tx preamble long enough to hit one sniff
+            window of a duty-cycled receiver
+**Input:    period_ms, receiver wake-up period, 0 for normal
+            sniff_ms, receiver Rx window per wake-up
+**Output:   preamble length in bytes, RFM26_LongPreamble
+**********************************************************/
+uint8_t RFM26_SetLongPreamble(uint16_t period_ms, uint8_t sniff_ms);
+
 /**********************************************************
 **Name:     RFM26_ReadRSSI
 **Function: Read the RSSI value
@@ -327,6 +578,223 @@ void RFM26_TestRx(void);
 **********************************************************/
 void RFM26_TestTx(void);
 
+/**********************************************************
+**Name:     RFM26_GetState
+**Function: Read the current radio state
+**Input:    None
+**Output:   CURR_STATE, one of C_STATE_xxx, C_STATE_ERR if
+            the radio did not answer
+**********************************************************/
+uint8_t RFM26_GetState(void);
+
+/**********************************************************
+**Name:     RFM26_Airtime
+**Function: Time on air of a frame at the current rate
+**Input:    len, bytes after the sync word
+**Output:   us
+**********************************************************/
+uint32_t RFM26_Airtime(uint8_t len);
+
+/**********************************************************
+**Name:     RFM26_WaitTxDone
+**Function: Wait, bounded, for a Tx on air to end
+**Input:    None
+**Output:   1 not in Tx, 0 still in Tx after a full Tx FIFO's
+            airtime or the radio does not answer
+**********************************************************/
+uint8_t RFM26_WaitTxDone(void);
+
+/**********************************************************
+**Name:     RFM26_PreloadTx
+**Function: Write Tx FIFO and prepare a Tx that turns around to
+            Rx, START_TX with C_TXCOMPLETE_RX is left to the
+            caller so it can be timed
+**Input:    p_data, data to send
+            num, data length
+            resp_len, length of the frame expected back
+**Output:   None
+**********************************************************/
+void RFM26_PreloadTx(uint8_t* p_data, uint8_t num, uint8_t resp_len);
+
+/**********************************************************
+**Name:     RFM26_StartExchange
+**Function: Send a request and let the radio turn around to Rx
+            in hardware (TXCOMPLETE_STATE = RX), the response
+            is picked up by receive_message()
+**Input:    p_data, request data
+            num, request length
+            resp_len, expected response length
+**Output:   None
+**********************************************************/
+void RFM26_StartExchange(uint8_t* p_data, uint8_t num, uint8_t resp_len);
+
+/**********************************************************
+**Name:     RFM26_ArmResponse
+**Function: Preload a response into Tx FIFO and start Rx, the
+            radio sends it in hardware (RXVALID_STATE = TX) as
+            soon as a valid request is received
+**Input:    p_data, response data
+            num, response length, also the request length
+**Output:   1 armed, 0 the previous response is still on air
+**********************************************************/
+uint8_t RFM26_ArmResponse(uint8_t* p_data, uint8_t num);
+
+/**********************************************************
+**Name:     RFM26_GetRoundTrip
+**Function: Round trip time of the last completed exchange
+**Input:    None
+**Output:   time from START_TX to response read, in us
+**********************************************************/
+uint32_t RFM26_GetRoundTrip(void);
+
+/**********************************************************
+**Name:     RFM26_EnableTimestamp
+**Function: Capture time of every nIRQ falling edge
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_EnableTimestamp(void);
+
+/**********************************************************
+**Name:     RFM26_SetIrqHook
+**Function: Call hook from the nIRQ interrupt, after the
+            timestamp
+**Input:    hook, 0: none
+**Output:   None
+**********************************************************/
+void RFM26_SetIrqHook(void (*hook)(void));
+
+/**********************************************************
+**Name:     RFM26_GetRxInfo
+**Function: Timestamps and RSSI of the last received packet
+**Input:    None
+**Output:   pointer to the packet info
+**********************************************************/
+const RFM26_PKT_INFO* RFM26_GetRxInfo(void);
+
+/**********************************************************
+**Name:     RFM26_GetTxStamp
+**Function: Time of the last send_message() completion
+**Input:    None
+**Output:   nIRQ (PACKET_SENT) time in us, 0 while Tx pending
+**********************************************************/
+uint32_t RFM26_GetTxStamp(void);
+
+/**********************************************************
+**Name:     RFM26_GetLatencyHist
+**Function: Read a receive latency histogram
+**Input:    which, C_LAT_IRQ_TO_FIFO or C_LAT_FIFO_TO_APP
+**Output:   RFM26_LAT_BINS counters
+**********************************************************/
+const uint16_t* RFM26_GetLatencyHist(uint8_t which);
+
+/**********************************************************
+**Name:     RFM26_ClearLatencyHist
+**Function: Clear both receive latency histograms
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ClearLatencyHist(void);
+
+/**********************************************************
+**Name:     RFM26_GetEnergyReport
+**Function: Time and energy per radio state since reset
+**Input:    r, report to fill
+**Output:   None
+**********************************************************/
+void RFM26_GetEnergyReport(RFM26_ENERGY_REPORT* r);
+
+/**********************************************************
+**Name:     RFM26_ClearEnergy
+**Function: Restart energy accounting, the radio state is kept
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ClearEnergy(void);
+
+/**********************************************************
+**Name:     RFM26_SetCapture
+**Function: Log every frame received or sent to a capture,
+            records are written after Rx is restarted
+**Input:    c, capture set up with RFM26_Cap_Init, 0 for none
+**Output:   None
+**********************************************************/
+void RFM26_SetCapture(RFM26_CAPTURE* c);
+
+#if RFM26_INSTRUMENT
+/**********************************************************
+**Name:     RFM26_GetInstr
+**Function: Driver counters and command trace, kept only when
+            built with RFM26_INSTRUMENT 1
+**Input:    None
+**Output:   pointer to the instrumentation
+**********************************************************/
+const RFM26_INSTR* RFM26_GetInstr(void);
+
+/**********************************************************
+**Name:     RFM26_ClearInstr
+**Function: Zero driver counters and command trace
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_ClearInstr(void);
+#endif
+
+/**********************************************************
+**Name:     RFM26_ReceiveSplit
+**Function: Read a received packet as header, then the rest
+            into the buffer place() returns for that header
+**Input:    hdr, hdr_len bytes out
+            hdr_len, 1..RFM26_PKT_LEN
+            place, payload placement, 0 to read the header only
+            ctx, passed to place
+**Output:   packet length, 0 for none
+**********************************************************/
+uint8_t RFM26_ReceiveSplit(uint8_t* hdr, uint8_t hdr_len, RFM26_RX_PLACE place, void* ctx);
+
+/**********************************************************
+**Name:     RFM26_SendSplit
+**Function: Send header and payload as one packet without
+            copying them together, zero padded to RFM26_PKT_LEN
+**Input:    hdr, header data
+            hdr_len, header length
+            p_data, payload data
+            num, payload length, hdr_len+num <= RFM26_PKT_LEN
+**Output:   None
+**********************************************************/
+void RFM26_SendSplit(const uint8_t* hdr, uint8_t hdr_len, const uint8_t* p_data, uint8_t num);
+
+/**********************************************************
+**Name:     RFM26_SetVarLen
+**Function: Length byte framing, payloads of 1..RFM26_VAR_MAX;
+            then RFM26_SetupRx/Tx. RFM26_Config sets it off,
+            off puts back the field 1 length set before on
+**Input:    on, 1 variable length, 0 fixed length packets
+**Output:   None
+**********************************************************/
+void RFM26_SetVarLen(uint8_t on);
+
+/**********************************************************
+**Name:     RFM26_SendVar
+**Function: Send a variable length frame
+**Input:    p_data, payload
+            num, 1..RFM26_VAR_MAX
+**Output:   1 sent, 0 bad length
+**********************************************************/
+uint8_t RFM26_SendVar(const uint8_t* p_data, uint8_t num);
+
+/**********************************************************
+**Name:     RFM26_ReceiveAll
+**Function: On nIRQ, every complete frame in the Rx FIFO to
+            sink; the FIFO is not reset and Rx goes on, so
+            back-to-back frames are all kept. On CRC_ERROR the
+            complete frames are dropped, the bad one is unknown
+**Input:    sink, called per frame
+            ctx, passed to sink
+**Output:   frames handed over, 0 for none
+**********************************************************/
+uint8_t RFM26_ReceiveAll(RFM26_RX_SINK sink, void* ctx);
+
 /**********************************************************/
 uint8_t receive_message(uint8_t* p_data);
 
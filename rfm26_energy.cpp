@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include "rfm26_energy.h"
+
+/************************Description************************
+  Radio energy accounting. The accountant follows the API
+  command stream (every command the driver sends goes through
+  bApi_SendCommand) and tracks the chip state:
+
+    CHANGE_STATE    -> SLEEP / READY / RX, SLEEP is LDC when the
+                       wake-up timer is set for Rx low duty cycle
+    START_RX        -> RX, until a valid packet -> RXVALID_STATE
+                       or a CRC error -> RXINVALID_STATE, as
+                       the driver reads PACKET_RX and CRC_ERROR
+                       (RXTIMEOUT_STATE is kept, no Rx timeout
+                       is set: LDC sniff windows are in LDC)
+    START_TX        -> TX for the airtime of preamble + sync +
+                       length at MODEM_DATA_RATE, then
+                       TXCOMPLETE_STATE
+
+  Because it only sees commands, the same code gives the same
+  numbers on the MCU and behind a host radio emulator.
+**********************************************************/
+
+//Current per state in nA: sleep (32kHz RC on), ready, Rx (module header), Rx inside LDC windows,
+//Tx at 20/17/14/11dBm (RFM26PowerTbl rows)
+const uint32_t RFM26EnergyCurrentTbl[RFM26_ENERGY_STATES] CFG_ROM = {
+  900UL,                                                  // SLEEP
+  1800000UL,                                              // READY
+  14000000UL,                                             // RX
+  14000000UL,                                             // LDC, weighted by WUT_LDC/WUT_M
+  85000000UL,                                             // TX 20dBm
+  50000000UL,                                             // TX 17dBm
+  33000000UL,                                             // TX 14dBm
+  21000000UL,                                             // TX 11dBm
+};
+
+#define C_ENERGY_NAME		6							// asEnergy_Name row, NUL included
+
+static const char asEnergy_Name[RFM26_ENERGY_STATES][C_ENERGY_NAME] CFG_ROM = {
+  "SLEEP", "READY", "RX", "LDC", "TX20", "TX17", "TX14", "TX11"
+};
+
+/**********************************************************
+**Name:     vEnergy_Add
+**Function: Add time to a state
+**********************************************************/
+static void vEnergy_Add(RFM26_ENERGY* e, uint8_t state, uint32_t dt)
+{
+  uint16_t us;
+
+  us = e->us[state] + (uint16_t)(dt % 1000);
+  e->ms[state] += dt / 1000 + us / 1000;
+  e->us[state] = us % 1000;
+}
+
+/**********************************************************
+**Name:     lEnergy_Sat
+**Function: Float to uint32_t, saturated at 0xFFFFFFFF
+**********************************************************/
+static uint32_t lEnergy_Sat(float v)
+{
+  if (v <= 0)
+    return 0;
+  if (v >= 4294967295.0f)
+    return 0xFFFFFFFFUL;
+  return (uint32_t)v;
+}
+
+/**********************************************************
+**Name:     uEnergy_FromChip
+**Function: Map a chip state (C_STATE_xxx) to an account
+**********************************************************/
+static uint8_t uEnergy_FromChip(const RFM26_ENERGY* e, uint8_t chip)
+{
+  switch (chip) {
+  case 0x01:                                              // SLEEP
+    return e->ldc ? C_ENERGY_LDC : C_ENERGY_SLEEP;
+  case 0x07:                                              // TX
+    return C_ENERGY_TX + e->level;
+  case 0x08:                                              // RX
+    return C_ENERGY_RX;
+  default:                                                // SPI_ACTIVE, READY, READY2, TX_TUNE, RX_TUNE
+    return C_ENERGY_READY;
+  }
+}
+
+/**********************************************************
+**Name:     vEnergy_Advance
+**Function: Account time up to now, ending a Tx that is due
+**********************************************************/
+static void vEnergy_Advance(RFM26_ENERGY* e, uint32_t now)
+{
+  if ((int32_t)(now - e->since) < 0)
+    now = e->since;                                       // stale timestamp
+  if (e->state >= C_ENERGY_TX && (int32_t)(now - e->tx_end) >= 0) {
+    vEnergy_Add(e, e->state, e->tx_end - e->since);
+    e->since = e->tx_end;
+    e->state = uEnergy_FromChip(e, e->tx_next);
+  }
+  vEnergy_Add(e, e->state, now - e->since);
+  e->since = now;
+}
+
+/**********************************************************
+**Name:     vEnergy_StartTx
+**Function: Enter Tx for the airtime of one packet
+**********************************************************/
+static void vEnergy_StartTx(RFM26_ENERGY* e, uint16_t len, uint32_t now)
+{
+  uint32_t bytes, bitrate;
+
+  bitrate = e->bitrate ? e->bitrate : 2400;
+  bytes = (uint32_t)e->preamble + 2 + len;                // preamble + sync + payload
+  e->state = C_ENERGY_TX + e->level;
+  e->since = now;
+  e->tx_end = now + bytes * 8000000UL / bitrate;
+  e->tx_packets++;
+}
+
+/**********************************************************
+**Name:     uEnergy_RxEnd
+**Function: Account time up to the end of an Rx and go to the
+            START_RX next state for it
+**Output:   1 if the radio was listening, 0 if not
+**********************************************************/
+static uint8_t uEnergy_RxEnd(RFM26_ENERGY* e, uint32_t at, uint8_t next)
+{
+  vEnergy_Advance(e, at);
+  if (e->state != C_ENERGY_RX && e->state != C_ENERGY_LDC)
+    return 0;
+  if (next == 0x07)
+    vEnergy_StartTx(e, e->field_len, e->since);           // hardware response (RFM26_ArmResponse)
+  else if (next != 0x00)
+    e->state = uEnergy_FromChip(e, next);
+  else
+    e->state = C_ENERGY_RX;                               // no change
+  return 1;
+}
+
+/**********************************************************
+**Name:     vEnergy_Property
+**Function: Follow one property written by SET_PROPERTY
+**********************************************************/
+static void vEnergy_Property(RFM26_ENERGY* e, uint8_t group, uint8_t prop, uint8_t val)
+{
+  switch (((uint16_t)group << 8) | prop) {
+  case 0x0004:                                            // GLOBAL_WUT_CONFIG
+    e->ldc = (val & 0xC0) == 0x40;
+    break;
+  case 0x0005:                                            // GLOBAL_WUT_M_15_8
+    e->wut_m = (e->wut_m & 0x00FF) | ((uint16_t)val << 8);
+    break;
+  case 0x0006:                                            // GLOBAL_WUT_M_7_0
+    e->wut_m = (e->wut_m & 0xFF00) | val;
+    break;
+  case 0x0008:                                            // GLOBAL_WUT_LDC
+    e->wut_ldc = val;
+    break;
+  case 0x1000:                                            // PREAMBLE_TX_LENGTH
+    e->preamble = val;
+    break;
+  case 0x120D:                                            // PKT_FIELD_1_LENGTH_12_8
+    e->field_len = (e->field_len & 0x00FF) | ((uint16_t)(val & 0x1F) << 8);
+    break;
+  case 0x120E:                                            // PKT_FIELD_1_LENGTH_7_0
+    e->field_len = (e->field_len & 0xFF00) | val;
+    break;
+  case 0x2003:                                            // MODEM_DATA_RATE, bps with TXOSR 10x and NCO = Fxtal/10
+    e->bitrate = (e->bitrate & 0x0000FFFFUL) | ((uint32_t)val << 16);
+    break;
+  case 0x2004:
+    e->bitrate = (e->bitrate & 0x00FF00FFUL) | ((uint32_t)val << 8);
+    break;
+  case 0x2005:
+    e->bitrate = (e->bitrate & 0x00FFFF00UL) | val;
+    break;
+  }
+}
+
+/**********************************************************
+**Name:     RFM26_Energy_Init
+**Function: Clear counters, radio assumed in SLEEP
+**Input:    e, energy state
+            now, current time in us
+**Output:   None
+**********************************************************/
+void RFM26_Energy_Init(RFM26_ENERGY* e, uint32_t now)
+{
+  uint8_t i;
+
+  for (i = 0; i < RFM26_ENERGY_STATES; i++) {
+    e->ms[i] = 0;
+    e->us[i] = 0;
+  }
+  e->since = now;
+  e->tx_packets = 0;
+  e->rx_packets = 0;
+  if (e->state >= C_ENERGY_TX)
+    e->tx_end = now;                                      // drop the rest of a running Tx
+}
+
+/**********************************************************
+**Name:     RFM26_Energy_OnCommand
+**Function: Follow an API command sent to the radio: state
+            changes (CHANGE_STATE, START_RX, START_TX) and the
+            properties that set Tx airtime, power and LDC
+**Input:    e, energy state
+            len, command length
+            cmd, command bytes
+            now, current time in us
+**Output:   None
+**********************************************************/
+void RFM26_Energy_OnCommand(RFM26_ENERGY* e, uint8_t len, const uint8_t* cmd, uint32_t now)
+{
+  uint16_t tx_len;
+  uint8_t i;
+
+  if (len == 0)
+    return;
+  switch (cmd[0]) {
+  case 0x02:                                              // POWER_UP
+    vEnergy_Advance(e, now);
+    e->state = C_ENERGY_READY;
+    break;
+  case 0x11:                                              // SET_PROPERTY group, count, start, values
+    for (i = 0; len >= 4 && i < cmd[2] && 4 + i < len; i++)
+      vEnergy_Property(e, cmd[1], cmd[3] + i, cmd[4 + i]);
+    break;
+  case 0x31:                                              // START_TX channel, condition, length
+    if (len < 5)
+      break;
+    vEnergy_Advance(e, now);
+    tx_len = ((uint16_t)cmd[3] << 8) | cmd[4];
+    e->tx_next = cmd[2] >> 4;
+    if (e->tx_next == 0x00)
+      e->tx_next = 0x03;                                  // no change: back to READY
+    vEnergy_StartTx(e, tx_len ? tx_len : e->field_len, now);
+    break;
+  case 0x32:                                              // START_RX channel, condition, length, next states
+    vEnergy_Advance(e, now);
+    e->state = C_ENERGY_RX;
+    e->rx_timeout = len > 5 ? cmd[5] & 0x0F : 0x00;       // 0, no change: stay in RX
+    e->rx_valid = len > 6 ? cmd[6] & 0x0F : 0x00;
+    e->rx_invalid = len > 7 ? cmd[7] & 0x0F : 0x00;
+    break;
+  case 0x34:                                              // CHANGE_STATE
+    if (len < 2 || cmd[1] == 0x00)
+      break;
+    vEnergy_Advance(e, now);
+    if (cmd[1] == 0x07)
+      vEnergy_StartTx(e, e->field_len, now);
+    else
+      e->state = uEnergy_FromChip(e, cmd[1]);
+    break;
+  }
+}
+
+/**********************************************************
+**Name:     RFM26_Energy_OnPacketRx
+**Function: A valid packet ended Rx, go to RXVALID_STATE
+**Input:    e, energy state
+            at, time of the PACKET_RX edge in us
+**Output:   None
+**********************************************************/
+void RFM26_Energy_OnPacketRx(RFM26_ENERGY* e, uint32_t at)
+{
+  if (uEnergy_RxEnd(e, at, e->rx_valid))
+    e->rx_packets++;
+}
+
+/**********************************************************
+**Name:     RFM26_Energy_OnPacketInvalid
+**Function: A packet failed CRC, go to RXINVALID_STATE
+**Input:    e, energy state
+            at, time of the CRC_ERROR edge in us
+**Output:   None
+**********************************************************/
+void RFM26_Energy_OnPacketInvalid(RFM26_ENERGY* e, uint32_t at)
+{
+  uEnergy_RxEnd(e, at, e->rx_invalid);
+}
+
+/**********************************************************
+**Name:     RFM26_Energy_SetLevel
+**Function: Select the Tx current row
+**Input:    e, energy state
+            level, C_20DBM..C_11DBM
+**Output:   None
+**********************************************************/
+void RFM26_Energy_SetLevel(RFM26_ENERGY* e, uint8_t level)
+{
+  if (level < RFM26_ENERGY_STATES - C_ENERGY_TX)
+    e->level = level;
+}
+
+/**********************************************************
+**Name:     RFM26_Energy_Report
+**Function: Close the current interval and compute totals,
+            energies stop at 0xFFFFFFFF uJ instead of wrapping
+**Input:    e, energy state
+            now, current time in us
+            r, report to fill
+**Output:   None
+**********************************************************/
+void RFM26_Energy_Report(RFM26_ENERGY* e, uint32_t now, RFM26_ENERGY_REPORT* r)
+{
+  float na, sleep;
+  uint8_t i;
+
+  vEnergy_Advance(e, now);
+  r->total_uj = 0;
+  sleep = (float)CFG_RD32(&RFM26EnergyCurrentTbl[C_ENERGY_SLEEP]);
+  for (i = 0; i < RFM26_ENERGY_STATES; i++) {
+    na = (float)CFG_RD32(&RFM26EnergyCurrentTbl[i]);
+    if (i == C_ENERGY_LDC)
+      na = sleep + (e->wut_m ? (na - sleep) * e->wut_ldc / e->wut_m : 0);
+    r->ms[i] = e->ms[i];
+    r->uj[i] = lEnergy_Sat(na * RFM26_ENERGY_MV / 1e6f * e->ms[i] / 1e3f);
+    r->total_uj += r->uj[i];
+    if (r->total_uj < r->uj[i])
+      r->total_uj = 0xFFFFFFFFUL;                         // saturate, 4.3kJ is hours of Tx at 20dBm
+  }
+  r->tx_packets = e->tx_packets;
+  r->rx_packets = e->rx_packets;
+  r->uj_per_packet = (r->tx_packets + r->rx_packets) ? r->total_uj / (r->tx_packets + r->rx_packets) : 0;
+}
+
+/**********************************************************
+**Name:     RFM26_Energy_Format
+**Function: Print a report as text, same layout on MCU and host
+**Input:    r, report
+            buf, text buffer
+            size, buffer size (about 300 bytes for all lines)
+**Output:   text length
+**********************************************************/
+uint16_t RFM26_Energy_Format(const RFM26_ENERGY_REPORT* r, char* buf, uint16_t size)
+{
+  char name[C_ENERGY_NAME];
+  uint16_t n;
+  uint8_t i, j;
+  int k;
+
+  n = 0;
+  k = snprintf(buf, size, "state      time_ms   energy_uJ\n");
+  n += (k > 0) ? k : 0;
+  for (i = 0; i < RFM26_ENERGY_STATES && n < size; i++) {
+    if (r->ms[i] == 0)
+      continue;
+    for (j = 0; j < C_ENERGY_NAME; j++)
+      name[j] = CFG_RD(&asEnergy_Name[i][j]);
+    k = snprintf(buf + n, size - n, "%-5s %12lu %11lu\n", name,
+                 (unsigned long)r->ms[i], (unsigned long)r->uj[i]);
+    n += (k > 0) ? k : 0;
+  }
+  if (n < size) {
+    k = snprintf(buf + n, size - n, "total %24lu\npackets tx %lu rx %lu, %lu uJ/packet\n",
+                 (unsigned long)r->total_uj, (unsigned long)r->tx_packets,
+                 (unsigned long)r->rx_packets, (unsigned long)r->uj_per_packet);
+    n += (k > 0) ? k : 0;
+  }
+  return (n < size) ? n : size - 1;
+}
@@ -0,0 +1,131 @@
+#ifndef HopeDuino_26_ENERGY_H_
+#define HopeDuino_26_ENERGY_H_
+
+#include <stdint.h>
+#include "rfm26_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define accounted states, Tx is split by power level (RFM26PowerTbl row)
+#define C_ENERGY_SLEEP		0
+#define C_ENERGY_READY		1							// READY, SPI_ACTIVE, TX_TUNE, RX_TUNE
+#define C_ENERGY_RX			2
+#define C_ENERGY_LDC		3							// sleeping on the wake-up timer with sniff windows
+#define C_ENERGY_TX			4							// + C_20DBM..C_11DBM
+#define RFM26_ENERGY_STATES	8
+
+//Define supply voltage for energy estimates
+#define RFM26_ENERGY_MV		3300
+
+typedef struct
+{
+  uint32_t ms[RFM26_ENERGY_STATES];                       // time per state, whole ms
+  uint16_t us[RFM26_ENERGY_STATES];                       // time per state, remainder
+  uint32_t since;                                         // start of the current state, in us
+  uint32_t tx_end;                                        // expected end of the current Tx, in us
+  uint8_t  state;                                         // current C_ENERGY_xxx
+  uint8_t  tx_next;                                       // chip state after Tx (TXCOMPLETE_STATE)
+  uint8_t  rx_timeout;                                    // chip state after an Rx timeout (RXTIMEOUT_STATE), not followed
+  uint8_t  rx_valid;                                      // chip state after a valid packet (RXVALID_STATE)
+  uint8_t  rx_invalid;                                    // chip state after a CRC error (RXINVALID_STATE)
+  uint8_t  level;                                         // Tx power level row
+  uint8_t  ldc;                                           // wake-up timer in Rx LDC mode
+  uint8_t  preamble;                                      // PREAMBLE_TX_LENGTH, bytes
+  uint16_t field_len;                                     // PKT_FIELD_1_LENGTH
+  uint32_t bitrate;                                       // MODEM_DATA_RATE
+  uint16_t wut_m;                                         // GLOBAL_WUT_M
+  uint8_t  wut_ldc;                                       // GLOBAL_WUT_LDC
+  uint32_t tx_packets;
+  uint32_t rx_packets;
+} RFM26_ENERGY;
+
+typedef struct
+{
+  uint32_t ms[RFM26_ENERGY_STATES];                       // time per state
+  uint32_t uj[RFM26_ENERGY_STATES];                       // energy per state, in uJ, saturates at 0xFFFFFFFF
+  uint32_t total_uj;                                      // saturates as uj
+  uint32_t tx_packets;
+  uint32_t rx_packets;
+  uint32_t uj_per_packet;                                 // total over Tx + Rx packets
+} RFM26_ENERGY_REPORT;
+
+//Current per state in nA, Tx rows follow RFM26PowerTbl, read with CFG_RD32
+extern const uint32_t RFM26EnergyCurrentTbl[RFM26_ENERGY_STATES] CFG_ROM;
+
+/**********************************************************
+**Name:     RFM26_Energy_Init
+**Function: Clear counters, radio assumed in SLEEP
+**Input:    e, energy state
+            now, current time in us
+**Output:   None
+**********************************************************/
+void RFM26_Energy_Init(RFM26_ENERGY* e, uint32_t now);
+
+/**********************************************************
+**Name:     RFM26_Energy_OnCommand
+**Function: Follow an API command sent to the radio: state
+            changes (CHANGE_STATE, START_RX, START_TX) and the
+            properties that set Tx airtime, power and LDC
+**Input:    e, energy state
+            len, command length
+            cmd, command bytes
+            now, current time in us
+**Output:   None
+**********************************************************/
+void RFM26_Energy_OnCommand(RFM26_ENERGY* e, uint8_t len, const uint8_t* cmd, uint32_t now);
+
+/**********************************************************
+**Name:     RFM26_Energy_OnPacketRx
+**Function: A valid packet ended Rx, go to RXVALID_STATE
+**Input:    e, energy state
+            at, time of the PACKET_RX edge in us
+**Output:   None
+**********************************************************/
+void RFM26_Energy_OnPacketRx(RFM26_ENERGY* e, uint32_t at);
+
+/**********************************************************
+**Name:     RFM26_Energy_OnPacketInvalid
+**Function: A packet failed CRC, go to RXINVALID_STATE
+**Input:    e, energy state
+            at, time of the CRC_ERROR edge in us
+**Output:   None
+**********************************************************/
+void RFM26_Energy_OnPacketInvalid(RFM26_ENERGY* e, uint32_t at);
+
+/**********************************************************
+**Name:     RFM26_Energy_SetLevel
+**Function: Select the Tx current row
+**Input:    e, energy state
+            level, C_20DBM..C_11DBM
+**Output:   None
+**********************************************************/
+void RFM26_Energy_SetLevel(RFM26_ENERGY* e, uint8_t level);
+
+/**********************************************************
+**Name:     RFM26_Energy_Report
+**Function: Close the current interval and compute totals,
+            energies stop at 0xFFFFFFFF uJ instead of wrapping
+**Input:    e, energy state
+            now, current time in us
+            r, report to fill
+**Output:   None
+**********************************************************/
+void RFM26_Energy_Report(RFM26_ENERGY* e, uint32_t now, RFM26_ENERGY_REPORT* r);
+
+/**********************************************************
+**Name:     RFM26_Energy_Format
+**Function: Print a report as text, same layout on MCU and host
+**Input:    r, report
+            buf, text buffer
+            size, buffer size (about 300 bytes for all lines)
+**Output:   text length
+**********************************************************/
+uint16_t RFM26_Energy_Format(const RFM26_ENERGY_REPORT* r, char* buf, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,337 @@
+#include <string.h>
+#include "rfm26_fec.h"
+#ifdef ARDUINO
+#include "rfm26_driver.h"
+#endif
+
+/************************Description************************
+  Reed-Solomon forward error correction for one packet.
+
+  Code:    GF(256), primitive polynomial 0x11D, first root
+           alpha^0, shortened to RFM26_FEC_FRAME_LEN bytes
+  Frame:   | data (k bytes) | parity (npar bytes) |
+  Decode:  syndromes, Berlekamp-Massey, Chien search, Forney
+
+  Every GF multiply is two log/exp table reads and an add, no
+  loops over bits, so an 8-bit MCU spends a few thousand cycles
+  on a 21 byte frame. The chip CRC is off in the WDS table; the
+  decoder is the only error check, a frame it cannot correct is
+  dropped instead of passing corrupt data up.
+**********************************************************/
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define FEC_ROM			PROGMEM
+#define FEC_RD(p)		pgm_read_byte(p)
+#else
+#define FEC_ROM
+#define FEC_RD(p)		(*(p))
+#endif
+
+//alpha^i, i = 0..254
+static const uint8_t abFec_Exp[255] FEC_ROM = {
+  0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1D, 0x3A, 0x74, 0xE8, 0xCD, 0x87, 0x13, 0x26,
+  0x4C, 0x98, 0x2D, 0x5A, 0xB4, 0x75, 0xEA, 0xC9, 0x8F, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0,
+  0x9D, 0x27, 0x4E, 0x9C, 0x25, 0x4A, 0x94, 0x35, 0x6A, 0xD4, 0xB5, 0x77, 0xEE, 0xC1, 0x9F, 0x23,
+  0x46, 0x8C, 0x05, 0x0A, 0x14, 0x28, 0x50, 0xA0, 0x5D, 0xBA, 0x69, 0xD2, 0xB9, 0x6F, 0xDE, 0xA1,
+  0x5F, 0xBE, 0x61, 0xC2, 0x99, 0x2F, 0x5E, 0xBC, 0x65, 0xCA, 0x89, 0x0F, 0x1E, 0x3C, 0x78, 0xF0,
+  0xFD, 0xE7, 0xD3, 0xBB, 0x6B, 0xD6, 0xB1, 0x7F, 0xFE, 0xE1, 0xDF, 0xA3, 0x5B, 0xB6, 0x71, 0xE2,
+  0xD9, 0xAF, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0D, 0x1A, 0x34, 0x68, 0xD0, 0xBD, 0x67, 0xCE,
+  0x81, 0x1F, 0x3E, 0x7C, 0xF8, 0xED, 0xC7, 0x93, 0x3B, 0x76, 0xEC, 0xC5, 0x97, 0x33, 0x66, 0xCC,
+  0x85, 0x17, 0x2E, 0x5C, 0xB8, 0x6D, 0xDA, 0xA9, 0x4F, 0x9E, 0x21, 0x42, 0x84, 0x15, 0x2A, 0x54,
+  0xA8, 0x4D, 0x9A, 0x29, 0x52, 0xA4, 0x55, 0xAA, 0x49, 0x92, 0x39, 0x72, 0xE4, 0xD5, 0xB7, 0x73,
+  0xE6, 0xD1, 0xBF, 0x63, 0xC6, 0x91, 0x3F, 0x7E, 0xFC, 0xE5, 0xD7, 0xB3, 0x7B, 0xF6, 0xF1, 0xFF,
+  0xE3, 0xDB, 0xAB, 0x4B, 0x96, 0x31, 0x62, 0xC4, 0x95, 0x37, 0x6E, 0xDC, 0xA5, 0x57, 0xAE, 0x41,
+  0x82, 0x19, 0x32, 0x64, 0xC8, 0x8D, 0x07, 0x0E, 0x1C, 0x38, 0x70, 0xE0, 0xDD, 0xA7, 0x53, 0xA6,
+  0x51, 0xA2, 0x59, 0xB2, 0x79, 0xF2, 0xF9, 0xEF, 0xC3, 0x9B, 0x2B, 0x56, 0xAC, 0x45, 0x8A, 0x09,
+  0x12, 0x24, 0x48, 0x90, 0x3D, 0x7A, 0xF4, 0xF5, 0xF7, 0xF3, 0xFB, 0xEB, 0xCB, 0x8B, 0x0B, 0x16,
+  0x2C, 0x58, 0xB0, 0x7D, 0xFA, 0xE9, 0xCF, 0x83, 0x1B, 0x36, 0x6C, 0xD8, 0xAD, 0x47, 0x8E,
+};
+
+//log_alpha(x), x = 1..255, entry 0 unused
+static const uint8_t abFec_Log[256] FEC_ROM = {
+  0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1A, 0xC6, 0x03, 0xDF, 0x33, 0xEE, 0x1B, 0x68, 0xC7, 0x4B,
+  0x04, 0x64, 0xE0, 0x0E, 0x34, 0x8D, 0xEF, 0x81, 0x1C, 0xC1, 0x69, 0xF8, 0xC8, 0x08, 0x4C, 0x71,
+  0x05, 0x8A, 0x65, 0x2F, 0xE1, 0x24, 0x0F, 0x21, 0x35, 0x93, 0x8E, 0xDA, 0xF0, 0x12, 0x82, 0x45,
+  0x1D, 0xB5, 0xC2, 0x7D, 0x6A, 0x27, 0xF9, 0xB9, 0xC9, 0x9A, 0x09, 0x78, 0x4D, 0xE4, 0x72, 0xA6,
+  0x06, 0xBF, 0x8B, 0x62, 0x66, 0xDD, 0x30, 0xFD, 0xE2, 0x98, 0x25, 0xB3, 0x10, 0x91, 0x22, 0x88,
+  0x36, 0xD0, 0x94, 0xCE, 0x8F, 0x96, 0xDB, 0xBD, 0xF1, 0xD2, 0x13, 0x5C, 0x83, 0x38, 0x46, 0x40,
+  0x1E, 0x42, 0xB6, 0xA3, 0xC3, 0x48, 0x7E, 0x6E, 0x6B, 0x3A, 0x28, 0x54, 0xFA, 0x85, 0xBA, 0x3D,
+  0xCA, 0x5E, 0x9B, 0x9F, 0x0A, 0x15, 0x79, 0x2B, 0x4E, 0xD4, 0xE5, 0xAC, 0x73, 0xF3, 0xA7, 0x57,
+  0x07, 0x70, 0xC0, 0xF7, 0x8C, 0x80, 0x63, 0x0D, 0x67, 0x4A, 0xDE, 0xED, 0x31, 0xC5, 0xFE, 0x18,
+  0xE3, 0xA5, 0x99, 0x77, 0x26, 0xB8, 0xB4, 0x7C, 0x11, 0x44, 0x92, 0xD9, 0x23, 0x20, 0x89, 0x2E,
+  0x37, 0x3F, 0xD1, 0x5B, 0x95, 0xBC, 0xCF, 0xCD, 0x90, 0x87, 0x97, 0xB2, 0xDC, 0xFC, 0xBE, 0x61,
+  0xF2, 0x56, 0xD3, 0xAB, 0x14, 0x2A, 0x5D, 0x9E, 0x84, 0x3C, 0x39, 0x53, 0x47, 0x6D, 0x41, 0xA2,
+  0x1F, 0x2D, 0x43, 0xD8, 0xB7, 0x7B, 0xA4, 0x76, 0xC4, 0x17, 0x49, 0xEC, 0x7F, 0x0C, 0x6F, 0xF6,
+  0x6C, 0xA1, 0x3B, 0x52, 0x29, 0x9D, 0x55, 0xAA, 0xFB, 0x60, 0x86, 0xB1, 0xBB, 0xCC, 0x3E, 0x5A,
+  0xCB, 0x59, 0x5F, 0xB0, 0x9C, 0xA9, 0xA0, 0x51, 0x0B, 0xF5, 0x16, 0xEB, 0x7A, 0x75, 0x2C, 0xD7,
+  0x4F, 0xAE, 0xD5, 0xE9, 0xE6, 0xE7, 0xAD, 0xE8, 0x74, 0xD6, 0xF4, 0xEA, 0xA8, 0x50, 0x58, 0xAF,
+};
+
+static uint8_t gb_FecNpar = 0;                            // parity bytes of the generator below
+static uint8_t ab_FecGenLog[RFM26_FEC_MAX_PARITY];        // log of g(x) coefficients x^0..x^(npar-1), 0xFF: zero
+
+/**********************************************************
+**Name:     uFec_Exp
+**Function: alpha^e for e < 510
+**********************************************************/
+static inline uint8_t uFec_Exp(uint16_t e)
+{
+  if (e >= 255)
+    e -= 255;
+  return FEC_RD(&abFec_Exp[e]);
+}
+
+static inline uint8_t uFec_Log(uint8_t x)
+{
+  return FEC_RD(&abFec_Log[x]);
+}
+
+static inline uint8_t uFec_Mul(uint8_t a, uint8_t b)
+{
+  if (a == 0 || b == 0)
+    return 0;
+  return uFec_Exp((uint16_t)uFec_Log(a) + uFec_Log(b));
+}
+
+/**********************************************************
+**Name:     RFM26_Fec_Init
+**Function: Build the generator polynomial for npar parity
+            bytes, call once before encoding
+**Input:    npar, even, 2..RFM26_FEC_MAX_PARITY
+**Output:   None
+**********************************************************/
+void RFM26_Fec_Init(uint8_t npar)
+{
+  uint8_t g[RFM26_FEC_MAX_PARITY + 1];
+  uint8_t i, j;
+
+  if (npar < 2 || npar > RFM26_FEC_MAX_PARITY)
+    npar = RFM26_FEC_PARITY;
+  memset(g, 0, sizeof(g));
+  g[0] = 1;
+  for (j = 0; j < npar; j++) {                            // g(x) *= (x + alpha^j)
+    for (i = j + 1; i > 0; i--)
+      g[i] = g[i - 1] ^ uFec_Mul(g[i], uFec_Exp(j));
+    g[0] = uFec_Mul(g[0], uFec_Exp(j));
+  }
+  for (i = 0; i < npar; i++)
+    ab_FecGenLog[i] = g[i] ? uFec_Log(g[i]) : 0xFF;
+  gb_FecNpar = npar;
+}
+
+/**********************************************************
+**Name:     RFM26_Fec_Encode
+**Function: Systematic encode: data first, then parity
+**Input:    data, k bytes
+            k, data length, k + parity <= 255
+            frame, k + parity bytes out (may be data)
+**Output:   None
+**********************************************************/
+void RFM26_Fec_Encode(const uint8_t* data, uint8_t k, uint8_t* frame)
+{
+  uint8_t par[RFM26_FEC_MAX_PARITY];
+  uint8_t i, j, fb, lf, npar;
+
+  if (gb_FecNpar == 0)
+    RFM26_Fec_Init(RFM26_FEC_PARITY);
+  npar = gb_FecNpar;
+  memset(par, 0, npar);
+  for (i = 0; i < k; i++) {                               // divide data(x)*x^npar by g(x)
+    fb = data[i] ^ par[0];
+    frame[i] = data[i];
+    if (fb == 0) {
+      memmove(par, par + 1, npar - 1);
+      par[npar - 1] = 0;
+      continue;
+    }
+    lf = uFec_Log(fb);
+    for (j = 0; j < npar - 1; j++)
+      par[j] = par[j + 1] ^ (ab_FecGenLog[npar - 1 - j] == 0xFF ? 0 : uFec_Exp((uint16_t)lf + ab_FecGenLog[npar - 1 - j]));
+    par[npar - 1] = (ab_FecGenLog[0] == 0xFF) ? 0 : uFec_Exp((uint16_t)lf + ab_FecGenLog[0]);
+  }
+  memcpy(frame + k, par, npar);
+}
+
+/**********************************************************
+**Name:     RFM26_Fec_Decode
+**Function: Correct a received frame in place
+**Input:    frame, n bytes, data then parity
+            n, frame length
+**Output:   byte errors corrected, -1 if beyond correction
+**********************************************************/
+int8_t RFM26_Fec_Decode(uint8_t* frame, uint8_t n)
+{
+  uint8_t s[RFM26_FEC_MAX_PARITY];
+  uint8_t c[RFM26_FEC_MAX_PARITY + 1], b[RFM26_FEC_MAX_PARITY + 1], t[RFM26_FEC_MAX_PARITY + 1];
+  uint8_t omega[RFM26_FEC_MAX_PARITY];
+  uint8_t pos[RFM26_FEC_MAX_PARITY / 2], xinv[RFM26_FEC_MAX_PARITY / 2];
+  uint8_t i, j, r, L, m, d, bb, coef, npar, roots, any;
+  uint8_t e, le, v, num, den, p;
+  uint16_t w;
+
+  if (gb_FecNpar == 0)
+    RFM26_Fec_Init(RFM26_FEC_PARITY);
+  npar = gb_FecNpar;
+  if (n <= npar)
+    return -1;
+
+  // Syndromes S_j = r(alpha^j), Horner over the bytes
+  memset(s, 0, npar);
+  for (i = 0; i < n; i++) {
+    v = frame[i];
+    for (j = 0; j < npar; j++)
+      s[j] = (s[j] ? uFec_Exp((uint16_t)uFec_Log(s[j]) + j) : 0) ^ v;
+  }
+  any = 0;
+  for (j = 0; j < npar; j++)
+    any |= s[j];
+  if (any == 0)
+    return 0;
+
+  // Berlekamp-Massey: error locator c(x)
+  memset(c, 0, npar + 1);
+  memset(b, 0, npar + 1);
+  c[0] = 1;
+  b[0] = 1;
+  L = 0;
+  m = 1;
+  bb = 1;
+  for (r = 0; r < npar; r++) {
+    d = s[r];
+    for (i = 1; i <= L; i++)
+      d ^= uFec_Mul(c[i], s[r - i]);
+    if (d == 0) {
+      m++;
+      continue;
+    }
+    coef = uFec_Exp((uint16_t)uFec_Log(d) + 255 - uFec_Log(bb));
+    memcpy(t, c, npar + 1);
+    for (i = m; i <= npar; i++)
+      c[i] ^= uFec_Mul(coef, b[i - m]);
+    if (2 * L <= r) {
+      L = r + 1 - L;
+      memcpy(b, t, npar + 1);
+      bb = d;
+      m = 1;
+    } else {
+      m++;
+    }
+  }
+  if (L > npar / 2)
+    return -1;
+
+  // Chien search over the n positions of the shortened code, byte i is x^(n-1-i)
+  roots = 0;
+  for (i = 0; i < n; i++) {
+    p = n - 1 - i;
+    e = p ? 255 - p : 0;                                  // log of X^-1
+    v = c[0];
+    le = 0;
+    for (j = 1; j <= L; j++) {
+      le = (le + e >= 255) ? le + e - 255 : le + e;
+      if (c[j])
+        v ^= uFec_Exp((uint16_t)uFec_Log(c[j]) + le);
+    }
+    if (v == 0) {
+      if (roots == L)
+        return -1;
+      pos[roots] = i;
+      xinv[roots] = e;
+      roots++;
+    }
+  }
+  if (roots != L)
+    return -1;
+
+  // Forney: error value = X * omega(X^-1) / c'(X^-1), omega = S*c mod x^npar
+  for (i = 0; i < npar; i++) {
+    omega[i] = 0;
+    for (j = 0; j <= i && j <= L; j++)
+      omega[i] ^= uFec_Mul(c[j], s[i - j]);
+  }
+  for (r = 0; r < roots; r++) {
+    e = xinv[r];
+    num = 0;
+    le = 0;
+    for (i = 0; i < npar; i++) {
+      if (omega[i])
+        num ^= uFec_Exp((uint16_t)uFec_Log(omega[i]) + le);
+      le = (le + e >= 255) ? le + e - 255 : le + e;
+    }
+    den = 0;
+    le = 0;                                               // X^-(k-1) for odd k, starts at k = 1
+    for (j = 1; j <= L; j += 2) {
+      if (c[j])
+        den ^= uFec_Exp((uint16_t)uFec_Log(c[j]) + le);
+      le = (le + e >= 255) ? le + e - 255 : le + e;
+      le = (le + e >= 255) ? le + e - 255 : le + e;
+    }
+    if (den == 0)
+      return -1;
+    if (num) {
+      w = (uint16_t)uFec_Log(num) + 255 - uFec_Log(den);  // log of num/den
+      if (w >= 255)
+        w -= 255;
+      frame[pos[r]] ^= uFec_Exp(w + (n - 1 - pos[r]));     // times X
+    }
+  }
+  return (int8_t)roots;
+}
+
+#ifdef ARDUINO
+static RFM26_FEC_STATS gt_FecStats;
+
+/**********************************************************
+**Name:     RFM26_Fec_Send
+**Function: send_message() with RFM26_FEC_DATA_LEN bytes of
+            data protected by RFM26_FEC_PARITY bytes
+**Input:    p_data, RFM26_FEC_DATA_LEN bytes
+**Output:   None
+**********************************************************/
+void RFM26_Fec_Send(uint8_t* p_data)
+{
+  uint8_t buf[RFM26_FEC_FRAME_LEN];
+
+  RFM26_Fec_Encode(p_data, RFM26_FEC_DATA_LEN, buf);
+  send_message(buf, RFM26_FEC_FRAME_LEN);
+}
+
+/**********************************************************
+**Name:     RFM26_Fec_Receive
+**Function: receive_message() with correction
+**Input:    p_data, RFM26_FEC_DATA_LEN bytes out
+**Output:   data length, 0 for none or an uncorrectable frame
+**********************************************************/
+uint8_t RFM26_Fec_Receive(uint8_t* p_data)
+{
+  uint8_t buf[RFM26_FEC_FRAME_LEN];
+  int8_t fixed;
+
+  if (receive_message(buf) == 0)
+    return 0;
+  gt_FecStats.frames++;
+  fixed = RFM26_Fec_Decode(buf, RFM26_FEC_FRAME_LEN);
+  if (fixed < 0) {
+    gt_FecStats.failed++;
+    return 0;
+  }
+  if (fixed > 0) {
+    gt_FecStats.corrected++;
+    gt_FecStats.symbols += fixed;
+  }
+  memcpy(p_data, buf, RFM26_FEC_DATA_LEN);
+  return RFM26_FEC_DATA_LEN;
+}
+
+/**********************************************************
+**Name:     RFM26_Fec_GetStats
+**Function: Decoder counters of RFM26_Fec_Receive()
+**Input:    None
+**Output:   counters
+**********************************************************/
+const RFM26_FEC_STATS* RFM26_Fec_GetStats(void)
+{
+  return &gt_FecStats;
+}
+#endif
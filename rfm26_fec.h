@@ -0,0 +1,83 @@
+#ifndef HopeDuino_26_FEC_H_
+#define HopeDuino_26_FEC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define Reed-Solomon code over GF(256), shortened to one packet
+#define RFM26_FEC_PARITY	8							// parity bytes, corrects RFM26_FEC_PARITY/2 byte errors
+#define RFM26_FEC_MAX_PARITY	16
+#define RFM26_FEC_FRAME_LEN	21							// RFM26_PKT_LEN
+#define RFM26_FEC_DATA_LEN	(RFM26_FEC_FRAME_LEN - RFM26_FEC_PARITY)
+
+typedef struct
+{
+  uint32_t frames;                                        // frames decoded
+  uint32_t corrected;                                     // frames with byte errors fixed
+  uint32_t symbols;                                       // byte errors fixed
+  uint32_t failed;                                        // frames beyond correction, dropped
+} RFM26_FEC_STATS;
+
+/**********************************************************
+**Name:     RFM26_Fec_Init
+**Function: Build the generator polynomial for npar parity
+            bytes, call once before encoding
+**Input:    npar, even, 2..RFM26_FEC_MAX_PARITY
+**Output:   None
+**********************************************************/
+void RFM26_Fec_Init(uint8_t npar);
+
+/**********************************************************
+**Name:     RFM26_Fec_Encode
+**Function: Systematic encode: data first, then parity
+**Input:    data, k bytes
+            k, data length, k + parity <= 255
+            frame, k + parity bytes out (may be data)
+**Output:   None
+**********************************************************/
+void RFM26_Fec_Encode(const uint8_t* data, uint8_t k, uint8_t* frame);
+
+/**********************************************************
+**Name:     RFM26_Fec_Decode
+**Function: Correct a received frame in place
+**Input:    frame, n bytes, data then parity
+            n, frame length
+**Output:   byte errors corrected, -1 if beyond correction
+**********************************************************/
+int8_t RFM26_Fec_Decode(uint8_t* frame, uint8_t n);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Fec_Send
+**Function: send_message() with RFM26_FEC_DATA_LEN bytes of
+            data protected by RFM26_FEC_PARITY bytes
+**Input:    p_data, RFM26_FEC_DATA_LEN bytes
+**Output:   None
+**********************************************************/
+void RFM26_Fec_Send(uint8_t* p_data);
+
+/**********************************************************
+**Name:     RFM26_Fec_Receive
+**Function: receive_message() with correction
+**Input:    p_data, RFM26_FEC_DATA_LEN bytes out
+**Output:   data length, 0 for none or an uncorrectable frame
+**********************************************************/
+uint8_t RFM26_Fec_Receive(uint8_t* p_data);
+
+/**********************************************************
+**Name:     RFM26_Fec_GetStats
+**Function: Decoder counters of RFM26_Fec_Receive()
+**Input:    None
+**Output:   counters
+**********************************************************/
+const RFM26_FEC_STATS* RFM26_Fec_GetStats(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,352 @@
+#include <string.h>
+#include "rfm26_frag.h"
+#ifdef ARDUINO
+#include "rfm26_driver.h"
+#endif
+
+/************************Description************************
+  Fragmentation of messages larger than one packet, and
+  reassembly in any order into buffers the application
+  preallocates.
+
+  Fragment:  | src | msg | index | count | tail | payload |
+
+  Every fragment carries RFM26_FRAG_PAYLOAD bytes at offset
+  index*RFM26_FRAG_PAYLOAD of the message; tail is the number
+  of those that count in the last one. A message is keyed by
+  (src, msg), so one peer can have several in flight.
+
+  The receiver reads the 5 header bytes from Rx FIFO, looks up
+  the slot, and reads the payload from Rx FIFO straight into
+  the slot buffer: no frame buffer, no copy. The sender writes
+  the header and then the payload from the message itself.
+
+  A slot covers the padded last fragment, so cap must be at
+  least count*RFM26_FRAG_PAYLOAD. The smallest free slot that
+  fits is taken. Partial messages are limited per peer and in
+  total reserved bytes, and dropped after timeout_ms without a
+  new fragment. A completed slot belongs to the application
+  until RFM26_Frag_Release(); fragments of it that arrive late
+  are counted as duplicates.
+**********************************************************/
+
+static void vFrag_Free(RFM26_FRAG_RX* rx, RFM26_FRAG_SLOT* s)
+{
+  if (s->state == C_FRAG_PARTIAL)
+    rx->mem_used -= (uint16_t)s->count * RFM26_FRAG_PAYLOAD;
+  s->state = C_FRAG_FREE;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_RxInit
+**Function: Set up reassembly over the application's slots
+**Input:    rx, reassembly state
+            slot, slots with buf and cap filled in
+            slots, slot count
+            mem_cap, bytes partial messages may reserve
+**Output:   None
+**********************************************************/
+void RFM26_Frag_RxInit(RFM26_FRAG_RX* rx, RFM26_FRAG_SLOT* slot, uint8_t slots, uint16_t mem_cap)
+{
+  uint8_t i;
+
+  memset(rx, 0, sizeof(*rx));
+  rx->slot = slot;
+  rx->slots = slots;
+  rx->per_peer = RFM26_FRAG_PER_PEER;
+  rx->mem_cap = mem_cap;
+  rx->timeout_ms = RFM26_FRAG_TIMEOUT_MS;
+  rx->cur = 0xFF;
+  for (i = 0; i < slots; i++)
+    slot[i].state = C_FRAG_FREE;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_Place
+**Function: Find the slot for a fragment header, open one for
+            the first fragment of a message
+**Input:    rx, reassembly state
+            hdr, RFM26_FRAG_HDR_LEN bytes
+            now_ms, time in ms
+**Output:   where the RFM26_FRAG_PAYLOAD payload bytes go,
+            0 to drop the fragment
+**********************************************************/
+uint8_t* RFM26_Frag_Place(RFM26_FRAG_RX* rx, const uint8_t* hdr, uint32_t now_ms)
+{
+  uint8_t peer = hdr[0], msg = hdr[1], idx = hdr[2], count = hdr[3], tail = hdr[4];
+  uint8_t i, found = 0xFF, best = 0xFF, held = 0;
+  uint16_t need;
+  RFM26_FRAG_SLOT* s;
+
+  rx->cur = 0xFF;
+  if (count == 0 || count > RFM26_FRAG_MAX_FRAGS || idx >= count || tail == 0 || tail > RFM26_FRAG_PAYLOAD) {
+    rx->stats.bad++;
+    return 0;
+  }
+  need = (uint16_t)count * RFM26_FRAG_PAYLOAD;
+
+  for (i = 0; i < rx->slots; i++) {
+    s = &rx->slot[i];
+    if (s->state == C_FRAG_FREE) {
+      if (s->cap >= need && (best == 0xFF || s->cap < rx->slot[best].cap))
+        best = i;
+      continue;
+    }
+    if (s->peer != peer)
+      continue;
+    if (s->msg == msg && s->count == count && s->tail == tail) {
+      if (s->state == C_FRAG_DONE) {
+        rx->stats.dup++;                                  // Late copy of a message already handed over
+        return 0;
+      }
+      found = i;
+    } else if (s->msg == msg && s->state == C_FRAG_PARTIAL) {
+      vFrag_Free(rx, s);                                  // Id reused by a new message, the old one is lost
+      if (s->cap >= need && (best == 0xFF || s->cap < rx->slot[best].cap))
+        best = i;
+    } else if (s->state == C_FRAG_PARTIAL) {
+      held++;
+    }
+  }
+
+  if (found == 0xFF) {
+    if (held >= rx->per_peer || best == 0xFF) {
+      rx->stats.no_slot++;
+      return 0;
+    }
+    if (rx->mem_used + need > rx->mem_cap) {
+      rx->stats.over_cap++;
+      return 0;
+    }
+    found = best;
+    s = &rx->slot[found];
+    s->state = C_FRAG_PARTIAL;
+    s->peer = peer;
+    s->msg = msg;
+    s->count = count;
+    s->tail = tail;
+    s->got = 0;
+    memset(s->map, 0, sizeof(s->map));
+    rx->mem_used += need;
+  }
+
+  s = &rx->slot[found];
+  if (s->map[idx >> 3] & (1 << (idx & 7))) {
+    rx->stats.dup++;
+    return 0;
+  }
+  s->heard_ms = now_ms;
+  rx->cur = found;
+  rx->cur_idx = idx;
+  return s->buf + (uint16_t)idx * RFM26_FRAG_PAYLOAD;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_Done
+**Function: Mark the fragment of the last RFM26_Frag_Place as
+            received, once its payload is in place
+**Input:    rx, reassembly state
+**Output:   the slot if this completed a message, else 0
+**********************************************************/
+RFM26_FRAG_SLOT* RFM26_Frag_Done(RFM26_FRAG_RX* rx)
+{
+  RFM26_FRAG_SLOT* s;
+  uint8_t idx = rx->cur_idx;
+
+  if (rx->cur == 0xFF)
+    return 0;
+  s = &rx->slot[rx->cur];
+  rx->cur = 0xFF;
+  s->map[idx >> 3] |= 1 << (idx & 7);
+  if (++s->got < s->count)
+    return 0;
+  vFrag_Free(rx, s);                                      // Gives back the reserved bytes
+  s->state = C_FRAG_DONE;
+  rx->stats.complete++;
+  return s;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_Put
+**Function: Place, copy and mark a whole received frame, for
+            callers that already hold the frame in RAM
+**Input:    rx, reassembly state
+            frame, RFM26_FRAG_FRAME_LEN bytes
+            now_ms, time in ms
+**Output:   the slot if this completed a message, else 0
+**********************************************************/
+RFM26_FRAG_SLOT* RFM26_Frag_Put(RFM26_FRAG_RX* rx, const uint8_t* frame, uint32_t now_ms)
+{
+  uint8_t* dst = RFM26_Frag_Place(rx, frame, now_ms);
+
+  if (dst == 0)
+    return 0;
+  memcpy(dst, frame + RFM26_FRAG_HDR_LEN, RFM26_FRAG_PAYLOAD);
+  return RFM26_Frag_Done(rx);
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_Tick
+**Function: Drop partial messages not heard from for
+            timeout_ms
+**Input:    rx, reassembly state
+            now_ms, time in ms
+**Output:   messages dropped
+**********************************************************/
+uint8_t RFM26_Frag_Tick(RFM26_FRAG_RX* rx, uint32_t now_ms)
+{
+  uint8_t i, n = 0;
+
+  for (i = 0; i < rx->slots; i++) {
+    RFM26_FRAG_SLOT* s = &rx->slot[i];
+    if (s->state == C_FRAG_PARTIAL && (uint32_t)(now_ms - s->heard_ms) >= rx->timeout_ms) {
+      vFrag_Free(rx, s);
+      n++;
+    }
+  }
+  rx->stats.timeout += n;
+  return n;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_Release
+**Function: Give a completed slot back for reassembly
+**Input:    rx, reassembly state
+            s, slot returned by RFM26_Frag_Done
+**Output:   None
+**********************************************************/
+void RFM26_Frag_Release(RFM26_FRAG_RX* rx, RFM26_FRAG_SLOT* s)
+{
+  vFrag_Free(rx, s);
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_Length
+**Function: Length of the message in a completed slot
+**Input:    s, slot
+**Output:   bytes in s->buf
+**********************************************************/
+uint16_t RFM26_Frag_Length(const RFM26_FRAG_SLOT* s)
+{
+  return (uint16_t)(s->count - 1) * RFM26_FRAG_PAYLOAD + s->tail;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_TxInit
+**Function: Start fragmenting a message, data is read in place
+            and must stay valid until the last fragment is sent
+**Input:    tx, fragmenter state
+            src, sender address
+            msg, message id, a new one per message
+            data, message
+            len, 1..RFM26_FRAG_MAX_LEN
+**Output:   fragment count, 0 if len is out of range
+**********************************************************/
+uint8_t RFM26_Frag_TxInit(RFM26_FRAG_TX* tx, uint8_t src, uint8_t msg, const uint8_t* data, uint16_t len)
+{
+  tx->data = data;
+  tx->len = len;
+  tx->src = src;
+  tx->msg = msg;
+  tx->idx = 0;
+  tx->count = 0;
+  if (len == 0 || len > RFM26_FRAG_MAX_LEN)
+    return 0;
+  tx->count = (uint8_t)((len + RFM26_FRAG_PAYLOAD - 1) / RFM26_FRAG_PAYLOAD);
+  return tx->count;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_TxFrag
+**Function: Header and payload of one fragment, for a resend
+**Input:    tx, fragmenter state
+            idx, fragment index
+            hdr, RFM26_FRAG_HDR_LEN bytes out
+            p_data, set to the payload inside the message
+**Output:   payload length, 0 if idx is out of range
+**********************************************************/
+uint8_t RFM26_Frag_TxFrag(const RFM26_FRAG_TX* tx, uint8_t idx, uint8_t* hdr, const uint8_t** p_data)
+{
+  uint8_t tail;
+
+  if (idx >= tx->count)
+    return 0;
+  tail = (uint8_t)(tx->len - (uint16_t)(tx->count - 1) * RFM26_FRAG_PAYLOAD);
+  hdr[0] = tx->src;
+  hdr[1] = tx->msg;
+  hdr[2] = idx;
+  hdr[3] = tx->count;
+  hdr[4] = tail;
+  *p_data = tx->data + (uint16_t)idx * RFM26_FRAG_PAYLOAD;
+  return idx == tx->count - 1 ? tail : RFM26_FRAG_PAYLOAD;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_TxNext
+**Function: Header and payload of the next fragment
+**Input:    tx, fragmenter state
+            hdr, RFM26_FRAG_HDR_LEN bytes out
+            p_data, set to the payload inside the message
+**Output:   payload length, 0 when all were sent
+**********************************************************/
+uint8_t RFM26_Frag_TxNext(RFM26_FRAG_TX* tx, uint8_t* hdr, const uint8_t** p_data)
+{
+  uint8_t n = RFM26_Frag_TxFrag(tx, tx->idx, hdr, p_data);
+
+  if (n)
+    tx->idx++;
+  return n;
+}
+
+#ifdef ARDUINO
+static uint8_t* pbFrag_Place(void* ctx, const uint8_t* hdr, uint8_t hdr_len)
+{
+  (void)hdr_len;
+  return RFM26_Frag_Place((RFM26_FRAG_RX*)ctx, hdr, millis());
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_Send
+**Function: Send a message as fragments, each one written to
+            Tx FIFO from the message itself
+**Input:    src, sender address
+            msg, message id
+            data, message
+            len, 1..RFM26_FRAG_MAX_LEN
+**Output:   fragments sent, 0 if len is out of range; fewer
+            than the message has if a Tx did not end
+**********************************************************/
+uint8_t RFM26_Frag_Send(uint8_t src, uint8_t msg, const uint8_t* data, uint16_t len)
+{
+  RFM26_FRAG_TX tx;
+  uint8_t hdr[RFM26_FRAG_HDR_LEN];
+  const uint8_t* p;
+  uint8_t n, sent = 0;
+
+  RFM26_Frag_TxInit(&tx, src, msg, data, len);
+  while ((n = RFM26_Frag_TxNext(&tx, hdr, &p)) != 0) {
+    if (!RFM26_WaitTxDone())                              // Standby in RFM26_SendSplit would cut the previous one
+      break;
+    RFM26_SendSplit(hdr, RFM26_FRAG_HDR_LEN, p, n);
+    sent++;
+  }
+  return sent;
+}
+
+/**********************************************************
+**Name:     RFM26_Frag_Receive
+**Function: Expire partial messages, then read a received
+            fragment from Rx FIFO straight into its slot
+**Input:    rx, reassembly state
+**Output:   a completed slot, 0 for none; release it after use
+**********************************************************/
+RFM26_FRAG_SLOT* RFM26_Frag_Receive(RFM26_FRAG_RX* rx)
+{
+  uint8_t hdr[RFM26_FRAG_HDR_LEN];
+
+  RFM26_Frag_Tick(rx, millis());
+  if (!RFM26_ReceiveSplit(hdr, RFM26_FRAG_HDR_LEN, pbFrag_Place, rx))
+    return 0;
+  return RFM26_Frag_Done(rx);
+}
+#endif
@@ -0,0 +1,203 @@
+#ifndef HopeDuino_26_FRAG_H_
+#define HopeDuino_26_FRAG_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define fragment: [src][msg][index][count][tail] + RFM26_FRAG_PAYLOAD bytes, the last one zero padded
+#define RFM26_FRAG_FRAME_LEN	21							// RFM26_PKT_LEN
+#define RFM26_FRAG_HDR_LEN		5
+#define RFM26_FRAG_PAYLOAD		(RFM26_FRAG_FRAME_LEN - RFM26_FRAG_HDR_LEN)
+#define RFM26_FRAG_MAX_FRAGS	64							// bitmap size per slot, messages up to 1024 bytes
+#define RFM26_FRAG_MAX_LEN		(RFM26_FRAG_MAX_FRAGS * RFM26_FRAG_PAYLOAD)
+#define RFM26_FRAG_TIMEOUT_MS	5000						// partial message dropped after this long without a fragment
+#define RFM26_FRAG_PER_PEER		4							// partial messages per peer
+
+//Define slot state
+#define C_FRAG_FREE			0
+#define C_FRAG_PARTIAL		1
+#define C_FRAG_DONE			2							// complete, owned by the application until RFM26_Frag_Release
+
+typedef struct
+{
+  uint8_t* buf;                                           // preallocated by the application
+  uint16_t cap;                                           // buf size; fragments land at index*RFM26_FRAG_PAYLOAD
+  uint8_t  state;
+  uint8_t  peer;                                          // src of the message
+  uint8_t  msg;                                           // message id, per peer
+  uint8_t  count;                                         // fragments in the message
+  uint8_t  tail;                                          // bytes in the last fragment
+  uint8_t  got;                                           // fragments received
+  uint32_t heard_ms;                                      // last fragment, for the timeout
+  uint8_t  map[RFM26_FRAG_MAX_FRAGS / 8];                 // bit per fragment received
+} RFM26_FRAG_SLOT;
+
+typedef struct
+{
+  uint32_t complete;                                      // messages reassembled
+  uint32_t timeout;                                       // partial messages dropped
+  uint32_t dup;                                           // fragments already held
+  uint32_t no_slot;                                       // no free slot large enough, or peer at its limit
+  uint32_t over_cap;                                      // would exceed the partial memory cap
+  uint32_t bad;                                           // malformed header
+} RFM26_FRAG_STATS;
+
+typedef struct
+{
+  RFM26_FRAG_SLOT* slot;
+  uint8_t  slots;
+  uint8_t  per_peer;                                      // partial messages one peer may hold
+  uint16_t mem_cap;                                       // bytes all partial messages may reserve
+  uint16_t mem_used;
+  uint16_t timeout_ms;
+  uint8_t  cur;                                           // slot of the fragment being read, 0xFF none
+  uint8_t  cur_idx;
+  RFM26_FRAG_STATS stats;
+} RFM26_FRAG_RX;
+
+typedef struct
+{
+  const uint8_t* data;
+  uint16_t len;
+  uint8_t  src;
+  uint8_t  msg;
+  uint8_t  idx;                                           // next fragment for RFM26_Frag_TxNext
+  uint8_t  count;
+} RFM26_FRAG_TX;
+
+/**********************************************************
+**Name:     RFM26_Frag_RxInit
+**Function: Set up reassembly over the application's slots
+**Input:    rx, reassembly state
+            slot, slots with buf and cap filled in
+            slots, slot count
+            mem_cap, bytes partial messages may reserve
+**Output:   None
+**********************************************************/
+void RFM26_Frag_RxInit(RFM26_FRAG_RX* rx, RFM26_FRAG_SLOT* slot, uint8_t slots, uint16_t mem_cap);
+
+/**********************************************************
+**Name:     RFM26_Frag_Place
+**Function: Find the slot for a fragment header, open one for
+            the first fragment of a message
+**Input:    rx, reassembly state
+            hdr, RFM26_FRAG_HDR_LEN bytes
+            now_ms, time in ms
+**Output:   where the RFM26_FRAG_PAYLOAD payload bytes go,
+            0 to drop the fragment
+**********************************************************/
+uint8_t* RFM26_Frag_Place(RFM26_FRAG_RX* rx, const uint8_t* hdr, uint32_t now_ms);
+
+/**********************************************************
+**Name:     RFM26_Frag_Done
+**Function: Mark the fragment of the last RFM26_Frag_Place as
+            received, once its payload is in place
+**Input:    rx, reassembly state
+**Output:   the slot if this completed a message, else 0
+**********************************************************/
+RFM26_FRAG_SLOT* RFM26_Frag_Done(RFM26_FRAG_RX* rx);
+
+/**********************************************************
+**Name:     RFM26_Frag_Put
+**Function: Place, copy and mark a whole received frame, for
+            callers that already hold the frame in RAM
+**Input:    rx, reassembly state
+            frame, RFM26_FRAG_FRAME_LEN bytes
+            now_ms, time in ms
+**Output:   the slot if this completed a message, else 0
+**********************************************************/
+RFM26_FRAG_SLOT* RFM26_Frag_Put(RFM26_FRAG_RX* rx, const uint8_t* frame, uint32_t now_ms);
+
+/**********************************************************
+**Name:     RFM26_Frag_Tick
+**Function: Drop partial messages not heard from for
+            timeout_ms
+**Input:    rx, reassembly state
+            now_ms, time in ms
+**Output:   messages dropped
+**********************************************************/
+uint8_t RFM26_Frag_Tick(RFM26_FRAG_RX* rx, uint32_t now_ms);
+
+/**********************************************************
+**Name:     RFM26_Frag_Release
+**Function: Give a completed slot back for reassembly
+**Input:    rx, reassembly state
+            s, slot returned by RFM26_Frag_Done
+**Output:   None
+**********************************************************/
+void RFM26_Frag_Release(RFM26_FRAG_RX* rx, RFM26_FRAG_SLOT* s);
+
+/**********************************************************
+**Name:     RFM26_Frag_Length
+**Function: Length of the message in a completed slot
+**Input:    s, slot
+**Output:   bytes in s->buf
+**********************************************************/
+uint16_t RFM26_Frag_Length(const RFM26_FRAG_SLOT* s);
+
+/**********************************************************
+**Name:     RFM26_Frag_TxInit
+**Function: Start fragmenting a message, data is read in place
+            and must stay valid until the last fragment is sent
+**Input:    tx, fragmenter state
+            src, sender address
+            msg, message id, a new one per message
+            data, message
+            len, 1..RFM26_FRAG_MAX_LEN
+**Output:   fragment count, 0 if len is out of range
+**********************************************************/
+uint8_t RFM26_Frag_TxInit(RFM26_FRAG_TX* tx, uint8_t src, uint8_t msg, const uint8_t* data, uint16_t len);
+
+/**********************************************************
+**Name:     RFM26_Frag_TxFrag
+**Function: Header and payload of one fragment, for a resend
+**Input:    tx, fragmenter state
+            idx, fragment index
+            hdr, RFM26_FRAG_HDR_LEN bytes out
+            p_data, set to the payload inside the message
+**Output:   payload length, 0 if idx is out of range
+**********************************************************/
+uint8_t RFM26_Frag_TxFrag(const RFM26_FRAG_TX* tx, uint8_t idx, uint8_t* hdr, const uint8_t** p_data);
+
+/**********************************************************
+**Name:     RFM26_Frag_TxNext
+**Function: Header and payload of the next fragment
+**Input:    tx, fragmenter state
+            hdr, RFM26_FRAG_HDR_LEN bytes out
+            p_data, set to the payload inside the message
+**Output:   payload length, 0 when all were sent
+**********************************************************/
+uint8_t RFM26_Frag_TxNext(RFM26_FRAG_TX* tx, uint8_t* hdr, const uint8_t** p_data);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Frag_Send
+**Function: Send a message as fragments, each one written to
+            Tx FIFO from the message itself
+**Input:    src, sender address
+            msg, message id
+            data, message
+            len, 1..RFM26_FRAG_MAX_LEN
+**Output:   fragments sent, 0 if len is out of range; fewer
+            than the message has if a Tx did not end
+**********************************************************/
+uint8_t RFM26_Frag_Send(uint8_t src, uint8_t msg, const uint8_t* data, uint16_t len);
+
+/**********************************************************
+**Name:     RFM26_Frag_Receive
+**Function: Expire partial messages, then read a received
+            fragment from Rx FIFO straight into its slot
+**Input:    rx, reassembly state
+**Output:   a completed slot, 0 for none; release it after use
+**********************************************************/
+RFM26_FRAG_SLOT* RFM26_Frag_Receive(RFM26_FRAG_RX* rx);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef HopeDuino_26_HAL_H_
+#define HopeDuino_26_HAL_H_
+
+#include <stdint.h>
+
+/************************Description************************
+  Transport under the driver: SPI block transfer, chip select,
+  RESET pin, nIRQ with a timed wait, a microsecond clock and
+  interrupt masking. RFM26_HAL picks the backend when the
+  driver is compiled; the Arduino ones are static inline here,
+  so no call goes through a pointer and an AVR build comes down
+  to port and SPDR accesses.
+
+    RFM26_HAL_AVR      ATmega328P/168 with the default pins:
+                       nCS, RESET and nIRQ0 on port B bits,
+                       hardware SPI through SPDR, the next
+                       byte loaded as soon as one is done
+    RFM26_HAL_ARDUINO  other Arduino cores (ARM included):
+                       digitalWrite/digitalRead and
+                       bSpiTransfer of arduino_spi.cpp
+    RFM26_HAL_HOST     Linux: C functions the host program
+                       links in; host/rfm26_emu.cpp implements
+                       them on the radio emulator
+
+  On Linux the driver source is then the one the MCU runs and
+  the host tools can be profiled as they are, e.g.
+  perf record host/capture_tool replay file.cap.
+**********************************************************/
+
+#define RFM26_HAL_HOST		0
+#define RFM26_HAL_ARDUINO	1
+#define RFM26_HAL_AVR		2
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "arduino_spi.h"
+#endif
+
+//Dirver hardware I/O define
+#define DIO0			4
+#define DIO2			5
+#define RFData 		    6
+#define nIRQ1			7
+#define nIRQ0			8
+#define RESET		    9
+
+//Define nIRQ0 pin change vector of the AVR backend: 1 has rfm26_driver.cpp define PCINT0_vect
+//for the nIRQ timestamps and the scheduler wake up, 0 leaves the vector to the sketch
+//(SoftwareSerial and PinChangeInterrupt define every PCINT vector) and nIRQ0 is only polled
+#ifndef RFM26_PCINT_ISR
+#define RFM26_PCINT_ISR	0
+#endif
+
+#ifndef RFM26_HAL
+#if defined(ARDUINO) && (defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)) && SPI_TYPE && \
+    nCS == 10 && RESET == 9 && nIRQ0 == 8
+#define RFM26_HAL		RFM26_HAL_AVR
+#elif defined(ARDUINO)
+#define RFM26_HAL		RFM26_HAL_ARDUINO
+#else
+#define RFM26_HAL		RFM26_HAL_HOST
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if RFM26_HAL == RFM26_HAL_HOST
+/**********************************************************
+**Name:     RFM26_Hal_Init
+**Function: Pins and SPI: nIRQ0 input, RESET output low (the
+            radio stays powered), nCS high
+**Input:    None
+**Output:   None
+**********************************************************/
+void RFM26_Hal_Init(void);
+
+/**********************************************************
+**Name:     RFM26_Hal_Select, RFM26_Hal_Release
+**Function: nCS low, a transaction starts; nCS high, it ends
+            and the radio runs the command
+**********************************************************/
+void RFM26_Hal_Select(void);
+void RFM26_Hal_Release(void);
+
+/**********************************************************
+**Name:     RFM26_Hal_Xfer
+**Function: One SPI byte out and one in, nCS already low
+**Input:    b, byte out
+**Output:   byte in
+**********************************************************/
+uint8_t RFM26_Hal_Xfer(uint8_t b);
+
+/**********************************************************
+**Name:     RFM26_Hal_Write, RFM26_Hal_Read
+**Function: n SPI bytes out, what comes back dropped; n bytes
+            in, 0x00 sent
+**Input:    p, n, bytes out or in
+**Output:   None
+**********************************************************/
+void RFM26_Hal_Write(const uint8_t* p, uint16_t n);
+void RFM26_Hal_Read(uint8_t* p, uint16_t n);
+
+/**********************************************************
+**Name:     RFM26_Hal_Reset
+**Function: RESET pin, 1 shuts the radio down
+**Input:    level
+**Output:   None
+**********************************************************/
+void RFM26_Hal_Reset(uint8_t level);
+
+/**********************************************************
+**Name:     RFM26_Hal_Irq
+**Function: nIRQ0 level, 0 while an enabled interrupt is
+            pending
+**Input:    None
+**Output:   0 or 1
+**********************************************************/
+uint8_t RFM26_Hal_Irq(void);
+
+/**********************************************************
+**Name:     RFM26_Hal_Attach
+**Function: Call isr on every nIRQ0 falling edge
+**Input:    isr
+**Output:   None
+**********************************************************/
+void RFM26_Hal_Attach(void (*isr)(void));
+
+/**********************************************************
+**Name:     RFM26_Hal_Micros
+**Function: Monotonic clock, wraps at 2^32
+**Input:    None
+**Output:   us
+**********************************************************/
+uint32_t RFM26_Hal_Micros(void);
+
+void RFM26_Hal_DelayUs(uint16_t us);
+void RFM26_Hal_DelayMs(uint16_t ms);
+
+/**********************************************************
+**Name:     RFM26_Hal_IrqOff, RFM26_Hal_IrqOn
+**Function: Keep the nIRQ0 isr out of a critical section
+**********************************************************/
+void RFM26_Hal_IrqOff(void);
+void RFM26_Hal_IrqOn(void);
+
+#else
+
+#if RFM26_HAL == RFM26_HAL_AVR
+#define C_HAL_nCS		_BV(PORTB2)							// D10
+#define C_HAL_RESET		_BV(PORTB1)							// D9
+#define C_HAL_nIRQ0		_BV(PINB0)							// D8
+
+static inline void RFM26_Hal_Select(void)  { PORTB &= ~C_HAL_nCS; }
+static inline void RFM26_Hal_Release(void) { PORTB |= C_HAL_nCS; }
+static inline uint8_t RFM26_Hal_Irq(void)  { return (PINB & C_HAL_nIRQ0) != 0; }
+
+static inline void RFM26_Hal_Reset(uint8_t level)
+{
+  if (level)
+    PORTB |= C_HAL_RESET;
+  else
+    PORTB &= ~C_HAL_RESET;
+}
+
+static inline uint8_t RFM26_Hal_Xfer(uint8_t b)
+{
+  SPDR = b;
+  while (!(SPSR & _BV(SPIF)));
+  return SPDR;
+}
+
+// the next byte goes into SPDR as the last one is done, the loop runs while it shifts
+static inline void RFM26_Hal_Write(const uint8_t* p, uint16_t n)
+{
+  uint8_t b;
+
+  if (!n)
+    return;
+  SPDR = *p++;
+  while (--n) {
+    b = *p++;
+    while (!(SPSR & _BV(SPIF)));
+    SPDR = b;
+  }
+  while (!(SPSR & _BV(SPIF)));
+  (void)SPDR;
+}
+
+static inline void RFM26_Hal_Read(uint8_t* p, uint16_t n)
+{
+  uint8_t b;
+
+  if (!n)
+    return;
+  SPDR = 0x00;
+  while (--n) {
+    while (!(SPSR & _BV(SPIF)));
+    b = SPDR;
+    SPDR = 0x00;
+    *p++ = b;
+  }
+  while (!(SPSR & _BV(SPIF)));
+  *p = SPDR;
+}
+
+// nIRQ0 (D8) is PB0, a pin change interrupt rather than an external interrupt on these parts;
+// PCINT0_vect in rfm26_driver.cpp calls the isr, without RFM26_PCINT_ISR no edge is stamped
+static inline void RFM26_Hal_Attach(void (*isr)(void))
+{
+  (void)isr;
+#if RFM26_PCINT_ISR
+  PCMSK0 |= _BV(PCINT0);                                  // PB0 only, the SPI pins share this port
+  PCIFR = _BV(PCIF0);                                     // Drop a stale edge
+  PCICR |= _BV(PCIE0);
+#endif
+}
+#else
+static inline void RFM26_Hal_Select(void)  { nCS_LOW(); }
+static inline void RFM26_Hal_Release(void) { nCS_HIGH(); }
+static inline uint8_t RFM26_Hal_Irq(void)  { return digitalRead(nIRQ0) != 0; }
+static inline void RFM26_Hal_Reset(uint8_t level) { digitalWrite(RESET, level ? HIGH : LOW); }
+static inline uint8_t RFM26_Hal_Xfer(uint8_t b) { return bSpiTransfer(b); }
+
+static inline void RFM26_Hal_Write(const uint8_t* p, uint16_t n)
+{
+  while (n--)
+    bSpiTransfer(*p++);
+}
+
+static inline void RFM26_Hal_Read(uint8_t* p, uint16_t n)
+{
+  while (n--)
+    *p++ = bSpiTransfer(0x00);
+}
+
+static inline void RFM26_Hal_Attach(void (*isr)(void))
+{
+  attachInterrupt(digitalPinToInterrupt(nIRQ0), isr, FALLING);
+}
+#endif
+
+static inline void RFM26_Hal_Init(void)
+{
+  pinMode(nIRQ0, INPUT);
+  pinMode(RESET, OUTPUT);
+  digitalWrite(RESET, LOW);
+  vSpiInit();
+}
+
+static inline uint32_t RFM26_Hal_Micros(void)        { return micros(); }
+static inline void RFM26_Hal_DelayUs(uint16_t us)    { delayMicroseconds(us); }
+static inline void RFM26_Hal_DelayMs(uint16_t ms)    { delay(ms); }
+static inline void RFM26_Hal_IrqOff(void)            { noInterrupts(); }
+static inline void RFM26_Hal_IrqOn(void)             { interrupts(); }
+#endif
+
+/**********************************************************
+**Name:     RFM26_Hal_WaitIrq
+**Function: Wait for nIRQ0 low without touching SPI
+**Input:    timeout_us
+**Output:   1 nIRQ0 low, 0 timed out
+**********************************************************/
+static inline uint8_t RFM26_Hal_WaitIrq(uint32_t timeout_us)
+{
+  uint32_t t0 = RFM26_Hal_Micros();
+
+  while (RFM26_Hal_Irq())
+    if (RFM26_Hal_Micros() - t0 >= timeout_us)
+      return 0;
+  return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
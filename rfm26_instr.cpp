@@ -0,0 +1,128 @@
+#include <string.h>
+#include "rfm26_instr.h"
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+/************************Description************************
+  Driver instrumentation, counters and a trace of the last
+  RFM26_TRACE_DEPTH API commands.
+
+  The driver calls in here through hooks that exist only when
+  RFM26_INSTRUMENT is 1; with 0 the driver holds no counters,
+  makes no calls, and this file compiles to nothing.
+
+  CTS polls are booked against the command sent last, so the
+  per opcode totals show which commands keep the chip busy:
+  SET_PROPERTY and START_RX wait for the chip, FIFO access and
+  FRR reads never poll.
+**********************************************************/
+
+#if RFM26_INSTRUMENT
+static const uint8_t RFM26InstrOp[RFM26_INSTR_OPS] = {
+  0x00, 0x01, 0x02, 0x10, 0x11, 0x12, 0x13, 0x15,         // NOP, PART_INFO, POWER_UP, FUNC_INFO, SET/GET_PROPERTY, GPIO_PIN_CFG, FIFO_INFO
+  0x17, 0x20, 0x21, 0x22, 0x23, 0x31, 0x32, 0x33,         // IRCAL, GET_INT/PH/MODEM/CHIP_STATUS, START_TX, START_RX, REQUEST_DEVICE_STATE
+  0x34, 0x50, 0x51, 0x53, 0x57, 0x66, 0x77, 0xFF,         // CHANGE_STATE, FRR_A/B/C/D, WRITE_TX_FIFO, READ_RX_FIFO, other
+};
+
+static uint8_t bInstr_Slot(uint8_t op)
+{
+  uint8_t i;
+
+  for (i = 0; i < RFM26_INSTR_OPS - 1; i++)
+    if (RFM26InstrOp[i] == op)
+      return i;
+  return RFM26_INSTR_OPS - 1;
+}
+
+void RFM26_Instr_Clear(RFM26_INSTR* s)
+{
+  memset(s, 0, sizeof(*s));
+}
+
+void RFM26_Instr_OnCmd(RFM26_INSTR* s, uint8_t op, uint8_t arg, uint32_t t_us)
+{
+  RFM26_TRACE* e = &s->trace[s->head++ & (RFM26_TRACE_DEPTH - 1)];
+
+  s->slot = bInstr_Slot(op);
+  s->op_count[s->slot]++;
+  s->cmds++;
+  e->t_us = t_us;
+  e->op = op;
+  e->arg = arg;
+  e->cts = 0;
+}
+
+void RFM26_Instr_OnCts(RFM26_INSTR* s, uint16_t polls, uint8_t ok)
+{
+  RFM26_TRACE* e = &s->trace[(uint8_t)(s->head - 1) & (RFM26_TRACE_DEPTH - 1)];
+
+  s->cts_polls += polls;
+  s->op_cts[s->slot] += polls;
+  if (polls > s->cts_max)
+    s->cts_max = polls;
+  if (!ok)
+    s->cts_timeouts++;
+  if (e->cts != 0xFFFF)
+    e->cts = ok ? (uint16_t)(e->cts + polls) : 0xFFFF;    // a command may be waited on twice
+}
+
+void RFM26_Instr_OnInt(RFM26_INSTR* s, const uint8_t* resp)
+{
+  if (resp[2] & C_INT_PH_CRC_ERROR)
+    s->crc_errors++;
+  if (resp[6] & C_INT_CHIP_FIFO_ERR)
+    s->fifo_errors++;
+  if (resp[6] & C_INT_CHIP_CMD_ERR)
+    s->cmd_errors++;
+}
+
+uint8_t RFM26_Instr_Op(uint8_t slot)
+{
+  return slot < RFM26_INSTR_OPS ? RFM26InstrOp[slot] : 0xFF;
+}
+
+uint8_t RFM26_Instr_Trace(const RFM26_INSTR* s, RFM26_TRACE* out)
+{
+  uint8_t i, n;
+
+  n = s->cmds < RFM26_TRACE_DEPTH ? (uint8_t)s->cmds : RFM26_TRACE_DEPTH;
+  for (i = 0; i < n; i++)
+    out[i] = s->trace[(uint8_t)(s->head - n + i) & (RFM26_TRACE_DEPTH - 1)];
+  return n;
+}
+
+#ifdef ARDUINO
+void RFM26_Instr_Dump(const RFM26_INSTR* s)
+{
+  const RFM26_TRACE* t;
+  uint8_t i, n;
+
+  Serial.print(F("spi bytes "));    Serial.print(s->spi_bytes);
+  Serial.print(F(" xfers "));       Serial.print(s->spi_xfers);
+  Serial.print(F(" cmds "));        Serial.print(s->cmds);
+  Serial.print(F(" cts polls "));   Serial.print(s->cts_polls);
+  Serial.print(F(" max "));         Serial.print(s->cts_max);
+  Serial.print(F(" timeouts "));    Serial.println(s->cts_timeouts);
+  Serial.print(F("fifo errors "));  Serial.print(s->fifo_errors);
+  Serial.print(F(" cmd errors "));  Serial.print(s->cmd_errors);
+  Serial.print(F(" crc errors "));  Serial.print(s->crc_errors);
+  Serial.print(F(" rx missed "));   Serial.println(s->rx_missed);
+  for (i = 0; i < RFM26_INSTR_OPS; i++) {
+    if (!s->op_count[i])
+      continue;
+    Serial.print(F("op "));         Serial.print(RFM26InstrOp[i], HEX);
+    Serial.print(F(" n "));         Serial.print(s->op_count[i]);
+    Serial.print(F(" cts "));       Serial.println(s->op_cts[i]);
+  }
+  n = s->cmds < RFM26_TRACE_DEPTH ? (uint8_t)s->cmds : RFM26_TRACE_DEPTH;
+  for (i = 0; i < n; i++) {                               // oldest first, no copy of the ring on the stack
+    t = &s->trace[(uint8_t)(s->head - n + i) & (RFM26_TRACE_DEPTH - 1)];
+    Serial.print(t->t_us);
+    Serial.print(' ');              Serial.print(t->op, HEX);
+    Serial.print(' ');              Serial.print(t->arg, HEX);
+    Serial.print(' ');              Serial.println(t->cts);
+  }
+}
+#endif
+#endif
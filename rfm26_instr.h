@@ -0,0 +1,124 @@
+#ifndef HopeDuino_26_INSTR_H_
+#define HopeDuino_26_INSTR_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define driver instrumentation: 1 counts SPI traffic, commands and errors and keeps a trace ring,
+//0 compiles every hook in the driver to nothing (430 bytes of RAM when on)
+#ifndef RFM26_INSTRUMENT
+#define RFM26_INSTRUMENT	0
+#endif
+
+//Define trace ring depth, a power of two, 8 bytes per entry
+#define RFM26_TRACE_DEPTH	32
+
+//Define opcode slots: the API commands the driver sends, the last slot counts anything else
+#define RFM26_INSTR_OPS		24
+
+//Define interrupt status bits counted, GET_INT_STATUS response
+#define C_INT_PH_CRC_ERROR	0x08						// PH_PEND
+#define C_INT_CHIP_FIFO_ERR	0x20						// CHIP_PEND, FIFO_UNDERFLOW_OVERFLOW_ERROR
+#define C_INT_CHIP_CMD_ERR	0x08						// CHIP_PEND, CMD_ERROR
+
+typedef struct
+{
+  uint32_t t_us;                                          // command sent
+  uint8_t  op;                                            // API opcode
+  uint8_t  arg;                                           // first argument: property group, state, FIFO length
+  uint16_t cts;                                           // CTS polls it took, 0xFFFF timed out
+} RFM26_TRACE;
+
+typedef struct
+{
+  uint32_t spi_bytes;
+  uint32_t spi_xfers;                                     // nCS low to nCS high
+  uint32_t cmds;
+  uint32_t cts_polls;                                     // READ_CMD_BUFF reads not 0xFF, and the one that was
+  uint16_t cts_max;                                       // most polls one command waited
+  uint16_t cts_timeouts;                                  // no CTS within MAX_CTS_RETRY, the driver carries on
+  uint16_t fifo_errors;                                   // Tx FIFO underflow or Rx FIFO overflow
+  uint16_t cmd_errors;                                    // chip refused a command
+  uint16_t crc_errors;                                    // packets dropped by the packet handler
+  uint16_t rx_missed;                                     // nIRQ edges no receive_message() got to
+  uint16_t op_count[RFM26_INSTR_OPS];                     // commands per opcode slot
+  uint32_t op_cts[RFM26_INSTR_OPS];                       // CTS polls per opcode slot
+  uint8_t  slot;                                          // slot of the last command, for the CTS that follows
+  uint8_t  head;                                          // next trace entry, free running
+  RFM26_TRACE trace[RFM26_TRACE_DEPTH];
+} RFM26_INSTR;
+
+/**********************************************************
+**Name:     RFM26_Instr_Clear
+**Function: Zero counters and trace
+**Input:    s, instrumentation
+**Output:   None
+**********************************************************/
+void RFM26_Instr_Clear(RFM26_INSTR* s);
+
+/**********************************************************
+**Name:     RFM26_Instr_OnCmd
+**Function: Count a command and open its trace entry
+**Input:    s, instrumentation
+            op, API opcode
+            arg, first argument byte
+            t_us, time
+**Output:   None
+**********************************************************/
+void RFM26_Instr_OnCmd(RFM26_INSTR* s, uint8_t op, uint8_t arg, uint32_t t_us);
+
+/**********************************************************
+**Name:     RFM26_Instr_OnCts
+**Function: Book a CTS wait against the last command
+**Input:    s, instrumentation
+            polls, READ_CMD_BUFF reads
+            ok, 0 if it timed out
+**Output:   None
+**********************************************************/
+void RFM26_Instr_OnCts(RFM26_INSTR* s, uint16_t polls, uint8_t ok);
+
+/**********************************************************
+**Name:     RFM26_Instr_OnInt
+**Function: Count errors in a GET_INT_STATUS response
+**Input:    s, instrumentation
+            resp, 8 response bytes
+**Output:   None
+**********************************************************/
+void RFM26_Instr_OnInt(RFM26_INSTR* s, const uint8_t* resp);
+
+/**********************************************************
+**Name:     RFM26_Instr_Op
+**Function: Opcode of a slot
+**Input:    slot, 0..RFM26_INSTR_OPS-1
+**Output:   opcode, 0xFF for the slot of other opcodes
+**********************************************************/
+uint8_t RFM26_Instr_Op(uint8_t slot);
+
+/**********************************************************
+**Name:     RFM26_Instr_Trace
+**Function: Copy the trace, oldest entry first
+**Input:    s, instrumentation
+            out, RFM26_TRACE_DEPTH entries
+**Output:   entries copied
+**********************************************************/
+uint8_t RFM26_Instr_Trace(const RFM26_INSTR* s, RFM26_TRACE* out);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Instr_Dump
+**Function: Print counters and trace to Serial; blocks while
+            the text goes out, for use on demand
+**Input:    s, instrumentation
+**Output:   None
+**********************************************************/
+void RFM26_Instr_Dump(const RFM26_INSTR* s);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
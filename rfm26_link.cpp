@@ -0,0 +1,237 @@
+#include "rfm26_link.h"
+#include "rfm26_energy.h"
+
+/************************Description************************
+  Link adaptation. Both ends estimate the path loss of the link
+  from the RSSI of every frame and the Tx power the sender puts
+  in the link header; the RSSI each side heard is fed back in
+  the next frame, so both directions are measured.
+
+  Per link the initiator picks the rate row, each side picks its
+  own power row: the pair with the least Tx energy per bit that
+  keeps RFM26_LINK_MARGIN_DB above the sensitivity of the rate,
+  plus RFM26_LINK_LOSS_DB for every recent loss. A new rate is
+  proposed in a request at the old rate; the responder switches
+  after its response, the initiator when the response arrives.
+  If either side misses that step the link breaks, the initiator
+  falls back after RFM26_LINK_FAILS losses and the responder
+  after RFM26_LINK_SILENCE_MS, both to the base rate.
+**********************************************************/
+
+const int8_t RFM26LinkPowerDbm[RFM26_LINK_POWERS] = { 20, 17, 14, 11 };
+const uint16_t RFM26LinkBitrate[RFM26_LINK_RATES] = { 1200, 2400, 4800, 9600 };
+//Same 150KHz Rx filter for all rates, every doubling costs 3dB of Eb/N0
+const int8_t RFM26LinkSensDbm[RFM26_LINK_RATES] = { -110, -107, -104, -101 };
+
+/**********************************************************
+**Name:     uLink_Losses
+**Function: Lost exchanges among the last 8
+**********************************************************/
+static uint8_t uLink_Losses(const RFM26_LINK* l)
+{
+  uint8_t bits = ~(uint8_t)l->history;
+  uint8_t n = 0;
+
+  while (bits) {
+    n += bits & 1;
+    bits >>= 1;
+  }
+  return n;
+}
+
+/**********************************************************
+**Name:     vLink_AddLoss
+**Function: Filter one path loss sample
+**********************************************************/
+static void vLink_AddLoss(RFM26_LINK* l, int16_t loss_db)
+{
+  int16_t q4 = loss_db * 16;
+
+  if (l->loss_q4 == 0)
+    l->loss_q4 = q4;
+  else
+    l->loss_q4 += (q4 - l->loss_q4) / 4;
+}
+
+/**********************************************************
+**Name:     uLink_Choose
+**Function: Least energy rate and power that keep the margin
+**Input:    l, link state
+            fixed_rate, 1: keep l->rate (responder)
+**Output:   1 if rate or power changed
+**********************************************************/
+static uint8_t uLink_Choose(RFM26_LINK* l, uint8_t fixed_rate)
+{
+  int16_t loss, need, margin;
+  uint32_t cost, best_cost;
+  uint8_t r, p, best_r, best_p, changed;
+
+  if (l->loss_q4 == 0)
+    return 0;
+  loss = (l->loss_q4 + 8) / 16;
+  need = RFM26_LINK_MARGIN_DB + RFM26_LINK_LOSS_DB * uLink_Losses(l);
+
+  best_r = l->rate;
+  best_p = RFM26_LINK_MAX_POWER;
+  best_cost = 0xFFFFFFFFUL;
+  for (r = 0; r < RFM26_LINK_RATES; r++) {
+    if (fixed_rate && r != l->rate)
+      continue;
+    if (r > l->rate && l->hold)
+      continue;
+    for (p = 0; p < RFM26_LINK_POWERS; p++) {
+      margin = RFM26LinkPowerDbm[p] - loss - RFM26LinkSensDbm[r];
+      if (margin < need + (r > l->rate ? RFM26_LINK_HYST_DB : 0))
+        continue;
+      cost = CFG_RD32(&RFM26EnergyCurrentTbl[C_ENERGY_TX + p]) / RFM26LinkBitrate[r];
+      if (cost < best_cost) {                              // r runs slow to fast: a tie keeps the slower rate, more margin
+        best_cost = cost;
+        best_r = r;
+        best_p = p;
+      }
+    }
+  }
+  if (best_cost == 0xFFFFFFFFUL)                          // out of range: slowest rate we may use, full power
+    best_r = fixed_rate ? l->rate : 0;
+
+  changed = (best_p != l->power);
+  l->power = best_p;
+  if (!fixed_rate)
+    l->next = best_r;                                     // proposed, taken when the peer answers
+  return changed;
+}
+
+/**********************************************************
+**Name:     RFM26_Link_Init
+**Function: Start a link at the base rate and full power
+**Input:    l, link state
+            role, C_LINK_INITIATOR or C_LINK_RESPONDER
+**Output:   None
+**********************************************************/
+void RFM26_Link_Init(RFM26_LINK* l, uint8_t role)
+{
+  l->loss_q4 = 0;
+  l->history = 0xFFFF;
+  l->heard_ms = 0;
+  l->role = role;
+  l->rate = RFM26_LINK_BASE_RATE;
+  l->next = RFM26_LINK_BASE_RATE;
+  l->power = RFM26_LINK_MAX_POWER;
+  l->fails = 0;
+  l->hold = 0;
+  l->rssi = 0;
+}
+
+/**********************************************************
+**Name:     RFM26_Link_RssiDbm
+**Function: Convert a latched RSSI (0.5dB steps) to dBm
+**Input:    raw, RFM26_ReadRSSI() value
+**Output:   dBm
+**********************************************************/
+int16_t RFM26_Link_RssiDbm(uint8_t raw)
+{
+  return (int16_t)(raw / 2) - 0x40 - 70;                  // MODEM_RSSI_COMP = 0x40
+}
+
+/**********************************************************
+**Name:     RFM26_Link_BuildHeader
+**Function: Write the link header of an outgoing frame
+**Input:    l, link state
+            hdr, RFM26_LINK_HDR_LEN bytes
+**Output:   None
+**********************************************************/
+void RFM26_Link_BuildHeader(const RFM26_LINK* l, uint8_t* hdr)
+{
+  hdr[0] = (uint8_t)((l->power << 6) | (l->rate << 4) | (l->next << 2));
+  hdr[1] = l->rssi;
+}
+
+/**********************************************************
+**Name:     RFM26_Link_OnFrame
+**Function: Learn from a frame of the peer: path loss both ways
+            (own RSSI and the RSSI the peer fed back); on the
+            responder take the rate the initiator proposes
+            and pick the Tx power
+**Input:    l, link state
+            hdr, link header of the frame
+            rssi, latched RSSI of the frame
+            now_ms, current time
+**Output:   1 if rate or power changed, apply with RFM26_SetLink
+**********************************************************/
+uint8_t RFM26_Link_OnFrame(RFM26_LINK* l, const uint8_t* hdr, uint8_t rssi, uint32_t now_ms)
+{
+  uint8_t next, changed = 0;
+
+  l->heard_ms = now_ms;
+  l->rssi = rssi;
+  vLink_AddLoss(l, RFM26LinkPowerDbm[hdr[0] >> 6] - RFM26_Link_RssiDbm(rssi));
+  if (hdr[1] != 0)
+    vLink_AddLoss(l, RFM26LinkPowerDbm[l->power] - RFM26_Link_RssiDbm(hdr[1]));
+
+  if (l->role == C_LINK_RESPONDER) {
+    next = (hdr[0] >> 2) & 0x03;
+    if (next != l->rate) {
+      l->rate = next;
+      l->next = next;
+      changed = 1;
+    }
+    changed |= uLink_Choose(l, 1);
+  }
+  return changed;
+}
+
+/**********************************************************
+**Name:     RFM26_Link_OnExchange
+**Function: Initiator: outcome of one request, then choose rate
+            and power for the next one. A delivered exchange
+            confirms a proposed rate; lost ones raise power and
+            fall back to the base rate after RFM26_LINK_FAILS
+**Input:    l, link state
+            delivered, 1: response received
+**Output:   1 if rate or power changed, apply with RFM26_SetLink
+**********************************************************/
+uint8_t RFM26_Link_OnExchange(RFM26_LINK* l, uint8_t delivered)
+{
+  uint8_t rate = l->rate, power = l->power;
+
+  l->history = (l->history << 1) | (delivered ? 1 : 0);
+  if (delivered) {
+    l->fails = 0;
+    l->rate = l->next;                                    // responder took the proposal with this request
+    if (l->hold)
+      l->hold--;
+    uLink_Choose(l, 0);
+  } else if (++l->fails >= RFM26_LINK_FAILS) {
+    l->fails = 0;
+    l->rate = RFM26_LINK_BASE_RATE;
+    l->next = RFM26_LINK_BASE_RATE;
+    l->power = RFM26_LINK_MAX_POWER;
+    l->hold = RFM26_LINK_HOLD;
+  } else {
+    if (l->power > RFM26_LINK_MAX_POWER)
+      l->power--;                                         // one step up, the loss penalty holds it there
+    l->next = l->rate;                                    // don't stack a new proposal on a lost one
+  }
+  return rate != l->rate || power != l->power;
+}
+
+/**********************************************************
+**Name:     RFM26_Link_Tick
+**Function: Responder: back to the base rate and full power when
+            nothing was heard for RFM26_LINK_SILENCE_MS
+**Input:    l, link state
+            now_ms, current time
+**Output:   1 if rate or power changed, apply with RFM26_SetLink
+**********************************************************/
+uint8_t RFM26_Link_Tick(RFM26_LINK* l, uint32_t now_ms)
+{
+  if (l->role != C_LINK_RESPONDER || now_ms - l->heard_ms < RFM26_LINK_SILENCE_MS)
+    return 0;
+  l->heard_ms = now_ms;
+  if (l->rate == RFM26_LINK_BASE_RATE && l->power == RFM26_LINK_MAX_POWER)
+    return 0;
+  l->rate = RFM26_LINK_BASE_RATE;
+  l->next = RFM26_LINK_BASE_RATE;
+  l->power = RFM26_LINK_MAX_POWER;
+  return 1;
+}
@@ -0,0 +1,116 @@
+#ifndef HopeDuino_26_LINK_H_
+#define HopeDuino_26_LINK_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define link roles: the initiator owns the rate of a link, each side owns its power
+#define C_LINK_INITIATOR	0
+#define C_LINK_RESPONDER	1
+
+//Define rate and power rows, same as C_1_2KHZ_35KHZ.. and C_20DBM.. in rfm26_driver.h
+#define RFM26_LINK_RATES	4
+#define RFM26_LINK_POWERS	4
+#define RFM26_LINK_BASE_RATE	1							// 2.4Kbps, the WDS profile every node starts with
+#define RFM26_LINK_MAX_POWER	0							// 20dBm
+
+//Define controller tuning
+#define RFM26_LINK_MARGIN_DB	8							// fade margin kept above sensitivity
+#define RFM26_LINK_HYST_DB		3							// extra margin before going faster
+#define RFM26_LINK_LOSS_DB		3							// extra margin per loss in the last 8 exchanges
+#define RFM26_LINK_FAILS		3							// lost exchanges in a row before falling back
+#define RFM26_LINK_HOLD			16							// exchanges at base rate after a fallback
+#define RFM26_LINK_SILENCE_MS	10000UL						// responder falls back when the initiator goes quiet
+
+//Define link header at the start of each payload
+#define RFM26_LINK_HDR_LEN		2							// [power<<6 | rate<<4 | next<<2] [RSSI heard, 0: none]
+
+typedef struct
+{
+  int16_t  loss_q4;                                       // path loss estimate, dB*16, 0: not measured yet
+  uint16_t history;                                       // one bit per exchange, 1: delivered
+  uint32_t heard_ms;                                      // last frame from the peer
+  uint8_t  role;                                          // C_LINK_INITIATOR or C_LINK_RESPONDER
+  uint8_t  rate;                                          // rate row in use on the link
+  uint8_t  next;                                          // rate row proposed to the peer, == rate when none
+  uint8_t  power;                                         // our Tx power row
+  uint8_t  fails;                                         // lost exchanges in a row
+  uint8_t  hold;                                          // exchanges before a faster rate may be proposed
+  uint8_t  rssi;                                          // RSSI of the last frame heard, fed back to the peer
+} RFM26_LINK;
+
+//Per row: Tx power in dBm, bit rate, sensitivity in dBm
+extern const int8_t RFM26LinkPowerDbm[RFM26_LINK_POWERS];
+extern const uint16_t RFM26LinkBitrate[RFM26_LINK_RATES];
+extern const int8_t RFM26LinkSensDbm[RFM26_LINK_RATES];
+
+/**********************************************************
+**Name:     RFM26_Link_Init
+**Function: Start a link at the base rate and full power
+**Input:    l, link state
+            role, C_LINK_INITIATOR or C_LINK_RESPONDER
+**Output:   None
+**********************************************************/
+void RFM26_Link_Init(RFM26_LINK* l, uint8_t role);
+
+/**********************************************************
+**Name:     RFM26_Link_RssiDbm
+**Function: Convert a latched RSSI (0.5dB steps) to dBm
+**Input:    raw, RFM26_ReadRSSI() value
+**Output:   dBm
+**********************************************************/
+int16_t RFM26_Link_RssiDbm(uint8_t raw);
+
+/**********************************************************
+**Name:     RFM26_Link_BuildHeader
+**Function: Write the link header of an outgoing frame
+**Input:    l, link state
+            hdr, RFM26_LINK_HDR_LEN bytes
+**Output:   None
+**********************************************************/
+void RFM26_Link_BuildHeader(const RFM26_LINK* l, uint8_t* hdr);
+
+/**********************************************************
+**Name:     RFM26_Link_OnFrame
+**Function: Learn from a frame of the peer: path loss both ways
+            (own RSSI and the RSSI the peer fed back); on the
+            responder take the rate the initiator proposes
+            and pick the Tx power
+**Input:    l, link state
+            hdr, link header of the frame
+            rssi, latched RSSI of the frame
+            now_ms, current time
+**Output:   1 if rate or power changed, apply with RFM26_SetLink
+**********************************************************/
+uint8_t RFM26_Link_OnFrame(RFM26_LINK* l, const uint8_t* hdr, uint8_t rssi, uint32_t now_ms);
+
+/**********************************************************
+**Name:     RFM26_Link_OnExchange
+**Function: Initiator: outcome of one request, then choose rate
+            and power for the next one. A delivered exchange
+            confirms a proposed rate; lost ones raise power and
+            fall back to the base rate after RFM26_LINK_FAILS
+**Input:    l, link state
+            delivered, 1: response received
+**Output:   1 if rate or power changed, apply with RFM26_SetLink
+**********************************************************/
+uint8_t RFM26_Link_OnExchange(RFM26_LINK* l, uint8_t delivered);
+
+/**********************************************************
+**Name:     RFM26_Link_Tick
+**Function: Responder: back to the base rate and full power when
+            nothing was heard for RFM26_LINK_SILENCE_MS
+**Input:    l, link state
+            now_ms, current time
+**Output:   1 if rate or power changed, apply with RFM26_SetLink
+**********************************************************/
+uint8_t RFM26_Link_Tick(RFM26_LINK* l, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
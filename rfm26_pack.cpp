@@ -0,0 +1,425 @@
+#include <string.h>
+#include "rfm26_pack.h"
+#ifdef ARDUINO
+#include "rfm26_driver.h"
+#endif
+
+/************************Description************************
+  Telemetry packing: as many fixed size records as fit in one
+  RFM26_PKT_LEN packet, so the radio sends fewer packets.
+
+  Frame:  | mode<<7 | seq<<4 | count | record 1 | ... | 0 pad |
+
+  C_PACK_DELTA  record as 16 bit little endian fields: a bit
+                mask of the fields that changed, then for each
+                the zigzag difference to the previous record,
+                7 bits per varint byte
+  C_PACK_LZ     tokens over [dictionary | previous record |
+                current record]:
+                  0lllllll          l+1 literal bytes follow
+                  1lllllll dddddddd copy l+3 bytes, d+1 back
+
+  The first record of a frame is coded against the last record
+  of the previous frame. Every RFM26_PACK_KEY_INTERVAL frames a
+  key frame (seq 0) starts from zeros, so a lost frame costs at
+  most the rest of its chain. Both modes code every record as it
+  is added; the frame goes out in the mode that fit the most.
+  RAM is the two candidate frames plus one record.
+**********************************************************/
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define PACK_ROM		PROGMEM
+#define PACK_RD(p)		pgm_read_byte(p)
+#else
+#define PACK_ROM
+#define PACK_RD(p)		(*(p))
+#endif
+
+const uint8_t RFM26PackDict[] PACK_ROM = {
+  'H','o','p','e','R','F',' ','R','F','M',' ','C','O','B','R','F','M','2','6','-','S',
+  'H','o','p','e','R','F',' ','R','F','M','2','6',' ','A','C','K',' ',' ',' ',' ',
+  '0','1','2','3','4','5','6','7','8','9',
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xFF, 0xFF, 0xFF, 0xFF,
+};
+const uint8_t RFM26PackDictLen = sizeof(RFM26PackDict);
+
+/**********************************************************
+**Name:     uPack_Byte
+**Function: Byte v of the LZ window [dict | prev | cur]
+**********************************************************/
+static uint8_t uPack_Byte(const RFM26_PACK* p, const uint8_t* cur, uint16_t v)
+{
+  if (v < p->dict_len)
+    return PACK_RD(&p->dict[v]);
+  v -= p->dict_len;
+  if (v < p->rec_len)
+    return p->prev[v];
+  return cur[v - p->rec_len];
+}
+
+static uint16_t wPack_Field(const uint8_t* rec, uint8_t len, uint8_t f)
+{
+  uint16_t w = rec[2 * f];
+
+  if (2 * f + 1 < len)
+    w |= (uint16_t)rec[2 * f + 1] << 8;
+  return w;
+}
+
+/**********************************************************
+**Name:     uPack_Delta
+**Function: Code a record in C_PACK_DELTA
+**Output:   bytes written, 0xFF if more than room
+**********************************************************/
+static uint8_t uPack_Delta(const RFM26_PACK* p, const uint8_t* rec, uint8_t* out, uint8_t room)
+{
+  uint8_t f, fields, n;
+  uint16_t z;
+  int16_t d;
+
+  fields = (p->rec_len + 1) / 2;
+  n = (fields + 7) / 8;                                   // change mask
+  if (n > room)
+    return 0xFF;
+  memset(out, 0, n);
+  for (f = 0; f < fields; f++) {
+    d = (int16_t)(wPack_Field(rec, p->rec_len, f) - wPack_Field(p->prev, p->rec_len, f));
+    if (d == 0)
+      continue;
+    out[f / 8] |= 1 << (f & 7);
+    z = (uint16_t)(((uint16_t)d << 1) ^ (uint16_t)(d >> 15));   // zigzag: small +/- -> small
+    do {
+      if (n >= room)
+        return 0xFF;
+      out[n++] = (uint8_t)(z & 0x7F) | (z > 0x7F ? 0x80 : 0);
+      z >>= 7;
+    } while (z);
+  }
+  return n;
+}
+
+/**********************************************************
+**Name:     uPack_Lz
+**Function: Code a record in C_PACK_LZ, greedy longest match
+**Output:   bytes written, 0xFF if more than room
+**********************************************************/
+static uint8_t uPack_Lz(const RFM26_PACK* p, const uint8_t* rec, uint8_t* out, uint8_t room)
+{
+  uint16_t base, pos, lo, v;
+  uint8_t i, n, lit, lit_at, l, max, best, best_d;
+
+  base = p->dict_len + p->rec_len;
+  i = 0;
+  n = 0;
+  lit = 0;
+  lit_at = 0;
+  while (i < p->rec_len) {
+    pos = base + i;
+    lo = pos > 256 ? pos - 256 : 0;
+    max = p->rec_len - i;
+    best = 0;
+    best_d = 0;
+    if (max >= 3) {
+      for (v = lo; v < pos; v++) {
+        for (l = 0; l < max && uPack_Byte(p, rec, v + l) == rec[i + l]; l++);
+        if (l >= 3 && l >= best) {                        // >= keeps the nearest
+          best = l;
+          best_d = (uint8_t)(pos - v - 1);
+        }
+      }
+    }
+    if (best && lit) {
+      if (n + 1 + lit > room)
+        return 0xFF;
+      out[n++] = lit - 1;
+      memcpy(out + n, rec + lit_at, lit);
+      n += lit;
+      lit = 0;
+    }
+    if (best) {
+      if (n + 2 > room)
+        return 0xFF;
+      out[n++] = 0x80 | (best - 3);
+      out[n++] = best_d;
+      i += best;
+    } else {
+      if (lit == 0)
+        lit_at = i;
+      lit++;
+      i++;
+    }
+  }
+  if (lit) {
+    if (n + 1 + lit > room)
+      return 0xFF;
+    out[n++] = lit - 1;
+    memcpy(out + n, rec + lit_at, lit);
+    n += lit;
+  }
+  return n;
+}
+
+/**********************************************************
+**Name:     vPack_Reset
+**Function: Start an empty frame
+**********************************************************/
+static void vPack_Reset(RFM26_PACK* p)
+{
+  uint8_t m;
+
+  if (p->seq == 0)
+    memset(p->prev, 0, sizeof(p->prev));                  // key frame
+  for (m = 0; m < RFM26_PACK_MODES; m++) {
+    p->len[m] = 1;
+    p->count[m] = 0;
+  }
+  p->full = 0;
+}
+
+/**********************************************************
+**Name:     RFM26_Pack_Init
+**Function: Set up a packer (or unpacker) for fixed size records
+**Input:    p, packer state
+            rec_len, record length, 1..RFM26_PACK_MAX_REC
+            dict, static dictionary, 0 for RFM26PackDict
+            dict_len, dictionary length, at most 200
+**Output:   None
+**********************************************************/
+void RFM26_Pack_Init(RFM26_PACK* p, uint8_t rec_len, const uint8_t* dict, uint8_t dict_len)
+{
+  if (rec_len == 0 || rec_len > RFM26_PACK_MAX_REC)
+    rec_len = RFM26_PACK_MAX_REC;
+  if (dict == 0) {
+    dict = RFM26PackDict;
+    dict_len = RFM26PackDictLen;
+  }
+  p->rec_len = rec_len;
+  p->dict = dict;
+  p->dict_len = dict_len > 200 ? 200 : dict_len;          // every byte within 256 back
+  p->seq = 0;
+  p->chain = 0;
+  vPack_Reset(p);
+}
+
+/**********************************************************
+**Name:     RFM26_Pack_Add
+**Function: Code one more record into the current frame
+**Input:    p, packer state
+            rec, rec_len bytes
+**Output:   1 added, 0 frame is full: RFM26_Pack_Finish and add again
+**********************************************************/
+uint8_t RFM26_Pack_Add(RFM26_PACK* p, const uint8_t* rec)
+{
+  uint8_t m, k, added = 0;
+
+  for (m = 0; m < RFM26_PACK_MODES; m++) {
+    if (p->full & (1 << m))
+      continue;
+    if (m == C_PACK_DELTA)
+      k = uPack_Delta(p, rec, p->out[m] + p->len[m], RFM26_PACK_FRAME_LEN - p->len[m]);
+    else
+      k = uPack_Lz(p, rec, p->out[m] + p->len[m], RFM26_PACK_FRAME_LEN - p->len[m]);
+    if (k == 0xFF) {
+      p->full |= 1 << m;                                  // partial output past len is ignored
+      continue;
+    }
+    p->len[m] += k;
+    if (++p->count[m] == RFM26_PACK_MAX_COUNT)
+      p->full |= 1 << m;
+    added = 1;
+  }
+  if (added)
+    memcpy(p->prev, rec, p->rec_len);
+  return added;
+}
+
+/**********************************************************
+**Name:     RFM26_Pack_Pending
+**Function: Records waiting in the current frame
+**Input:    p, packer state
+**Output:   record count
+**********************************************************/
+uint8_t RFM26_Pack_Pending(const RFM26_PACK* p)
+{
+  return p->count[C_PACK_DELTA] > p->count[C_PACK_LZ] ? p->count[C_PACK_DELTA] : p->count[C_PACK_LZ];
+}
+
+/**********************************************************
+**Name:     RFM26_Pack_Finish
+**Function: Close the current frame in the best mode and start
+            a new one
+**Input:    p, packer state
+            frame, RFM26_PACK_FRAME_LEN bytes out, zero padded
+**Output:   bytes used, 0 if no record was pending
+**********************************************************/
+uint8_t RFM26_Pack_Finish(RFM26_PACK* p, uint8_t* frame)
+{
+  uint8_t m, best, len;
+
+  best = C_PACK_DELTA;
+  for (m = 1; m < RFM26_PACK_MODES; m++)
+    if (p->count[m] > p->count[best] || (p->count[m] == p->count[best] && p->len[m] < p->len[best]))
+      best = m;
+  if (p->count[best] == 0)
+    return 0;
+
+  len = p->len[best];
+  memcpy(frame, p->out[best], len);
+  memset(frame + len, 0, RFM26_PACK_FRAME_LEN - len);
+  frame[0] = (uint8_t)(best << 7) | (uint8_t)(p->seq << 4) | p->count[best];
+  p->seq = (p->seq + 1) % RFM26_PACK_KEY_INTERVAL;
+  vPack_Reset(p);
+  return len;
+}
+
+/**********************************************************
+**Name:     RFM26_Pack_Unpack
+**Function: Decode a packed frame
+**Input:    p, packer state (rec_len and dictionary)
+            frame, received frame
+            len, frame length
+            recs, max_recs * rec_len bytes out
+            max_recs, room in recs
+**Output:   records decoded, 0 for a malformed frame
+**********************************************************/
+uint8_t RFM26_Pack_Unpack(RFM26_PACK* p, const uint8_t* frame, uint8_t len, uint8_t* recs, uint8_t max_recs)
+{
+  uint8_t mode, seq, count, r, i, f, t, l, k, sh, fields, mask;
+  uint8_t* cur;
+  uint16_t z, pos, v, w;
+  int16_t d;
+
+  if (len == 0)
+    return 0;
+  mode = frame[0] >> 7;
+  seq = (frame[0] >> 4) & 0x07;
+  count = frame[0] & 0x0F;
+  if (seq == 0) {
+    memset(p->prev, 0, sizeof(p->prev));                  // key frame
+  } else if (!p->chain || seq != (p->seq + 1) % RFM26_PACK_KEY_INTERVAL) {
+    p->chain = 0;                                         // wait for the next key frame
+    return 0;
+  }
+  p->chain = 0;
+  if (count > max_recs || count == 0)
+    return 0;
+  k = 1;
+  for (r = 0; r < count; r++) {
+    cur = recs + (uint16_t)r * p->rec_len;
+    if (mode == C_PACK_DELTA) {
+      fields = (p->rec_len + 1) / 2;
+      mask = k;
+      k += (fields + 7) / 8;
+      for (f = 0; f < fields; f++) {
+        if (k > len)
+          return 0;
+        if (!(frame[mask + f / 8] & (1 << (f & 7)))) {
+          w = wPack_Field(p->prev, p->rec_len, f);
+          cur[2 * f] = (uint8_t)w;
+          if (2 * f + 1 < p->rec_len)
+            cur[2 * f + 1] = (uint8_t)(w >> 8);
+          continue;
+        }
+        z = 0;
+        sh = 0;
+        do {
+          if (k >= len || sh > 14)
+            return 0;
+          t = frame[k++];
+          z |= (uint16_t)(t & 0x7F) << sh;
+          sh += 7;
+        } while (t & 0x80);
+        d = (int16_t)((z >> 1) ^ (uint16_t)-(int16_t)(z & 1));
+        w = wPack_Field(p->prev, p->rec_len, f) + (uint16_t)d;
+        cur[2 * f] = (uint8_t)w;
+        if (2 * f + 1 < p->rec_len)
+          cur[2 * f + 1] = (uint8_t)(w >> 8);
+      }
+    } else {
+      i = 0;
+      while (i < p->rec_len) {
+        if (k >= len)
+          return 0;
+        t = frame[k++];
+        if (t < 0x80) {
+          l = t + 1;
+          if (i + l > p->rec_len || k + l > len)
+            return 0;
+          memcpy(cur + i, frame + k, l);
+          k += l;
+        } else {
+          l = (t & 0x7F) + 3;
+          if (i + l > p->rec_len || k >= len)
+            return 0;
+          pos = p->dict_len + p->rec_len + i;
+          if (frame[k] + 1 > pos)
+            return 0;
+          v = pos - frame[k++] - 1;
+          for (t = 0; t < l; t++)
+            cur[i + t] = uPack_Byte(p, cur, v + t);
+        }
+        i += l;
+      }
+    }
+    memcpy(p->prev, cur, p->rec_len);
+  }
+  p->seq = seq;
+  p->chain = 1;
+  return count;
+}
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Pack_Send
+**Function: Queue a record, send_message() the frame when the
+            record does not fit anymore
+**Input:    p, packer state
+            rec, rec_len bytes
+**Output:   1 if a frame was sent
+**********************************************************/
+uint8_t RFM26_Pack_Send(RFM26_PACK* p, const uint8_t* rec)
+{
+  uint8_t sent = 0;
+
+  if (!RFM26_Pack_Add(p, rec)) {
+    sent = RFM26_Pack_Flush(p);
+    RFM26_Pack_Add(p, rec);
+  }
+  return sent;
+}
+
+/**********************************************************
+**Name:     RFM26_Pack_Flush
+**Function: send_message() the pending records now
+**Input:    p, packer state
+**Output:   1 if a frame was sent
+**********************************************************/
+uint8_t RFM26_Pack_Flush(RFM26_PACK* p)
+{
+  uint8_t frame[RFM26_PACK_FRAME_LEN];
+
+  if (RFM26_Pack_Finish(p, frame) == 0)
+    return 0;
+  send_message(frame, RFM26_PACK_FRAME_LEN);
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_Pack_Receive
+**Function: receive_message() and unpack
+**Input:    p, packer state
+            recs, max_recs * rec_len bytes out
+            max_recs, room in recs
+**Output:   records received, 0 for none
+**********************************************************/
+uint8_t RFM26_Pack_Receive(RFM26_PACK* p, uint8_t* recs, uint8_t max_recs)
+{
+  uint8_t frame[RFM26_PACK_FRAME_LEN];
+
+  if (receive_message(frame) == 0)
+    return 0;
+  return RFM26_Pack_Unpack(p, frame, RFM26_PACK_FRAME_LEN, recs, max_recs);
+}
+#endif
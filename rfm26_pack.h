@@ -0,0 +1,124 @@
+#ifndef HopeDuino_26_PACK_H_
+#define HopeDuino_26_PACK_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define packed frame: [mode<<7 | seq<<4 | count] + coded records, padded to the packet length
+#define RFM26_PACK_FRAME_LEN	21							// RFM26_PKT_LEN
+#define RFM26_PACK_MAX_REC		19							// record length limit, any record fits an empty frame
+#define RFM26_PACK_MAX_COUNT	15
+#define RFM26_PACK_KEY_INTERVAL	8							// frames per chain, seq 0 is a key frame; 1..8
+
+//Define coding modes, the encoder runs both and keeps the one that fits more records
+#define C_PACK_DELTA		0							// 16 bit fields, zigzag delta to the previous record, varint
+#define C_PACK_LZ			1							// LZ77 over static dictionary + previous record
+#define RFM26_PACK_MODES	2
+
+typedef struct
+{
+  uint8_t  rec_len;                                       // bytes per record, both ends
+  const uint8_t* dict;                                    // shared static dictionary, PROGMEM on AVR
+  uint8_t  dict_len;
+  uint8_t  prev[RFM26_PACK_MAX_REC];                      // last record coded, zeros at a key frame
+  uint8_t  seq;                                           // Tx: seq of the frame being filled; Rx: last seq decoded
+  uint8_t  chain;                                         // Rx: prev is valid for the next frame
+  uint8_t  out[RFM26_PACK_MODES][RFM26_PACK_FRAME_LEN];   // frame per mode
+  uint8_t  len[RFM26_PACK_MODES];                         // bytes used per mode, header included
+  uint8_t  count[RFM26_PACK_MODES];                       // records per mode
+  uint8_t  full;                                          // bit per mode that ran out of room
+} RFM26_PACK;
+
+//Default dictionary: the sketch payload and common runs
+extern const uint8_t RFM26PackDict[];
+extern const uint8_t RFM26PackDictLen;
+
+/**********************************************************
+**Name:     RFM26_Pack_Init
+**Function: Set up a packer (or unpacker) for fixed size records
+**Input:    p, packer state
+            rec_len, record length, 1..RFM26_PACK_MAX_REC
+            dict, static dictionary, 0 for RFM26PackDict
+            dict_len, dictionary length, at most 200
+**Output:   None
+**********************************************************/
+void RFM26_Pack_Init(RFM26_PACK* p, uint8_t rec_len, const uint8_t* dict, uint8_t dict_len);
+
+/**********************************************************
+**Name:     RFM26_Pack_Add
+**Function: Code one more record into the current frame
+**Input:    p, packer state
+            rec, rec_len bytes
+**Output:   1 added, 0 frame is full: RFM26_Pack_Finish and add again
+**********************************************************/
+uint8_t RFM26_Pack_Add(RFM26_PACK* p, const uint8_t* rec);
+
+/**********************************************************
+**Name:     RFM26_Pack_Pending
+**Function: Records waiting in the current frame
+**Input:    p, packer state
+**Output:   record count
+**********************************************************/
+uint8_t RFM26_Pack_Pending(const RFM26_PACK* p);
+
+/**********************************************************
+**Name:     RFM26_Pack_Finish
+**Function: Close the current frame in the best mode and start
+            a new one
+**Input:    p, packer state
+            frame, RFM26_PACK_FRAME_LEN bytes out, zero padded
+**Output:   bytes used, 0 if no record was pending
+**********************************************************/
+uint8_t RFM26_Pack_Finish(RFM26_PACK* p, uint8_t* frame);
+
+/**********************************************************
+**Name:     RFM26_Pack_Unpack
+**Function: Decode a packed frame
+**Input:    p, packer state (rec_len and dictionary)
+            frame, received frame
+            len, frame length
+            recs, max_recs * rec_len bytes out
+            max_recs, room in recs
+**Output:   records decoded, 0 for a malformed frame or a
+            broken chain (a frame since the key frame was lost)
+**********************************************************/
+uint8_t RFM26_Pack_Unpack(RFM26_PACK* p, const uint8_t* frame, uint8_t len, uint8_t* recs, uint8_t max_recs);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Pack_Send
+**Function: Queue a record, send_message() the frame when the
+            record does not fit anymore
+**Input:    p, packer state
+            rec, rec_len bytes
+**Output:   1 if a frame was sent
+**********************************************************/
+uint8_t RFM26_Pack_Send(RFM26_PACK* p, const uint8_t* rec);
+
+/**********************************************************
+**Name:     RFM26_Pack_Flush
+**Function: send_message() the pending records now
+**Input:    p, packer state
+**Output:   1 if a frame was sent
+**********************************************************/
+uint8_t RFM26_Pack_Flush(RFM26_PACK* p);
+
+/**********************************************************
+**Name:     RFM26_Pack_Receive
+**Function: receive_message() and unpack
+**Input:    p, packer state
+            recs, max_recs * rec_len bytes out
+            max_recs, room in recs
+**Output:   records received, 0 for none
+**********************************************************/
+uint8_t RFM26_Pack_Receive(RFM26_PACK* p, uint8_t* recs, uint8_t max_recs);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
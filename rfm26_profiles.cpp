@@ -0,0 +1,49 @@
+#include "rfm26_config.h"
+
+/************************Description************************
+  Generated by host/config_pack from rfm26_wds.h and
+  RFM26RateTbl, do not edit; run config_pack -o again when
+  either changes.
+**********************************************************/
+
+//WDS table, 331 bytes raw, 245 encoded
+const uint8_t RFM26CfgBase[] CFG_ROM = {
+  0x87, 0x02, 0x01, 0x01, 0x01, 0xC9, 0xC3, 0x80, 0x87, 0x13, 0x5C, 0x53,
+  0x5B, 0x51, 0x00, 0x00, 0x61, 0x00, 0x00, 0x5D, 0x21, 0x03, 0x40, 0x62,
+  0x01, 0x00, 0x01, 0x30, 0x74, 0x02, 0x00, 0x00, 0x00, 0x00, 0x69, 0x10,
+  0x00, 0x08, 0x14, 0x00, 0x0F, 0x31, 0x00, 0x00, 0x00, 0x00, 0x65, 0x11,
+  0x00, 0x01, 0xB4, 0x2B, 0x00, 0x00, 0x61, 0x12, 0x00, 0x80, 0x21, 0x06,
+  0x02, 0x33, 0x08, 0x00, 0x00, 0x2C, 0x0D, 0x00, 0x40, 0x04, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x6C, 0x20, 0x00, 0x02, 0x00, 0x07, 0x00, 0x09, 0x60, 0x00, 0x2D,
+  0xC6, 0xC0, 0x00, 0x04, 0x01, 0xC7, 0x28, 0x18, 0x01, 0x80, 0x08, 0x03,
+  0xC0, 0x00, 0x12, 0x10, 0x29, 0x22, 0x04, 0x12, 0x00, 0x7D, 0xD4, 0x00,
+  0x3F, 0x02, 0xC2, 0x27, 0x2C, 0x04, 0x36, 0x80, 0x01, 0x75, 0x0B, 0x80,
+  0x21, 0x35, 0xE2, 0x29, 0x38, 0x11, 0xE4, 0xE4, 0x00, 0x02, 0x74, 0xAA,
+  0x00, 0x2B, 0x2B, 0x42, 0xA4, 0x02, 0xD6, 0x81, 0x05, 0xEA, 0x01, 0x80,
+  0xFF, 0x0C, 0x00, 0x21, 0x4E, 0x40, 0x21, 0x51, 0x08, 0x6C, 0x21, 0x00,
+  0xFF, 0xBA, 0x0F, 0x51, 0xCF, 0xA9, 0xC9, 0xFC, 0x1B, 0x1E, 0x0F, 0x01,
+  0x0C, 0xFC, 0xFD, 0x15, 0xFF, 0x00, 0x0F, 0xFF, 0xBA, 0x0F, 0x51, 0xCF,
+  0xA9, 0x0C, 0xC9, 0xFC, 0x1B, 0x1E, 0x0F, 0x01, 0xFC, 0xFD, 0x15, 0xFF,
+  0x00, 0x0F, 0x64, 0x22, 0x00, 0x08, 0x7F, 0x00, 0x0E, 0x67, 0x23, 0x00,
+  0x2C, 0x0E, 0x0B, 0x04, 0x0C, 0x73, 0x03, 0x7C, 0x30, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x68, 0x40, 0x00, 0x3C, 0x08, 0x00, 0x00,
+  0x00, 0x00, 0x20, 0xFF, 0x00,
+};
+
+//Rate profiles, the properties each sets other than the base
+const uint8_t RFM26CfgProfile[] CFG_ROM = {
+  //1.2Kbps
+  0x62, 0x20, 0x04, 0x04, 0xB0, 0x22, 0x22, 0x08, 0x24, 0x22, 0x25, 0x3E,
+  0xEA, 0x21, 0x28, 0x20, 0x00,
+  //2.4Kbps, as the base
+  0x00,
+  //4.8Kbps
+  0x62, 0x20, 0x04, 0x12, 0xC0, 0x22, 0x22, 0x02, 0x09, 0x22, 0x25, 0xFB,
+  0xA8, 0x21, 0x28, 0x7E, 0x00,
+  //9.6Kbps
+  0x62, 0x20, 0x04, 0x25, 0x80, 0x25, 0x22, 0x01, 0x04, 0x01, 0xF7, 0x50,
+  0x21, 0x28, 0xFC, 0x00,
+};
+
+const uint16_t RFM26CfgProfileOfs[RFM26_PROFILES] CFG_ROM = {0, 17, 18, 35};
@@ -0,0 +1,228 @@
+#include <string.h>
+#include "rfm26_relay.h"
+#ifdef ARDUINO
+#include "rfm26_driver.h"
+#endif
+
+/************************Description************************
+  Multi-hop relay by controlled flooding.
+
+  Frame:  | dst | src | seq | ttl | payload |
+
+  A node delivers frames for its address and for broadcast,
+  and forwards every frame not for it alone while ttl > 0,
+  with ttl - 1. The last RFM26_RELAY_SEEN (src, seq) pairs
+  are remembered; a frame seen before (a neighbour forwarding
+  the same frame, or our own coming back) is dropped, so the
+  flood dies out and loops cannot form.
+
+  On the radio the frame is never stored whole. Rx FIFO almost
+  full fires every RFM26_RELAY_CHUNK bytes: the first chunk is
+  the header, which is routed and rewritten and goes to Tx FIFO
+  at once; later chunks are moved to Tx FIFO while the rest is
+  still on air. At PACKET_RX, START_TX is sent before the last
+  bytes are moved: preamble and sync go out first, which gives
+  the MCU about 10 byte times to top up Tx FIFO. The radio is
+  half duplex, so a hop still costs one frame time on air, but
+  nothing else: no reconfigure, no copy of the whole frame, and
+  TXCOMPLETE_STATE returns to Rx by itself.
+**********************************************************/
+
+static uint8_t bRelay_Seen(RFM26_RELAY* r, uint8_t src, uint8_t seq)
+{
+  uint16_t key = ((uint16_t)src << 8) | seq;
+  uint8_t i;
+
+  for (i = 0; i < RFM26_RELAY_SEEN; i++)
+    if (r->seen[i] == key)
+      return 1;
+  r->seen[r->seen_head] = key;
+  r->seen_head = (r->seen_head + 1) % RFM26_RELAY_SEEN;
+  return 0;
+}
+
+/**********************************************************
+**Name:     RFM26_Relay_Init
+**Function: Set up a node for relaying
+**Input:    r, relay state
+            addr, node address, 0..0xFE
+**Output:   None
+**********************************************************/
+void RFM26_Relay_Init(RFM26_RELAY* r, uint8_t addr)
+{
+  memset(r, 0, sizeof(*r));
+  memset(r->seen, 0xFF, sizeof(r->seen));                 // src 0xFF never sends
+  r->addr = addr;
+  r->action = C_RELAY_PENDING;
+}
+
+/**********************************************************
+**Name:     RFM26_Relay_Header
+**Function: Header for a frame this node originates, its own
+            copy coming back from a relay is dropped
+**Input:    r, relay state
+            dst, destination or RFM26_RELAY_BROADCAST
+            ttl, relays it may take
+            hdr, RFM26_RELAY_HDR_LEN bytes out
+**Output:   None
+**********************************************************/
+void RFM26_Relay_Header(RFM26_RELAY* r, uint8_t dst, uint8_t ttl, uint8_t* hdr)
+{
+  hdr[0] = dst;
+  hdr[1] = r->addr;
+  hdr[2] = r->seq++;
+  hdr[3] = ttl;
+  bRelay_Seen(r, hdr[1], hdr[2]);
+  r->stats.originated++;
+}
+
+/**********************************************************
+**Name:     RFM26_Relay_Route
+**Function: Decide what to do with a received header, rewrite
+            it in place for the next hop
+**Input:    r, relay state
+            hdr, RFM26_RELAY_HDR_LEN bytes
+**Output:   C_RELAY_DELIVER and/or C_RELAY_FORWARD bits,
+            C_RELAY_DROP
+**********************************************************/
+uint8_t RFM26_Relay_Route(RFM26_RELAY* r, uint8_t* hdr)
+{
+  uint8_t action = C_RELAY_DROP;
+
+  if (hdr[1] == RFM26_RELAY_BROADCAST || bRelay_Seen(r, hdr[1], hdr[2])) {
+    r->stats.dup++;
+    return C_RELAY_DROP;
+  }
+  if (hdr[0] == r->addr || hdr[0] == RFM26_RELAY_BROADCAST) {
+    action |= C_RELAY_DELIVER;
+    r->stats.delivered++;
+  }
+  if (hdr[0] != r->addr) {
+    if (hdr[3] > 0) {
+      hdr[3]--;
+      action |= C_RELAY_FORWARD;
+      r->stats.forwarded++;
+    } else if (hdr[0] != RFM26_RELAY_BROADCAST) {
+      r->stats.expired++;
+    }
+  }
+  return action;
+}
+
+#ifdef ARDUINO
+// Move up to avail bytes of the frame from Rx FIFO, routing it once the header is in
+static void vRelay_Drain(RFM26_RELAY* r, uint8_t avail)
+{
+  uint8_t n;
+
+  if (avail > RFM26_RELAY_FRAME_LEN - r->copied)
+    avail = RFM26_RELAY_FRAME_LEN - r->copied;
+  if (r->action == C_RELAY_PENDING) {
+    if (r->copied + avail < RFM26_RELAY_HDR_LEN)
+      return;                                             // Wait for the whole header
+    n = RFM26_RELAY_HDR_LEN - r->copied;
+    bApi_ReadRxDataBuffer(n, &r->frame[r->copied]);
+    r->copied = RFM26_RELAY_HDR_LEN;
+    avail -= n;
+    r->action = RFM26_Relay_Route(r, r->frame);
+    if (r->action & C_RELAY_FORWARD) {
+      RFM26_ResetTxFifo();                                // The previous forward is off air, we are in Rx
+      bApi_WriteTxDataBuffer(RFM26_RELAY_HDR_LEN, r->frame);
+    }
+  }
+  if (r->action == C_RELAY_DROP || avail == 0)
+    return;                                               // A dropped frame is left to RFM26_ResetRxFifo
+  bApi_ReadRxDataBuffer(avail, &r->frame[r->copied]);
+  if (r->action & C_RELAY_FORWARD)
+    bApi_WriteTxDataBuffer(avail, &r->frame[r->copied]);
+  r->copied += avail;
+}
+
+/**********************************************************
+**Name:     RFM26_Relay_Start
+**Function: Enter relay Rx: PACKET_RX and Rx FIFO almost full
+            interrupts, RFM26_RELAY_CHUNK byte threshold
+**Input:    r, relay state
+**Output:   None
+**********************************************************/
+void RFM26_Relay_Start(RFM26_RELAY* r)
+{
+  RFM26_SetINT_CTL(0x01, C_PH_PACKET_RX|C_PH_RX_ALMOST_FULL, 0x00, 0x00);
+  RFM26_SetRxThreshold(RFM26_RELAY_CHUNK);
+  RFM26_SetFieldLength(RFM26_RELAY_FRAME_LEN);            // Rx entered from TXCOMPLETE_STATE uses field 1 length
+  RFM26_ResetRxFifo();
+  RFM26_ClrAllInterrupt();
+  r->action = C_RELAY_PENDING;
+  r->copied = 0;
+  RFM26_Start_Rx(0, 0, RFM26_RELAY_FRAME_LEN, 0, C_STATE_READY, C_STATE_READY);
+}
+
+/**********************************************************
+**Name:     RFM26_Relay_Send
+**Function: Originate a frame and return to relay Rx once it
+            is on air
+**Input:    r, relay state
+            dst, destination or RFM26_RELAY_BROADCAST
+            p_data, payload
+            num, payload length, up to RFM26_RELAY_PAYLOAD
+**Output:   1 sent, 0 a Tx on air did not end (before: not
+            sent, after: relay Rx restarted anyway)
+**********************************************************/
+uint8_t RFM26_Relay_Send(RFM26_RELAY* r, uint8_t dst, const uint8_t* p_data, uint8_t num)
+{
+  uint8_t hdr[RFM26_RELAY_HDR_LEN];
+  uint8_t ok;
+
+  if (!RFM26_WaitTxDone())                                // A forward is on air
+    return 0;
+  RFM26_Relay_Header(r, dst, RFM26_RELAY_TTL, hdr);
+  RFM26_SendSplit(hdr, RFM26_RELAY_HDR_LEN, p_data, num);
+  ok = RFM26_WaitTxDone();
+  RFM26_Relay_Start(r);
+  return ok;
+}
+
+/**********************************************************
+**Name:     RFM26_Relay_Poll
+**Function: Service the radio: route a frame once its header
+            is in Rx FIFO, stream a forwarded one into Tx FIFO
+            while it is still arriving and start Tx as soon as
+            it ends
+**Input:    r, relay state
+**Output:   1 when a frame for this node is in r->frame
+**********************************************************/
+uint8_t RFM26_Relay_Poll(RFM26_RELAY* r)
+{
+  uint8_t ph, local;
+  uint32_t t0;
+
+  if (nIRQ0_READ())
+    return 0;
+  t0 = time_us();
+  ph = RFM26_GetPHPending();
+  if (!(ph & C_PH_PACKET_RX)) {
+    if (ph & C_PH_RX_ALMOST_FULL)
+      vRelay_Drain(r, RFM26_GetRxFifoCount());
+    return 0;
+  }
+
+  if (r->action == C_RELAY_PENDING)
+    vRelay_Drain(r, RFM26_RELAY_HDR_LEN);                 // Polled late, route the header first
+  if (r->action & C_RELAY_FORWARD) {
+    RFM26_Start_Tx(0x00, C_TXCOMPLETE_RX, RFM26_RELAY_FRAME_LEN);
+    r->stats.turn_us = time_us() - t0;
+    if (r->stats.turn_us > r->stats.turn_max_us)
+      r->stats.turn_max_us = r->stats.turn_us;
+    vRelay_Drain(r, RFM26_RELAY_FRAME_LEN);               // Tail goes in under the preamble
+    RFM26_ResetRxFifo();
+  } else {
+    vRelay_Drain(r, RFM26_RELAY_FRAME_LEN);
+    RFM26_ResetRxFifo();
+    RFM26_Start_Rx(0, 0, RFM26_RELAY_FRAME_LEN, 0, C_STATE_READY, C_STATE_READY);
+  }
+  local = r->action & C_RELAY_DELIVER;
+  r->action = C_RELAY_PENDING;
+  r->copied = 0;
+  return local;
+}
+#endif
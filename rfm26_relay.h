@@ -0,0 +1,119 @@
+#ifndef HopeDuino_26_RELAY_H_
+#define HopeDuino_26_RELAY_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define relay frame: [dst][src][seq][ttl] + payload, a relay rewrites only ttl
+#define RFM26_RELAY_FRAME_LEN	21							// RFM26_PKT_LEN
+#define RFM26_RELAY_HDR_LEN		4
+#define RFM26_RELAY_PAYLOAD		(RFM26_RELAY_FRAME_LEN - RFM26_RELAY_HDR_LEN)
+#define RFM26_RELAY_BROADCAST	0xFF						// dst for every node, never a src
+#define RFM26_RELAY_TTL			7							// relays a frame may still take
+#define RFM26_RELAY_SEEN		16							// (src, seq) pairs remembered against duplicates
+#define RFM26_RELAY_CHUNK		4							// Rx FIFO almost full threshold while streaming
+
+//Define routing decision, bits
+#define C_RELAY_DROP		0x00
+#define C_RELAY_DELIVER		0x01						// for this node
+#define C_RELAY_FORWARD		0x02						// send on, header already rewritten
+#define C_RELAY_PENDING		0xFF						// header not read yet
+
+typedef struct
+{
+  uint32_t originated;
+  uint32_t forwarded;
+  uint32_t delivered;
+  uint32_t dup;                                           // seen before, dropped
+  uint32_t expired;                                       // ttl used up before dst
+  uint32_t turn_us;                                       // last PACKET_RX to START_TX of a forward
+  uint32_t turn_max_us;
+} RFM26_RELAY_STATS;
+
+typedef struct
+{
+  uint8_t  addr;                                          // this node, not RFM26_RELAY_BROADCAST
+  uint8_t  seq;                                           // next originated seq
+  uint16_t seen[RFM26_RELAY_SEEN];                        // src<<8|seq, ring
+  uint8_t  seen_head;
+  uint8_t  action;                                        // C_RELAY_xxx of the frame on air, C_RELAY_PENDING
+  uint8_t  copied;                                        // bytes of it read from Rx FIFO
+  uint8_t  frame[RFM26_RELAY_FRAME_LEN];                  // the frame being received, header rewritten
+  RFM26_RELAY_STATS stats;
+} RFM26_RELAY;
+
+/**********************************************************
+**Name:     RFM26_Relay_Init
+**Function: Set up a node for relaying
+**Input:    r, relay state
+            addr, node address, 0..0xFE
+**Output:   None
+**********************************************************/
+void RFM26_Relay_Init(RFM26_RELAY* r, uint8_t addr);
+
+/**********************************************************
+**Name:     RFM26_Relay_Header
+**Function: Header for a frame this node originates, its own
+            copy coming back from a relay is dropped
+**Input:    r, relay state
+            dst, destination or RFM26_RELAY_BROADCAST
+            ttl, relays it may take
+            hdr, RFM26_RELAY_HDR_LEN bytes out
+**Output:   None
+**********************************************************/
+void RFM26_Relay_Header(RFM26_RELAY* r, uint8_t dst, uint8_t ttl, uint8_t* hdr);
+
+/**********************************************************
+**Name:     RFM26_Relay_Route
+**Function: Decide what to do with a received header, rewrite
+            it in place for the next hop
+**Input:    r, relay state
+            hdr, RFM26_RELAY_HDR_LEN bytes
+**Output:   C_RELAY_DELIVER and/or C_RELAY_FORWARD bits,
+            C_RELAY_DROP
+**********************************************************/
+uint8_t RFM26_Relay_Route(RFM26_RELAY* r, uint8_t* hdr);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Relay_Start
+**Function: Enter relay Rx: PACKET_RX and Rx FIFO almost full
+            interrupts, RFM26_RELAY_CHUNK byte threshold
+**Input:    r, relay state
+**Output:   None
+**********************************************************/
+void RFM26_Relay_Start(RFM26_RELAY* r);
+
+/**********************************************************
+**Name:     RFM26_Relay_Send
+**Function: Originate a frame and return to relay Rx once it
+            is on air
+**Input:    r, relay state
+            dst, destination or RFM26_RELAY_BROADCAST
+            p_data, payload
+            num, payload length, up to RFM26_RELAY_PAYLOAD
+**Output:   1 sent, 0 a Tx on air did not end (before: not
+            sent, after: relay Rx restarted anyway)
+**********************************************************/
+uint8_t RFM26_Relay_Send(RFM26_RELAY* r, uint8_t dst, const uint8_t* p_data, uint8_t num);
+
+/**********************************************************
+**Name:     RFM26_Relay_Poll
+**Function: Service the radio: route a frame once its header
+            is in Rx FIFO, stream a forwarded one into Tx FIFO
+            while it is still arriving and start Tx as soon as
+            it ends
+**Input:    r, relay state
+**Output:   1 when a frame for this node is in r->frame
+**********************************************************/
+uint8_t RFM26_Relay_Poll(RFM26_RELAY* r);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,154 @@
+#include <string.h>
+#include "rfm26_sched.h"
+#ifdef ARDUINO
+#include <Arduino.h>
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+#endif
+
+/************************Description************************
+  Cooperative scheduler for the sketch: a hashed timer wheel
+  of RFM26_SCHED_SLOTS slots, one tick each, and a task for the
+  nIRQ edge. A task sits in the slot of its due tick and runs
+  on the first RFM26_Sched_Run at or after its due time; one
+  further out than the wheel stays in its slot until its round
+  comes. Arming and running are O(1) plus the tasks sharing a
+  slot. Tasks are the caller's, nothing is allocated.
+
+  Instead of delay(), loop() runs what is due and sleeps to the
+  next interrupt: the radio reset sequence, periodic Tx, Rx
+  draining on nIRQ and the telemetry flush are tasks, so Rx and
+  the serial port are served while the others wait.
+**********************************************************/
+
+#define C_SCHED_MASK		(RFM26_SCHED_SLOTS - 1)
+
+static void vSched_Insert(RFM26_SCHED* s, RFM26_TASK* t, uint32_t due)
+{
+  uint8_t k = (uint8_t)((due >> RFM26_SCHED_TICK) & C_SCHED_MASK);
+
+  t->due = due;
+  t->armed = 1;
+  t->next = s->slot[k];
+  s->slot[k] = t;
+}
+
+void RFM26_Sched_Init(RFM26_SCHED* s, uint32_t now)
+{
+  memset(s, 0, sizeof(*s));
+  s->tick = now >> RFM26_SCHED_TICK;
+}
+
+void RFM26_Sched_Task(RFM26_TASK* t, RFM26_TASK_FN fn, void* ctx)
+{
+  memset(t, 0, sizeof(*t));
+  t->fn = fn;
+  t->ctx = ctx;
+}
+
+void RFM26_Sched_Add(RFM26_SCHED* s, RFM26_TASK* t, uint32_t now, uint32_t delay, uint32_t period)
+{
+  RFM26_Sched_Cancel(s, t);
+  t->period = period;
+  vSched_Insert(s, t, now + delay);
+}
+
+void RFM26_Sched_Cancel(RFM26_SCHED* s, RFM26_TASK* t)
+{
+  RFM26_TASK** pp;
+
+  if (!t->armed)
+    return;
+  for (pp = &s->slot[(t->due >> RFM26_SCHED_TICK) & C_SCHED_MASK]; *pp; pp = &(*pp)->next)
+    if (*pp == t) {
+      *pp = t->next;
+      break;
+    }
+  t->armed = 0;
+}
+
+void RFM26_Sched_OnIrq(RFM26_SCHED* s, RFM26_TASK* t)
+{
+  s->irq = t;
+}
+
+void RFM26_Sched_Irq(RFM26_SCHED* s)
+{
+  s->irq_pending = 1;
+}
+
+uint32_t RFM26_Sched_Run(RFM26_SCHED* s, uint32_t now)
+{
+  uint32_t tick = now >> RFM26_SCHED_TICK;
+  uint32_t n = tick - s->tick + 1, i, late, due, wait;
+  RFM26_TASK** pp;
+  RFM26_TASK* t;
+
+  if (s->irq_pending) {
+    s->irq_pending = 0;
+    if (s->irq) {
+      s->runs++;
+      s->irq->fn(s->irq->ctx);
+    }
+  }
+
+  // slots from the last tick run on; a task may arm or cancel any other, so the slot is searched again after each
+  if (n > RFM26_SCHED_SLOTS)
+    n = RFM26_SCHED_SLOTS;
+  for (i = 0; i < n; i++) {
+    RFM26_TASK** head = &s->slot[(s->tick + i) & C_SCHED_MASK];
+    for (;;) {
+      for (pp = head; (t = *pp) != 0; pp = &t->next)
+        if ((int32_t)(now - t->due) >= 0)
+          break;
+      if (!t)
+        break;
+      *pp = t->next;
+      t->armed = 0;
+      late = now - t->due;
+      if (late > s->late_max)
+        s->late_max = late;
+      if (t->period) {                                    // keeps its phase, runs missed while late are dropped
+        due = t->due + t->period;
+        if ((int32_t)(now - due) >= 0)
+          due += t->period * ((now - due) / t->period + 1);
+        vSched_Insert(s, t, due);
+      }
+      s->runs++;
+      t->fn(t->ctx);
+    }
+  }
+  s->tick = tick;
+
+  if (s->irq_pending)
+    return 0;
+  wait = (uint32_t)RFM26_SCHED_SLOTS << RFM26_SCHED_TICK;
+  for (i = 0; i < RFM26_SCHED_SLOTS; i++)
+    for (t = s->slot[i]; t; t = t->next) {
+      if ((int32_t)(t->due - now) <= 0)
+        return 0;
+      if (t->due - now < wait)
+        wait = t->due - now;
+    }
+  return wait;
+}
+
+#ifdef ARDUINO
+void RFM26_Sched_Sleep(RFM26_SCHED* s)
+{
+#ifdef __AVR__
+  set_sleep_mode(SLEEP_MODE_IDLE);                        // Timer0, UART and the pin change interrupt keep running
+  noInterrupts();
+  if (!s->irq_pending) {
+    sleep_enable();
+    interrupts();                                         // the instruction after SEI runs first: no edge is missed
+    sleep_cpu();
+    sleep_disable();
+  }
+  interrupts();
+#else
+  (void)s;
+#endif
+}
+#endif
@@ -0,0 +1,119 @@
+#ifndef HopeDuino_26_SCHED_H_
+#define HopeDuino_26_SCHED_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define timer wheel: RFM26_SCHED_SLOTS slots of 2^RFM26_SCHED_TICK us
+#define RFM26_SCHED_SLOTS	16							// power of two
+#define RFM26_SCHED_TICK	10							// 1024us, the AVR Timer0 overflow that wakes the CPU anyway
+
+typedef void (*RFM26_TASK_FN)(void* ctx);
+
+typedef struct RFM26_TASK
+{
+  struct RFM26_TASK* next;
+  uint32_t due;                                           // us
+  uint32_t period;                                        // us, 0: runs once
+  RFM26_TASK_FN fn;
+  void*    ctx;
+  uint8_t  armed;
+} RFM26_TASK;
+
+typedef struct
+{
+  RFM26_TASK* slot[RFM26_SCHED_SLOTS];
+  RFM26_TASK* irq;                                        // runs after RFM26_Sched_Irq
+  volatile uint8_t irq_pending;
+  uint32_t tick;                                          // last tick run, now >> RFM26_SCHED_TICK
+  uint32_t runs;                                          // task calls
+  uint32_t late_max;                                      // us a timed task ran after its due time, at most
+} RFM26_SCHED;
+
+/**********************************************************
+**Name:     RFM26_Sched_Init
+**Function: Empty wheel
+**Input:    s, scheduler
+            now, us
+**Output:   None
+**********************************************************/
+void RFM26_Sched_Init(RFM26_SCHED* s, uint32_t now);
+
+/**********************************************************
+**Name:     RFM26_Sched_Task
+**Function: Set up a task, not armed
+**Input:    t, task, kept by the caller
+            fn, ctx, what it runs
+**Output:   None
+**********************************************************/
+void RFM26_Sched_Task(RFM26_TASK* t, RFM26_TASK_FN fn, void* ctx);
+
+/**********************************************************
+**Name:     RFM26_Sched_Add
+**Function: Arm a task, or move it when armed
+**Input:    s, scheduler
+            t, task
+            now, us
+            delay, us from now, up to 2^31
+            period, us between runs from then on, 0: once
+**Output:   None
+**********************************************************/
+void RFM26_Sched_Add(RFM26_SCHED* s, RFM26_TASK* t, uint32_t now, uint32_t delay, uint32_t period);
+
+/**********************************************************
+**Name:     RFM26_Sched_Cancel
+**Function: Disarm a task, nothing if it is not armed
+**Input:    s, scheduler
+            t, task
+**Output:   None
+**********************************************************/
+void RFM26_Sched_Cancel(RFM26_SCHED* s, RFM26_TASK* t);
+
+/**********************************************************
+**Name:     RFM26_Sched_OnIrq
+**Function: Task run by RFM26_Sched_Run after an nIRQ edge
+**Input:    s, scheduler
+            t, task from RFM26_Sched_Task, 0: none
+**Output:   None
+**********************************************************/
+void RFM26_Sched_OnIrq(RFM26_SCHED* s, RFM26_TASK* t);
+
+/**********************************************************
+**Name:     RFM26_Sched_Irq
+**Function: Note an nIRQ edge, from the interrupt (the hook of
+            RFM26_SetIrqHook)
+**Input:    s, scheduler
+**Output:   None
+**********************************************************/
+void RFM26_Sched_Irq(RFM26_SCHED* s);
+
+/**********************************************************
+**Name:     RFM26_Sched_Run
+**Function: Run the nIRQ task if an edge came, then every task
+            due by now; call from loop()
+**Input:    s, scheduler
+            now, us
+**Output:   us to the next due task, 0 when an edge came
+            meanwhile, RFM26_SCHED_SLOTS ticks at most
+**********************************************************/
+uint32_t RFM26_Sched_Run(RFM26_SCHED* s, uint32_t now);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Sched_Sleep
+**Function: Idle the CPU to the next interrupt unless an nIRQ
+            edge is waiting; Timer0, the UART and nIRQ wake it
+**Input:    s, scheduler
+**Output:   None
+**********************************************************/
+void RFM26_Sched_Sleep(RFM26_SCHED* s);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
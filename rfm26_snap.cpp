@@ -0,0 +1,59 @@
+#include "rfm26_snap.h"
+#include "rfm26_config.h"
+
+/************************Description************************
+  Read back of the radio's property space.
+
+  RFM26_Snapshot in the driver walks the groups below with one
+  GET_PROPERTY per 16 properties, 22 commands and 434 SPI bytes
+  for all of them, 5ms at 1MHz, and hands each chunk to a sink
+  as it comes: nothing is held in RAM. The sketch
+  sends the chunks as C_TEL_PROPS records, host/prop_diff puts
+  them back together and compares them with the configuration
+  streams.
+
+  The groups are the ones the WDS table and the driver write,
+  each up to its last property on the Si4463.
+**********************************************************/
+
+static const uint8_t abSnap_Group[RFM26_SNAP_GROUPS][2] CFG_ROM = {
+  {0x00, 0x0A},                                           // GLOBAL
+  {0x01, 0x04},                                           // INT_CTL
+  {0x02, 0x04},                                           // FRR_CTL
+  {0x10, 0x0E},                                           // PREAMBLE
+  {0x11, 0x06},                                           // SYNC
+  {0x12, 0x35},                                           // PKT
+  {0x20, 0x60},                                           // MODEM
+  {0x21, 0x24},                                           // MODEM_CHFLT
+  {0x22, 0x07},                                           // PA
+  {0x23, 0x08},                                           // SYNTH
+  {0x30, 0x0C},                                           // MATCH
+  {0x40, 0x08},                                           // FREQ_CONTROL
+};
+
+void RFM26_Snap_Group(uint8_t i, uint8_t* group, uint8_t* count)
+{
+  *group = CFG_RD(&abSnap_Group[i][0]);
+  *count = CFG_RD(&abSnap_Group[i][1]);
+}
+
+void RFM26_Snap_Expect(const uint8_t* stream, uint8_t group, uint8_t start, uint8_t n, uint8_t* want,
+                       uint16_t* known)
+{
+  RFM26_CFG_RD r;
+  uint8_t cmd[RFM26_CFG_MAX_CMD];
+  uint8_t i, p;
+
+  RFM26_Cfg_Begin(&r, stream);
+  while (RFM26_Cfg_Next(&r, cmd)) {
+    if (cmd[0] != 0x11 || cmd[1] != group)                // SET_PROPERTY of this group only
+      continue;
+    for (i = 0; i < cmd[2]; i++) {
+      p = (uint8_t)(cmd[3] + i - start);
+      if (p < n) {
+        want[p] = cmd[4 + i];
+        *known |= (uint16_t)1 << p;
+      }
+    }
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef HopeDuino_26_SNAP_H_
+#define HopeDuino_26_SNAP_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define property space read back: groups, and the chunk one GET_PROPERTY returns
+#define RFM26_SNAP_GROUPS	12
+#define RFM26_SNAP_CHUNK	16
+
+//Chunk sink: n properties of group from start on
+typedef void (*RFM26_SNAP_SINK)(void* ctx, uint8_t group, uint8_t start, const uint8_t* v, uint8_t n);
+
+/**********************************************************
+**Name:     RFM26_Snap_Group
+**Function: A property group of the snapshot
+**Input:    i, 0..RFM26_SNAP_GROUPS-1
+            group, count, out
+**Output:   None
+**********************************************************/
+void RFM26_Snap_Group(uint8_t i, uint8_t* group, uint8_t* count);
+
+/**********************************************************
+**Name:     RFM26_Snap_Expect
+**Function: Values an encoded stream writes into a chunk; call
+            for the base stream, then the profile, later
+            writes win
+**Input:    stream, rfm26_config.h stream in program memory
+            group, start, n, the chunk, n up to 16
+            want, n values, set where the stream writes
+            known, bit i set for each want[i] set
+**Output:   None
+**********************************************************/
+void RFM26_Snap_Expect(const uint8_t* stream, uint8_t group, uint8_t start, uint8_t n, uint8_t* want,
+                       uint16_t* known);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,371 @@
+#include <string.h>
+#include "rfm26_tdma.h"
+#ifdef ARDUINO
+#include "rfm26_driver.h"
+#endif
+
+/************************Description************************
+  Beacon-synchronized TDMA on top of the RFM26 driver.
+
+  Superframe:  | beacon | slot 1 | slot 2 | ... | slot N-1 |
+  Slot:        | guard | preamble + sync + data | turnaround |
+
+  The coordinator stamps each beacon with the time it issues
+  START_TX, with the frame preloaded in the TX FIFO so the stamp
+  is exact. A node takes the PACKET_RX edge time (nIRQ capture),
+  subtracts the frame airtime and gets one (local, coordinator)
+  time pair per beacon. A second order loop tracks phase and
+  crystal drift, so a node keeps its slot across lost beacons.
+
+  Nothing waits for a slot: SendBeacon and SendInSlot preload
+  the FIFO and note the START_TX time, the sketch runs
+  RFM26_Tdma_StartTx from a task timed for it, e.g.
+    if (RFM26_Tdma_SendInSlot(&tdma, data) == 0)
+      RFM26_Sched_Add(&sched, &tx_task, micros(), tdma.tx_at - micros(), 0);
+
+  Beacon frame:
+  [0] RFM26_TDMA_BEACON  [1] seq  [2..5] START_TX time
+  [6] slots  [7..9] slot length us  [10..11] guard us
+
+  Slot frame:
+  [0] RFM26_TDMA_DATA  [1..20] payload
+**********************************************************/
+
+static void vTdma_Put32(uint8_t* p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v>>8);
+  p[2] = (uint8_t)(v>>16);
+  p[3] = (uint8_t)(v>>24);
+}
+
+static uint32_t lTdma_Get32(const uint8_t* p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24);
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_Init
+**Function: Initialize TDMA state
+**Input:    t, TDMA state
+            role, C_TDMA_NODE or C_TDMA_COORDINATOR
+            slots, slots per superframe, beacon included
+            my_slot, own slot (1..slots-1), 0 for coordinator
+            air_us, frame airtime at the rate set,
+            RFM26_Airtime(RFM26_TDMA_FRAME_LEN)
+**Output:   None
+**********************************************************/
+void RFM26_Tdma_Init(RFM26_TDMA* t, uint8_t role, uint8_t slots, uint8_t my_slot, uint32_t air_us)
+{
+  memset(t, 0, sizeof(RFM26_TDMA));
+  t->role = role;
+  t->slots = slots;
+  t->my_slot = my_slot;
+  t->air_us = air_us;
+  t->slot_us = air_us + RFM26_TDMA_GUARD_US + RFM26_TDMA_TURN_US;
+  t->guard_us = RFM26_TDMA_GUARD_US;
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_BuildBeacon
+**Function: Build a beacon for a given START_TX time
+**Input:    t, TDMA state
+            buf, RFM26_TDMA_FRAME_LEN bytes
+            tx_time, coordinator time of START_TX
+**Output:   frame length
+**********************************************************/
+uint8_t RFM26_Tdma_BuildBeacon(RFM26_TDMA* t, uint8_t* buf, uint32_t tx_time)
+{
+  memset(buf, 0, RFM26_TDMA_FRAME_LEN);
+  buf[0] = RFM26_TDMA_BEACON;
+  buf[1] = ++t->seq;
+  vTdma_Put32(&buf[2], tx_time);
+  buf[6] = t->slots;
+  buf[7] = (uint8_t)t->slot_us;
+  buf[8] = (uint8_t)(t->slot_us>>8);
+  buf[9] = (uint8_t)(t->slot_us>>16);
+  buf[10] = (uint8_t)t->guard_us;
+  buf[11] = (uint8_t)(t->guard_us>>8);
+
+  if (t->beacons)
+    t->slots_seen += t->slots - 1;                        // data slots of the superframe now closing
+  else
+    t->beacons = 1;
+  t->sf_start = tx_time;
+  return RFM26_TDMA_FRAME_LEN;
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_BuildData
+**Function: Build a slot frame, type byte and payload
+**Input:    buf, RFM26_TDMA_FRAME_LEN bytes
+            p_data, RFM26_TDMA_DATA_LEN bytes
+**Output:   frame length
+**********************************************************/
+uint8_t RFM26_Tdma_BuildData(uint8_t* buf, const uint8_t* p_data)
+{
+  buf[0] = RFM26_TDMA_DATA;
+  memcpy(&buf[1], p_data, RFM26_TDMA_DATA_LEN);
+  return RFM26_TDMA_FRAME_LEN;
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_OnBeacon
+**Function: Discipline the local clock to a received beacon
+**Input:    t, TDMA state
+            buf, received frame
+            rx_local, local time of the PACKET_RX edge
+**Output:   1 if the frame was a beacon, 0 for a slot frame or
+            a beacon with a schedule that cannot be followed
+**********************************************************/
+uint8_t RFM26_Tdma_OnBeacon(RFM26_TDMA* t, const uint8_t* buf, uint32_t rx_local)
+{
+  uint32_t coord, pred, slot_us;
+  int32_t dl, err;
+
+  if (buf[0] != RFM26_TDMA_BEACON)
+    return 0;
+  slot_us = (uint32_t)buf[7] | ((uint32_t)buf[8]<<8) | ((uint32_t)buf[9]<<16);
+  if (buf[6] < 2 || slot_us < t->air_us)
+    return 0;                                             // no data slot, or slots shorter than a frame
+  if (t->role == C_TDMA_COORDINATOR)
+    return 1;                                             // another coordinator, ignore
+
+  t->seq = buf[1];
+  t->sf_start = lTdma_Get32(&buf[2]);
+  t->slots = buf[6];
+  t->slot_us = slot_us;
+  t->guard_us = (uint16_t)buf[10] | ((uint16_t)buf[11]<<8);
+  coord = t->sf_start + t->air_us;                        // coordinator time at the PACKET_RX edge
+
+  if (t->beacons == 0) {
+    t->drift_q24 = 0;
+    t->last_err = 0;
+  } else {
+    dl = (int32_t)(rx_local - t->ref_local);
+    err = (int32_t)(coord - RFM26_Tdma_ToCoord(t, rx_local));
+    t->last_err = err;
+    if (dl > 0) {
+      // Frequency: take the first measurement whole, then 1/4 of the residual
+      if (t->beacons == 1)
+        t->drift_q24 += (int32_t)(((int64_t)err << 24) / dl);
+      else
+        t->drift_q24 += (int32_t)(((int64_t)err << 22) / dl);
+    }
+    // Phase: filter capture jitter once the drift estimate has settled
+    if (t->beacons >= 2) {
+      pred = RFM26_Tdma_ToCoord(t, rx_local);             // with the updated drift
+      coord = pred + (int32_t)(coord - pred)/2;
+    }
+  }
+  t->ref_local = rx_local;
+  t->ref_coord = coord;
+  t->missed = 0;
+  if (t->beacons != 0xFF)
+    t->beacons++;
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_Tick
+**Function: Count superframes whose beacon is overdue, the
+            clock runs on its drift estimate meanwhile
+**Input:    t, TDMA state
+            now_local, current local time
+**Output:   1 while still synchronized
+**********************************************************/
+uint8_t RFM26_Tdma_Tick(RFM26_TDMA* t, uint32_t now_local)
+{
+  uint32_t sf_us;
+  int32_t elapsed;
+
+  if (t->role == C_TDMA_NODE && t->beacons != 0) {
+    sf_us = (uint32_t)t->slots * t->slot_us;
+    elapsed = (int32_t)(RFM26_Tdma_ToCoord(t, now_local) - t->sf_start - t->air_us - t->slot_us/2);
+    if (elapsed > 0 && sf_us != 0)
+      t->missed = ((uint32_t)elapsed / sf_us > 0xFF) ? 0xFF : (uint8_t)((uint32_t)elapsed / sf_us);
+  }
+  return RFM26_Tdma_Synced(t);
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_Synced
+**Function: Check the clock can be used for slot timing
+**Input:    t, TDMA state
+**Output:   1 if synchronized
+**********************************************************/
+uint8_t RFM26_Tdma_Synced(const RFM26_TDMA* t)
+{
+  if (t->role == C_TDMA_COORDINATOR)
+    return 1;
+  return t->beacons >= 2 && t->missed < RFM26_TDMA_HOLDOVER;
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_ToCoord / RFM26_Tdma_ToLocal
+**Function: Convert between local and coordinator time
+**Input:    t, TDMA state
+            time, time in us
+**Output:   converted time in us
+**********************************************************/
+uint32_t RFM26_Tdma_ToCoord(const RFM26_TDMA* t, uint32_t local)
+{
+  int32_t dl = (int32_t)(local - t->ref_local);
+
+  return t->ref_coord + dl + (int32_t)(((int64_t)dl * t->drift_q24) >> 24);
+}
+
+uint32_t RFM26_Tdma_ToLocal(const RFM26_TDMA* t, uint32_t coord)
+{
+  int32_t dc = (int32_t)(coord - t->ref_coord);
+
+  return t->ref_local + dc - (int32_t)(((int64_t)dc * t->drift_q24) >> 24);
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_NextTx
+**Function: Local START_TX time of the next own slot
+**Input:    t, TDMA state
+            now_local, current local time
+            lead_us, minimum time left for FIFO preload
+**Output:   local time in us
+**********************************************************/
+uint32_t RFM26_Tdma_NextTx(const RFM26_TDMA* t, uint32_t now_local, uint32_t lead_us)
+{
+  uint32_t sf_us, first, k;
+  int32_t d;
+
+  sf_us = (uint32_t)t->slots * t->slot_us;
+  first = t->sf_start + (uint32_t)t->my_slot * t->slot_us + t->guard_us;
+  d = (int32_t)(RFM26_Tdma_ToCoord(t, now_local) + lead_us - first);
+  k = (d <= 0) ? 0 : ((uint32_t)d + sf_us - 1) / sf_us;
+  return RFM26_Tdma_ToLocal(t, first + k * sf_us);
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_OnSlotRx
+**Function: Coordinator, account a frame received in a slot
+**Input:    t, TDMA state
+            rx_coord, coordinator time of the PACKET_RX edge
+**Output:   slot number the frame arrived in
+**********************************************************/
+uint8_t RFM26_Tdma_OnSlotRx(RFM26_TDMA* t, uint32_t rx_coord)
+{
+  uint32_t sf_us;
+  int32_t pos, err;
+  uint8_t slot;
+
+  sf_us = (uint32_t)t->slots * t->slot_us;
+  pos = (int32_t)(rx_coord - t->air_us - t->guard_us - t->sf_start);   // START_TX vs ideal of slot 0
+  pos %= (int32_t)sf_us;
+  if (pos < 0)
+    pos += sf_us;
+  slot = (uint8_t)(((uint32_t)pos + t->slot_us/2) / t->slot_us);
+  err = pos - (int32_t)((uint32_t)slot * t->slot_us);
+  if (slot >= t->slots)
+    slot = 0;
+
+  t->slots_used++;
+  if (t->slots_used == 1 || err < t->slot_err_min)
+    t->slot_err_min = err;
+  if (t->slots_used == 1 || err > t->slot_err_max)
+    t->slot_err_max = err;
+  if (err > (int32_t)t->guard_us || -err > (int32_t)t->guard_us)
+    t->guard_violations++;
+  return slot;
+}
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Tdma_SendBeacon
+**Function: Coordinator, preload a beacon stamped with a
+            START_TX time RFM26_TDMA_LEAD_US ahead, t->tx_at;
+            a task run then calls RFM26_Tdma_StartTx
+**Input:    t, TDMA state
+**Output:   None
+**********************************************************/
+void RFM26_Tdma_SendBeacon(RFM26_TDMA* t)
+{
+  uint8_t buf[RFM26_TDMA_FRAME_LEN];
+
+  t->tx_at = time_us() + RFM26_TDMA_LEAD_US;
+  RFM26_Tdma_BuildBeacon(t, buf, t->tx_at);
+  RFM26_PreloadTx(buf, RFM26_TDMA_FRAME_LEN, RFM26_TDMA_FRAME_LEN);
+  t->tx_armed = 1;
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_SendInSlot
+**Function: Node, preload the TX FIFO if the own slot is due
+            within RFM26_TDMA_LEAD_US; a task run at t->tx_at
+            calls RFM26_Tdma_StartTx
+**Input:    t, TDMA state
+            p_data, RFM26_TDMA_DATA_LEN bytes
+**Output:   0 preloaded, 1 not synchronized, 2 slot not due
+            yet, 3 a frame still waits for START_TX
+**********************************************************/
+uint8_t RFM26_Tdma_SendInSlot(RFM26_TDMA* t, uint8_t* p_data)
+{
+  uint8_t buf[RFM26_TDMA_FRAME_LEN];
+  uint32_t now, tx;
+
+  if (t->tx_armed)
+    return 3;
+  now = time_us();
+  if (!RFM26_Tdma_Tick(t, now))
+    return 1;
+  tx = RFM26_Tdma_NextTx(t, now, 0);
+  if ((int32_t)(tx - now) > (int32_t)RFM26_TDMA_LEAD_US)
+    return 2;
+
+  RFM26_Tdma_BuildData(buf, p_data);
+  RFM26_PreloadTx(buf, RFM26_TDMA_FRAME_LEN, RFM26_TDMA_FRAME_LEN);
+  t->tx_at = tx;
+  t->tx_armed = 1;
+  return 0;
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_StartTx
+**Function: START_TX of the preloaded frame, back to Rx when
+            it is sent; from a task timed for t->tx_at
+**Input:    t, TDMA state
+**Output:   us START_TX came after t->tx_at, the beacon stamp
+            or slot error it adds; 0 with nothing preloaded
+**********************************************************/
+int32_t RFM26_Tdma_StartTx(RFM26_TDMA* t)
+{
+  if (!t->tx_armed)
+    return 0;
+  t->tx_armed = 0;
+  RFM26_Start_Tx(0x00, C_TXCOMPLETE_RX, RFM26_TDMA_FRAME_LEN);   // back to Rx for the next beacon or the data slots
+  return (int32_t)(time_us() - t->tx_at);
+}
+
+/**********************************************************
+**Name:     RFM26_Tdma_Receive
+**Function: receive_message() wrapper feeding beacons into
+            the clock and slot frames into the metrics
+**Input:    t, TDMA state
+            p_data, received payload, RFM26_TDMA_DATA_LEN bytes
+**Output:   payload length, 0 for none, a beacon or a frame of
+            another type
+**********************************************************/
+uint8_t RFM26_Tdma_Receive(RFM26_TDMA* t, uint8_t* p_data)
+{
+  uint8_t buf[RFM26_TDMA_FRAME_LEN];
+  uint32_t rx;
+
+  if (receive_message(buf) == 0)
+    return 0;
+  rx = RFM26_GetRxInfo()->irq_us;
+  if (RFM26_Tdma_OnBeacon(t, buf, rx))
+    return 0;
+  if (buf[0] != RFM26_TDMA_DATA)
+    return 0;                                             // not ours, or a beacon that was refused
+  if (t->role == C_TDMA_COORDINATOR)
+    RFM26_Tdma_OnSlotRx(t, rx);
+  memcpy(p_data, &buf[1], RFM26_TDMA_DATA_LEN);
+  return RFM26_TDMA_DATA_LEN;
+}
+#endif
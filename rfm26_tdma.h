@@ -0,0 +1,198 @@
+#ifndef HopeDuino_26_TDMA_H_
+#define HopeDuino_26_TDMA_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define TDMA frame layout, fixed RFM26_PKT_LEN frames, frame[0] is the type
+#define RFM26_TDMA_FRAME_LEN	21
+#define RFM26_TDMA_BEACON		0xBE						// frame[0] of a beacon
+#define RFM26_TDMA_DATA			0xDA						// frame[0] of a slot frame
+#define RFM26_TDMA_DATA_LEN		(RFM26_TDMA_FRAME_LEN-1)	// payload of a slot frame
+
+//Define default schedule, a slot is the frame airtime (RFM26_Airtime) + guard + turnaround,
+//120ms at 2.4Kbps
+#define RFM26_TDMA_GUARD_US		2000						// Tx starts this late into the slot
+#define RFM26_TDMA_TURN_US		14667						// Tx to Rx and the frame handled
+#define RFM26_TDMA_LEAD_US		4000						// FIFO preload ahead of the slot
+#define RFM26_TDMA_HOLDOVER		8							// superframes without beacon before unsync
+
+//Define role
+#define C_TDMA_NODE				0
+#define C_TDMA_COORDINATOR		1
+
+typedef struct
+{
+  // clock discipline, coordinator time = local time + phase + drift
+  uint32_t ref_local;                                     // local time of the last beacon
+  uint32_t ref_coord;                                     // coordinator time of the last beacon
+  int32_t  drift_q24;                                     // (coord rate / local rate - 1) * 2^24
+  int32_t  last_err;                                      // last beacon phase error, in us
+  uint8_t  beacons;                                       // beacons used, saturates
+  uint8_t  missed;                                        // superframes since last beacon
+  uint8_t  seq;                                           // beacon sequence
+
+  // schedule, slot 0 is the beacon
+  uint32_t air_us;                                        // frame on air, START_TX to PACKET_RX
+  uint32_t sf_start;                                      // coordinator time of the current superframe
+  uint32_t slot_us;
+  uint16_t guard_us;
+  uint8_t  slots;
+  uint8_t  my_slot;
+  uint8_t  role;
+
+  // Tx preloaded, START_TX left to RFM26_Tdma_StartTx
+  uint32_t tx_at;                                         // local time START_TX is due
+  uint8_t  tx_armed;
+
+  // metrics
+  uint32_t slots_seen;                                    // data slots elapsed, coordinator
+  uint32_t slots_used;                                    // data slots with a frame, coordinator
+  int32_t  slot_err_min;                                  // arrival error vs slot start + guard, in us
+  int32_t  slot_err_max;
+  uint16_t guard_violations;                              // |arrival error| beyond guard
+} RFM26_TDMA;
+
+/**********************************************************
+**Name:     RFM26_Tdma_Init
+**Function: Initialize TDMA state
+**Input:    t, TDMA state
+            role, C_TDMA_NODE or C_TDMA_COORDINATOR
+            slots, slots per superframe, beacon included
+            my_slot, own slot (1..slots-1), 0 for coordinator
+            air_us, frame airtime at the rate set,
+            RFM26_Airtime(RFM26_TDMA_FRAME_LEN)
+**Output:   None
+**********************************************************/
+void RFM26_Tdma_Init(RFM26_TDMA* t, uint8_t role, uint8_t slots, uint8_t my_slot, uint32_t air_us);
+
+/**********************************************************
+**Name:     RFM26_Tdma_BuildBeacon
+**Function: Build a beacon for a given START_TX time
+**Input:    t, TDMA state
+            buf, RFM26_TDMA_FRAME_LEN bytes
+            tx_time, coordinator time of START_TX
+**Output:   frame length
+**********************************************************/
+uint8_t RFM26_Tdma_BuildBeacon(RFM26_TDMA* t, uint8_t* buf, uint32_t tx_time);
+
+/**********************************************************
+**Name:     RFM26_Tdma_BuildData
+**Function: Build a slot frame, type byte and payload
+**Input:    buf, RFM26_TDMA_FRAME_LEN bytes
+            p_data, RFM26_TDMA_DATA_LEN bytes
+**Output:   frame length
+**********************************************************/
+uint8_t RFM26_Tdma_BuildData(uint8_t* buf, const uint8_t* p_data);
+
+/**********************************************************
+**Name:     RFM26_Tdma_OnBeacon
+**Function: Discipline the local clock to a received beacon
+**Input:    t, TDMA state
+            buf, received frame
+            rx_local, local time of the PACKET_RX edge
+**Output:   1 if the frame was a beacon, 0 for a slot frame or
+            a beacon with a schedule that cannot be followed
+**********************************************************/
+uint8_t RFM26_Tdma_OnBeacon(RFM26_TDMA* t, const uint8_t* buf, uint32_t rx_local);
+
+/**********************************************************
+**Name:     RFM26_Tdma_Tick
+**Function: Count superframes whose beacon is overdue, the
+            clock runs on its drift estimate meanwhile
+**Input:    t, TDMA state
+            now_local, current local time
+**Output:   1 while still synchronized
+**********************************************************/
+uint8_t RFM26_Tdma_Tick(RFM26_TDMA* t, uint32_t now_local);
+
+/**********************************************************
+**Name:     RFM26_Tdma_Synced
+**Function: Check the clock can be used for slot timing
+**Input:    t, TDMA state
+**Output:   1 if synchronized
+**********************************************************/
+uint8_t RFM26_Tdma_Synced(const RFM26_TDMA* t);
+
+/**********************************************************
+**Name:     RFM26_Tdma_ToCoord / RFM26_Tdma_ToLocal
+**Function: Convert between local and coordinator time
+**Input:    t, TDMA state
+            time, time in us
+**Output:   converted time in us
+**********************************************************/
+uint32_t RFM26_Tdma_ToCoord(const RFM26_TDMA* t, uint32_t local);
+uint32_t RFM26_Tdma_ToLocal(const RFM26_TDMA* t, uint32_t coord);
+
+/**********************************************************
+**Name:     RFM26_Tdma_NextTx
+**Function: Local START_TX time of the next own slot
+**Input:    t, TDMA state
+            now_local, current local time
+            lead_us, minimum time left for FIFO preload
+**Output:   local time in us
+**********************************************************/
+uint32_t RFM26_Tdma_NextTx(const RFM26_TDMA* t, uint32_t now_local, uint32_t lead_us);
+
+/**********************************************************
+**Name:     RFM26_Tdma_OnSlotRx
+**Function: Coordinator, account a frame received in a slot
+**Input:    t, TDMA state
+            rx_coord, coordinator time of the PACKET_RX edge
+**Output:   slot number the frame arrived in
+**********************************************************/
+uint8_t RFM26_Tdma_OnSlotRx(RFM26_TDMA* t, uint32_t rx_coord);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Tdma_SendBeacon
+**Function: Coordinator, preload a beacon stamped with a
+            START_TX time RFM26_TDMA_LEAD_US ahead, t->tx_at;
+            a task run then calls RFM26_Tdma_StartTx
+**Input:    t, TDMA state
+**Output:   None
+**********************************************************/
+void RFM26_Tdma_SendBeacon(RFM26_TDMA* t);
+
+/**********************************************************
+**Name:     RFM26_Tdma_SendInSlot
+**Function: Node, preload the TX FIFO if the own slot is due
+            within RFM26_TDMA_LEAD_US; a task run at t->tx_at
+            calls RFM26_Tdma_StartTx
+**Input:    t, TDMA state
+            p_data, RFM26_TDMA_DATA_LEN bytes
+**Output:   0 preloaded, 1 not synchronized, 2 slot not due
+            yet, 3 a frame still waits for START_TX
+**********************************************************/
+uint8_t RFM26_Tdma_SendInSlot(RFM26_TDMA* t, uint8_t* p_data);
+
+/**********************************************************
+**Name:     RFM26_Tdma_StartTx
+**Function: START_TX of the preloaded frame, back to Rx when
+            it is sent; from a task timed for t->tx_at
+**Input:    t, TDMA state
+**Output:   us START_TX came after t->tx_at, the beacon stamp
+            or slot error it adds; 0 with nothing preloaded
+**********************************************************/
+int32_t RFM26_Tdma_StartTx(RFM26_TDMA* t);
+
+/**********************************************************
+**Name:     RFM26_Tdma_Receive
+**Function: receive_message() wrapper feeding beacons into
+            the clock and slot frames into the metrics
+**Input:    t, TDMA state
+            p_data, received payload, RFM26_TDMA_DATA_LEN bytes
+**Output:   payload length, 0 for none, a beacon or a frame of
+            another type
+**********************************************************/
+uint8_t RFM26_Tdma_Receive(RFM26_TDMA* t, uint8_t* p_data);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#include <string.h>
+#include "rfm26_telem.h"
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+/************************Description************************
+  Binary telemetry over the UART without blocking loop().
+
+  Serial.print waits once the core's 64 byte Tx buffer is full,
+  and a line per packet at 115200 baud outlasts a short frame.
+  Here a record is COBS encoded straight into a RAM ring when
+  it is made, and RFM26_Tel_Flush passes on only what the UART
+  has room for. A record that does not fit is dropped whole and
+  counted; the sequence number counts dropped records too, so
+  the host sees every gap.
+
+  On the wire each record is COBS(type, seq, t_ms, payload,
+  check) followed by 0x00. No record is 254 bytes long, so the
+  encoding adds exactly one byte, and a reader that starts mid
+  stream is in step after the next 0x00.
+**********************************************************/
+
+#define C_TEL_MASK		(RFM26_TEL_RING - 1)
+
+static uint16_t wTel_Used(const RFM26_TELEM* t)
+{
+  return (uint16_t)(t->head - t->tail);
+}
+
+void RFM26_Tel_Init(RFM26_TELEM* t)
+{
+  memset(t, 0, sizeof(*t));
+  t->head = 1;                                            // a 0x00 first ends whatever the host had before boot
+}
+
+/**********************************************************
+**Name:     vTel_Byte
+**Function: COBS encode one byte at the ring head; the code
+            byte of the current block is filled in when the
+            block ends
+**********************************************************/
+static void vTel_Byte(RFM26_TELEM* t, uint8_t b, uint16_t* code_at, uint8_t* code)
+{
+  if (b == 0) {
+    t->ring[*code_at & C_TEL_MASK] = *code;
+    *code_at = t->head++;
+    *code = 1;
+  } else {
+    t->ring[t->head++ & C_TEL_MASK] = b;
+    (*code)++;
+  }
+}
+
+uint8_t RFM26_Tel_Put(RFM26_TELEM* t, uint8_t type, uint32_t t_ms, const uint8_t* p, uint8_t n)
+{
+  uint8_t h[RFM26_TEL_HDR];
+  uint8_t i, sum = 0, code = 1;
+  uint16_t code_at;
+
+  h[0] = type;
+  h[1] = t->seq++;
+  h[2] = (uint8_t)t_ms;
+  h[3] = (uint8_t)(t_ms >> 8);
+  h[4] = (uint8_t)(t_ms >> 16);
+  h[5] = (uint8_t)(t_ms >> 24);
+  if (n > RFM26_TEL_MAX_DATA || RFM26_Tel_Room(t) < RFM26_TEL_HDR + n + 3) {
+    t->dropped++;
+    return 0;
+  }
+  code_at = t->head++;
+  for (i = 0; i < RFM26_TEL_HDR; i++) {
+    sum += h[i];
+    vTel_Byte(t, h[i], &code_at, &code);
+  }
+  for (i = 0; i < n; i++) {
+    sum += p[i];
+    vTel_Byte(t, p[i], &code_at, &code);
+  }
+  vTel_Byte(t, ~sum, &code_at, &code);
+  t->ring[code_at & C_TEL_MASK] = code;
+  t->ring[t->head++ & C_TEL_MASK] = 0;
+  t->records++;
+  if (wTel_Used(t) > t->high)
+    t->high = wTel_Used(t);
+  return 1;
+}
+
+uint8_t RFM26_Tel_Stats(RFM26_TELEM* t, uint32_t t_ms)
+{
+  uint8_t p[10];
+
+  p[0] = (uint8_t)t->records;
+  p[1] = (uint8_t)(t->records >> 8);
+  p[2] = (uint8_t)(t->records >> 16);
+  p[3] = (uint8_t)(t->records >> 24);
+  p[4] = (uint8_t)t->dropped;
+  p[5] = (uint8_t)(t->dropped >> 8);
+  p[6] = (uint8_t)(t->dropped >> 16);
+  p[7] = (uint8_t)(t->dropped >> 24);
+  p[8] = (uint8_t)t->high;
+  p[9] = (uint8_t)(t->high >> 8);
+  return RFM26_Tel_Put(t, C_TEL_STATS, t_ms, p, sizeof(p));
+}
+
+uint16_t RFM26_Tel_Room(const RFM26_TELEM* t)
+{
+  return (uint16_t)(RFM26_TEL_RING - wTel_Used(t));
+}
+
+uint16_t RFM26_Tel_Take(RFM26_TELEM* t, uint8_t* out, uint16_t max)
+{
+  uint16_t n = 0;
+
+  while (n < max && t->tail != t->head)
+    out[n++] = t->ring[t->tail++ & C_TEL_MASK];
+  return n;
+}
+
+uint8_t RFM26_Tel_Decode(const uint8_t* in, uint16_t n, uint8_t* buf, RFM26_TEL_REC* r)
+{
+  uint16_t i = 0, len = 0;
+  uint8_t code, k, sum = 0;
+
+  while (i < n) {
+    code = in[i++];
+    if (code == 0 || i + code - 1 > n || len + code - 1 > RFM26_TEL_MAX_RAW)
+      return 0;
+    for (k = 1; k < code; k++)
+      buf[len++] = in[i++];
+    if (i < n) {
+      if (len == RFM26_TEL_MAX_RAW)
+        return 0;
+      buf[len++] = 0;                                     // a block ended before the record: a zero was there
+    }
+  }
+  if (len < RFM26_TEL_HDR + 1)
+    return 0;
+  for (i = 0; i < len; i++)
+    sum += buf[i];
+  if (sum != 0xFF)                                        // payload sum plus its complement
+    return 0;
+  r->type = buf[0];
+  r->seq = buf[1];
+  r->t_ms = (uint32_t)buf[2] | (uint32_t)buf[3] << 8 | (uint32_t)buf[4] << 16 | (uint32_t)buf[5] << 24;
+  r->len = (uint8_t)(len - RFM26_TEL_HDR - 1);
+  r->data = buf + RFM26_TEL_HDR;
+  return 1;
+}
+
+#ifdef ARDUINO
+uint16_t RFM26_Tel_Flush(RFM26_TELEM* t)
+{
+  int room = Serial.availableForWrite();
+  uint16_t n, run;
+
+  n = wTel_Used(t);
+  if (room <= 0 || n == 0)
+    return 0;
+  if (n > (uint16_t)room)
+    n = (uint16_t)room;
+  run = RFM26_TEL_RING - (t->tail & C_TEL_MASK);          // up to the end of the ring
+  if (n > run)
+    n = run;
+  Serial.write(t->ring + (t->tail & C_TEL_MASK), n);
+  t->tail += n;
+  return n;
+}
+#endif
@@ -0,0 +1,120 @@
+#ifndef HopeDuino_26_TELEM_H_
+#define HopeDuino_26_TELEM_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define ring size, a power of two; at 115200 baud 256 bytes take 22ms to drain
+#define RFM26_TEL_RING		256
+#define RFM26_TEL_MAX_DATA	40							// record payload, keeps a record under 254 bytes
+#define RFM26_TEL_HDR		6							// type, seq, t_ms (4, little endian)
+#define RFM26_TEL_MAX_RAW	(RFM26_TEL_HDR + RFM26_TEL_MAX_DATA + 1)	// + check byte
+#define RFM26_TEL_MAX_WIRE	(RFM26_TEL_MAX_RAW + 2)		// COBS code byte and 0x00 delimiter
+
+//Define record types written by rfm26.cpp, payload integers little endian
+#define C_TEL_BOOT			0x01						// mode
+#define C_TEL_RX			0x02						// cnt (2), rssi, frame
+#define C_TEL_TX			0x03						// cnt (2)
+#define C_TEL_ACK			0x04						// cnt (2), round trip us (4)
+#define C_TEL_NOACK			0x05						// cnt (2)
+#define C_TEL_STATS			0x06						// records (4), dropped (4), ring high water (2)
+#define C_TEL_PROPS			0x07						// group, start, property values (up to 16)
+
+typedef struct
+{
+  uint8_t  ring[RFM26_TEL_RING];                          // COBS encoded records, each ended by 0x00
+  uint16_t head;                                          // free running, masked on access
+  uint16_t tail;
+  uint8_t  seq;                                           // counts every record, dropped ones too
+  uint32_t records;
+  uint32_t dropped;                                       // no room in the ring
+  uint16_t high;                                          // most bytes ever queued
+} RFM26_TELEM;
+
+//Record as decoded
+typedef struct
+{
+  uint8_t  type;
+  uint8_t  seq;
+  uint32_t t_ms;
+  uint8_t  len;
+  const uint8_t* data;                                    // points into the decode buffer
+} RFM26_TEL_REC;
+
+/**********************************************************
+**Name:     RFM26_Tel_Init
+**Function: Empty telemetry ring, a delimiter queued first
+**Input:    t, telemetry
+**Output:   None
+**********************************************************/
+void RFM26_Tel_Init(RFM26_TELEM* t);
+
+/**********************************************************
+**Name:     RFM26_Tel_Put
+**Function: Encode one record into the ring, or drop it whole
+            when it does not fit; never waits for the UART
+**Input:    t, telemetry
+            type, C_TEL_xxx
+            t_ms, time of the record
+            p, n, payload, n up to RFM26_TEL_MAX_DATA
+**Output:   1 queued, 0 dropped
+**********************************************************/
+uint8_t RFM26_Tel_Put(RFM26_TELEM* t, uint8_t type, uint32_t t_ms, const uint8_t* p, uint8_t n);
+
+/**********************************************************
+**Name:     RFM26_Tel_Stats
+**Function: Put a C_TEL_STATS record with the ring counters
+**Input:    t, telemetry
+            t_ms, time of the record
+**Output:   1 queued, 0 dropped
+**********************************************************/
+uint8_t RFM26_Tel_Stats(RFM26_TELEM* t, uint32_t t_ms);
+
+/**********************************************************
+**Name:     RFM26_Tel_Room
+**Function: Bytes free in the ring
+**Input:    t, telemetry
+**Output:   free bytes, a record of n payload bytes needs
+            RFM26_TEL_HDR + n + 3
+**********************************************************/
+uint16_t RFM26_Tel_Room(const RFM26_TELEM* t);
+
+/**********************************************************
+**Name:     RFM26_Tel_Take
+**Function: Move queued bytes out of the ring
+**Input:    t, telemetry
+            out, buffer
+            max, room in out
+**Output:   bytes moved
+**********************************************************/
+uint16_t RFM26_Tel_Take(RFM26_TELEM* t, uint8_t* out, uint16_t max);
+
+/**********************************************************
+**Name:     RFM26_Tel_Decode
+**Function: One record from the bytes between two delimiters
+**Input:    in, n, COBS bytes without the 0x00
+            buf, RFM26_TEL_MAX_RAW bytes for the decoded record
+            r, record out
+**Output:   1 if the record is whole and its check byte right
+**********************************************************/
+uint8_t RFM26_Tel_Decode(const uint8_t* in, uint16_t n, uint8_t* buf, RFM26_TEL_REC* r);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_Tel_Flush
+**Function: Hand Serial what its Tx buffer has room for, call
+            from loop()
+**Input:    t, telemetry
+**Output:   bytes written
+**********************************************************/
+uint16_t RFM26_Tel_Flush(RFM26_TELEM* t);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,199 @@
+#include <string.h>
+#include "rfm26_txq.h"
+#ifdef ARDUINO
+#include "rfm26_driver.h"
+#endif
+
+/************************Description************************
+  Tx queue with traffic classes and per frame deadlines, in
+  front of send_message().
+
+  Frames are copied into a fixed pool of RFM26_TXQ_DEPTH
+  entries. The next frame on air is the one with the earliest
+  deadline (EDF); alarms get short default deadlines, so they
+  go ahead of a bulk upload already queued, and wait at most
+  for the frame on air. A frame that cannot be off air before
+  its deadline is dropped instead of sent late.
+
+  Memory is bounded per class: bulk may take all but 4 entries
+  and control all but 2, so an upload cannot lock out alarms.
+  When the pool is full a more urgent frame evicts the least
+  urgent frame of a less urgent class.
+**********************************************************/
+
+static const uint32_t RFM26TxqDeadline[RFM26_TXQ_CLASSES] = {
+  RFM26_TXQ_DL_ALARM, RFM26_TXQ_DL_CONTROL, RFM26_TXQ_DL_BULK,
+};
+
+static void vTxq_Free(RFM26_TXQ* q, uint8_t i)
+{
+  q->used &= ~(1UL << i);
+  q->count[q->e[i].cls]--;
+}
+
+/**********************************************************
+**Name:     RFM26_TxQ_Init
+**Function: Empty queue, bulk may hold all but 4 entries and
+            control all but 2, alarms all
+**Input:    q, queue
+            air_ms, airtime of one frame
+**Output:   None
+**********************************************************/
+void RFM26_TxQ_Init(RFM26_TXQ* q, uint16_t air_ms)
+{
+  memset(q, 0, sizeof(*q));
+  q->air_ms = air_ms;
+  q->cap[C_TXQ_ALARM] = RFM26_TXQ_DEPTH;
+  q->cap[C_TXQ_CONTROL] = RFM26_TXQ_DEPTH - 2;
+  q->cap[C_TXQ_BULK] = RFM26_TXQ_DEPTH - 4;
+}
+
+/**********************************************************
+**Name:     RFM26_TxQ_Push
+**Function: Queue a frame; when the queue or the class is full
+            the least urgent frame of a less urgent class makes
+            room, else the frame is dropped
+**Input:    q, queue
+            cls, C_TXQ_xxx
+            data, frame
+            len, 1..RFM26_TXQ_FRAME_LEN
+            deadline_ms, relative, 0 for the class default
+            now_ms, time in ms
+**Output:   1 queued, 0 dropped
+**********************************************************/
+uint8_t RFM26_TxQ_Push(RFM26_TXQ* q, uint8_t cls, const uint8_t* data, uint8_t len, uint32_t deadline_ms, uint32_t now_ms)
+{
+  uint8_t i, victim = 0xFF;
+  RFM26_TXQ_ENTRY* e;
+
+  if (cls >= RFM26_TXQ_CLASSES || len == 0 || len > RFM26_TXQ_FRAME_LEN)
+    return 0;
+  RFM26_TxQ_Expire(q, now_ms);                            // Stale frames don't hold room
+  if (q->count[cls] >= q->cap[cls]) {
+    q->stats[cls].dropped++;
+    return 0;
+  }
+  if (RFM26_TxQ_Pending(q) >= RFM26_TXQ_DEPTH) {
+    for (i = 0; i < RFM26_TXQ_DEPTH; i++) {
+      e = &q->e[i];
+      if (e->cls <= cls)
+        continue;
+      if (victim == 0xFF || e->cls > q->e[victim].cls ||
+          (e->cls == q->e[victim].cls && (int32_t)(e->deadline - q->e[victim].deadline) > 0))
+        victim = i;
+    }
+    if (victim == 0xFF) {
+      q->stats[cls].dropped++;
+      return 0;
+    }
+    q->stats[q->e[victim].cls].evicted++;
+    vTxq_Free(q, victim);
+  }
+
+  for (i = 0; q->used & (1UL << i); i++);
+  e = &q->e[i];
+  e->cls = cls;
+  e->len = len;
+  e->enq = now_ms;
+  e->deadline = now_ms + (deadline_ms ? deadline_ms : RFM26TxqDeadline[cls]);
+  memcpy(e->data, data, len);
+  memset(e->data + len, 0, RFM26_TXQ_FRAME_LEN - len);
+  q->used |= 1UL << i;
+  q->count[cls]++;
+  q->stats[cls].queued++;
+  return 1;
+}
+
+/**********************************************************
+**Name:     RFM26_TxQ_Expire
+**Function: Drop frames that can no longer be off air before
+            their deadline
+**Input:    q, queue
+            now_ms, time in ms
+**Output:   frames dropped
+**********************************************************/
+uint8_t RFM26_TxQ_Expire(RFM26_TXQ* q, uint32_t now_ms)
+{
+  uint8_t i, n = 0;
+
+  for (i = 0; i < RFM26_TXQ_DEPTH; i++)
+    if ((q->used & (1UL << i)) && (int32_t)(q->e[i].deadline - now_ms) < (int32_t)q->air_ms) {
+      q->stats[q->e[i].cls].expired++;
+      vTxq_Free(q, i);
+      n++;
+    }
+  return n;
+}
+
+/**********************************************************
+**Name:     RFM26_TxQ_Pop
+**Function: Expire, then take the frame with the earliest
+            deadline, the more urgent class on a tie
+**Input:    q, queue
+            now_ms, time in ms
+            data, RFM26_TXQ_FRAME_LEN bytes out
+            cls, class out, may be 0
+**Output:   frame length, 0 if nothing is left to send
+**********************************************************/
+uint8_t RFM26_TxQ_Pop(RFM26_TXQ* q, uint32_t now_ms, uint8_t* data, uint8_t* cls)
+{
+  uint8_t i, best = 0xFF;
+  int32_t slack, best_slack = 0;
+  RFM26_TXQ_ENTRY* e;
+
+  RFM26_TxQ_Expire(q, now_ms);
+  for (i = 0; i < RFM26_TXQ_DEPTH; i++) {
+    if (!(q->used & (1UL << i)))
+      continue;
+    slack = (int32_t)(q->e[i].deadline - now_ms);
+    if (best == 0xFF || slack < best_slack || (slack == best_slack && q->e[i].cls < q->e[best].cls)) {
+      best = i;
+      best_slack = slack;
+    }
+  }
+  if (best == 0xFF)
+    return 0;
+  e = &q->e[best];
+  memcpy(data, e->data, RFM26_TXQ_FRAME_LEN);
+  if (cls)
+    *cls = e->cls;
+  q->stats[e->cls].sent++;
+  vTxq_Free(q, best);
+  return e->len;
+}
+
+/**********************************************************
+**Name:     RFM26_TxQ_Pending
+**Function: Frames queued
+**Input:    q, queue
+**Output:   count
+**********************************************************/
+uint8_t RFM26_TxQ_Pending(const RFM26_TXQ* q)
+{
+  uint8_t i, n = 0;
+
+  for (i = 0; i < RFM26_TXQ_CLASSES; i++)
+    n += q->count[i];
+  return n;
+}
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_TxQ_Service
+**Function: send_message() the next frame when the radio is
+            not transmitting, call from loop()
+**Input:    q, queue
+**Output:   1 if a frame was started
+**********************************************************/
+uint8_t RFM26_TxQ_Service(RFM26_TXQ* q)
+{
+  uint8_t frame[RFM26_TXQ_FRAME_LEN];
+
+  if (RFM26_TxQ_Pending(q) == 0 || RFM26_GetState() == C_STATE_TX)
+    return 0;
+  if (RFM26_TxQ_Pop(q, millis(), frame, 0) == 0)
+    return 0;                                             // Everything left had expired
+  send_message(frame, RFM26_TXQ_FRAME_LEN);
+  return 1;
+}
+#endif
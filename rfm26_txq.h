@@ -0,0 +1,123 @@
+#ifndef HopeDuino_26_TXQ_H_
+#define HopeDuino_26_TXQ_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Define Tx queue size, frames are copied in, RAM is RFM26_TXQ_DEPTH * (RFM26_TXQ_FRAME_LEN + 10)
+#define RFM26_TXQ_DEPTH			16							// at most 32
+#define RFM26_TXQ_FRAME_LEN		21							// RFM26_PKT_LEN
+
+//Define traffic classes, lower is more urgent
+#define C_TXQ_ALARM			0
+#define C_TXQ_CONTROL		1
+#define C_TXQ_BULK			2
+#define RFM26_TXQ_CLASSES	3
+
+//Define default relative deadlines per class, in ms
+#define RFM26_TXQ_DL_ALARM		500
+#define RFM26_TXQ_DL_CONTROL	2000
+#define RFM26_TXQ_DL_BULK		60000
+
+typedef struct
+{
+  uint32_t queued;
+  uint32_t sent;
+  uint32_t expired;                                       // deadline passed before airtime, never sent
+  uint32_t dropped;                                       // no room at push
+  uint32_t evicted;                                       // pushed out by a more urgent class
+} RFM26_TXQ_STATS;
+
+typedef struct
+{
+  uint32_t deadline;                                      // ms, the frame must be off air by then
+  uint32_t enq;                                           // ms, push time
+  uint8_t  cls;
+  uint8_t  len;
+  uint8_t  data[RFM26_TXQ_FRAME_LEN];
+} RFM26_TXQ_ENTRY;
+
+typedef struct
+{
+  RFM26_TXQ_ENTRY e[RFM26_TXQ_DEPTH];
+  uint32_t used;                                          // bit per entry
+  uint16_t air_ms;                                        // airtime of one frame, for the expiry test
+  uint8_t  cap[RFM26_TXQ_CLASSES];                        // entries one class may hold
+  uint8_t  count[RFM26_TXQ_CLASSES];
+  RFM26_TXQ_STATS stats[RFM26_TXQ_CLASSES];
+} RFM26_TXQ;
+
+/**********************************************************
+**Name:     RFM26_TxQ_Init
+**Function: Empty queue, bulk may hold all but 4 entries and
+            control all but 2, alarms all
+**Input:    q, queue
+            air_ms, airtime of one frame
+**Output:   None
+**********************************************************/
+void RFM26_TxQ_Init(RFM26_TXQ* q, uint16_t air_ms);
+
+/**********************************************************
+**Name:     RFM26_TxQ_Push
+**Function: Queue a frame; when the queue or the class is full
+            the least urgent frame of a less urgent class makes
+            room, else the frame is dropped
+**Input:    q, queue
+            cls, C_TXQ_xxx
+            data, frame
+            len, 1..RFM26_TXQ_FRAME_LEN
+            deadline_ms, relative, 0 for the class default
+            now_ms, time in ms
+**Output:   1 queued, 0 dropped
+**********************************************************/
+uint8_t RFM26_TxQ_Push(RFM26_TXQ* q, uint8_t cls, const uint8_t* data, uint8_t len, uint32_t deadline_ms, uint32_t now_ms);
+
+/**********************************************************
+**Name:     RFM26_TxQ_Expire
+**Function: Drop frames that can no longer be off air before
+            their deadline
+**Input:    q, queue
+            now_ms, time in ms
+**Output:   frames dropped
+**********************************************************/
+uint8_t RFM26_TxQ_Expire(RFM26_TXQ* q, uint32_t now_ms);
+
+/**********************************************************
+**Name:     RFM26_TxQ_Pop
+**Function: Expire, then take the frame with the earliest
+            deadline, the more urgent class on a tie
+**Input:    q, queue
+            now_ms, time in ms
+            data, RFM26_TXQ_FRAME_LEN bytes out
+            cls, class out, may be 0
+**Output:   frame length, 0 if nothing is left to send
+**********************************************************/
+uint8_t RFM26_TxQ_Pop(RFM26_TXQ* q, uint32_t now_ms, uint8_t* data, uint8_t* cls);
+
+/**********************************************************
+**Name:     RFM26_TxQ_Pending
+**Function: Frames queued
+**Input:    q, queue
+**Output:   count
+**********************************************************/
+uint8_t RFM26_TxQ_Pending(const RFM26_TXQ* q);
+
+#ifdef ARDUINO
+/**********************************************************
+**Name:     RFM26_TxQ_Service
+**Function: send_message() the next frame when the radio is
+            not transmitting, call from loop()
+**Input:    q, queue
+**Output:   1 if a frame was started
+**********************************************************/
+uint8_t RFM26_TxQ_Service(RFM26_TXQ* q);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif